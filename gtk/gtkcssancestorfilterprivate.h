@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2018 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_CSS_ANCESTOR_FILTER_PRIVATE_H__
+#define __GTK_CSS_ANCESTOR_FILTER_PRIVATE_H__
+
+#include <string.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* A Bloom filter of the names, ids and style classes of all ancestors
+ * of a node. If it doesn't contain a name, no ancestor has that name,
+ * so selectors like "name child" can be rejected without looking at
+ * the ancestors. It may contain names no ancestor has.
+ */
+#define GTK_CSS_ANCESTOR_FILTER_BITS 256
+
+typedef struct _GtkCssAncestorFilter GtkCssAncestorFilter;
+
+struct _GtkCssAncestorFilter {
+  guint32 bits[GTK_CSS_ANCESTOR_FILTER_BITS / 32];
+};
+
+/* Fibonacci hashing, the top bits are well distributed */
+#define GTK_CSS_ANCESTOR_FILTER_HASH(value, kind) \
+  ((guint32) ((((guint32) (value)) ^ (kind)) * 2654435769U))
+
+static inline guint32
+gtk_css_ancestor_filter_hash_name (/*interned*/ const char *name)
+{
+  return GTK_CSS_ANCESTOR_FILTER_HASH (GPOINTER_TO_SIZE (name) >> 3, 0x6e616d65);
+}
+
+static inline guint32
+gtk_css_ancestor_filter_hash_id (/*interned*/ const char *id)
+{
+  return GTK_CSS_ANCESTOR_FILTER_HASH (GPOINTER_TO_SIZE (id) >> 3, 0x69642020);
+}
+
+static inline guint32
+gtk_css_ancestor_filter_hash_class (GQuark style_class)
+{
+  return GTK_CSS_ANCESTOR_FILTER_HASH (style_class, 0x636c6173);
+}
+
+static inline void
+gtk_css_ancestor_filter_init (GtkCssAncestorFilter *filter)
+{
+  memset (filter, 0, sizeof (GtkCssAncestorFilter));
+}
+
+static inline void
+gtk_css_ancestor_filter_union (GtkCssAncestorFilter       *filter,
+                               const GtkCssAncestorFilter *other)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (filter->bits); i++)
+    filter->bits[i] |= other->bits[i];
+}
+
+/* Each hash sets two bits, taken from the top 16 bits of the hash */
+static inline void
+gtk_css_ancestor_filter_add (GtkCssAncestorFilter *filter,
+                             guint32               hash)
+{
+  guint bit1 = hash >> 24;
+  guint bit2 = (hash >> 16) & 0xff;
+
+  filter->bits[bit1 / 32] |= 1U << (bit1 % 32);
+  filter->bits[bit2 / 32] |= 1U << (bit2 % 32);
+}
+
+static inline gboolean
+gtk_css_ancestor_filter_may_contain (const GtkCssAncestorFilter *filter,
+                                     guint32                     hash)
+{
+  guint bit1 = hash >> 24;
+  guint bit2 = (hash >> 16) & 0xff;
+
+  return (filter->bits[bit1 / 32] & (1U << (bit1 % 32))) &&
+         (filter->bits[bit2 / 32] & (1U << (bit2 % 32)));
+}
+
+G_END_DECLS
+
+#endif /* __GTK_CSS_ANCESTOR_FILTER_PRIVATE_H__ */
@@ -327,6 +327,16 @@ _gtk_css_matcher_node_init (GtkCssMatcher *matcher,
   matcher->node.node = node;
 }
 
+/* Only nodes know all their ancestors up front */
+const GtkCssAncestorFilter *
+_gtk_css_matcher_get_ancestor_filter (const GtkCssMatcher *matcher)
+{
+  if (matcher->klass != &GTK_CSS_MATCHER_NODE)
+    return NULL;
+
+  return gtk_css_node_get_ancestor_filter (matcher->node.node);
+}
+
 /* GTK_CSS_MATCHER_WIDGET_ANY */
 
 static gboolean
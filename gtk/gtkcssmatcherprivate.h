@@ -20,6 +20,7 @@
 
 #include <gtk/gtkenums.h>
 #include <gtk/gtktypes.h>
+#include "gtk/gtkcssancestorfilterprivate.h"
 #include "gtk/gtkcsstypesprivate.h"
 
 G_BEGIN_DECLS
@@ -85,6 +86,8 @@ void              _gtk_css_matcher_superset_init  (GtkCssMatcher          *match
                                                    const GtkCssMatcher    *subset,
                                                    GtkCssChange            relevant);
 
+const GtkCssAncestorFilter *
+                  _gtk_css_matcher_get_ancestor_filter (const GtkCssMatcher *matcher);
 
 static inline gboolean
 _gtk_css_matcher_get_parent (GtkCssMatcher       *matcher,
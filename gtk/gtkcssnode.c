@@ -20,6 +20,8 @@
 #include "gtkcssnodeprivate.h"
 
 #include "gtkcssanimatedstyleprivate.h"
+#include "gtkcsspathnodeprivate.h"
+#include "gtkcssprefetchprivate.h"
 #include "gtkcsssectionprivate.h"
 #include "gtkcssstylepropertyprivate.h"
 #include "gtkintl.h"
@@ -115,6 +117,9 @@ struct _GtkCssNodeStyleChange {
 static guint cssnode_signals[LAST_SIGNAL] = { 0 };
 static GParamSpec *cssnode_properties[NUM_PROPERTIES];
 
+/* Styles looked up ahead of time by gtk_css_node_validate() */
+static GtkCssPrefetch *current_prefetch = NULL;
+
 static GtkStyleProvider *
 gtk_css_node_get_style_provider_or_null (GtkCssNode *cssnode)
 {
@@ -284,6 +289,14 @@ gtk_css_node_is_last_child (GtkCssNode *node)
   return TRUE;
 }
 
+/* Path nodes are matched via their widget path, all other nodes
+ * (including widget nodes) are matched via their declaration. */
+static gboolean
+gtk_css_node_is_matched_as_node (GtkCssNode *node)
+{
+  return !GTK_IS_CSS_PATH_NODE (node);
+}
+
 static gboolean
 may_use_global_parent_cache (GtkCssNode *node)
 {
@@ -352,32 +365,174 @@ store_in_global_parent_cache (GtkCssNode                  *node,
                                                  style);
 }
 
+static gboolean
+may_use_shared_cache (GtkCssNode *node)
+{
+  GtkCssMatcher matcher;
+
+  /* Shared styles are looked up by declaration, so only nodes that
+   * are matched via their declaration may use them */
+  return gtk_css_node_is_matched_as_node (node) &&
+         gtk_css_node_init_matcher (node, &matcher);
+}
+
+static GtkCssStyle *
+lookup_in_shared_cache (GtkCssNode                  *node,
+                        const GtkCssNodeDeclaration *decl)
+{
+  if (!may_use_shared_cache (node))
+    return NULL;
+
+  return gtk_css_node_style_cache_lookup_shared (gtk_css_node_get_style_provider (node),
+                                                 decl,
+                                                 node->parent ? node->parent->style : NULL,
+                                                 gtk_css_node_is_first_child (node),
+                                                 gtk_css_node_is_last_child (node));
+}
+
+static void
+store_in_shared_cache (GtkCssNode                  *node,
+                       const GtkCssNodeDeclaration *decl,
+                       GtkCssStyle                 *style)
+{
+  if (!may_use_shared_cache (node))
+    return;
+
+  gtk_css_node_style_cache_insert_shared (gtk_css_node_get_style_provider (node),
+                                          (GtkCssNodeDeclaration *) decl,
+                                          node->parent ? node->parent->style : NULL,
+                                          gtk_css_node_is_first_child (node),
+                                          gtk_css_node_is_last_child (node),
+                                          style);
+}
+
+static GtkCssStyle *
+lookup_in_caches (GtkCssNode                  *node,
+                  const GtkCssNodeDeclaration *decl,
+                  GtkCssChange                 change)
+{
+  GtkCssStyle *style;
+
+  style = lookup_in_global_parent_cache (node, decl);
+  if (style)
+    return g_object_ref (style);
+
+  /* The provider changed, so shared styles may be outdated */
+  if (change & GTK_CSS_CHANGE_SOURCE)
+    return NULL;
+
+  style = lookup_in_shared_cache (node, decl);
+  if (style)
+    {
+      store_in_global_parent_cache (node, decl, style);
+      return g_object_ref (style);
+    }
+
+  return NULL;
+}
+
+static void
+store_in_caches (GtkCssNode                  *node,
+                 const GtkCssNodeDeclaration *decl,
+                 GtkCssStyle                 *style)
+{
+  store_in_global_parent_cache (node, decl, style);
+  store_in_shared_cache (node, decl, style);
+}
+
+static GtkCssLookup *
+lookup_prefetched (GtkCssNode       *node,
+                   GtkStyleProvider *provider,
+                   GtkCssChange     *lookup_change)
+{
+  if (current_prefetch == NULL)
+    return NULL;
+
+  return gtk_css_prefetch_lookup (current_prefetch, node, provider, lookup_change);
+}
+
 static GtkCssStyle *
-gtk_css_node_create_style (GtkCssNode *cssnode)
+gtk_css_node_create_style (GtkCssNode   *cssnode,
+                           GtkCssChange  change)
 {
   const GtkCssNodeDeclaration *decl;
+  GtkStyleProvider *provider;
   GtkCssMatcher matcher;
   GtkCssStyle *parent;
   GtkCssStyle *style;
+  GtkCssLookup *lookup;
+  GtkCssChange lookup_change;
 
   decl = gtk_css_node_get_declaration (cssnode);
 
-  style = lookup_in_global_parent_cache (cssnode, decl);
+  style = lookup_in_caches (cssnode, decl, change);
   if (style)
-    return g_object_ref (style);
+    return style;
 
   parent = cssnode->parent ? cssnode->parent->style : NULL;
-
-  if (gtk_css_node_init_matcher (cssnode, &matcher))
-    style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
+  provider = gtk_css_node_get_style_provider (cssnode);
+
+  lookup = lookup_prefetched (cssnode, provider, &lookup_change);
+  if (lookup)
+    style = gtk_css_static_style_new_from_lookup (provider,
+                                                  lookup,
+                                                  lookup_change,
+                                                  parent);
+  else if (gtk_css_node_init_matcher (cssnode, &matcher))
+    style = gtk_css_static_style_new_compute (provider,
                                               &matcher,
                                               parent);
   else
-    style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
+    style = gtk_css_static_style_new_compute (provider,
                                               NULL,
                                               parent);
 
-  store_in_global_parent_cache (cssnode, decl, style);
+  store_in_caches (cssnode, decl, style);
+
+  return style;
+}
+
+static GtkCssStyle *
+gtk_css_node_update_static_style (GtkCssNode   *cssnode,
+                                  GtkCssStyle  *static_style,
+                                  GtkCssChange  change)
+{
+  const GtkCssNodeDeclaration *decl;
+  GtkStyleProvider *provider;
+  GtkCssMatcher matcher;
+  GtkCssStyle *style;
+  GtkCssLookup *lookup;
+  GtkCssChange lookup_change = 0;
+
+  /* Radical changes may change everything, so there is nothing to reuse.
+   * The default style wasn't computed for this node at all. */
+  if ((change & GTK_CSS_RADICAL_CHANGE) ||
+      static_style == gtk_css_static_style_get_default ())
+    return gtk_css_node_create_style (cssnode, change);
+
+  decl = gtk_css_node_get_declaration (cssnode);
+
+  style = lookup_in_caches (cssnode, decl, change);
+  if (style)
+    return style;
+
+  if (!gtk_css_node_init_matcher (cssnode, &matcher))
+    return gtk_css_node_create_style (cssnode, change);
+
+  provider = gtk_css_node_get_style_provider (cssnode);
+  lookup = lookup_prefetched (cssnode, provider, &lookup_change);
+
+  style = gtk_css_static_style_new_update (GTK_CSS_STATIC_STYLE (static_style),
+                                           provider,
+                                           &matcher,
+                                           lookup,
+                                           lookup_change,
+                                           cssnode->parent ? cssnode->parent->style : NULL,
+                                           change);
+  if (style == NULL)
+    return gtk_css_node_create_style (cssnode, change);
+
+  store_in_caches (cssnode, decl, style);
 
   return style;
 }
@@ -423,7 +578,7 @@ gtk_css_node_real_update_style (GtkCssNode   *cssnode,
     }
 
   if (gtk_css_style_needs_recreation (static_style, change))
-    new_static_style = gtk_css_node_create_style (cssnode);
+    new_static_style = gtk_css_node_update_static_style (cssnode, static_style, change);
   else
     new_static_style = g_object_ref (static_style);
 
@@ -734,6 +889,30 @@ gtk_css_node_invalidate_style (GtkCssNode *cssnode)
     gtk_css_node_invalidate_style (cssnode->next_sibling);
 }
 
+static void
+gtk_css_node_invalidate_ancestor_filter (GtkCssNode *cssnode)
+{
+  GtkCssNode *child;
+
+  /* The descendants of a node with an invalid filter are invalid already */
+  if (!cssnode->ancestor_filter_valid)
+    return;
+
+  cssnode->ancestor_filter_valid = FALSE;
+
+  for (child = cssnode->first_child; child; child = child->next_sibling)
+    gtk_css_node_invalidate_ancestor_filter (child);
+}
+
+static void
+gtk_css_node_invalidate_children_ancestor_filter (GtkCssNode *cssnode)
+{
+  GtkCssNode *child;
+
+  for (child = cssnode->first_child; child; child = child->next_sibling)
+    gtk_css_node_invalidate_ancestor_filter (child);
+}
+
 static void
 gtk_css_node_reposition (GtkCssNode *node,
                          GtkCssNode *new_parent,
@@ -747,6 +926,8 @@ gtk_css_node_reposition (GtkCssNode *node,
   /* Take a reference here so the whole function has a reference */
   g_object_ref (node);
 
+  gtk_css_prefetch_tree_changed ();
+
   if (node->visible)
     {
       if (node->next_sibling)
@@ -767,6 +948,8 @@ gtk_css_node_reposition (GtkCssNode *node,
 
   if (old_parent != new_parent)
     {
+      gtk_css_node_invalidate_ancestor_filter (node);
+
       if (old_parent == NULL)
         {
           gtk_css_node_parent_will_be_set (node);
@@ -1033,6 +1216,7 @@ gtk_css_node_set_visible (GtkCssNode *cssnode,
 
   cssnode->visible = visible;
   g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_VISIBLE]);
+  gtk_css_prefetch_tree_changed ();
 
   if (cssnode->invalid)
     {
@@ -1096,6 +1280,8 @@ gtk_css_node_set_name (GtkCssNode              *cssnode,
   if (gtk_css_node_declaration_set_name (&cssnode->decl, name))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_NAME);
+      gtk_css_node_invalidate_children_ancestor_filter (cssnode);
+      gtk_css_prefetch_tree_changed ();
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_NAME]);
     }
 }
@@ -1113,6 +1299,7 @@ gtk_css_node_set_widget_type (GtkCssNode *cssnode,
   if (gtk_css_node_declaration_set_type (&cssnode->decl, widget_type))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_NAME);
+      gtk_css_prefetch_tree_changed ();
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_WIDGET_TYPE]);
     }
 }
@@ -1130,6 +1317,8 @@ gtk_css_node_set_id (GtkCssNode                *cssnode,
   if (gtk_css_node_declaration_set_id (&cssnode->decl, id))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_ID);
+      gtk_css_node_invalidate_children_ancestor_filter (cssnode);
+      gtk_css_prefetch_tree_changed ();
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_ID]);
     }
 }
@@ -1147,6 +1336,7 @@ gtk_css_node_set_state (GtkCssNode    *cssnode,
   if (gtk_css_node_declaration_set_state (&cssnode->decl, state_flags))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_STATE);
+      gtk_css_prefetch_tree_changed ();
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_STATE]);
     }
 }
@@ -1163,6 +1353,8 @@ gtk_css_node_clear_classes (GtkCssNode *cssnode)
   if (gtk_css_node_declaration_clear_classes (&cssnode->decl))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_children_ancestor_filter (cssnode);
+      gtk_css_prefetch_tree_changed ();
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1214,6 +1406,8 @@ gtk_css_node_add_class (GtkCssNode *cssnode,
   if (gtk_css_node_declaration_add_class (&cssnode->decl, style_class))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_children_ancestor_filter (cssnode);
+      gtk_css_prefetch_tree_changed ();
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1225,6 +1419,8 @@ gtk_css_node_remove_class (GtkCssNode *cssnode,
   if (gtk_css_node_declaration_remove_class (&cssnode->decl, style_class))
     {
       gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_CLASS);
+      gtk_css_node_invalidate_children_ancestor_filter (cssnode);
+      gtk_css_prefetch_tree_changed ();
       g_object_notify_by_pspec (G_OBJECT (cssnode), cssnode_properties[PROP_CLASSES]);
     }
 }
@@ -1249,11 +1445,82 @@ gtk_css_node_get_declaration (GtkCssNode *cssnode)
   return cssnode->decl;
 }
 
+/*
+ * gtk_css_node_get_ancestor_filter:
+ * @cssnode: a #GtkCssNode
+ *
+ * Gets a Bloom filter of the names, ids and style classes of all
+ * ancestors of @cssnode. If an ancestor is matched via a widget
+ * path, there is no filter.
+ *
+ * Returns: (nullable): the filter or %NULL
+ */
+const GtkCssAncestorFilter *
+gtk_css_node_get_ancestor_filter (GtkCssNode *cssnode)
+{
+  GtkCssNode *parent = cssnode->parent;
+
+  if (!cssnode->ancestor_filter_valid)
+    {
+      const GtkCssAncestorFilter *parent_filter;
+
+      if (parent == NULL)
+        {
+          gtk_css_ancestor_filter_init (&cssnode->ancestor_filter);
+          cssnode->ancestor_filter_usable = TRUE;
+        }
+      else
+        {
+          parent_filter = gtk_css_node_get_ancestor_filter (parent);
+
+          /* Ancestors matched via a widget path aren't in the filter */
+          if (parent_filter == NULL ||
+              !gtk_css_node_is_matched_as_node (parent))
+            {
+              cssnode->ancestor_filter_usable = FALSE;
+            }
+          else
+            {
+              const GQuark *classes;
+              const char *name, *id;
+              guint i, n_classes;
+
+              cssnode->ancestor_filter = *parent_filter;
+
+              name = gtk_css_node_declaration_get_name (parent->decl);
+              if (name)
+                gtk_css_ancestor_filter_add (&cssnode->ancestor_filter,
+                                             gtk_css_ancestor_filter_hash_name (name));
+
+              id = gtk_css_node_declaration_get_id (parent->decl);
+              if (id)
+                gtk_css_ancestor_filter_add (&cssnode->ancestor_filter,
+                                             gtk_css_ancestor_filter_hash_id (id));
+
+              classes = gtk_css_node_declaration_get_classes (parent->decl, &n_classes);
+              for (i = 0; i < n_classes; i++)
+                gtk_css_ancestor_filter_add (&cssnode->ancestor_filter,
+                                             gtk_css_ancestor_filter_hash_class (classes[i]));
+
+              cssnode->ancestor_filter_usable = TRUE;
+            }
+        }
+
+      cssnode->ancestor_filter_valid = TRUE;
+    }
+
+  if (!cssnode->ancestor_filter_usable)
+    return NULL;
+
+  return &cssnode->ancestor_filter;
+}
+
 void
 gtk_css_node_invalidate_style_provider (GtkCssNode *cssnode)
 {
   GtkCssNode *child;
 
+  gtk_css_prefetch_tree_changed ();
   gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_SOURCE);
 
   for (child = cssnode->first_child;
@@ -1342,14 +1609,107 @@ gtk_css_node_validate_internal (GtkCssNode *cssnode,
     }
 }
 
+/* Finds the nodes that validating @cssnode will look up styles for,
+ * the same way gtk_css_node_ensure_style() and
+ * gtk_css_node_propagate_pending_changes() will, and adds them to
+ * @prefetch. Guessing wrong is fine, nodes that aren't prefetched are
+ * looked up while validating.
+ */
+static void
+gtk_css_node_collect_prefetch (GtkCssNode     *cssnode,
+                               GtkCssChange    change,
+                               GtkCssPrefetch *prefetch)
+{
+  GtkCssChange child_change, sibling_change;
+  GtkCssMatcher matcher;
+  GtkCssNode *child;
+  gboolean recreate;
+
+  change |= cssnode->pending_changes;
+  recreate = change != 0 && gtk_css_style_needs_recreation (cssnode->style, change);
+
+  if (recreate &&
+      gtk_css_node_is_matched_as_node (cssnode) &&
+      gtk_css_node_init_matcher (cssnode, &matcher))
+    gtk_css_prefetch_add (prefetch, cssnode, gtk_css_node_get_style_provider (cssnode));
+
+  child_change = _gtk_css_change_for_child (change);
+  if (recreate)
+    child_change |= GTK_CSS_CHANGE_PARENT_STYLE;
+
+  for (child = gtk_css_node_get_first_child (cssnode);
+       child;
+       child = gtk_css_node_get_next_sibling (child))
+    {
+      /* Lookups may look at all siblings, so their filters must be
+       * there before other threads get to them */
+      gtk_css_node_get_ancestor_filter (child);
+
+      if (!child->visible)
+        continue;
+
+      sibling_change = child->pending_changes;
+      if (child->invalid || child_change != 0)
+        gtk_css_node_collect_prefetch (child, child_change, prefetch);
+      child_change |= _gtk_css_change_for_sibling (sibling_change);
+    }
+}
+
+/* Looks up the styles of large invalid subtrees of @cssnode in other
+ * threads, so that validating them only needs to compute values. */
+static GtkCssPrefetch *
+gtk_css_node_prefetch_styles (GtkCssNode *cssnode)
+{
+  GtkCssPrefetch *prefetch;
+  GtkCssNode *ancestor, *child;
+
+  if (current_prefetch != NULL ||
+      !cssnode->invalid ||
+      gtk_css_prefetch_get_n_threads () < 2)
+    return NULL;
+
+  /* Compute the ancestor filters that may be used while matching
+   * ancestors and their siblings */
+  gtk_css_node_get_ancestor_filter (cssnode);
+  for (ancestor = cssnode->parent; ancestor; ancestor = ancestor->parent)
+    {
+      for (child = ancestor->first_child; child; child = child->next_sibling)
+        gtk_css_node_get_ancestor_filter (child);
+    }
+
+  prefetch = gtk_css_prefetch_new ();
+  gtk_css_node_collect_prefetch (cssnode, 0, prefetch);
+
+  if (gtk_css_prefetch_get_n_nodes (prefetch) < GTK_CSS_PREFETCH_MIN_NODES)
+    {
+      gtk_css_prefetch_free (prefetch);
+      return NULL;
+    }
+
+  gtk_css_prefetch_run (prefetch);
+
+  return prefetch;
+}
+
 void
 gtk_css_node_validate (GtkCssNode *cssnode)
 {
+  GtkCssPrefetch *prefetch;
   gint64 timestamp;
 
   timestamp = gtk_css_node_get_timestamp (cssnode);
 
+  prefetch = gtk_css_node_prefetch_styles (cssnode);
+  if (prefetch)
+    current_prefetch = prefetch;
+
   gtk_css_node_validate_internal (cssnode, timestamp);
+
+  if (prefetch)
+    {
+      current_prefetch = NULL;
+      gtk_css_prefetch_free (prefetch);
+    }
 }
 
 gboolean
@@ -18,6 +18,7 @@
 #ifndef __GTK_CSS_NODE_PRIVATE_H__
 #define __GTK_CSS_NODE_PRIVATE_H__
 
+#include "gtkcssancestorfilterprivate.h"
 #include "gtkcssnodedeclarationprivate.h"
 #include "gtkcssnodestylecacheprivate.h"
 #include "gtkcssstylechangeprivate.h"
@@ -48,6 +49,7 @@ struct _GtkCssNode
   GtkCssNodeDeclaration *decl;
   GtkCssStyle           *style;
   GtkCssNodeStyleCache  *cache;                 /* cache for children to look up styles */
+  GtkCssAncestorFilter   ancestor_filter;       /* names, ids and classes of all ancestors */
 
   GtkCssChange           pending_changes;       /* changes that accumulated since the style was last computed */
 
@@ -60,6 +62,9 @@ struct _GtkCssNode
    * So if a valid style is computed, one has to previously ensure that the parent's and the previous sibling's style
    * are valid. This allows both validation and invalidation to run in O(nodes-in-tree) */
   guint                  style_is_invalid :1;   /* the style needs to be recomputed */
+  /* If a node's ancestor_filter is invalid, so are the ones of all its descendants. */
+  guint                  ancestor_filter_valid :1;  /* ancestor_filter is up to date */
+  guint                  ancestor_filter_usable :1; /* all ancestors are matched as nodes, so ancestor_filter can be used */
 };
 
 struct _GtkCssNodeClass
@@ -143,6 +148,8 @@ const GQuark *          gtk_css_node_list_classes       (GtkCssNode            *
 const GtkCssNodeDeclaration *
                         gtk_css_node_get_declaration    (GtkCssNode            *cssnode);
 GtkCssStyle *           gtk_css_node_get_style          (GtkCssNode            *cssnode);
+const GtkCssAncestorFilter *
+                        gtk_css_node_get_ancestor_filter (GtkCssNode           *cssnode);
 
 
 void                    gtk_css_node_invalidate_style_provider
@@ -152,6 +159,7 @@ void                    gtk_css_node_invalidate_frame_clock
                                                          gboolean               just_timestamp);
 void                    gtk_css_node_invalidate         (GtkCssNode            *cssnode,
                                                          GtkCssChange           change);
+GDK_AVAILABLE_IN_ALL
 void                    gtk_css_node_validate           (GtkCssNode            *cssnode);
 
 gboolean                gtk_css_node_init_matcher       (GtkCssNode            *cssnode,
@@ -180,3 +180,167 @@ gtk_css_node_style_cache_lookup (GtkCssNodeStyleCache        *parent,
   return gtk_css_node_style_cache_ref (result);
 }
 
+
+/* The caches above are owned by the parent node, so they only help
+ * siblings. The shared cache is keyed on the parent's style instead, so
+ * nodes with the same declaration share their style even when they are
+ * children of different nodes that happen to have the same style.
+ *
+ * A style pointer stays the same while its node changes (e.g. when a state
+ * change did not affect any property), so the parent's style does not
+ * identify the ancestors. Only styles that don't depend on any ancestor
+ * can be shared.
+ */
+#define GTK_CSS_SHARED_STYLE_CACHE_SIZE 1024
+
+typedef struct _GtkCssSharedStyle GtkCssSharedStyle;
+
+struct _GtkCssSharedStyle {
+  GtkStyleProvider      *provider;
+  GtkCssNodeDeclaration *decl;
+  GtkCssStyle           *parent;
+  guint                  flags;
+
+  GtkCssStyle           *style;
+  GList                  link;     /* in shared_styles_lru, most recently used first */
+};
+
+static GHashTable *shared_styles;
+static GQueue shared_styles_lru = G_QUEUE_INIT;
+static guint shared_style_hits;
+static guint shared_style_misses;
+
+static guint
+gtk_css_shared_style_hash (gconstpointer item)
+{
+  const GtkCssSharedStyle *shared = item;
+
+  return gtk_css_node_declaration_hash (shared->decl) ^
+         (g_direct_hash (shared->parent) << 2) ^
+         g_direct_hash (shared->provider) ^
+         shared->flags;
+}
+
+static gboolean
+gtk_css_shared_style_equal (gconstpointer item1,
+                            gconstpointer item2)
+{
+  const GtkCssSharedStyle *shared1 = item1;
+  const GtkCssSharedStyle *shared2 = item2;
+
+  return shared1->provider == shared2->provider &&
+         shared1->parent == shared2->parent &&
+         shared1->flags == shared2->flags &&
+         gtk_css_node_declaration_equal (shared1->decl, shared2->decl);
+}
+
+static void
+gtk_css_shared_style_free (gpointer item)
+{
+  GtkCssSharedStyle *shared = item;
+
+  g_queue_unlink (&shared_styles_lru, &shared->link);
+
+  g_object_unref (shared->provider);
+  gtk_css_node_declaration_unref (shared->decl);
+  g_clear_object (&shared->parent);
+  g_object_unref (shared->style);
+
+  g_slice_free (GtkCssSharedStyle, shared);
+}
+
+GtkCssStyle *
+gtk_css_node_style_cache_lookup_shared (GtkStyleProvider            *provider,
+                                        const GtkCssNodeDeclaration *decl,
+                                        GtkCssStyle                 *parent,
+                                        gboolean                     is_first,
+                                        gboolean                     is_last)
+{
+  GtkCssSharedStyle key, *shared;
+
+  if (shared_styles == NULL)
+    {
+      shared_style_misses++;
+      return NULL;
+    }
+
+  key.provider = provider;
+  key.decl = (GtkCssNodeDeclaration *) decl;
+  key.parent = parent;
+  key.flags = (is_first ? 0x2 : 0) | (is_last ? 0x1 : 0);
+
+  shared = g_hash_table_lookup (shared_styles, &key);
+  if (shared == NULL)
+    {
+      shared_style_misses++;
+      return NULL;
+    }
+
+  shared_style_hits++;
+  g_queue_unlink (&shared_styles_lru, &shared->link);
+  g_queue_push_head_link (&shared_styles_lru, &shared->link);
+
+  return shared->style;
+}
+
+void
+gtk_css_node_style_cache_insert_shared (GtkStyleProvider      *provider,
+                                        GtkCssNodeDeclaration *decl,
+                                        GtkCssStyle           *parent,
+                                        gboolean               is_first,
+                                        gboolean               is_last,
+                                        GtkCssStyle           *style)
+{
+  GtkCssSharedStyle *shared;
+
+  if (!may_be_stored_in_cache (style))
+    return;
+
+  /* See above, toplevel nodes have no ancestors to depend on */
+  if (parent != NULL &&
+      gtk_css_static_style_get_change (GTK_CSS_STATIC_STYLE (style)) & GTK_CSS_CHANGE_ANY_PARENT)
+    return;
+
+  if (shared_styles == NULL)
+    shared_styles = g_hash_table_new_full (gtk_css_shared_style_hash,
+                                           gtk_css_shared_style_equal,
+                                           gtk_css_shared_style_free,
+                                           NULL);
+
+  shared = g_slice_new0 (GtkCssSharedStyle);
+  shared->provider = g_object_ref (provider);
+  shared->decl = gtk_css_node_declaration_ref (decl);
+  shared->parent = parent ? g_object_ref (parent) : NULL;
+  shared->flags = (is_first ? 0x2 : 0) | (is_last ? 0x1 : 0);
+  shared->style = g_object_ref (style);
+  shared->link.data = shared;
+
+  /* Replaces an existing entry, which also unlinks it */
+  g_hash_table_add (shared_styles, shared);
+  g_queue_push_head_link (&shared_styles_lru, &shared->link);
+
+  while (shared_styles_lru.length > GTK_CSS_SHARED_STYLE_CACHE_SIZE)
+    g_hash_table_remove (shared_styles, g_queue_peek_tail (&shared_styles_lru));
+}
+
+/* Called when styles may be computed differently from now on, for example
+ * because a style provider changed.
+ */
+void
+gtk_css_node_style_cache_clear_shared (void)
+{
+  g_clear_pointer (&shared_styles, g_hash_table_unref);
+}
+
+void
+gtk_css_node_style_cache_get_shared_stats (guint *hits,
+                                           guint *misses,
+                                           guint *size)
+{
+  if (hits)
+    *hits = shared_style_hits;
+  if (misses)
+    *misses = shared_style_misses;
+  if (size)
+    *size = shared_styles_lru.length;
+}
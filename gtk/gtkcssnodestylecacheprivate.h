@@ -20,6 +20,7 @@
 
 #include "gtkcssnodedeclarationprivate.h"
 #include "gtkcssstyleprivate.h"
+#include "gtkstyleprovider.h"
 
 G_BEGIN_DECLS
 
@@ -41,6 +42,23 @@ GtkCssNodeStyleCache *  gtk_css_node_style_cache_lookup         (GtkCssNodeStyle
                                                                  gboolean                     is_first,
                                                                  gboolean                     is_last);
 
+GtkCssStyle *           gtk_css_node_style_cache_lookup_shared  (GtkStyleProvider            *provider,
+                                                                 const GtkCssNodeDeclaration *decl,
+                                                                 GtkCssStyle                 *parent,
+                                                                 gboolean                     is_first,
+                                                                 gboolean                     is_last);
+void                    gtk_css_node_style_cache_insert_shared  (GtkStyleProvider            *provider,
+                                                                 GtkCssNodeDeclaration       *decl,
+                                                                 GtkCssStyle                 *parent,
+                                                                 gboolean                     is_first,
+                                                                 gboolean                     is_last,
+                                                                 GtkCssStyle                 *style);
+void                    gtk_css_node_style_cache_clear_shared   (void);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_css_node_style_cache_get_shared_stats (guint                     *hits,
+                                                                   guint                     *misses,
+                                                                   guint                     *size);
+
 G_END_DECLS
 
 #endif /* __GTK_CSS_NODE_STYLE_CACHE_PRIVATE_H__ */
@@ -0,0 +1,319 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2018 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkcssprefetchprivate.h"
+
+#include "gtkcssmatcherprivate.h"
+#include "gtkstyleproviderprivate.h"
+
+/* GtkCssPrefetch looks up the styles of many nodes in a pool of
+ * threads before a tree of nodes is validated. Validation then only
+ * needs to compute the values.
+ *
+ * Only the lookup runs in other threads. It matches the selectors of
+ * the style providers against the node tree and collects pointers to
+ * the winning declarations. Nothing is referenced or modified while
+ * doing that, so the main thread must not touch the node tree or the
+ * style providers until the lookups are done. Computing values isn't
+ * thread-safe, as it may load images and icon themes.
+ *
+ * Lookups are only valid as long as the node tree isn't changed,
+ * gtk_css_prefetch_tree_changed() marks all of them as outdated.
+ */
+
+/* Number of nodes a thread takes at once */
+#define BATCH_SIZE 16
+
+typedef struct _GtkCssPrefetchEntry GtkCssPrefetchEntry;
+
+struct _GtkCssPrefetchEntry {
+  GtkCssNode       *node;
+  GtkStyleProvider *provider;
+  GtkCssChange      change;
+  GtkCssLookup      lookup;
+};
+
+struct _GtkCssPrefetch {
+  GArray     *entries;
+  GHashTable *nodes;            /* GtkCssNode => index + 1 */
+  guint       serial;
+  guint       done : 1;
+
+  gint        next;             /* atomic, next entry to look up */
+  guint       n_running;        /* threads that aren't done */
+  GMutex      mutex;
+  GCond       cond;
+};
+
+static GThreadPool *pool = NULL;
+static guint max_threads = 0;
+static guint tree_serial = 0;
+static guint n_prefetched = 0;
+static guint n_used = 0;
+
+GtkCssPrefetch *
+gtk_css_prefetch_new (void)
+{
+  GtkCssPrefetch *prefetch;
+
+  prefetch = g_slice_new0 (GtkCssPrefetch);
+  prefetch->entries = g_array_new (FALSE, FALSE, sizeof (GtkCssPrefetchEntry));
+  prefetch->nodes = g_hash_table_new (NULL, NULL);
+  g_mutex_init (&prefetch->mutex);
+  g_cond_init (&prefetch->cond);
+
+  return prefetch;
+}
+
+void
+gtk_css_prefetch_free (GtkCssPrefetch *prefetch)
+{
+  guint i;
+
+  if (prefetch->done)
+    {
+      for (i = 0; i < prefetch->entries->len; i++)
+        _gtk_css_lookup_destroy (&g_array_index (prefetch->entries, GtkCssPrefetchEntry, i).lookup);
+    }
+
+  g_array_free (prefetch->entries, TRUE);
+  g_hash_table_unref (prefetch->nodes);
+  g_mutex_clear (&prefetch->mutex);
+  g_cond_clear (&prefetch->cond);
+
+  g_slice_free (GtkCssPrefetch, prefetch);
+}
+
+/*
+ * gtk_css_prefetch_add:
+ * @prefetch: a #GtkCssPrefetch
+ * @node: a node that is matched via its declaration
+ * @provider: the style provider of @node
+ *
+ * Adds @node to the nodes to look up in gtk_css_prefetch_run().
+ * The lookup must not need anything from @node that isn't computed
+ * yet, in particular its ancestor filter and the ancestor filters of
+ * its siblings.
+ */
+void
+gtk_css_prefetch_add (GtkCssPrefetch   *prefetch,
+                      GtkCssNode       *node,
+                      GtkStyleProvider *provider)
+{
+  GtkCssPrefetchEntry *entry;
+
+  g_return_if_fail (!prefetch->done);
+
+  if (g_hash_table_contains (prefetch->nodes, node))
+    return;
+
+  g_array_set_size (prefetch->entries, prefetch->entries->len + 1);
+  entry = &g_array_index (prefetch->entries, GtkCssPrefetchEntry, prefetch->entries->len - 1);
+  entry->node = node;
+  entry->provider = provider;
+
+  g_hash_table_insert (prefetch->nodes, node, GUINT_TO_POINTER (prefetch->entries->len));
+}
+
+guint
+gtk_css_prefetch_get_n_nodes (GtkCssPrefetch *prefetch)
+{
+  return prefetch->entries->len;
+}
+
+static void
+gtk_css_prefetch_process (GtkCssPrefetch *prefetch)
+{
+  GtkCssPrefetchEntry *entry;
+  GtkCssMatcher matcher;
+  guint i, start, end;
+
+  while (TRUE)
+    {
+      start = g_atomic_int_add (&prefetch->next, BATCH_SIZE);
+      if (start >= prefetch->entries->len)
+        break;
+
+      end = MIN (start + BATCH_SIZE, prefetch->entries->len);
+      for (i = start; i < end; i++)
+        {
+          entry = &g_array_index (prefetch->entries, GtkCssPrefetchEntry, i);
+
+          _gtk_css_lookup_init (&entry->lookup, NULL);
+          if (gtk_css_node_init_matcher (entry->node, &matcher))
+            gtk_style_provider_lookup (entry->provider, &matcher, &entry->lookup, &entry->change);
+          else
+            entry->change = GTK_CSS_CHANGE_ANY_SELF | GTK_CSS_CHANGE_ANY_SIBLING | GTK_CSS_CHANGE_ANY_PARENT;
+        }
+    }
+}
+
+static void
+gtk_css_prefetch_thread_func (gpointer data,
+                              gpointer unused)
+{
+  GtkCssPrefetch *prefetch = data;
+
+  gtk_css_prefetch_process (prefetch);
+
+  g_mutex_lock (&prefetch->mutex);
+  prefetch->n_running--;
+  if (prefetch->n_running == 0)
+    g_cond_signal (&prefetch->cond);
+  g_mutex_unlock (&prefetch->mutex);
+}
+
+/*
+ * gtk_css_prefetch_run:
+ * @prefetch: a #GtkCssPrefetch
+ *
+ * Looks up the styles of all added nodes, using as many threads as
+ * gtk_css_prefetch_get_n_threads() returns, and waits until all
+ * lookups are done.
+ */
+void
+gtk_css_prefetch_run (GtkCssPrefetch *prefetch)
+{
+  guint i, n_workers;
+
+  g_return_if_fail (!prefetch->done);
+
+  n_workers = MIN (gtk_css_prefetch_get_n_threads (),
+                   (prefetch->entries->len + BATCH_SIZE - 1) / BATCH_SIZE);
+  /* The main thread is one of them */
+  if (n_workers > 0)
+    n_workers--;
+
+  if (n_workers > 0 && pool == NULL)
+    pool = g_thread_pool_new (gtk_css_prefetch_thread_func,
+                              NULL,
+                              gtk_css_prefetch_get_n_threads () - 1,
+                              FALSE,
+                              NULL);
+
+  prefetch->n_running = n_workers;
+  for (i = 0; i < n_workers; i++)
+    g_thread_pool_push (pool, prefetch, NULL);
+
+  gtk_css_prefetch_process (prefetch);
+
+  g_mutex_lock (&prefetch->mutex);
+  while (prefetch->n_running > 0)
+    g_cond_wait (&prefetch->cond, &prefetch->mutex);
+  g_mutex_unlock (&prefetch->mutex);
+
+  prefetch->serial = tree_serial;
+  prefetch->done = TRUE;
+  n_prefetched += prefetch->entries->len;
+}
+
+/*
+ * gtk_css_prefetch_lookup:
+ * @prefetch: a #GtkCssPrefetch
+ * @node: a node
+ * @provider: the style provider of @node
+ * @change: (out): the change returned by the lookup
+ *
+ * Gets the result of looking up the style of @node in @provider,
+ * if it was looked up and the node tree didn't change since then.
+ * The lookup is owned by @prefetch.
+ *
+ * Returns: (nullable): the lookup or %NULL
+ */
+GtkCssLookup *
+gtk_css_prefetch_lookup (GtkCssPrefetch   *prefetch,
+                         GtkCssNode       *node,
+                         GtkStyleProvider *provider,
+                         GtkCssChange     *change)
+{
+  GtkCssPrefetchEntry *entry;
+  guint index;
+
+  if (!prefetch->done || prefetch->serial != tree_serial)
+    return NULL;
+
+  index = GPOINTER_TO_UINT (g_hash_table_lookup (prefetch->nodes, node));
+  if (index == 0)
+    return NULL;
+
+  entry = &g_array_index (prefetch->entries, GtkCssPrefetchEntry, index - 1);
+  if (entry->provider != provider)
+    return NULL;
+
+  n_used++;
+  *change = entry->change;
+
+  return &entry->lookup;
+}
+
+/*
+ * gtk_css_prefetch_tree_changed:
+ *
+ * Marks all lookups as outdated. This must be called whenever a
+ * change to a node or style provider may change the result of a
+ * lookup.
+ */
+void
+gtk_css_prefetch_tree_changed (void)
+{
+  tree_serial++;
+}
+
+/*
+ * gtk_css_prefetch_get_n_threads:
+ *
+ * Gets the number of threads to look up styles in, including the
+ * main thread. If this is 1, no styles are prefetched.
+ *
+ * Returns: the number of threads
+ */
+guint
+gtk_css_prefetch_get_n_threads (void)
+{
+  if (max_threads == 0)
+    max_threads = CLAMP (g_get_num_processors (), 1, 8);
+
+  return max_threads;
+}
+
+/*
+ * gtk_css_prefetch_set_n_threads:
+ * @n_threads: the number of threads or 0 for the default
+ *
+ * Sets the number of threads to look up styles in. This is meant
+ * for tests and benchmarks.
+ */
+void
+gtk_css_prefetch_set_n_threads (guint n_threads)
+{
+  max_threads = n_threads;
+
+  if (pool)
+    g_thread_pool_set_max_threads (pool, MAX (gtk_css_prefetch_get_n_threads (), 2) - 1, NULL);
+}
+
+void
+gtk_css_prefetch_get_stats (guint *prefetched,
+                            guint *used)
+{
+  if (prefetched)
+    *prefetched = n_prefetched;
+  if (used)
+    *used = n_used;
+}
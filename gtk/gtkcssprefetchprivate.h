@@ -0,0 +1,57 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2018 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_CSS_PREFETCH_PRIVATE_H__
+#define __GTK_CSS_PREFETCH_PRIVATE_H__
+
+#include "gtkcssnodeprivate.h"
+#include "gtkcsslookupprivate.h"
+#include "gtkstyleprovider.h"
+
+G_BEGIN_DECLS
+
+/* Don't bother with threads for fewer nodes than this */
+#define GTK_CSS_PREFETCH_MIN_NODES 128
+
+typedef struct _GtkCssPrefetch GtkCssPrefetch;
+
+GtkCssPrefetch *        gtk_css_prefetch_new                    (void);
+void                    gtk_css_prefetch_free                   (GtkCssPrefetch         *prefetch);
+
+void                    gtk_css_prefetch_add                    (GtkCssPrefetch         *prefetch,
+                                                                 GtkCssNode             *node,
+                                                                 GtkStyleProvider       *provider);
+guint                   gtk_css_prefetch_get_n_nodes            (GtkCssPrefetch         *prefetch);
+void                    gtk_css_prefetch_run                    (GtkCssPrefetch         *prefetch);
+GtkCssLookup *          gtk_css_prefetch_lookup                 (GtkCssPrefetch         *prefetch,
+                                                                 GtkCssNode             *node,
+                                                                 GtkStyleProvider       *provider,
+                                                                 GtkCssChange           *change);
+
+void                    gtk_css_prefetch_tree_changed           (void);
+
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_css_prefetch_get_n_threads          (void);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_css_prefetch_set_n_threads          (guint                   n_threads);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_css_prefetch_get_stats              (guint                  *n_prefetched,
+                                                                 guint                  *n_used);
+
+G_END_DECLS
+
+#endif /* __GTK_CSS_PREFETCH_PRIVATE_H__ */
@@ -95,6 +95,7 @@ struct GtkCssRuleset
   GtkCssSelectorTree *selector_match;
   PropertyValue *styles;
   GtkBitmask *set_styles;
+  GtkCssChange change;
   guint n_styles;
   guint owns_styles : 1;
 };
@@ -117,8 +118,13 @@ struct _GtkCssProviderPrivate
 
   GArray *rulesets;
   GtkCssSelectorTree *tree;
+  GtkBitmask *change_properties[64]; /* properties set by rules depending on each change bit */
   GResource *resource;
   gchar *path;
+
+  GPtrArray *files;            /* files that were loaded, for compiling */
+  guint has_binding_sets : 1;  /* binding sets can't be compiled */
+  guint loaded_compiled : 1;   /* loaded from a compiled file */
 };
 
 enum {
@@ -431,6 +437,7 @@ gtk_css_provider_init (GtkCssProvider *css_provider)
   GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
 
   priv->rulesets = g_array_new (FALSE, FALSE, sizeof (GtkCssRuleset));
+  priv->files = g_ptr_array_new_with_free_func (g_object_unref);
 
   priv->symbolic_colors = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                  (GDestroyNotify) g_free,
@@ -614,15 +621,44 @@ gtk_css_style_provider_lookup (GtkStyleProvider    *provider,
     }
 }
 
+static gboolean
+gtk_css_style_provider_get_change_properties (GtkStyleProvider  *provider,
+                                              GtkCssChange       change,
+                                              GtkBitmask       **properties)
+{
+  GtkCssProvider *css_provider = GTK_CSS_PROVIDER (provider);
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+  guint i;
+
+  for (i = 0; change != 0; i++, change >>= 1)
+    {
+      if ((change & 1) && priv->change_properties[i])
+        *properties = _gtk_bitmask_union (*properties, priv->change_properties[i]);
+    }
+
+  return TRUE;
+}
+
 static void
 gtk_css_style_provider_iface_init (GtkStyleProviderInterface *iface)
 {
   iface->get_color = gtk_css_style_provider_get_color;
   iface->get_keyframes = gtk_css_style_provider_get_keyframes;
   iface->lookup = gtk_css_style_provider_lookup;
+  iface->get_change_properties = gtk_css_style_provider_get_change_properties;
   iface->emit_error = gtk_css_style_provider_emit_error;
 }
 
+static void
+gtk_css_provider_clear_change_properties (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (priv->change_properties); i++)
+    g_clear_pointer (&priv->change_properties[i], _gtk_bitmask_free);
+}
+
 static void
 gtk_css_provider_finalize (GObject *object)
 {
@@ -635,9 +671,11 @@ gtk_css_provider_finalize (GObject *object)
 
   g_array_free (priv->rulesets, TRUE);
   _gtk_css_selector_tree_free (priv->tree);
+  gtk_css_provider_clear_change_properties (css_provider);
 
   g_hash_table_destroy (priv->symbolic_colors);
   g_hash_table_destroy (priv->keyframes);
+  g_ptr_array_unref (priv->files);
 
   if (priv->resource)
     {
@@ -766,13 +804,16 @@ gtk_css_provider_reset (GtkCssProvider *css_provider)
 
   g_hash_table_remove_all (priv->symbolic_colors);
   g_hash_table_remove_all (priv->keyframes);
+  g_ptr_array_set_size (priv->files, 0);
+  priv->has_binding_sets = FALSE;
+  priv->loaded_compiled = FALSE;
 
   for (i = 0; i < priv->rulesets->len; i++)
     gtk_css_ruleset_clear (&g_array_index (priv->rulesets, GtkCssRuleset, i));
   g_array_set_size (priv->rulesets, 0);
   _gtk_css_selector_tree_free (priv->tree);
   priv->tree = NULL;
-
+  gtk_css_provider_clear_change_properties (css_provider);
 }
 
 static gboolean
@@ -901,6 +942,7 @@ parse_color_definition (GtkCssScanner *scanner)
 static gboolean
 parse_binding_set (GtkCssScanner *scanner)
 {
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (scanner->provider);
   GtkBindingSet *binding_set;
   char *name;
 
@@ -924,6 +966,8 @@ parse_binding_set (GtkCssScanner *scanner)
       goto skip_semicolon;
     }
 
+  priv->has_binding_sets = TRUE;
+
   binding_set = gtk_binding_set_find (name);
   if (!binding_set)
     {
@@ -1319,6 +1363,39 @@ parse_stylesheet (GtkCssScanner *scanner)
   gtk_css_scanner_pop_section (scanner, GTK_CSS_SECTION_DOCUMENT);
 }
 
+/* Record which properties can be affected by each kind of change, so
+ * that a node only needs to recompute those when e.g. its state changes.
+ */
+static void
+gtk_css_provider_compute_change_properties (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+  guint i;
+
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset;
+      GtkCssChange change;
+      guint bit;
+
+      ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      if (ruleset->set_styles == NULL)
+        continue;
+
+      change = ruleset->change;
+      for (bit = 0; change != 0; bit++, change >>= 1)
+        {
+          if ((change & 1) == 0)
+            continue;
+
+          if (priv->change_properties[bit] == NULL)
+            priv->change_properties[bit] = _gtk_bitmask_new ();
+          priv->change_properties[bit] = _gtk_bitmask_union (priv->change_properties[bit],
+                                                             ruleset->set_styles);
+        }
+    }
+}
+
 static int
 gtk_css_provider_compare_rule (gconstpointer a_,
                                gconstpointer b_)
@@ -1359,6 +1436,17 @@ gtk_css_provider_postprocess (GtkCssProvider *css_provider)
   priv->tree = _gtk_css_selector_tree_builder_build (builder);
   _gtk_css_selector_tree_builder_free (builder);
 
+  /* Remember the change of each ruleset, the selectors are freed below */
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset;
+
+      ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      ruleset->change = _gtk_css_selector_get_change (ruleset->selector);
+    }
+
+  gtk_css_provider_compute_change_properties (css_provider);
+
 #ifndef VERIFY_TREE
   for (i = 0; i < priv->rulesets->len; i++)
     {
@@ -1378,6 +1466,7 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
                                 GFile          *file,
                                 const char     *text)
 {
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
   GtkCssScanner *scanner;
   GBytes *bytes;
 
@@ -1390,6 +1479,7 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
       if (bytes)
         {
           text = g_bytes_get_data (bytes, NULL);
+          g_ptr_array_add (priv->files, g_object_ref (file));
         }
       else
         {
@@ -1446,6 +1536,509 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
     g_bytes_unref (bytes);
 }
 
+/* Compiled providers
+ *
+ * A provider's parsed state can be saved with gtk_css_provider_compile()
+ * and is picked up by gtk_css_provider_load_from_file() and friends when
+ * a file with ".compiled" appended to the name exists next to the CSS file,
+ * was created by the same version of GTK+ and all files it was created
+ * from still have the same contents.
+ *
+ * Rulesets are saved in their sorted order together with the serialized
+ * selector tree, so neither needs to be rebuilt. Values are saved in their
+ * printed form, with identical values only saved and parsed once. Parsing
+ * them is most of the remaining cost of loading a compiled file, but
+ * saving them in binary form would need serialization for every
+ * GtkCssValue type.
+ */
+#define GTK_CSS_PROVIDER_COMPILED_MAGIC "GtkCssProvider compiled"
+#define GTK_CSS_PROVIDER_COMPILED_TYPE "(ssyya(ss)(asay)a(ss)a(tuau)a(ss)a(ss))"
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define GTK_CSS_PROVIDER_COMPILED_BYTE_ORDER 'l'
+#else
+#define GTK_CSS_PROVIDER_COMPILED_BYTE_ORDER 'B'
+#endif
+
+static char *
+gtk_css_provider_get_file_checksum (GFile   *file,
+                                    GError **error)
+{
+  GBytes *bytes;
+  char *checksum;
+
+  bytes = g_file_load_bytes (file, NULL, NULL, error);
+  if (bytes == NULL)
+    return NULL;
+
+  checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes);
+  g_bytes_unref (bytes);
+
+  return checksum;
+}
+
+/**
+ * gtk_css_provider_compile:
+ * @provider: a #GtkCssProvider
+ * @error: return location for an error
+ *
+ * Saves the parsed state of @provider so that it can be loaded again
+ * without parsing. This is used by gtk4-compile-css.
+ *
+ * Returns: (transfer full) (nullable): the compiled provider or %NULL
+ *     if @provider cannot be compiled
+ **/
+GBytes *
+gtk_css_provider_compile (GtkCssProvider  *provider,
+                          GError         **error)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (provider);
+  GVariantBuilder files, values, rulesets, colors, keyframes;
+  GHashTable *value_indexes;
+  GHashTableIter iter;
+  gpointer key, value;
+  gpointer *matches;
+  GVariant *tree, *result;
+  GString *str;
+  GBytes *bytes;
+  guint i, j;
+
+  g_return_val_if_fail (GTK_IS_CSS_PROVIDER (provider), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (priv->has_binding_sets)
+    {
+      g_set_error_literal (error,
+                           GTK_CSS_PROVIDER_ERROR, GTK_CSS_PROVIDER_ERROR_FAILED,
+                           "Style sheets containing binding sets cannot be compiled");
+      return NULL;
+    }
+
+  g_variant_builder_init (&files, G_VARIANT_TYPE ("a(ss)"));
+  for (i = 0; i < priv->files->len; i++)
+    {
+      GFile *file = g_ptr_array_index (priv->files, i);
+      char *uri, *checksum;
+
+      checksum = gtk_css_provider_get_file_checksum (file, error);
+      if (checksum == NULL)
+        {
+          g_variant_builder_clear (&files);
+          return NULL;
+        }
+
+      uri = g_file_get_uri (file);
+      g_variant_builder_add (&files, "(ss)", uri, checksum);
+      g_free (uri);
+      g_free (checksum);
+    }
+
+  str = g_string_new (NULL);
+  value_indexes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  matches = g_new (gpointer, priv->rulesets->len);
+
+  g_variant_builder_init (&values, G_VARIANT_TYPE ("a(ss)"));
+  g_variant_builder_init (&rulesets, G_VARIANT_TYPE ("a(tuau)"));
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      GVariantBuilder styles;
+      guint32 match_offset;
+
+      matches[i] = ruleset;
+
+      g_variant_builder_init (&styles, G_VARIANT_TYPE ("au"));
+      for (j = 0; j < ruleset->n_styles; j++)
+        {
+          const char *name = _gtk_style_property_get_name (GTK_STYLE_PROPERTY (ruleset->styles[j].property));
+          char *value_key;
+          gpointer index;
+
+          g_string_set_size (str, 0);
+          _gtk_css_value_print (ruleset->styles[j].value, str);
+
+          value_key = g_strconcat (name, ": ", str->str, NULL);
+          if (g_hash_table_lookup_extended (value_indexes, value_key, NULL, &index))
+            {
+              g_free (value_key);
+            }
+          else
+            {
+              index = GUINT_TO_POINTER (g_hash_table_size (value_indexes));
+              g_hash_table_insert (value_indexes, value_key, index);
+              g_variant_builder_add (&values, "(ss)", name, str->str);
+            }
+
+          g_variant_builder_add (&styles, "u", GPOINTER_TO_UINT (index));
+        }
+
+      if (ruleset->selector_match)
+        match_offset = (guint8 *) ruleset->selector_match - (guint8 *) priv->tree;
+      else
+        match_offset = G_MAXUINT32;
+
+      g_variant_builder_add (&rulesets, "(tu@au)",
+                             (guint64) ruleset->change,
+                             match_offset,
+                             g_variant_builder_end (&styles));
+    }
+
+  tree = _gtk_css_selector_tree_serialize (priv->tree, matches, priv->rulesets->len);
+
+  g_variant_builder_init (&colors, G_VARIANT_TYPE ("a(ss)"));
+  g_hash_table_iter_init (&iter, priv->symbolic_colors);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      g_string_set_size (str, 0);
+      _gtk_css_value_print (value, str);
+      g_variant_builder_add (&colors, "(ss)", key, str->str);
+    }
+
+  g_variant_builder_init (&keyframes, G_VARIANT_TYPE ("a(ss)"));
+  g_hash_table_iter_init (&iter, priv->keyframes);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      g_string_set_size (str, 0);
+      _gtk_css_keyframes_print (value, str);
+      g_variant_builder_add (&keyframes, "(ss)", key, str->str);
+    }
+
+  result = g_variant_new ("(ssyy@a(ss)@(asay)@a(ss)@a(tuau)@a(ss)@a(ss))",
+                          GTK_CSS_PROVIDER_COMPILED_MAGIC,
+                          GTK_VERSION,
+                          (guchar) sizeof (gpointer),
+                          (guchar) GTK_CSS_PROVIDER_COMPILED_BYTE_ORDER,
+                          g_variant_builder_end (&files),
+                          tree,
+                          g_variant_builder_end (&values),
+                          g_variant_builder_end (&rulesets),
+                          g_variant_builder_end (&colors),
+                          g_variant_builder_end (&keyframes));
+  g_variant_ref_sink (result);
+  bytes = g_variant_get_data_as_bytes (result);
+  g_variant_unref (result);
+
+  g_free (matches);
+  g_hash_table_unref (value_indexes);
+  g_string_free (str, TRUE);
+
+  return bytes;
+}
+
+static void
+gtk_css_provider_compiled_parser_error (GtkCssParser *parser,
+                                        const GError *error,
+                                        gpointer      user_data)
+{
+  gboolean *failed = user_data;
+
+  *failed = TRUE;
+}
+
+static gboolean
+gtk_css_provider_compiled_files_are_fresh (GVariant *files)
+{
+  GVariantIter iter;
+  const char *uri, *checksum;
+
+  g_variant_iter_init (&iter, files);
+  while (g_variant_iter_next (&iter, "(&s&s)", &uri, &checksum))
+    {
+      GFile *file;
+      char *current;
+      gboolean fresh;
+
+      file = g_file_new_for_uri (uri);
+      current = gtk_css_provider_get_file_checksum (file, NULL);
+      fresh = current != NULL && g_str_equal (current, checksum);
+      g_free (current);
+      g_object_unref (file);
+
+      if (!fresh)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_provider_load_compiled_values (GtkCssProvider  *css_provider,
+                                       GVariant        *files,
+                                       GVariant        *tree,
+                                       GVariant        *values,
+                                       GVariant        *rulesets,
+                                       GVariant        *colors,
+                                       GVariant        *keyframes)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+  GtkCssStyleProperty **properties;
+  GtkCssValue **parsed;
+  guint32 *match_offsets;
+  gpointer *matches;
+  GVariantIter iter;
+  const char *name, *text;
+  GVariant *styles;
+  guint64 change;
+  guint32 match_offset;
+  gboolean failed = FALSE;
+  gsize i, j, n_values, n_rulesets;
+
+  n_values = g_variant_n_children (values);
+  properties = g_new0 (GtkCssStyleProperty *, n_values);
+  parsed = g_new0 (GtkCssValue *, n_values);
+
+  g_variant_iter_init (&iter, values);
+  for (i = 0; !failed && g_variant_iter_next (&iter, "(&s&s)", &name, &text); i++)
+    {
+      GtkStyleProperty *property;
+      GtkCssParser *parser;
+
+      property = _gtk_style_property_lookup (name);
+      if (!GTK_IS_CSS_STYLE_PROPERTY (property))
+        {
+          failed = TRUE;
+          break;
+        }
+
+      parser = _gtk_css_parser_new (text, NULL, gtk_css_provider_compiled_parser_error, &failed);
+      parsed[i] = _gtk_style_property_parse_value (property, parser);
+      if (parsed[i] == NULL || !_gtk_css_parser_is_eof (parser))
+        failed = TRUE;
+      _gtk_css_parser_free (parser);
+
+      properties[i] = GTK_CSS_STYLE_PROPERTY (property);
+    }
+
+  n_rulesets = g_variant_n_children (rulesets);
+  match_offsets = g_new (guint32, n_rulesets);
+
+  g_variant_iter_init (&iter, rulesets);
+  while (!failed && g_variant_iter_next (&iter, "(tu@au)", &change, &match_offset, &styles))
+    {
+      GtkCssRuleset ruleset = { 0, };
+      const guint32 *indexes;
+      gsize n_styles;
+
+      indexes = g_variant_get_fixed_array (styles, &n_styles, sizeof (guint32));
+
+      ruleset.change = change;
+      ruleset.owns_styles = TRUE;
+      ruleset.set_styles = _gtk_bitmask_new ();
+      if (n_styles > 0)
+        ruleset.styles = g_new0 (PropertyValue, n_styles);
+
+      for (j = 0; j < n_styles; j++)
+        {
+          if (indexes[j] >= n_values)
+            {
+              failed = TRUE;
+              break;
+            }
+
+          ruleset.styles[j].property = properties[indexes[j]];
+          ruleset.styles[j].value = _gtk_css_value_ref (parsed[indexes[j]]);
+          ruleset.n_styles++;
+          ruleset.set_styles = _gtk_bitmask_set (ruleset.set_styles,
+                                                 _gtk_css_style_property_get_id (properties[indexes[j]]),
+                                                 TRUE);
+        }
+
+      match_offsets[priv->rulesets->len] = match_offset;
+      g_array_append_val (priv->rulesets, ruleset);
+      g_variant_unref (styles);
+    }
+
+  if (!failed)
+    {
+      matches = g_new (gpointer, priv->rulesets->len);
+      for (i = 0; i < priv->rulesets->len; i++)
+        matches[i] = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      /* This also checks that the match offsets point at nodes of the tree */
+      failed = !_gtk_css_selector_tree_deserialize (tree,
+                                                    matches, priv->rulesets->len,
+                                                    match_offsets, priv->rulesets->len,
+                                                    &priv->tree);
+
+      for (i = 0; !failed && i < priv->rulesets->len; i++)
+        {
+          GtkCssRuleset *ruleset = matches[i];
+
+          if (match_offsets[i] != G_MAXUINT32)
+            ruleset->selector_match = (GtkCssSelectorTree *) ((guint8 *) priv->tree + match_offsets[i]);
+        }
+
+      g_free (matches);
+    }
+
+  g_variant_iter_init (&iter, colors);
+  while (!failed && g_variant_iter_next (&iter, "(&s&s)", &name, &text))
+    {
+      GtkCssParser *parser;
+      GtkCssValue *color;
+
+      parser = _gtk_css_parser_new (text, NULL, gtk_css_provider_compiled_parser_error, &failed);
+      color = _gtk_css_color_value_parse (parser);
+      if (color == NULL || !_gtk_css_parser_is_eof (parser))
+        failed = TRUE;
+      _gtk_css_parser_free (parser);
+
+      if (color)
+        g_hash_table_insert (priv->symbolic_colors, g_strdup (name), color);
+    }
+
+  g_variant_iter_init (&iter, keyframes);
+  while (!failed && g_variant_iter_next (&iter, "(&s&s)", &name, &text))
+    {
+      GtkCssParser *parser;
+      GtkCssKeyframes *frames;
+      char *block;
+
+      /* The keyframes parser stops at the closing brace */
+      block = g_strconcat (text, "}", NULL);
+      parser = _gtk_css_parser_new (block, NULL, gtk_css_provider_compiled_parser_error, &failed);
+      frames = _gtk_css_keyframes_parse (parser);
+      if (frames == NULL)
+        failed = TRUE;
+      _gtk_css_parser_free (parser);
+      g_free (block);
+
+      if (frames)
+        g_hash_table_insert (priv->keyframes, g_strdup (name), frames);
+    }
+
+  if (!failed)
+    {
+      g_variant_iter_init (&iter, files);
+      while (g_variant_iter_next (&iter, "(&s&s)", &name, NULL))
+        g_ptr_array_add (priv->files, g_file_new_for_uri (name));
+
+      gtk_css_provider_compute_change_properties (css_provider);
+    }
+
+  for (i = 0; i < n_values; i++)
+    {
+      if (parsed[i])
+        _gtk_css_value_unref (parsed[i]);
+    }
+  g_free (parsed);
+  g_free (properties);
+  g_free (match_offsets);
+
+  return !failed;
+}
+
+static GBytes *
+gtk_css_provider_load_compiled_bytes (GFile *file)
+{
+  GFile *compiled;
+  GBytes *bytes;
+  char *uri, *compiled_uri;
+
+  uri = g_file_get_uri (file);
+  compiled_uri = g_strconcat (uri, ".compiled", NULL);
+  compiled = g_file_new_for_uri (compiled_uri);
+  g_free (compiled_uri);
+  g_free (uri);
+
+  if (g_file_peek_path (compiled))
+    {
+      GMappedFile *mapped;
+
+      mapped = g_mapped_file_new (g_file_peek_path (compiled), FALSE, NULL);
+      if (mapped)
+        {
+          bytes = g_mapped_file_get_bytes (mapped);
+          g_mapped_file_unref (mapped);
+        }
+      else
+        bytes = NULL;
+    }
+  else
+    {
+      bytes = g_file_load_bytes (compiled, NULL, NULL, NULL);
+    }
+
+  g_object_unref (compiled);
+
+  return bytes;
+}
+
+/* Loads the compiled version of @file, if there is an up-to-date one.
+ * If this returns %FALSE, @css_provider is still empty.
+ */
+static gboolean
+gtk_css_provider_load_compiled (GtkCssProvider *css_provider,
+                                GFile          *file)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+  GVariant *variant, *files, *tree, *values, *rulesets, *colors, *keyframes;
+  const char *magic, *version;
+  guchar pointer_size, byte_order;
+  GBytes *bytes;
+  gboolean result;
+
+  /* Compiled providers don't know where things were defined */
+  if (gtk_keep_css_sections)
+    return FALSE;
+
+  bytes = gtk_css_provider_load_compiled_bytes (file);
+  if (bytes == NULL)
+    return FALSE;
+
+  variant = g_variant_new_from_bytes (G_VARIANT_TYPE (GTK_CSS_PROVIDER_COMPILED_TYPE), bytes, FALSE);
+  g_variant_ref_sink (variant);
+  g_bytes_unref (bytes);
+
+  g_variant_get (variant, "(&s&syy@a(ss)@(asay)@a(ss)@a(tuau)@a(ss)@a(ss))",
+                 &magic, &version, &pointer_size, &byte_order,
+                 &files, &tree, &values, &rulesets, &colors, &keyframes);
+
+  result = g_str_equal (magic, GTK_CSS_PROVIDER_COMPILED_MAGIC) &&
+           g_str_equal (version, GTK_VERSION) &&
+           pointer_size == sizeof (gpointer) &&
+           byte_order == GTK_CSS_PROVIDER_COMPILED_BYTE_ORDER &&
+           gtk_css_provider_compiled_files_are_fresh (files);
+
+  if (result)
+    result = gtk_css_provider_load_compiled_values (css_provider, files, tree, values,
+                                                    rulesets, colors, keyframes);
+
+  if (result)
+    priv->loaded_compiled = TRUE;
+  else
+    gtk_css_provider_reset (css_provider);
+
+  g_variant_unref (files);
+  g_variant_unref (tree);
+  g_variant_unref (values);
+  g_variant_unref (rulesets);
+  g_variant_unref (colors);
+  g_variant_unref (keyframes);
+  g_variant_unref (variant);
+
+  return result;
+}
+
+/*
+ * gtk_css_provider_is_compiled:
+ * @provider: a #GtkCssProvider
+ *
+ * Checks whether @provider was loaded from a compiled file instead
+ * of parsing CSS. This is meant for tests.
+ *
+ * Returns: %TRUE if the compiled file was used
+ */
+gboolean
+gtk_css_provider_is_compiled (GtkCssProvider *provider)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (provider);
+
+  g_return_val_if_fail (GTK_IS_CSS_PROVIDER (provider), FALSE);
+
+  return priv->loaded_compiled;
+}
+
 /**
  * gtk_css_provider_load_from_data:
  * @css_provider: a #GtkCssProvider
@@ -1504,7 +2097,8 @@ gtk_css_provider_load_from_file (GtkCssProvider  *css_provider,
 
   gtk_css_provider_reset (css_provider);
 
-  gtk_css_provider_load_internal (css_provider, NULL, file, NULL);
+  if (!gtk_css_provider_load_compiled (css_provider, file))
+    gtk_css_provider_load_internal (css_provider, NULL, file, NULL);
 
   gtk_style_provider_changed (GTK_STYLE_PROVIDER (css_provider));
 }
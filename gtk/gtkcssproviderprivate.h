@@ -32,6 +32,12 @@ void   _gtk_css_provider_load_named    (GtkCssProvider *provider,
 
 void   gtk_css_provider_set_keep_css_sections (void);
 
+GDK_AVAILABLE_IN_ALL
+GBytes *gtk_css_provider_compile       (GtkCssProvider  *provider,
+                                        GError         **error);
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_css_provider_is_compiled  (GtkCssProvider  *provider);
+
 G_END_DECLS
 
 #endif /* __GTK_CSS_PROVIDER_PRIVATE_H__ */
@@ -34,6 +34,7 @@ struct _GtkCssRbTree
   GDestroyNotify clear_augment_func;
 
   GtkCssRbNode *root;
+  guint n_nodes;
 };
 
 struct _GtkCssRbNode
@@ -66,6 +67,8 @@ gtk_css_rb_node_new (GtkCssRbTree *tree)
   result->red = TRUE;
   result->dirty = TRUE;
 
+  tree->n_nodes++;
+
   return result;
 }
 
@@ -79,6 +82,8 @@ gtk_css_rb_node_free (GtkCssRbTree *tree,
     tree->clear_augment_func (NODE_TO_AUG_POINTER (tree, node));
 
   g_slice_free1 (gtk_css_rb_node_get_size (tree), node);
+
+  tree->n_nodes--;
 }
 
 static void
@@ -550,6 +555,9 @@ gtk_css_rb_tree_insert_before (GtkCssRbTree *tree,
 {
   GtkCssRbNode *result;
 
+  if (tree->root != NULL && node == NULL)
+    return gtk_css_rb_tree_insert_after (tree, gtk_css_rb_tree_get_last (tree));
+
   /* setup new node */
   result = gtk_css_rb_node_new (tree);
 
@@ -558,10 +566,6 @@ gtk_css_rb_tree_insert_before (GtkCssRbTree *tree,
       g_assert (node == NULL);
       tree->root = result;
     }
-  else if (node == NULL)
-    {
-      return gtk_css_rb_tree_insert_after (tree, gtk_css_rb_tree_get_last (tree));
-    }
   else
     {
       GtkCssRbNode *current = NODE_FROM_POINTER (node);
@@ -590,6 +594,9 @@ gtk_css_rb_tree_insert_after (GtkCssRbTree *tree,
 {
   GtkCssRbNode *result;
 
+  if (tree->root != NULL && node == NULL)
+    return gtk_css_rb_tree_insert_before (tree, gtk_css_rb_tree_get_first (tree));
+
   /* setup new node */
   result = gtk_css_rb_node_new (tree);
 
@@ -598,10 +605,6 @@ gtk_css_rb_tree_insert_after (GtkCssRbTree *tree,
       g_assert (node == NULL);
       tree->root = result;
     }
-  else if (node == NULL)
-    {
-      return gtk_css_rb_tree_insert_before (tree, gtk_css_rb_tree_get_first (tree));
-    }
   else
     {
       GtkCssRbNode *current = NODE_FROM_POINTER (node);
@@ -624,6 +627,107 @@ gtk_css_rb_tree_insert_after (GtkCssRbTree *tree,
   return NODE_TO_POINTER (result);
 }
 
+/* Links the nodes into a balanced tree. All nodes are black, except
+ * for the ones at red_depth, which is the last level if it isn't full.
+ * That way all paths have the same number of black nodes. */
+static GtkCssRbNode *
+gtk_css_rb_node_build (GtkCssRbNode **nodes,
+                       guint          n_nodes,
+                       guint          depth,
+                       guint          red_depth,
+                       GtkCssRbNode  *parent)
+{
+  GtkCssRbNode *node;
+  guint mid;
+
+  if (n_nodes == 0)
+    return NULL;
+
+  mid = n_nodes / 2;
+  node = nodes[mid];
+  node->red = depth == red_depth;
+  node->dirty = TRUE;
+  node->parent = parent;
+  node->left = gtk_css_rb_node_build (nodes, mid, depth + 1, red_depth, node);
+  node->right = gtk_css_rb_node_build (nodes + mid + 1, n_nodes - mid - 1, depth + 1, red_depth, node);
+
+  return node;
+}
+
+/*
+ * gtk_css_rb_tree_insert_n_before:
+ * @tree: a #GtkCssRbTree
+ * @node: (nullable): the node to insert before or %NULL to append
+ * @n: the number of nodes to insert
+ *
+ * Inserts @n consecutive new nodes before @node, like calling
+ * gtk_css_rb_tree_insert_before() @n times.
+ *
+ * If @n isn't small compared to the size of @tree, the whole tree is
+ * rebuilt as a balanced tree in linear time instead of rebalancing it
+ * for every node. Existing nodes stay valid either way, but all of
+ * their augments need to be recomputed.
+ *
+ * Returns: (nullable): the first inserted node or %NULL if @n is 0
+ */
+gpointer
+gtk_css_rb_tree_insert_n_before (GtkCssRbTree *tree,
+                                 gpointer      node,
+                                 guint         n)
+{
+  GtkCssRbNode **nodes, *iter, *before, *first;
+  guint i, start, n_nodes, red_depth;
+  gpointer result;
+
+  if (n == 0)
+    return NULL;
+
+  /* n insertions cost O(n log N), rebuilding costs O(N + n) */
+  if (n < tree->n_nodes / 8)
+    {
+      result = gtk_css_rb_tree_insert_before (tree, node);
+      for (i = 1; i < n; i++)
+        gtk_css_rb_tree_insert_before (tree, node);
+
+      return result;
+    }
+
+  before = NODE_FROM_POINTER (node);
+  n_nodes = tree->n_nodes + n;
+  nodes = g_new (GtkCssRbNode *, n_nodes);
+
+  /* Leave a gap for the new nodes */
+  start = tree->n_nodes;
+  i = 0;
+  for (iter = tree->root ? gtk_css_rb_node_get_first (tree->root) : NULL;
+       iter != NULL;
+       iter = gtk_css_rb_node_get_next (iter))
+    {
+      if (iter == before)
+        {
+          start = i;
+          i += n;
+        }
+      nodes[i++] = iter;
+    }
+
+  for (i = start; i < start + n; i++)
+    nodes[i] = gtk_css_rb_node_new (tree);
+
+  /* The last level is full if n_nodes + 1 is a power of 2 */
+  if ((n_nodes & (n_nodes + 1)) == 0)
+    red_depth = G_MAXUINT;
+  else
+    red_depth = g_bit_storage (n_nodes) - 1;
+
+  tree->root = gtk_css_rb_node_build (nodes, n_nodes, 0, red_depth, NULL);
+  first = nodes[start];
+
+  g_free (nodes);
+
+  return NODE_TO_POINTER (first);
+}
+
 void
 gtk_css_rb_tree_remove (GtkCssRbTree *tree,
                         gpointer      node)
@@ -72,6 +72,9 @@ gpointer                gtk_css_rb_tree_insert_before   (GtkCssRbTree
                                                          gpointer                node);
 gpointer                gtk_css_rb_tree_insert_after    (GtkCssRbTree           *tree,
                                                          gpointer                node);
+gpointer                gtk_css_rb_tree_insert_n_before (GtkCssRbTree           *tree,
+                                                         gpointer                node,
+                                                         guint                   n);
 void                    gtk_css_rb_tree_remove          (GtkCssRbTree           *tree,
                                                          gpointer                node);
 void                    gtk_css_rb_tree_remove_all      (GtkCssRbTree           *tree);
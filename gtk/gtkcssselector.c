@@ -1476,6 +1476,80 @@ gtk_css_selectors_skip_initial_selector (GtkCssSelector *selector, const GtkCssS
   return (GtkCssSelector *)gtk_css_selector_previous (selector);
 }
 
+/* Checks the simple selectors of @tree up to the next combinator
+ * against the ancestor filter. If this returns %FALSE, no ancestor
+ * can match them.
+ */
+static gboolean
+gtk_css_selector_tree_ancestor_may_match (const GtkCssSelectorTree   *tree,
+                                          const GtkCssAncestorFilter *filter)
+{
+  const GtkCssSelectorTree *prev;
+
+  if (tree->selector.class == &GTK_CSS_SELECTOR_NAME)
+    {
+      if (!gtk_css_ancestor_filter_may_contain (filter, gtk_css_ancestor_filter_hash_name (tree->selector.name.name)))
+        return FALSE;
+    }
+  else if (tree->selector.class == &GTK_CSS_SELECTOR_CLASS)
+    {
+      if (!gtk_css_ancestor_filter_may_contain (filter, gtk_css_ancestor_filter_hash_class (tree->selector.style_class.style_class)))
+        return FALSE;
+    }
+  else if (tree->selector.class == &GTK_CSS_SELECTOR_ID)
+    {
+      if (!gtk_css_ancestor_filter_may_contain (filter, gtk_css_ancestor_filter_hash_id (tree->selector.id.name)))
+        return FALSE;
+    }
+  else if (!tree->selector.class->is_simple)
+    {
+      return TRUE;
+    }
+
+  if (gtk_css_selector_tree_get_matches (tree))
+    return TRUE;
+
+  for (prev = gtk_css_selector_tree_get_previous (tree);
+       prev != NULL;
+       prev = gtk_css_selector_tree_get_sibling (prev))
+    {
+      if (gtk_css_selector_tree_ancestor_may_match (prev, filter))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Descendant and child combinators walk up the ancestors of @matcher,
+ * which is expensive in deep trees. Avoid that if the ancestor filter
+ * shows that none of the selectors before @combinator can match.
+ */
+static gboolean
+gtk_css_selector_tree_ancestors_may_match (const GtkCssSelectorTree *combinator,
+                                           const GtkCssMatcher      *matcher)
+{
+  const GtkCssAncestorFilter *filter;
+  const GtkCssSelectorTree *prev;
+
+  if (combinator->selector.class != &GTK_CSS_SELECTOR_DESCENDANT &&
+      combinator->selector.class != &GTK_CSS_SELECTOR_CHILD)
+    return TRUE;
+
+  filter = _gtk_css_matcher_get_ancestor_filter (matcher);
+  if (filter == NULL)
+    return TRUE;
+
+  for (prev = gtk_css_selector_tree_get_previous (combinator);
+       prev != NULL;
+       prev = gtk_css_selector_tree_get_sibling (prev))
+    {
+      if (gtk_css_selector_tree_ancestor_may_match (prev, filter))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 static gboolean
 gtk_css_selector_tree_match_foreach (const GtkCssSelector *selector,
                                      const GtkCssMatcher  *matcher,
@@ -1492,7 +1566,12 @@ gtk_css_selector_tree_match_foreach (const GtkCssSelector *selector,
   for (prev = gtk_css_selector_tree_get_previous (tree);
        prev != NULL;
        prev = gtk_css_selector_tree_get_sibling (prev))
-    gtk_css_selector_foreach (&prev->selector, matcher, gtk_css_selector_tree_match_foreach, res);
+    {
+      if (!gtk_css_selector_tree_ancestors_may_match (prev, matcher))
+        continue;
+
+      gtk_css_selector_foreach (&prev->selector, matcher, gtk_css_selector_tree_match_foreach, res);
+    }
 
   return FALSE;
 }
@@ -1903,3 +1982,398 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 
   return tree;
 }
+
+/* SERIALIZATION
+ *
+ * The tree is one blob of memory with node-relative offsets, so it can be
+ * saved by replacing the pointers it contains with indexes: selector classes
+ * are replaced by their index in selector_classes, names, ids and style
+ * classes by their index in a string table and matches by their index + 1
+ * in the array of matches passed to _gtk_css_selector_tree_deserialize().
+ */
+
+static const GtkCssSelectorClass *selector_classes[] = {
+  &GTK_CSS_SELECTOR_DESCENDANT,
+  &GTK_CSS_SELECTOR_CHILD,
+  &GTK_CSS_SELECTOR_SIBLING,
+  &GTK_CSS_SELECTOR_ADJACENT,
+  &GTK_CSS_SELECTOR_ANY,
+  &GTK_CSS_SELECTOR_NOT_ANY,
+  &GTK_CSS_SELECTOR_NAME,
+  &GTK_CSS_SELECTOR_NOT_NAME,
+  &GTK_CSS_SELECTOR_CLASS,
+  &GTK_CSS_SELECTOR_NOT_CLASS,
+  &GTK_CSS_SELECTOR_ID,
+  &GTK_CSS_SELECTOR_NOT_ID,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_POSITION,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_POSITION
+};
+
+static gsize
+gtk_css_selector_tree_get_size (const GtkCssSelectorTree *tree,
+                                const guint8             *data)
+{
+  gsize size = 0;
+
+  for (; tree != NULL; tree = gtk_css_selector_tree_get_sibling (tree))
+    {
+      gpointer *matches;
+
+      size = MAX (size, (const guint8 *) tree - data + sizeof (GtkCssSelectorTree));
+
+      matches = gtk_css_selector_tree_get_matches (tree);
+      if (matches)
+        {
+          guint i;
+
+          for (i = 0; matches[i] != NULL; i++)
+            ;
+          size = MAX (size, (const guint8 *) &matches[i + 1] - data);
+        }
+
+      size = MAX (size, gtk_css_selector_tree_get_size (gtk_css_selector_tree_get_previous (tree), data));
+    }
+
+  return size;
+}
+
+static guint
+gtk_css_selector_tree_add_string (GHashTable *string_indexes,
+                                  GPtrArray  *strings,
+                                  const char *string)
+{
+  gpointer index;
+
+  if (g_hash_table_lookup_extended (string_indexes, string, NULL, &index))
+    return GPOINTER_TO_UINT (index);
+
+  index = GUINT_TO_POINTER (strings->len);
+  g_hash_table_insert (string_indexes, (gpointer) string, index);
+  g_ptr_array_add (strings, (gpointer) string);
+
+  return GPOINTER_TO_UINT (index);
+}
+
+static void
+gtk_css_selector_tree_serialize_nodes (GtkCssSelectorTree *tree,
+                                       GHashTable         *match_indexes,
+                                       GHashTable         *string_indexes,
+                                       GPtrArray          *strings)
+{
+  for (; tree != NULL; tree = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (tree))
+    {
+      const GtkCssSelectorClass *class = tree->selector.class;
+      gpointer *matches;
+      guint i;
+
+      if (class == &GTK_CSS_SELECTOR_NAME || class == &GTK_CSS_SELECTOR_NOT_NAME)
+        {
+          i = gtk_css_selector_tree_add_string (string_indexes, strings, tree->selector.name.name);
+          tree->selector.name.name = GUINT_TO_POINTER (i);
+        }
+      else if (class == &GTK_CSS_SELECTOR_ID || class == &GTK_CSS_SELECTOR_NOT_ID)
+        {
+          i = gtk_css_selector_tree_add_string (string_indexes, strings, tree->selector.id.name);
+          tree->selector.id.name = GUINT_TO_POINTER (i);
+        }
+      else if (class == &GTK_CSS_SELECTOR_CLASS || class == &GTK_CSS_SELECTOR_NOT_CLASS)
+        {
+          i = gtk_css_selector_tree_add_string (string_indexes, strings,
+                                                g_quark_to_string (tree->selector.style_class.style_class));
+          tree->selector.style_class.style_class = i;
+        }
+
+      for (i = 0; i < G_N_ELEMENTS (selector_classes); i++)
+        {
+          if (selector_classes[i] == class)
+            break;
+        }
+      g_assert (i < G_N_ELEMENTS (selector_classes));
+      tree->selector.class = GUINT_TO_POINTER (i);
+
+      matches = gtk_css_selector_tree_get_matches (tree);
+      if (matches)
+        {
+          for (i = 0; matches[i] != NULL; i++)
+            matches[i] = g_hash_table_lookup (match_indexes, matches[i]);
+        }
+
+      gtk_css_selector_tree_serialize_nodes ((GtkCssSelectorTree *) gtk_css_selector_tree_get_previous (tree),
+                                             match_indexes,
+                                             string_indexes,
+                                             strings);
+    }
+}
+
+/**
+ * _gtk_css_selector_tree_serialize:
+ * @tree: (allow-none): the tree to serialize
+ * @matches: the matches added to the tree builder
+ * @n_matches: number of @matches
+ *
+ * Serializes @tree into a #GVariant of type "(asay)", see
+ * _gtk_css_selector_tree_deserialize(). Every match in @tree must be
+ * part of @matches.
+ *
+ * The result depends on the pointer size and byte order of the machine.
+ *
+ * Returns: (transfer floating): the serialized tree
+ **/
+GVariant *
+_gtk_css_selector_tree_serialize (const GtkCssSelectorTree *tree,
+                                  gpointer                 *matches,
+                                  guint                     n_matches)
+{
+  GHashTable *match_indexes, *string_indexes;
+  GPtrArray *strings;
+  GVariant *result;
+  guint8 *data;
+  gsize size;
+  guint i;
+
+  if (tree == NULL)
+    {
+      const char *empty = NULL;
+
+      return g_variant_new ("(^as@ay)",
+                            &empty,
+                            g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, NULL, 0, 1));
+    }
+
+  size = gtk_css_selector_tree_get_size (tree, (const guint8 *) tree);
+  data = g_memdup (tree, size);
+
+  match_indexes = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < n_matches; i++)
+    g_hash_table_insert (match_indexes, matches[i], GUINT_TO_POINTER (i + 1));
+  string_indexes = g_hash_table_new (g_str_hash, g_str_equal);
+  strings = g_ptr_array_new ();
+
+  gtk_css_selector_tree_serialize_nodes ((GtkCssSelectorTree *) data, match_indexes, string_indexes, strings);
+  g_ptr_array_add (strings, NULL);
+
+  result = g_variant_new ("(^as@ay)",
+                          (const char **) strings->pdata,
+                          g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, data, size, 1));
+
+  g_ptr_array_free (strings, TRUE);
+  g_hash_table_unref (string_indexes);
+  g_hash_table_unref (match_indexes);
+  g_free (data);
+
+  return result;
+}
+
+static gboolean
+gtk_css_selector_tree_check_offset (const guint8 *data,
+                                    gsize         size,
+                                    const guint8 *node,
+                                    gint32        offset,
+                                    gsize         needed)
+{
+  gssize pos;
+
+  if (offset == GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+    return TRUE;
+
+  pos = node - data + offset;
+
+  return pos >= 0 &&
+         pos % sizeof (gpointer) == 0 &&
+         pos + needed <= size;
+}
+
+/* @visited has one byte per pointer-sized slot of the blob and marks
+ * the slots where nodes start. A node reached twice means the offsets
+ * form a cycle or a shared subtree, which the builder never creates.
+ */
+static gboolean
+gtk_css_selector_tree_deserialize_nodes (GtkCssSelectorTree  *tree,
+                                         const guint8        *data,
+                                         gsize                size,
+                                         guint8              *visited,
+                                         const char         **strings,
+                                         guint                n_strings,
+                                         gpointer            *matches,
+                                         guint                n_matches)
+{
+  for (; tree != NULL; tree = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (tree))
+    {
+      const GtkCssSelectorClass *class;
+      gpointer *tree_matches;
+      gsize slot;
+      guint i;
+
+      slot = ((const guint8 *) tree - data) / sizeof (gpointer);
+      if (visited[slot])
+        return FALSE;
+      visited[slot] = TRUE;
+
+      if (!gtk_css_selector_tree_check_offset (data, size, (guint8 *) tree, tree->previous_offset, sizeof (GtkCssSelectorTree)) ||
+          !gtk_css_selector_tree_check_offset (data, size, (guint8 *) tree, tree->sibling_offset, sizeof (GtkCssSelectorTree)) ||
+          !gtk_css_selector_tree_check_offset (data, size, (guint8 *) tree, tree->parent_offset, sizeof (GtkCssSelectorTree)) ||
+          !gtk_css_selector_tree_check_offset (data, size, (guint8 *) tree, tree->matches_offset, sizeof (gpointer)))
+        return FALSE;
+
+      i = GPOINTER_TO_UINT (tree->selector.class);
+      if (i >= G_N_ELEMENTS (selector_classes))
+        return FALSE;
+      class = selector_classes[i];
+      tree->selector.class = class;
+
+      if (class == &GTK_CSS_SELECTOR_NAME || class == &GTK_CSS_SELECTOR_NOT_NAME)
+        {
+          i = GPOINTER_TO_UINT (tree->selector.name.name);
+          if (i >= n_strings)
+            return FALSE;
+          tree->selector.name.name = g_intern_string (strings[i]);
+        }
+      else if (class == &GTK_CSS_SELECTOR_ID || class == &GTK_CSS_SELECTOR_NOT_ID)
+        {
+          i = GPOINTER_TO_UINT (tree->selector.id.name);
+          if (i >= n_strings)
+            return FALSE;
+          tree->selector.id.name = g_intern_string (strings[i]);
+        }
+      else if (class == &GTK_CSS_SELECTOR_CLASS || class == &GTK_CSS_SELECTOR_NOT_CLASS)
+        {
+          i = tree->selector.style_class.style_class;
+          if (i >= n_strings)
+            return FALSE;
+          tree->selector.style_class.style_class = g_quark_from_string (strings[i]);
+        }
+
+      tree_matches = gtk_css_selector_tree_get_matches (tree);
+      if (tree_matches)
+        {
+          for (i = 0; ; i++)
+            {
+              guint index;
+
+              if ((guint8 *) &tree_matches[i + 1] > data + size)
+                return FALSE;
+
+              index = GPOINTER_TO_UINT (tree_matches[i]);
+              if (index == 0)
+                break;
+              if (index > n_matches)
+                return FALSE;
+
+              tree_matches[i] = matches[index - 1];
+            }
+        }
+
+      if (!gtk_css_selector_tree_deserialize_nodes ((GtkCssSelectorTree *) gtk_css_selector_tree_get_previous (tree),
+                                                    data, size, visited,
+                                                    strings, n_strings,
+                                                    matches, n_matches))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * _gtk_css_selector_tree_deserialize:
+ * @variant: a #GVariant of type "(asay)" created by
+ *     _gtk_css_selector_tree_serialize()
+ * @matches: the matches to use
+ * @n_matches: number of @matches
+ * @node_offsets: (array length=n_node_offsets): offsets of nodes in the
+ *     serialized tree, or %G_MAXUINT32 for none
+ * @n_node_offsets: number of @node_offsets
+ * @out_tree: (out): return location for the tree, which may be %NULL
+ *     for an empty tree
+ *
+ * Recreates a tree saved with _gtk_css_selector_tree_serialize().
+ * @matches must correspond to the matches passed when serializing.
+ *
+ * The caller may turn @node_offsets into pointers into the returned
+ * tree, so they are checked to be the offsets of nodes of the tree.
+ *
+ * Returns: %FALSE if @variant is not a valid serialized tree
+ **/
+gboolean
+_gtk_css_selector_tree_deserialize (GVariant            *variant,
+                                    gpointer            *matches,
+                                    guint                n_matches,
+                                    const guint32       *node_offsets,
+                                    guint                n_node_offsets,
+                                    GtkCssSelectorTree **out_tree)
+{
+  GVariant *blob;
+  const char **strings;
+  gsize n_strings;
+  const guint8 *bytes;
+  guint8 *data, *visited;
+  gsize size;
+  guint i;
+
+  g_return_val_if_fail (g_variant_is_of_type (variant, G_VARIANT_TYPE ("(asay)")), FALSE);
+
+  g_variant_get (variant, "(^a&s@ay)", &strings, &blob);
+  bytes = g_variant_get_fixed_array (blob, &size, 1);
+
+  *out_tree = NULL;
+
+  if (size == 0)
+    {
+      g_free (strings);
+      g_variant_unref (blob);
+
+      for (i = 0; i < n_node_offsets; i++)
+        {
+          if (node_offsets[i] != G_MAXUINT32)
+            return FALSE;
+        }
+
+      return TRUE;
+    }
+
+  if (size < sizeof (GtkCssSelectorTree))
+    {
+      g_free (strings);
+      g_variant_unref (blob);
+      return FALSE;
+    }
+
+  n_strings = g_strv_length ((char **) strings);
+  data = g_memdup (bytes, size);
+  visited = g_new0 (guint8, size / sizeof (gpointer));
+
+  if (!gtk_css_selector_tree_deserialize_nodes ((GtkCssSelectorTree *) data,
+                                                data, size, visited,
+                                                strings, n_strings,
+                                                matches, n_matches))
+    goto fail;
+
+  for (i = 0; i < n_node_offsets; i++)
+    {
+      if (node_offsets[i] == G_MAXUINT32)
+        continue;
+
+      if (node_offsets[i] % sizeof (gpointer) != 0 ||
+          node_offsets[i] + sizeof (GtkCssSelectorTree) > size ||
+          !visited[node_offsets[i] / sizeof (gpointer)])
+        goto fail;
+    }
+
+  g_free (visited);
+
+  *out_tree = (GtkCssSelectorTree *) data;
+
+  g_free (strings);
+  g_variant_unref (blob);
+
+  return TRUE;
+
+fail:
+  g_free (visited);
+  g_free (data);
+  g_free (strings);
+  g_variant_unref (blob);
+
+  return FALSE;
+}
@@ -48,6 +48,16 @@ GtkCssChange _gtk_css_selector_tree_get_change_all   (const GtkCssSelectorTree *
 void         _gtk_css_selector_tree_match_print      (const GtkCssSelectorTree *tree,
 						      GString                  *str);
 
+GVariant *   _gtk_css_selector_tree_serialize        (const GtkCssSelectorTree *tree,
+                                                      gpointer                 *matches,
+                                                      guint                     n_matches);
+gboolean     _gtk_css_selector_tree_deserialize      (GVariant                 *variant,
+                                                      gpointer                 *matches,
+                                                      guint                     n_matches,
+                                                      const guint32            *node_offsets,
+                                                      guint                     n_node_offsets,
+                                                      GtkCssSelectorTree      **out_tree);
+
 
 GtkCssSelectorTreeBuilder *_gtk_css_selector_tree_builder_new   (void);
 void                       _gtk_css_selector_tree_builder_add   (GtkCssSelectorTreeBuilder *builder,
@@ -171,7 +171,7 @@ gtk_css_static_style_new_compute (GtkStyleProvider    *provider,
                                   const GtkCssMatcher *matcher,
                                   GtkCssStyle         *parent)
 {
-  GtkCssStaticStyle *result;
+  GtkCssStyle *result;
   GtkCssLookup lookup;
   GtkCssChange change = GTK_CSS_CHANGE_ANY_SELF | GTK_CSS_CHANGE_ANY_SIBLING | GTK_CSS_CHANGE_ANY_PARENT;
 
@@ -183,20 +183,207 @@ gtk_css_static_style_new_compute (GtkStyleProvider    *provider,
                                &lookup,
                                &change);
 
+  result = gtk_css_static_style_new_from_lookup (provider, &lookup, change, parent);
+
+  _gtk_css_lookup_destroy (&lookup);
+
+  return result;
+}
+
+/**
+ * gtk_css_static_style_new_from_lookup:
+ * @provider: the style provider
+ * @lookup: the result of looking up all properties in @provider
+ * @lookup_change: the change returned by that lookup
+ * @parent: (allow-none): the parent style
+ *
+ * Computes a new style from the result of a previous lookup. This is
+ * used for lookups that were done ahead of time, possibly in another
+ * thread. @lookup is not modified.
+ *
+ * Returns: the new style
+ **/
+GtkCssStyle *
+gtk_css_static_style_new_from_lookup (GtkStyleProvider *provider,
+                                      GtkCssLookup     *lookup,
+                                      GtkCssChange      lookup_change,
+                                      GtkCssStyle      *parent)
+{
+  GtkCssStaticStyle *result;
+
   result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
 
-  result->change = change;
+  result->change = lookup_change;
 
-  _gtk_css_lookup_resolve (&lookup,
+  _gtk_css_lookup_resolve (lookup,
                            provider,
                            result,
                            parent);
 
-  _gtk_css_lookup_destroy (&lookup);
-
   return GTK_CSS_STYLE (result);
 }
 
+static guint n_updated = 0;
+static guint n_recomputed = 0;
+
+/* Properties that other properties refer to while computing their
+ * values, like currentColor or em units. If one of those changes, we
+ * can't reuse the computed values of any other property. */
+static gboolean
+gtk_css_static_style_property_has_dependents (guint id)
+{
+  switch (id)
+    {
+    case GTK_CSS_PROPERTY_COLOR:
+    case GTK_CSS_PROPERTY_DPI:
+    case GTK_CSS_PROPERTY_FONT_SIZE:
+    case GTK_CSS_PROPERTY_ICON_THEME:
+    case GTK_CSS_PROPERTY_ICON_PALETTE:
+    case GTK_CSS_PROPERTY_BACKGROUND_COLOR:
+    case GTK_CSS_PROPERTY_BORDER_TOP_STYLE:
+    case GTK_CSS_PROPERTY_BORDER_LEFT_STYLE:
+    case GTK_CSS_PROPERTY_BORDER_BOTTOM_STYLE:
+    case GTK_CSS_PROPERTY_BORDER_RIGHT_STYLE:
+    case GTK_CSS_PROPERTY_OUTLINE_STYLE:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/**
+ * gtk_css_static_style_new_update:
+ * @style: the previous style of the node
+ * @provider: the style provider
+ * @matcher: the matcher for the node
+ * @prefetched: (allow-none): the result of looking up all properties
+ *     for @matcher ahead of time
+ * @prefetched_change: the change returned by the lookup of @prefetched
+ * @parent: (allow-none): the parent style
+ * @change: the change that happened since @style was computed
+ *
+ * Computes a new style for a node by only recomputing the properties
+ * that may be affected by @change and reusing all other values from
+ * @style. This is only valid if the change does not include changes
+ * to the parent style or the style provider.
+ *
+ * If @prefetched is given, the affected properties are taken from it
+ * instead of being looked up again.
+ *
+ * Returns: (nullable): the new style or %NULL if the style must be
+ *     computed from scratch via gtk_css_static_style_new_compute()
+ **/
+GtkCssStyle *
+gtk_css_static_style_new_update (GtkCssStaticStyle   *style,
+                                 GtkStyleProvider    *provider,
+                                 const GtkCssMatcher *matcher,
+                                 GtkCssLookup        *prefetched,
+                                 GtkCssChange         prefetched_change,
+                                 GtkCssStyle         *parent,
+                                 GtkCssChange         change)
+{
+  GtkCssStaticStyle *result;
+  GtkBitmask *affected;
+  GtkCssLookup own_lookup, *lookup;
+  GtkCssChange lookup_change;
+  guint i;
+
+  gtk_internal_return_val_if_fail (GTK_IS_CSS_STATIC_STYLE (style), NULL);
+  gtk_internal_return_val_if_fail (matcher != NULL, NULL);
+
+  affected = _gtk_bitmask_new ();
+  if (!gtk_style_provider_get_change_properties (provider, change & style->change, &affected))
+    {
+      _gtk_bitmask_free (affected);
+      g_atomic_int_inc (&n_recomputed);
+      return NULL;
+    }
+
+  /* No rule depends on the change, so the matched rules are the same */
+  if (_gtk_bitmask_is_empty (affected))
+    {
+      _gtk_bitmask_free (affected);
+      return g_object_ref (GTK_CSS_STYLE (style));
+    }
+
+  if (prefetched)
+    {
+      lookup = prefetched;
+      lookup_change = prefetched_change;
+    }
+  else
+    {
+      lookup = &own_lookup;
+      _gtk_css_lookup_init (lookup, affected);
+
+      gtk_style_provider_lookup (provider,
+                                 matcher,
+                                 lookup,
+                                 &lookup_change);
+    }
+
+  result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
+
+  result->change = lookup_change;
+
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (!_gtk_bitmask_get (affected, i))
+        {
+          gtk_css_static_style_set_value (result,
+                                          i,
+                                          style->values[i],
+                                          gtk_css_style_get_section (GTK_CSS_STYLE (style), i));
+          continue;
+        }
+
+      gtk_css_static_style_compute_value (result,
+                                          provider,
+                                          parent,
+                                          i,
+                                          lookup->values[i].value,
+                                          lookup->values[i].section);
+
+      if (gtk_css_static_style_property_has_dependents (i) &&
+          !_gtk_css_value_equal (result->values[i], style->values[i]))
+        {
+          g_clear_object (&result);
+          break;
+        }
+    }
+
+  if (lookup == &own_lookup)
+    _gtk_css_lookup_destroy (lookup);
+  _gtk_bitmask_free (affected);
+
+  if (result)
+    g_atomic_int_inc (&n_updated);
+  else
+    g_atomic_int_inc (&n_recomputed);
+
+  return (GtkCssStyle *) result;
+}
+
+/*
+ * gtk_css_static_style_get_update_stats:
+ * @updated: (out) (optional): number of styles that were updated
+ *     by gtk_css_static_style_new_update()
+ * @recomputed: (out) (optional): number of times it asked for a
+ *     full recompute instead
+ *
+ * Gets statistics about partial style updates. This is meant for tests.
+ */
+void
+gtk_css_static_style_get_update_stats (guint *updated,
+                                       guint *recomputed)
+{
+  if (updated)
+    *updated = g_atomic_int_get (&n_updated);
+  if (recomputed)
+    *recomputed = g_atomic_int_get (&n_recomputed);
+}
+
 void
 gtk_css_static_style_compute_value (GtkCssStaticStyle *style,
                                     GtkStyleProvider  *provider,
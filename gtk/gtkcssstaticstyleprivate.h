@@ -56,6 +56,17 @@ GtkCssStyle *           gtk_css_static_style_get_default        (void);
 GtkCssStyle *           gtk_css_static_style_new_compute        (GtkStyleProvider       *provider,
                                                                  const GtkCssMatcher    *matcher,
                                                                  GtkCssStyle            *parent);
+GtkCssStyle *           gtk_css_static_style_new_from_lookup    (GtkStyleProvider       *provider,
+                                                                 struct _GtkCssLookup   *lookup,
+                                                                 GtkCssChange            lookup_change,
+                                                                 GtkCssStyle            *parent);
+GtkCssStyle *           gtk_css_static_style_new_update         (GtkCssStaticStyle      *style,
+                                                                 GtkStyleProvider       *provider,
+                                                                 const GtkCssMatcher    *matcher,
+                                                                 struct _GtkCssLookup   *prefetched,
+                                                                 GtkCssChange            prefetched_change,
+                                                                 GtkCssStyle            *parent,
+                                                                 GtkCssChange            change);
 
 void                    gtk_css_static_style_compute_value      (GtkCssStaticStyle      *style,
                                                                  GtkStyleProvider       *provider,
@@ -66,6 +77,10 @@ void                    gtk_css_static_style_compute_value      (GtkCssStaticSty
 
 GtkCssChange            gtk_css_static_style_get_change         (GtkCssStaticStyle      *style);
 
+GDK_AVAILABLE_IN_ALL
+void                    gtk_css_static_style_get_update_stats   (guint                  *updated,
+                                                                 guint                  *recomputed);
+
 G_END_DECLS
 
 #endif /* __GTK_CSS_STATIC_STYLE_PRIVATE_H__ */
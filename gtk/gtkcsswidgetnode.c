@@ -21,6 +21,7 @@
 
 #include "gtkcontainerprivate.h"
 #include "gtkcssanimatedstyleprivate.h"
+#include "gtkcssprefetchprivate.h"
 #include "gtkprivate.h"
 #include "gtksettingsprivate.h"
 #include "gtkstylecontextprivate.h"
@@ -244,6 +245,7 @@ gtk_css_widget_node_widget_destroyed (GtkCssWidgetNode *node)
   gtk_internal_return_if_fail (node->widget != NULL);
 
   node->widget = NULL;
+  gtk_css_prefetch_tree_changed ();
   /* Contents of this node are now undefined.
    * So we don't clear the style or anything.
    */
@@ -35,13 +35,30 @@
  * listmodel.
  * It hides some elements from the other model according to
  * criteria given by a #GtkFilterListModelFilterFunc.
+ *
+ * When filtering takes too long, #GtkFilterListModel:incremental can
+ * be set. The model will then refilter its items in small steps while
+ * the main loop is idle, emitting #GListModel::items-changed for the
+ * items it refiltered. The #GtkFilterListModel:pending property tells
+ * how many items remain to be refiltered.
+ *
+ * When the filter changes in a way that only hides items or only shows
+ * items, gtk_filter_list_model_refilter_with_change() avoids checking
+ * the items that cannot change.
  */
 
+/* Incremental filtering checks the time after this many items */
+#define FILTER_STEP_SIZE 256
+/* Time incremental filtering may take per main loop iteration, in µs */
+#define FILTER_SLICE_USEC 1000
+
 enum {
   PROP_0,
   PROP_HAS_FILTER,
+  PROP_INCREMENTAL,
   PROP_ITEM_TYPE,
   PROP_MODEL,
+  PROP_PENDING,
   NUM_PROPERTIES
 };
 
@@ -70,6 +87,11 @@ struct _GtkFilterListModel
   GDestroyNotify user_destroy;
 
   GtkCssRbTree *items; /* NULL if filter_func == NULL */
+
+  guint incremental : 1;
+  guint filter_source; /* idle source of incremental filtering, 0 if not filtering */
+  guint filter_position; /* first item that still needs to be refiltered */
+  GtkFilterListModelChange filter_change; /* items that need to be refiltered */
 };
 
 struct _GtkFilterListModelClass
@@ -165,6 +187,126 @@ gtk_filter_list_model_get_nth (GtkCssRbTree *tree,
   return node;
 }
 
+/* Returns the position of node and the number of visible items
+ * before it in out_filtered */
+static guint
+gtk_filter_list_model_get_position (GtkCssRbTree *tree,
+                                    FilterNode   *node,
+                                    guint        *out_filtered)
+{
+  FilterNode *parent, *left;
+  FilterAugment *aug;
+  guint position, filtered;
+
+  position = 0;
+  filtered = 0;
+
+  left = gtk_css_rb_tree_get_left (tree, node);
+  if (left)
+    {
+      aug = gtk_css_rb_tree_get_augment (tree, left);
+      position += aug->n_items;
+      filtered += aug->n_visible;
+    }
+
+  for (parent = gtk_css_rb_tree_get_parent (tree, node);
+       parent != NULL;
+       node = parent, parent = gtk_css_rb_tree_get_parent (tree, node))
+    {
+      if (gtk_css_rb_tree_get_right (tree, parent) != node)
+        continue;
+
+      position++;
+      if (parent->visible)
+        filtered++;
+
+      left = gtk_css_rb_tree_get_left (tree, parent);
+      if (left)
+        {
+          aug = gtk_css_rb_tree_get_augment (tree, left);
+          position += aug->n_items;
+          filtered += aug->n_visible;
+        }
+    }
+
+  if (out_filtered)
+    *out_filtered = filtered;
+
+  return position;
+}
+
+static guint
+gtk_filter_list_model_count (GtkCssRbTree *tree,
+                             FilterNode   *node,
+                             gboolean      visible)
+{
+  FilterAugment *aug;
+
+  if (node == NULL)
+    return 0;
+
+  aug = gtk_css_rb_tree_get_augment (tree, node);
+
+  return visible ? aug->n_visible : aug->n_items - aug->n_visible;
+}
+
+/* Finds the first node below node that is visible or not, skipping
+ * subtrees without such nodes */
+static FilterNode *
+gtk_filter_list_model_get_first_with_visibility (GtkCssRbTree *tree,
+                                                 FilterNode   *node,
+                                                 gboolean      visible)
+{
+  FilterNode *left;
+
+  if (gtk_filter_list_model_count (tree, node, visible) == 0)
+    return NULL;
+
+  while (TRUE)
+    {
+      left = gtk_css_rb_tree_get_left (tree, node);
+      if (gtk_filter_list_model_count (tree, left, visible) > 0)
+        node = left;
+      else if (node->visible == visible)
+        return node;
+      else
+        node = gtk_css_rb_tree_get_right (tree, node);
+    }
+}
+
+static FilterNode *
+gtk_filter_list_model_get_next_with_visibility (GtkCssRbTree *tree,
+                                                FilterNode   *node,
+                                                gboolean      visible)
+{
+  FilterNode *parent, *result;
+
+  result = gtk_filter_list_model_get_first_with_visibility (tree,
+                                                            gtk_css_rb_tree_get_right (tree, node),
+                                                            visible);
+  if (result)
+    return result;
+
+  for (parent = gtk_css_rb_tree_get_parent (tree, node);
+       parent != NULL;
+       node = parent, parent = gtk_css_rb_tree_get_parent (tree, node))
+    {
+      if (gtk_css_rb_tree_get_left (tree, parent) != node)
+        continue;
+
+      if (parent->visible == visible)
+        return parent;
+
+      result = gtk_filter_list_model_get_first_with_visibility (tree,
+                                                                gtk_css_rb_tree_get_right (tree, parent),
+                                                                visible);
+      if (result)
+        return result;
+    }
+
+  return NULL;
+}
+
 static GType
 gtk_filter_list_model_get_item_type (GListModel *list)
 {
@@ -248,17 +390,175 @@ gtk_filter_list_model_add_items (GtkFilterListModel *self,
 
   n_visible = 0;
   
+  node = gtk_css_rb_tree_insert_n_before (self->items, after, n_items);
   for (i = 0; i < n_items; i++)
     {
-      node = gtk_css_rb_tree_insert_before (self->items, after);
       node->visible = gtk_filter_list_model_run_filter (self, position + i);
       if (node->visible)
         n_visible++;
+      node = gtk_css_rb_tree_get_next (self->items, node);
     }
 
   return n_visible;
 }
 
+/* Refilters the items starting at position until all items are
+ * refiltered or end_time is reached. position is set to the first
+ * item that wasn't refiltered. Depending on change, only the visible
+ * or hidden items are refiltered.
+ *
+ * Returns: %TRUE if the visible items changed and
+ *   #GListModel::items-changed needs to be emitted
+ */
+static gboolean
+gtk_filter_list_model_refilter_range (GtkFilterListModel       *self,
+                                      GtkFilterListModelChange  change,
+                                      guint                    *position,
+                                      gint64                    end_time,
+                                      guint                    *change_position,
+                                      guint                    *change_removed,
+                                      guint                    *change_added)
+{
+  FilterNode *node;
+  guint i, filtered, n_checked;
+  guint first_change, last_change, n_shown, n_hidden;
+  gboolean visible, check_visible;
+
+  /* Items that are hidden can only get shown if the filter
+   * gets less strict and the other way around */
+  check_visible = change == GTK_FILTER_LIST_MODEL_CHANGE_MORE_STRICT;
+
+  i = *position;
+  node = gtk_filter_list_model_get_nth (self->items, i, &filtered);
+  if (node && change != GTK_FILTER_LIST_MODEL_CHANGE_DIFFERENT && node->visible != check_visible)
+    {
+      node = gtk_filter_list_model_get_next_with_visibility (self->items, node, check_visible);
+      if (node)
+        i = gtk_filter_list_model_get_position (self->items, node, &filtered);
+    }
+
+  first_change = G_MAXUINT;
+  last_change = 0;
+  n_shown = 0;
+  n_hidden = 0;
+  for (n_checked = 0; node != NULL; n_checked++)
+    {
+      if (n_checked > 0 && n_checked % FILTER_STEP_SIZE == 0 &&
+          g_get_monotonic_time () >= end_time)
+        break;
+
+      visible = gtk_filter_list_model_run_filter (self, i);
+      if (visible != node->visible)
+        {
+          node->visible = visible;
+          gtk_css_rb_tree_mark_dirty (self->items, node);
+          first_change = MIN (filtered, first_change);
+          if (visible)
+            n_shown++;
+          else
+            n_hidden++;
+          last_change = filtered + (visible ? 1 : 0);
+        }
+      if (visible)
+        filtered++;
+
+      if (change == GTK_FILTER_LIST_MODEL_CHANGE_DIFFERENT)
+        {
+          node = gtk_css_rb_tree_get_next (self->items, node);
+          i++;
+        }
+      else
+        {
+          node = gtk_filter_list_model_get_next_with_visibility (self->items, node, check_visible);
+          if (node)
+            i = gtk_filter_list_model_get_position (self->items, node, &filtered);
+        }
+    }
+
+  *position = node ? i : g_list_model_get_n_items (self->model);
+
+  if (first_change == G_MAXUINT)
+    return FALSE;
+
+  /* last_change is the end of the changed range after the change,
+   * before the change it was at last_change - n_shown + n_hidden */
+  *change_position = first_change;
+  *change_removed = last_change - n_shown + n_hidden - first_change;
+  *change_added = last_change - first_change;
+
+  return TRUE;
+}
+
+static void
+gtk_filter_list_model_stop_filtering (GtkFilterListModel *self)
+{
+  if (self->filter_source == 0)
+    return;
+
+  g_source_remove (self->filter_source);
+  self->filter_source = 0;
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+}
+
+/* Refilters incrementally until all items are refiltered or end_time
+ * is reached and emits the changes. */
+static void
+gtk_filter_list_model_run_filter_until (GtkFilterListModel *self,
+                                        gint64              end_time)
+{
+  guint position, removed, added;
+  gboolean changed;
+
+  changed = gtk_filter_list_model_refilter_range (self,
+                                                  self->filter_change,
+                                                  &self->filter_position,
+                                                  end_time,
+                                                  &position, &removed, &added);
+
+  if (self->filter_position >= g_list_model_get_n_items (self->model))
+    gtk_filter_list_model_stop_filtering (self);
+  else
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+
+  if (changed)
+    g_list_model_items_changed (G_LIST_MODEL (self), position, removed, added);
+}
+
+static gboolean
+gtk_filter_list_model_filter_cb (gpointer data)
+{
+  GtkFilterListModel *self = data;
+
+  gtk_filter_list_model_run_filter_until (self, g_get_monotonic_time () + FILTER_SLICE_USEC);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gtk_filter_list_model_start_filtering (GtkFilterListModel       *self,
+                                       GtkFilterListModelChange  change)
+{
+  /* Items that weren't refiltered yet may need to be refiltered
+   * for the previous change, too */
+  if (self->filter_source && self->filter_change != change)
+    change = GTK_FILTER_LIST_MODEL_CHANGE_DIFFERENT;
+
+  self->filter_change = change;
+  self->filter_position = 0;
+
+  if (self->filter_source == 0)
+    {
+      self->filter_source = g_idle_add_full (GDK_PRIORITY_REDRAW + 1,
+                                             gtk_filter_list_model_filter_cb,
+                                             self,
+                                             NULL);
+      g_source_set_name_by_id (self->filter_source, "[gtk+] gtk_filter_list_model_filter_cb");
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+}
+
 static void
 gtk_filter_list_model_items_changed_cb (GListModel         *model,
                                         guint               position,
@@ -289,6 +589,15 @@ gtk_filter_list_model_items_changed_cb (GListModel         *model,
 
   filter_added = gtk_filter_list_model_add_items (self, node, position, added);
 
+  /* Added items are filtered already */
+  if (self->filter_source && position < self->filter_position)
+    {
+      if (position + removed <= self->filter_position)
+        self->filter_position += added - removed;
+      else
+        self->filter_position = position + added;
+    }
+
   if (filter_removed > 0 || filter_added > 0)
     g_list_model_items_changed (G_LIST_MODEL (self), filter_position, filter_removed, filter_added);
 }
@@ -303,6 +612,10 @@ gtk_filter_list_model_set_property (GObject      *object,
 
   switch (prop_id)
     {
+    case PROP_INCREMENTAL:
+      gtk_filter_list_model_set_incremental (self, g_value_get_boolean (value));
+      break;
+
     case PROP_ITEM_TYPE:
       self->item_type = g_value_get_gtype (value);
       break;
@@ -331,6 +644,10 @@ gtk_filter_list_model_get_property (GObject     *object,
       g_value_set_boolean (value, self->items != NULL);
       break;
 
+    case PROP_INCREMENTAL:
+      g_value_set_boolean (value, self->incremental);
+      break;
+
     case PROP_ITEM_TYPE:
       g_value_set_gtype (value, self->item_type);
       break;
@@ -339,6 +656,10 @@ gtk_filter_list_model_get_property (GObject     *object,
       g_value_set_object (value, self->model);
       break;
 
+    case PROP_PENDING:
+      g_value_set_uint (value, gtk_filter_list_model_get_pending (self));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -351,6 +672,7 @@ gtk_filter_list_model_clear_model (GtkFilterListModel *self)
   if (self->model == NULL)
     return;
 
+  gtk_filter_list_model_stop_filtering (self);
   g_signal_handlers_disconnect_by_func (self->model, gtk_filter_list_model_items_changed_cb, self);
   g_clear_object (&self->model);
   if (self->items)
@@ -394,6 +716,18 @@ gtk_filter_list_model_class_init (GtkFilterListModelClass *class)
                             FALSE,
                             GTK_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkFilterListModel:incremental:
+   *
+   * If the model should filter items incrementally
+   */
+  properties[PROP_INCREMENTAL] =
+      g_param_spec_boolean ("incremental",
+                            P_("Incremental"),
+                            P_("Filter items incrementally"),
+                            FALSE,
+                            GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * GtkFilterListModel:item-type:
    *
@@ -418,6 +752,18 @@ gtk_filter_list_model_class_init (GtkFilterListModelClass *class)
                            G_TYPE_LIST_MODEL,
                            GTK_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkFilterListModel:pending:
+   *
+   * Number of items not yet refiltered
+   */
+  properties[PROP_PENDING] =
+      g_param_spec_uint ("pending",
+                         P_("Pending"),
+                         P_("Number of items not yet refiltered"),
+                         0, G_MAXUINT, 0,
+                         GTK_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 }
 
@@ -543,6 +889,7 @@ gtk_filter_list_model_set_filter_func (GtkFilterListModel           *self,
   
   if (!will_be_filtered)
     {
+      gtk_filter_list_model_stop_filtering (self);
       g_clear_pointer (&self->items, gtk_css_rb_tree_unref);
     }
   else if (!was_filtered)
@@ -555,11 +902,14 @@ gtk_filter_list_model_set_filter_func (GtkFilterListModel           *self,
                                          NULL, NULL);
       if (self->model)
         {
+          FilterNode *node;
+
           n_items = g_list_model_get_n_items (self->model);
+          node = gtk_css_rb_tree_insert_n_before (self->items, NULL, n_items);
           for (i = 0; i < n_items; i++)
             {
-              FilterNode *node = gtk_css_rb_tree_insert_before (self->items, NULL);
               node->visible = TRUE;
+              node = gtk_css_rb_tree_get_next (self->items, node);
             }
         }
     }
@@ -603,7 +953,14 @@ gtk_filter_list_model_set_model (GtkFilterListModel *self,
     {
       self->model = g_object_ref (model);
       g_signal_connect (model, "items-changed", G_CALLBACK (gtk_filter_list_model_items_changed_cb), self);
-      if (self->items)
+      if (self->items && self->incremental)
+        {
+          /* Items show up as they are filtered, new nodes are hidden */
+          gtk_css_rb_tree_insert_n_before (self->items, NULL, g_list_model_get_n_items (model));
+          gtk_filter_list_model_start_filtering (self, GTK_FILTER_LIST_MODEL_CHANGE_DIFFERENT);
+          added = 0;
+        }
+      else if (self->items)
         added = gtk_filter_list_model_add_items (self, NULL, 0, g_list_model_get_n_items (model));
       else
         added = g_list_model_get_n_items (model);
@@ -657,55 +1014,128 @@ gtk_filter_list_model_has_filter (GtkFilterListModel *self)
  *
  * Calling this function is necessary when data used by the filter
  * function has changed.
+ *
+ * If @self is incremental, this starts refiltering the items in the
+ * background.
  **/
 void
 gtk_filter_list_model_refilter (GtkFilterListModel *self)
 {
-  FilterNode *node;
-  guint i, first_change, last_change;
-  guint n_is_visible, n_was_visible;
-  gboolean visible;
+  g_return_if_fail (GTK_IS_FILTER_LIST_MODEL (self));
+
+  gtk_filter_list_model_refilter_with_change (self, GTK_FILTER_LIST_MODEL_CHANGE_DIFFERENT);
+}
+
+/**
+ * gtk_filter_list_model_refilter_with_change:
+ * @self: a #GtkFilterListModel
+ * @change: how the filter function changed
+ *
+ * Like gtk_filter_list_model_refilter(), but uses @change to only
+ * refilter the items that may change.
+ *
+ * If the filter function got more strict, for example because a
+ * character was added to a search string, only the visible items
+ * are refiltered. If it got less strict, only the hidden items are.
+ **/
+void
+gtk_filter_list_model_refilter_with_change (GtkFilterListModel       *self,
+                                            GtkFilterListModelChange  change)
+{
+  guint start, position, removed, added;
 
   g_return_if_fail (GTK_IS_FILTER_LIST_MODEL (self));
   
   if (self->items == NULL || self->model == NULL)
     return;
 
-  first_change = G_MAXUINT;
-  last_change = 0;
-  n_is_visible = 0;
-  n_was_visible = 0;
-  for (i = 0, node = gtk_css_rb_tree_get_first (self->items);
-       node != NULL;
-       i++, node = gtk_css_rb_tree_get_next (self->items, node))
+  if (self->incremental)
     {
-      visible = gtk_filter_list_model_run_filter (self, i);
-      if (visible == node->visible)
-        {
-          if (visible)
-            {
-              n_is_visible++;
-              n_was_visible++;
-            }
-          continue;
-        }
-
-      node->visible = visible;
-      gtk_css_rb_tree_mark_dirty (self->items, node);
-      first_change = MIN (n_is_visible, first_change);
-      if (visible)
-        n_is_visible++;
-      else
-        n_was_visible++;
-      last_change = MAX (n_is_visible, last_change);
+      gtk_filter_list_model_start_filtering (self, change);
+      return;
     }
 
-  if (first_change <= last_change)
-    {
-      g_list_model_items_changed (G_LIST_MODEL (self),
-                                  first_change,
-                                  last_change - first_change + n_was_visible - n_is_visible,
-                                  last_change - first_change);
-    }
+  gtk_filter_list_model_stop_filtering (self);
+
+  start = 0;
+  if (gtk_filter_list_model_refilter_range (self, change, &start, G_MAXINT64, &position, &removed, &added))
+    g_list_model_items_changed (G_LIST_MODEL (self), position, removed, added);
 }
 
+/**
+ * gtk_filter_list_model_set_incremental:
+ * @self: a #GtkFilterListModel
+ * @incremental: %TRUE to filter incrementally
+ *
+ * Sets whether @self refilters incrementally.
+ *
+ * When filtering incrementally, @self refilters a bit of its items at a
+ * time while the main loop is idle, and emits #GListModel::items-changed
+ * for the items it refiltered. Until it is done, items that weren't
+ * refiltered keep their previous visibility. Items added to the model
+ * in the meantime are filtered right away. This keeps the application
+ * responsive when filtering large models, for example when filtering
+ * them while the user types in a search entry.
+ *
+ * Use gtk_filter_list_model_get_pending() to find out how many items
+ * still need to be refiltered.
+ *
+ * When incremental filtering is turned off while items are refiltered,
+ * the remaining items are refiltered right away.
+ **/
+void
+gtk_filter_list_model_set_incremental (GtkFilterListModel *self,
+                                       gboolean            incremental)
+{
+  g_return_if_fail (GTK_IS_FILTER_LIST_MODEL (self));
+
+  incremental = !!incremental;
+  if (self->incremental == incremental)
+    return;
+
+  self->incremental = incremental;
+
+  if (!incremental && self->filter_source)
+    gtk_filter_list_model_run_filter_until (self, G_MAXINT64);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_INCREMENTAL]);
+}
+
+/**
+ * gtk_filter_list_model_get_incremental:
+ * @self: a #GtkFilterListModel
+ *
+ * Returns whether incremental filtering was enabled via
+ * gtk_filter_list_model_set_incremental().
+ *
+ * Returns: %TRUE if incremental filtering is enabled
+ **/
+gboolean
+gtk_filter_list_model_get_incremental (GtkFilterListModel *self)
+{
+  g_return_val_if_fail (GTK_IS_FILTER_LIST_MODEL (self), FALSE);
+
+  return self->incremental;
+}
+
+/**
+ * gtk_filter_list_model_get_pending:
+ * @self: a #GtkFilterListModel
+ *
+ * Returns the number of items that still need to be refiltered when
+ * filtering incrementally. It is 0 once all items are refiltered.
+ *
+ * You can use this value to show progress to the user.
+ *
+ * Returns: the number of items not yet refiltered
+ **/
+guint
+gtk_filter_list_model_get_pending (GtkFilterListModel *self)
+{
+  g_return_val_if_fail (GTK_IS_FILTER_LIST_MODEL (self), 0);
+
+  if (self->filter_source == 0)
+    return 0;
+
+  return g_list_model_get_n_items (self->model) - self->filter_position;
+}
@@ -49,6 +49,24 @@ G_DECLARE_FINAL_TYPE (GtkFilterListModel, gtk_filter_list_model, GTK, FILTER_LIS
  */
 typedef gboolean (* GtkFilterListModelFilterFunc) (gpointer item, gpointer user_data);
 
+/**
+ * GtkFilterListModelChange:
+ * @GTK_FILTER_LIST_MODEL_CHANGE_DIFFERENT: The filter function may
+ *   show and hide any items
+ * @GTK_FILTER_LIST_MODEL_CHANGE_LESS_STRICT: The filter function shows
+ *   all items it showed before and maybe more
+ * @GTK_FILTER_LIST_MODEL_CHANGE_MORE_STRICT: The filter function hides
+ *   all items it hid before and maybe more
+ *
+ * Describes how the filter function of a #GtkFilterListModel changed,
+ * see gtk_filter_list_model_refilter_with_change().
+ */
+typedef enum {
+  GTK_FILTER_LIST_MODEL_CHANGE_DIFFERENT,
+  GTK_FILTER_LIST_MODEL_CHANGE_LESS_STRICT,
+  GTK_FILTER_LIST_MODEL_CHANGE_MORE_STRICT
+} GtkFilterListModelChange;
+
 GDK_AVAILABLE_IN_ALL
 GtkFilterListModel *    gtk_filter_list_model_new               (GListModel             *model,
                                                                  GtkFilterListModelFilterFunc filter_func,
@@ -72,6 +90,17 @@ gboolean                gtk_filter_list_model_has_filter        (GtkFilterListMo
 
 GDK_AVAILABLE_IN_ALL
 void                    gtk_filter_list_model_refilter          (GtkFilterListModel     *self);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_filter_list_model_refilter_with_change (GtkFilterListModel  *self,
+                                                                 GtkFilterListModelChange change);
+
+GDK_AVAILABLE_IN_ALL
+void                    gtk_filter_list_model_set_incremental   (GtkFilterListModel     *self,
+                                                                 gboolean                incremental);
+GDK_AVAILABLE_IN_ALL
+gboolean                gtk_filter_list_model_get_incremental   (GtkFilterListModel     *self);
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_filter_list_model_get_pending       (GtkFilterListModel     *self);
 
 G_END_DECLS
 
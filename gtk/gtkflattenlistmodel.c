@@ -287,9 +287,9 @@ gtk_flatten_list_model_add_items (GtkFlattenListModel *self,
   guint added, i;
 
   added = 0;
+  node = gtk_css_rb_tree_insert_n_before (self->items, after, n);
   for (i = 0; i < n; i++)
     {
-      node = gtk_css_rb_tree_insert_before (self->items, after);
       node->model = g_list_model_get_item (self->model, position + i);
       g_warn_if_fail (g_type_is_a (g_list_model_get_item_type (node->model), self->item_type));
       g_signal_connect (node->model,
@@ -298,6 +298,7 @@ gtk_flatten_list_model_add_items (GtkFlattenListModel *self,
                         node);
       node->list = self;
       added +=g_list_model_get_n_items (node->model);
+      node = gtk_css_rb_tree_get_next (self->items, node);
     }
 
   return added;
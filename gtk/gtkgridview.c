@@ -0,0 +1,1048 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#include "config.h"
+
+#include "gtkgridview.h"
+
+#include "gtkadjustment.h"
+#include "gtkgesturemultipress.h"
+#include "gtkintl.h"
+#include "gtklistitemfactoryprivate.h"
+#include "gtkmain.h"
+#include "gtkprivate.h"
+#include "gtkscrollable.h"
+#include "gtksetprivate.h"
+#include "gtksnapshot.h"
+
+/**
+ * SECTION:gtkgridview
+ * @Title: GtkGridView
+ * @Short_description: A widget for displaying large grids
+ * @See_also: #GListModel, #GtkFlowBox, #GtkListView
+ *
+ * GtkGridView presents the items of a large dynamic list in a grid
+ * of cells that all have the same size, like a photo browser does.
+ *
+ * Unlike #GtkFlowBox, it only creates widgets for the visible cells
+ * and reuses them while scrolling, the same way #GtkListView does.
+ * The widgets are created and bound to items by the functions set
+ * with gtk_grid_view_set_functions().
+ *
+ * All cells are assumed to be as large as the largest of the visible
+ * ones, so the position of every item can be computed from the number
+ * of columns without measuring it. As many columns as fit are used,
+ * up to #GtkGridView:max-columns.
+ *
+ * The selection is stored for the items, not for the widgets, so
+ * selecting all items does not need any widgets. Widgets of selected
+ * items get the %GTK_STATE_FLAG_SELECTED state.
+ *
+ * GtkGridView implements #GtkScrollable and scrolls vertically.
+ *
+ * # CSS nodes
+ *
+ * GtkGridView has a single CSS node with name gridview.
+ */
+
+#define DEFAULT_MAX_COLUMNS 7
+
+/* Rows of cells that get widgets above and below the visible ones */
+#define GTK_GRID_VIEW_EXTRA_ROWS 1
+
+struct _GtkGridView
+{
+  GtkWidget parent_instance;
+
+  GListModel *model;
+  GtkListItemFactory *factory;
+  GtkAdjustment *adjustment[2];
+  GtkScrollablePolicy scroll_policy[2];
+  guint max_columns;
+
+  GtkSet *selected;             /* positions of the selected items */
+
+  /* The widgets for the items from range_start on */
+  GPtrArray *cells;
+  guint range_start;
+
+  /* The layout of the last allocation */
+  guint n_columns;
+  int cell_width;               /* natural width of the cells */
+  int column_width;
+  int cell_height;
+};
+
+enum
+{
+  PROP_0,
+  PROP_HADJUSTMENT,
+  PROP_HSCROLL_POLICY,
+  PROP_MAX_COLUMNS,
+  PROP_MODEL,
+  PROP_VADJUSTMENT,
+  PROP_VSCROLL_POLICY,
+
+  N_PROPS
+};
+
+enum {
+  SELECTION_CHANGED,
+  LAST_SIGNAL
+};
+
+G_DEFINE_TYPE_WITH_CODE (GtkGridView, gtk_grid_view, GTK_TYPE_WIDGET,
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_SCROLLABLE, NULL))
+
+static GParamSpec *properties[N_PROPS] = { NULL, };
+static guint signals[LAST_SIGNAL] = { 0 };
+
+static guint
+gtk_grid_view_get_n_items (GtkGridView *self)
+{
+  if (self->model == NULL)
+    return 0;
+
+  return g_list_model_get_n_items (self->model);
+}
+
+static guint
+gtk_grid_view_get_n_rows (GtkGridView *self,
+                          guint        n_columns)
+{
+  guint n_items = gtk_grid_view_get_n_items (self);
+
+  return n_items / n_columns + (n_items % n_columns ? 1 : 0);
+}
+
+static void
+gtk_grid_view_update_cell_state (GtkGridView *self,
+                                 GtkWidget   *cell,
+                                 guint        position)
+{
+  if (gtk_set_contains (self->selected, position))
+    gtk_widget_set_state_flags (cell, GTK_STATE_FLAG_SELECTED, FALSE);
+  else
+    gtk_widget_unset_state_flags (cell, GTK_STATE_FLAG_SELECTED);
+}
+
+static void
+gtk_grid_view_update_cell_states (GtkGridView *self)
+{
+  guint i;
+
+  for (i = 0; i < self->cells->len; i++)
+    gtk_grid_view_update_cell_state (self, g_ptr_array_index (self->cells, i), self->range_start + i);
+}
+
+static GtkWidget *
+gtk_grid_view_acquire_cell (GtkGridView *self,
+                            guint        position)
+{
+  GtkWidget *cell;
+  gpointer item;
+
+  item = g_list_model_get_item (self->model, position);
+  cell = gtk_list_item_factory_acquire (self->factory, GTK_WIDGET (self), item);
+  g_object_unref (item);
+
+  gtk_grid_view_update_cell_state (self, cell, position);
+
+  return cell;
+}
+
+/* Releases the widgets of the cells from index on */
+static void
+gtk_grid_view_release_cells (GtkGridView *self,
+                             guint        index)
+{
+  guint i;
+
+  for (i = index; i < self->cells->len; i++)
+    gtk_list_item_factory_release (self->factory, g_ptr_array_index (self->cells, i));
+
+  g_ptr_array_set_size (self->cells, MIN (index, self->cells->len));
+}
+
+static int
+gtk_grid_view_measure_cell_height (GtkGridView *self,
+                                   int          column_width)
+{
+  int cell_height, nat;
+  guint i;
+
+  cell_height = 1;
+  for (i = 0; i < self->cells->len; i++)
+    {
+      gtk_widget_measure (g_ptr_array_index (self->cells, i),
+                          GTK_ORIENTATION_VERTICAL, column_width,
+                          NULL, &nat,
+                          NULL, NULL);
+      cell_height = MAX (cell_height, nat);
+    }
+
+  return cell_height;
+}
+
+/* Computes the layout for width from the cells that have widgets */
+static void
+gtk_grid_view_measure_cells (GtkGridView *self,
+                             int          width)
+{
+  guint i, n_columns;
+  int nat;
+
+  self->cell_width = 1;
+  for (i = 0; i < self->cells->len; i++)
+    {
+      gtk_widget_measure (g_ptr_array_index (self->cells, i),
+                          GTK_ORIENTATION_HORIZONTAL, -1,
+                          NULL, &nat,
+                          NULL, NULL);
+      self->cell_width = MAX (self->cell_width, nat);
+    }
+
+  n_columns = width / self->cell_width;
+  self->n_columns = CLAMP (n_columns, 1, self->max_columns);
+  self->column_width = width / self->n_columns;
+  self->cell_height = gtk_grid_view_measure_cell_height (self, self->column_width);
+}
+
+/* Makes sure the cells that are visible at the scroll position value
+ * and a row around them have widgets. Returns the scroll position to
+ * use, which keeps the first visible item in view when the number of
+ * columns or the cell size changes.
+ */
+static int
+gtk_grid_view_update_cells (GtkGridView *self,
+                            int          value,
+                            int          width,
+                            int          height)
+{
+  GPtrArray *old_cells;
+  GtkWidget *cell;
+  guint n_items, anchor, old_start, start, end, first_row, last_row, pos, i;
+  guint old_columns;
+  int old_cell_height, total;
+
+  n_items = gtk_grid_view_get_n_items (self);
+
+  if (self->factory == NULL || n_items == 0)
+    {
+      if (self->factory)
+        gtk_grid_view_release_cells (self, 0);
+      self->range_start = 0;
+      self->n_columns = 0;
+      self->cell_height = 0;
+      return 0;
+    }
+
+  old_columns = self->n_columns;
+  old_cell_height = self->cell_height;
+  if (old_columns > 0 && old_cell_height > 0)
+    anchor = MIN ((value / old_cell_height) * old_columns, n_items - 1);
+  else
+    anchor = 0;
+
+  /* We need a widget to know the size of the cells */
+  if (self->cells->len == 0)
+    {
+      self->range_start = anchor;
+      g_ptr_array_add (self->cells, gtk_grid_view_acquire_cell (self, anchor));
+    }
+
+  gtk_grid_view_measure_cells (self, width);
+
+  if (old_columns > 0 &&
+      (old_columns != self->n_columns || old_cell_height != self->cell_height))
+    value = (anchor / self->n_columns) * self->cell_height;
+
+  total = gtk_grid_view_get_n_rows (self, self->n_columns) * self->cell_height;
+  value = CLAMP (value, 0, MAX (total - height, 0));
+
+  first_row = value / self->cell_height;
+  last_row = (value + height + self->cell_height - 1) / self->cell_height;
+  first_row = first_row > GTK_GRID_VIEW_EXTRA_ROWS ? first_row - GTK_GRID_VIEW_EXTRA_ROWS : 0;
+  last_row += GTK_GRID_VIEW_EXTRA_ROWS;
+  start = first_row * self->n_columns;
+  end = MIN (n_items, last_row * self->n_columns);
+
+  /* Free widgets first, so they can be reused */
+  old_cells = self->cells;
+  old_start = self->range_start;
+  for (i = 0; i < old_cells->len; i++)
+    {
+      pos = old_start + i;
+      if (pos < start || pos >= end)
+        gtk_list_item_factory_release (self->factory, g_ptr_array_index (old_cells, i));
+    }
+
+  self->cells = g_ptr_array_sized_new (end - start);
+  for (pos = start; pos < end; pos++)
+    {
+      if (pos >= old_start && pos < old_start + old_cells->len)
+        cell = g_ptr_array_index (old_cells, pos - old_start);
+      else
+        cell = gtk_grid_view_acquire_cell (self, pos);
+      g_ptr_array_add (self->cells, cell);
+    }
+  g_ptr_array_unref (old_cells);
+
+  self->range_start = start;
+  gtk_list_item_factory_trim (self->factory, end - start);
+
+  /* The new cells may be larger */
+  self->cell_height = gtk_grid_view_measure_cell_height (self, self->column_width);
+  total = gtk_grid_view_get_n_rows (self, self->n_columns) * self->cell_height;
+
+  return CLAMP (value, 0, MAX (total - height, 0));
+}
+
+static void
+gtk_grid_view_size_allocate (GtkWidget *widget,
+                             int        width,
+                             int        height,
+                             int        baseline)
+{
+  GtkGridView *self = GTK_GRID_VIEW (widget);
+  GtkAllocation child_allocation;
+  gboolean rtl;
+  guint i, pos, column;
+  int value, total;
+
+  value = gtk_adjustment_get_value (self->adjustment[GTK_ORIENTATION_VERTICAL]);
+  value = gtk_grid_view_update_cells (self, value, width, height);
+  if (self->n_columns > 0)
+    total = gtk_grid_view_get_n_rows (self, self->n_columns) * self->cell_height;
+  else
+    total = 0;
+
+  g_object_freeze_notify (G_OBJECT (self->adjustment[GTK_ORIENTATION_HORIZONTAL]));
+  g_object_freeze_notify (G_OBJECT (self->adjustment[GTK_ORIENTATION_VERTICAL]));
+
+  gtk_adjustment_configure (self->adjustment[GTK_ORIENTATION_HORIZONTAL],
+                            0,
+                            0,
+                            width,
+                            width * 0.1,
+                            width * 0.9,
+                            width);
+  gtk_adjustment_configure (self->adjustment[GTK_ORIENTATION_VERTICAL],
+                            value,
+                            0,
+                            MAX (total, height),
+                            height * 0.1,
+                            height * 0.9,
+                            height);
+
+  g_object_thaw_notify (G_OBJECT (self->adjustment[GTK_ORIENTATION_HORIZONTAL]));
+  g_object_thaw_notify (G_OBJECT (self->adjustment[GTK_ORIENTATION_VERTICAL]));
+
+  /* configuring may have clamped the value */
+  value = gtk_adjustment_get_value (self->adjustment[GTK_ORIENTATION_VERTICAL]);
+  rtl = gtk_widget_get_direction (widget) == GTK_TEXT_DIR_RTL;
+
+  for (i = 0; i < self->cells->len; i++)
+    {
+      pos = self->range_start + i;
+      column = pos % self->n_columns;
+      if (rtl)
+        column = self->n_columns - 1 - column;
+
+      child_allocation.x = column * self->column_width;
+      child_allocation.y = (pos / self->n_columns) * self->cell_height - value;
+      child_allocation.width = self->column_width;
+      child_allocation.height = self->cell_height;
+      gtk_widget_size_allocate (g_ptr_array_index (self->cells, i), &child_allocation, -1);
+    }
+}
+
+static void
+gtk_grid_view_measure (GtkWidget      *widget,
+                       GtkOrientation  orientation,
+                       int             for_size,
+                       int            *minimum,
+                       int            *natural,
+                       int            *minimum_baseline,
+                       int            *natural_baseline)
+{
+  GtkGridView *self = GTK_GRID_VIEW (widget);
+  int child_min, child_nat;
+  guint i, n_columns;
+
+  *minimum = 0;
+  *natural = 0;
+
+  if (orientation == GTK_ORIENTATION_VERTICAL)
+    {
+      /* Uses the cell size of the last allocation */
+      if (self->cell_height == 0)
+        return;
+
+      if (for_size < 0)
+        n_columns = self->max_columns;
+      else
+        n_columns = CLAMP (for_size / self->cell_width, 1, self->max_columns);
+      *natural = gtk_grid_view_get_n_rows (self, n_columns) * self->cell_height;
+      return;
+    }
+
+  for (i = 0; i < self->cells->len; i++)
+    {
+      gtk_widget_measure (g_ptr_array_index (self->cells, i),
+                          orientation, -1,
+                          &child_min, &child_nat,
+                          NULL, NULL);
+      *minimum = MAX (*minimum, child_min);
+      *natural = MAX (*natural, child_nat);
+    }
+  *natural *= MIN (self->max_columns, MAX (gtk_grid_view_get_n_items (self), 1));
+}
+
+static void
+gtk_grid_view_snapshot (GtkWidget   *widget,
+                        GtkSnapshot *snapshot)
+{
+  gtk_snapshot_push_clip (snapshot,
+                          &GRAPHENE_RECT_INIT(
+                            0, 0,
+                            gtk_widget_get_width (widget),
+                            gtk_widget_get_height (widget)));
+
+  GTK_WIDGET_CLASS (gtk_grid_view_parent_class)->snapshot (widget, snapshot);
+
+  gtk_snapshot_pop (snapshot);
+}
+
+/* Returns the position of the item at x, y or G_MAXUINT */
+static guint
+gtk_grid_view_get_position_at (GtkGridView *self,
+                               double       x,
+                               double       y)
+{
+  guint column, position;
+  int value;
+
+  if (self->n_columns == 0 || x < 0 || y < 0)
+    return G_MAXUINT;
+
+  /* Not allocated, or allocated with no space for the cells */
+  if (self->column_width <= 0 || self->cell_height <= 0)
+    return G_MAXUINT;
+
+  column = x / self->column_width;
+  if (column >= self->n_columns)
+    return G_MAXUINT;
+  if (gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL)
+    column = self->n_columns - 1 - column;
+
+  value = gtk_adjustment_get_value (self->adjustment[GTK_ORIENTATION_VERTICAL]);
+  position = ((int) y + value) / self->cell_height * self->n_columns + column;
+  if (position >= gtk_grid_view_get_n_items (self))
+    return G_MAXUINT;
+
+  return position;
+}
+
+static void
+gtk_grid_view_multipress_gesture_released (GtkGestureMultiPress *gesture,
+                                           guint                 n_press,
+                                           double                x,
+                                           double                y,
+                                           GtkGridView          *self)
+{
+  GdkModifierType state = 0;
+  GdkModifierType mask;
+  guint position;
+
+  position = gtk_grid_view_get_position_at (self, x, y);
+  if (position == G_MAXUINT)
+    return;
+
+  mask = gtk_widget_get_modifier_mask (GTK_WIDGET (self), GDK_MODIFIER_INTENT_MODIFY_SELECTION);
+  if (gtk_get_current_event_state (&state) && (state & mask) == mask)
+    {
+      if (gtk_grid_view_is_selected (self, position))
+        gtk_grid_view_unselect_item (self, position);
+      else
+        gtk_grid_view_select_item (self, position, FALSE);
+    }
+  else
+    {
+      gtk_grid_view_select_item (self, position, TRUE);
+    }
+}
+
+static void
+gtk_grid_view_adjustment_value_changed_cb (GtkAdjustment *adjustment,
+                                           GtkGridView   *self)
+{
+  gtk_widget_queue_allocate (GTK_WIDGET (self));
+}
+
+static void
+gtk_grid_view_clear_adjustment (GtkGridView    *self,
+                                GtkOrientation  orientation)
+{
+  if (self->adjustment[orientation] == NULL)
+    return;
+
+  g_signal_handlers_disconnect_by_func (self->adjustment[orientation],
+                                        gtk_grid_view_adjustment_value_changed_cb,
+                                        self);
+  g_clear_object (&self->adjustment[orientation]);
+}
+
+static void
+gtk_grid_view_set_adjustment (GtkGridView    *self,
+                              GtkOrientation  orientation,
+                              GtkAdjustment  *adjustment)
+{
+  if (adjustment != NULL && self->adjustment[orientation] == adjustment)
+    return;
+
+  if (adjustment == NULL)
+    adjustment = gtk_adjustment_new (0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+  g_object_ref_sink (adjustment);
+
+  gtk_grid_view_clear_adjustment (self, orientation);
+
+  self->adjustment[orientation] = adjustment;
+  g_signal_connect (adjustment, "value-changed",
+                    G_CALLBACK (gtk_grid_view_adjustment_value_changed_cb),
+                    self);
+
+  gtk_widget_queue_allocate (GTK_WIDGET (self));
+}
+
+/* Moves the selection of the items after the changed ones */
+static gboolean
+gtk_grid_view_splice_selection (GtkGridView *self,
+                                guint        position,
+                                guint        removed,
+                                guint        added)
+{
+  guint start, n_items;
+  gboolean changed;
+
+  changed = removed > 0 &&
+            gtk_set_get_next_range (self->selected, position, &start, &n_items) &&
+            start < position + removed;
+
+  gtk_set_splice (self->selected, position, removed, added);
+
+  return changed;
+}
+
+static void
+gtk_grid_view_model_items_changed_cb (GListModel  *model,
+                                      guint        position,
+                                      guint        removed,
+                                      guint        added,
+                                      GtkGridView *self)
+{
+  if (position + removed <= self->range_start)
+    {
+      self->range_start = self->range_start + added - removed;
+    }
+  else if (position < self->range_start + self->cells->len)
+    {
+      /* Keep the cells before the change, the others are rebound
+       * on the next allocation. */
+      if (self->factory)
+        gtk_grid_view_release_cells (self, position > self->range_start ? position - self->range_start : 0);
+      self->range_start = MIN (self->range_start, position);
+    }
+
+  if (gtk_grid_view_splice_selection (self, position, removed, added))
+    g_signal_emit (self, signals[SELECTION_CHANGED], 0);
+
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+}
+
+static void
+gtk_grid_view_clear_model (GtkGridView *self)
+{
+  if (self->model == NULL)
+    return;
+
+  if (self->factory)
+    gtk_grid_view_release_cells (self, 0);
+  self->range_start = 0;
+
+  g_signal_handlers_disconnect_by_func (self->model,
+                                        gtk_grid_view_model_items_changed_cb,
+                                        self);
+  g_clear_object (&self->model);
+}
+
+static void
+gtk_grid_view_dispose (GObject *object)
+{
+  GtkGridView *self = GTK_GRID_VIEW (object);
+
+  gtk_grid_view_clear_model (self);
+  g_clear_pointer (&self->factory, gtk_list_item_factory_free);
+
+  gtk_grid_view_clear_adjustment (self, GTK_ORIENTATION_HORIZONTAL);
+  gtk_grid_view_clear_adjustment (self, GTK_ORIENTATION_VERTICAL);
+
+  G_OBJECT_CLASS (gtk_grid_view_parent_class)->dispose (object);
+}
+
+static void
+gtk_grid_view_finalize (GObject *object)
+{
+  GtkGridView *self = GTK_GRID_VIEW (object);
+
+  g_ptr_array_unref (self->cells);
+  gtk_set_free (self->selected);
+
+  G_OBJECT_CLASS (gtk_grid_view_parent_class)->finalize (object);
+}
+
+static void
+gtk_grid_view_get_property (GObject    *object,
+                            guint       property_id,
+                            GValue     *value,
+                            GParamSpec *pspec)
+{
+  GtkGridView *self = GTK_GRID_VIEW (object);
+
+  switch (property_id)
+    {
+    case PROP_HADJUSTMENT:
+      g_value_set_object (value, self->adjustment[GTK_ORIENTATION_HORIZONTAL]);
+      break;
+
+    case PROP_HSCROLL_POLICY:
+      g_value_set_enum (value, self->scroll_policy[GTK_ORIENTATION_HORIZONTAL]);
+      break;
+
+    case PROP_MAX_COLUMNS:
+      g_value_set_uint (value, self->max_columns);
+      break;
+
+    case PROP_MODEL:
+      g_value_set_object (value, self->model);
+      break;
+
+    case PROP_VADJUSTMENT:
+      g_value_set_object (value, self->adjustment[GTK_ORIENTATION_VERTICAL]);
+      break;
+
+    case PROP_VSCROLL_POLICY:
+      g_value_set_enum (value, self->scroll_policy[GTK_ORIENTATION_VERTICAL]);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gtk_grid_view_set_scroll_policy (GtkGridView         *self,
+                                 GtkOrientation       orientation,
+                                 GtkScrollablePolicy  scroll_policy,
+                                 GParamSpec          *pspec)
+{
+  if (self->scroll_policy[orientation] == scroll_policy)
+    return;
+
+  self->scroll_policy[orientation] = scroll_policy;
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+  g_object_notify_by_pspec (G_OBJECT (self), pspec);
+}
+
+static void
+gtk_grid_view_set_property (GObject      *object,
+                            guint         property_id,
+                            const GValue *value,
+                            GParamSpec   *pspec)
+{
+  GtkGridView *self = GTK_GRID_VIEW (object);
+
+  switch (property_id)
+    {
+    case PROP_HADJUSTMENT:
+      gtk_grid_view_set_adjustment (self, GTK_ORIENTATION_HORIZONTAL, g_value_get_object (value));
+      break;
+
+    case PROP_HSCROLL_POLICY:
+      gtk_grid_view_set_scroll_policy (self, GTK_ORIENTATION_HORIZONTAL, g_value_get_enum (value), pspec);
+      break;
+
+    case PROP_MAX_COLUMNS:
+      gtk_grid_view_set_max_columns (self, g_value_get_uint (value));
+      break;
+
+    case PROP_MODEL:
+      gtk_grid_view_set_model (self, g_value_get_object (value));
+      break;
+
+    case PROP_VADJUSTMENT:
+      gtk_grid_view_set_adjustment (self, GTK_ORIENTATION_VERTICAL, g_value_get_object (value));
+      break;
+
+    case PROP_VSCROLL_POLICY:
+      gtk_grid_view_set_scroll_policy (self, GTK_ORIENTATION_VERTICAL, g_value_get_enum (value), pspec);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gtk_grid_view_class_init (GtkGridViewClass *klass)
+{
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  widget_class->measure = gtk_grid_view_measure;
+  widget_class->size_allocate = gtk_grid_view_size_allocate;
+  widget_class->snapshot = gtk_grid_view_snapshot;
+
+  gobject_class->dispose = gtk_grid_view_dispose;
+  gobject_class->finalize = gtk_grid_view_finalize;
+  gobject_class->get_property = gtk_grid_view_get_property;
+  gobject_class->set_property = gtk_grid_view_set_property;
+
+  g_object_class_override_property (gobject_class, PROP_HADJUSTMENT, "hadjustment");
+  g_object_class_override_property (gobject_class, PROP_HSCROLL_POLICY, "hscroll-policy");
+  g_object_class_override_property (gobject_class, PROP_VADJUSTMENT, "vadjustment");
+  g_object_class_override_property (gobject_class, PROP_VSCROLL_POLICY, "vscroll-policy");
+
+  /**
+   * GtkGridView:max-columns:
+   *
+   * Maximum number of columns per row
+   */
+  properties[PROP_MAX_COLUMNS] =
+      g_param_spec_uint ("max-columns",
+                         P_("Max columns"),
+                         P_("Maximum number of columns per row"),
+                         1, G_MAXUINT, DEFAULT_MAX_COLUMNS,
+                         GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+  g_object_class_install_property (gobject_class, PROP_MAX_COLUMNS, properties[PROP_MAX_COLUMNS]);
+
+  /**
+   * GtkGridView:model:
+   *
+   * Model for the items displayed
+   */
+  properties[PROP_MODEL] =
+      g_param_spec_object ("model",
+                           P_("Model"),
+                           P_("Model for the items displayed"),
+                           G_TYPE_LIST_MODEL,
+                           GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+  g_object_class_install_property (gobject_class, PROP_MODEL, properties[PROP_MODEL]);
+
+  /**
+   * GtkGridView::selection-changed:
+   * @self: the #GtkGridView
+   *
+   * Emitted when the set of selected items changes, also when
+   * selected items are removed from the model.
+   */
+  signals[SELECTION_CHANGED] =
+      g_signal_new (I_("selection-changed"),
+                    G_TYPE_FROM_CLASS (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0,
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+
+  gtk_widget_class_set_css_name (widget_class, I_("gridview"));
+}
+
+static void
+gtk_grid_view_init (GtkGridView *self)
+{
+  GtkGesture *gesture;
+
+  gtk_widget_set_has_surface (GTK_WIDGET (self), FALSE);
+
+  self->max_columns = DEFAULT_MAX_COLUMNS;
+  self->selected = gtk_set_new ();
+  self->cells = g_ptr_array_new ();
+
+  gtk_grid_view_set_adjustment (self, GTK_ORIENTATION_HORIZONTAL, NULL);
+  gtk_grid_view_set_adjustment (self, GTK_ORIENTATION_VERTICAL, NULL);
+
+  gesture = gtk_gesture_multi_press_new ();
+  gtk_gesture_single_set_button (GTK_GESTURE_SINGLE (gesture), GDK_BUTTON_PRIMARY);
+  g_signal_connect (gesture, "released",
+                    G_CALLBACK (gtk_grid_view_multipress_gesture_released), self);
+  gtk_widget_add_controller (GTK_WIDGET (self), GTK_EVENT_CONTROLLER (gesture));
+}
+
+/**
+ * gtk_grid_view_new:
+ *
+ * Creates a new empty #GtkGridView.
+ *
+ * You most likely want to call gtk_grid_view_set_functions() and
+ * gtk_grid_view_set_model() next.
+ *
+ * Returns: a new #GtkGridView
+ **/
+GtkWidget *
+gtk_grid_view_new (void)
+{
+  return g_object_new (GTK_TYPE_GRID_VIEW, NULL);
+}
+
+/**
+ * gtk_grid_view_get_model:
+ * @self: a #GtkGridView
+ *
+ * Gets the model that's currently used to read the items displayed.
+ *
+ * Returns: (nullable) (transfer none): The model in use
+ **/
+GListModel *
+gtk_grid_view_get_model (GtkGridView *self)
+{
+  g_return_val_if_fail (GTK_IS_GRID_VIEW (self), NULL);
+
+  return self->model;
+}
+
+/**
+ * gtk_grid_view_set_model:
+ * @self: a #GtkGridView
+ * @model: (allow-none) (transfer none): the model to use or %NULL for none
+ *
+ * Sets the #GListModel to use. This clears the selection.
+ **/
+void
+gtk_grid_view_set_model (GtkGridView *self,
+                         GListModel  *model)
+{
+  g_return_if_fail (GTK_IS_GRID_VIEW (self));
+  g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
+
+  if (self->model == model)
+    return;
+
+  gtk_grid_view_clear_model (self);
+  gtk_grid_view_unselect_all (self);
+
+  if (model)
+    {
+      self->model = g_object_ref (model);
+      g_signal_connect (model,
+                        "items-changed",
+                        G_CALLBACK (gtk_grid_view_model_items_changed_cb),
+                        self);
+    }
+
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MODEL]);
+}
+
+/**
+ * gtk_grid_view_set_functions:
+ * @self: a #GtkGridView
+ * @setup_func: function to create widgets for items
+ * @bind_func: function to make a widget display an item
+ * @user_data: user data to pass to the functions
+ * @user_destroy: destroy notifier for @user_data
+ *
+ * Sets the functions to create the widgets that display the items of
+ * the model, see gtk_list_view_set_functions().
+ *
+ * All existing widgets are destroyed and new ones are created using
+ * the new functions.
+ **/
+void
+gtk_grid_view_set_functions (GtkGridView          *self,
+                             GtkListItemSetupFunc  setup_func,
+                             GtkListItemBindFunc   bind_func,
+                             gpointer              user_data,
+                             GDestroyNotify        user_destroy)
+{
+  g_return_if_fail (GTK_IS_GRID_VIEW (self));
+  g_return_if_fail (setup_func != NULL);
+  g_return_if_fail (bind_func != NULL);
+
+  if (self->factory)
+    {
+      gtk_grid_view_release_cells (self, 0);
+      gtk_list_item_factory_free (self->factory);
+    }
+
+  self->factory = gtk_list_item_factory_new (setup_func, bind_func, user_data, user_destroy);
+
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+}
+
+/**
+ * gtk_grid_view_get_max_columns:
+ * @self: a #GtkGridView
+ *
+ * Gets the maximum number of columns, see
+ * gtk_grid_view_set_max_columns().
+ *
+ * Returns: the maximum number of columns
+ **/
+guint
+gtk_grid_view_get_max_columns (GtkGridView *self)
+{
+  g_return_val_if_fail (GTK_IS_GRID_VIEW (self), DEFAULT_MAX_COLUMNS);
+
+  return self->max_columns;
+}
+
+/**
+ * gtk_grid_view_set_max_columns:
+ * @self: a #GtkGridView
+ * @max_columns: the maximum number of columns
+ *
+ * Sets the maximum number of columns to use. If there is room for
+ * more cells, they are made wider.
+ **/
+void
+gtk_grid_view_set_max_columns (GtkGridView *self,
+                               guint        max_columns)
+{
+  g_return_if_fail (GTK_IS_GRID_VIEW (self));
+  g_return_if_fail (max_columns > 0);
+
+  if (self->max_columns == max_columns)
+    return;
+
+  self->max_columns = max_columns;
+
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MAX_COLUMNS]);
+}
+
+/**
+ * gtk_grid_view_is_selected:
+ * @self: a #GtkGridView
+ * @position: the position of the item
+ *
+ * Checks if the item at @position is selected.
+ *
+ * Returns: %TRUE if the item is selected
+ **/
+gboolean
+gtk_grid_view_is_selected (GtkGridView *self,
+                           guint        position)
+{
+  g_return_val_if_fail (GTK_IS_GRID_VIEW (self), FALSE);
+
+  return gtk_set_contains (self->selected, position);
+}
+
+static void
+gtk_grid_view_selection_changed (GtkGridView *self)
+{
+  gtk_grid_view_update_cell_states (self);
+  g_signal_emit (self, signals[SELECTION_CHANGED], 0);
+}
+
+/**
+ * gtk_grid_view_select_item:
+ * @self: a #GtkGridView
+ * @position: the position of the item
+ * @exclusive: %TRUE to unselect all other items
+ *
+ * Selects the item at @position.
+ **/
+void
+gtk_grid_view_select_item (GtkGridView *self,
+                           guint        position,
+                           gboolean     exclusive)
+{
+  gboolean changed;
+
+  g_return_if_fail (GTK_IS_GRID_VIEW (self));
+  g_return_if_fail (position < gtk_grid_view_get_n_items (self));
+
+  changed = FALSE;
+  if (exclusive)
+    {
+      changed |= gtk_set_remove_range (self->selected, 0, position, NULL, NULL);
+      changed |= gtk_set_remove_range (self->selected, position + 1, G_MAXUINT - position - 1, NULL, NULL);
+    }
+  changed |= gtk_set_add_range (self->selected, position, 1, NULL, NULL);
+
+  if (changed)
+    gtk_grid_view_selection_changed (self);
+}
+
+/**
+ * gtk_grid_view_unselect_item:
+ * @self: a #GtkGridView
+ * @position: the position of the item
+ *
+ * Unselects the item at @position.
+ **/
+void
+gtk_grid_view_unselect_item (GtkGridView *self,
+                             guint        position)
+{
+  g_return_if_fail (GTK_IS_GRID_VIEW (self));
+
+  if (gtk_set_remove_range (self->selected, position, 1, NULL, NULL))
+    gtk_grid_view_selection_changed (self);
+}
+
+/**
+ * gtk_grid_view_select_all:
+ * @self: a #GtkGridView
+ *
+ * Selects all items. This does not need widgets for the items, so it
+ * is cheap even for large models.
+ **/
+void
+gtk_grid_view_select_all (GtkGridView *self)
+{
+  g_return_if_fail (GTK_IS_GRID_VIEW (self));
+
+  if (gtk_set_add_range (self->selected, 0, gtk_grid_view_get_n_items (self), NULL, NULL))
+    gtk_grid_view_selection_changed (self);
+}
+
+/**
+ * gtk_grid_view_unselect_all:
+ * @self: a #GtkGridView
+ *
+ * Unselects all items.
+ **/
+void
+gtk_grid_view_unselect_all (GtkGridView *self)
+{
+  g_return_if_fail (GTK_IS_GRID_VIEW (self));
+
+  if (gtk_set_is_empty (self->selected))
+    return;
+
+  gtk_set_remove_all (self->selected);
+  gtk_grid_view_selection_changed (self);
+}
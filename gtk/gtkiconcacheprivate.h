@@ -23,6 +23,10 @@ G_BEGIN_DECLS
 
 typedef struct _GtkIconCache GtkIconCache;
 
+typedef void (* GtkIconCacheForeachFunc) (const gchar *icon_name,
+                                          gint         directory_index,
+                                          gpointer     user_data);
+
 GtkIconCache *gtk_icon_cache_new                        (const gchar  *data);
 GtkIconCache *gtk_icon_cache_new_for_path               (const gchar  *path);
 gint          gtk_icon_cache_get_directory_index        (GtkIconCache *cache,
@@ -37,6 +41,9 @@ gboolean      gtk_icon_cache_has_icons                  (GtkIconCache *cache,
 void	      gtk_icon_cache_add_icons                  (GtkIconCache *cache,
                                                          const gchar  *directory,
                                                          GHashTable   *hash_table);
+void          gtk_icon_cache_foreach_icon               (GtkIconCache *cache,
+                                                         GtkIconCacheForeachFunc func,
+                                                         gpointer      user_data);
 
 gint          gtk_icon_cache_get_icon_flags             (GtkIconCache *cache,
                                                          const gchar  *icon_name,
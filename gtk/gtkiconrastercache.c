@@ -0,0 +1,465 @@
+/* gtkiconrastercache.c
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkdebug.h"
+#include "gtkiconrastercacheprivate.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+/* The raster cache keeps the result of loading an icon at a given
+ * size - typically an SVG rendered with librsvg - in a per-user
+ * directory, so that the next process asking for the same icon can
+ * map the pixels instead of parsing and rendering the source again.
+ *
+ * Every entry is a single file, named after the checksum of its key.
+ * It starts with a CacheHeader, followed by the key itself (to guard
+ * against collisions) and the raw pixbuf data. Entries are written
+ * with g_file_set_contents(), which renames a temporary file into
+ * place, so concurrent writers never expose partial files to readers
+ * and the last one simply wins.
+ *
+ * An entry is only used if the size and modification time of the
+ * source file still match the ones recorded when it was written.
+ * The modification time of the entry itself is used for eviction:
+ * hits refresh it (at most once a day), and whenever enough data has
+ * been written the oldest entries are removed until the cache is
+ * comfortably below its budget.
+ */
+
+#define CACHE_MAGIC "GtkIRC\r\n"
+#define CACHE_VERSION 1
+
+#define CACHE_KEY_ALIGN 8
+#define CACHE_TOUCH_INTERVAL (24 * 60 * 60)
+
+typedef struct
+{
+  gchar   magic[8];
+  guint32 version;
+  guint32 byte_order;
+  guint32 width;
+  guint32 height;
+  guint32 rowstride;
+  guint32 has_alpha;
+  guint32 key_length;
+  guint32 reserved;
+  gint64  source_mtime;
+  gint64  source_size;
+  gdouble scale;
+} CacheHeader;
+
+struct _GtkIconRasterCache
+{
+  gchar *directory;
+  gsize budget;
+  gint trim_interval;
+
+  /* Bytes written since the last trim, or 0 before the first store */
+  volatile gint pending;
+};
+
+G_LOCK_DEFINE_STATIC (trim);
+
+GtkIconRasterCache *
+gtk_icon_raster_cache_new (const gchar *directory,
+                           gsize        budget)
+{
+  GtkIconRasterCache *cache;
+
+  g_return_val_if_fail (directory != NULL, NULL);
+  g_return_val_if_fail (budget > 0, NULL);
+
+  cache = g_new0 (GtkIconRasterCache, 1);
+  cache->directory = g_strdup (directory);
+  cache->budget = budget;
+  cache->trim_interval = MAX (1, MIN (budget / 8, G_MAXINT / 2));
+
+  return cache;
+}
+
+void
+gtk_icon_raster_cache_free (GtkIconRasterCache *cache)
+{
+  g_free (cache->directory);
+  g_free (cache);
+}
+
+/* The cache is opt-in: GTK_ICON_RASTER_CACHE is the budget in
+ * megabytes, and it is disabled if unset or 0.
+ */
+GtkIconRasterCache *
+gtk_icon_raster_cache_get_default (void)
+{
+  static GtkIconRasterCache *default_cache = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      const gchar *env;
+      guint64 budget = 0;
+
+      env = g_getenv ("GTK_ICON_RASTER_CACHE");
+      if (env)
+        budget = g_ascii_strtoull (env, NULL, 10);
+
+      if (budget > 0 && budget <= G_MAXSIZE / (1024 * 1024))
+        {
+          gchar *directory;
+
+          directory = g_build_filename (g_get_user_cache_dir (),
+                                        "gtk-4.0", "icon-raster-cache",
+                                        NULL);
+          default_cache = gtk_icon_raster_cache_new (directory, budget * 1024 * 1024);
+          g_free (directory);
+
+          GTK_NOTE (ICONTHEME, g_message ("icon raster cache in %s, %" G_GUINT64_FORMAT " MB",
+                                          default_cache->directory, budget));
+        }
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return default_cache;
+}
+
+static gchar *
+get_entry_path (GtkIconRasterCache *cache,
+                const gchar        *key)
+{
+  gchar *checksum;
+  gchar *path;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+  path = g_build_filename (cache->directory, checksum, NULL);
+  g_free (checksum);
+
+  return path;
+}
+
+static gsize
+get_pixels_offset (gsize key_length)
+{
+  return sizeof (CacheHeader) + ((key_length + CACHE_KEY_ALIGN - 1) & ~(gsize) (CACHE_KEY_ALIGN - 1));
+}
+
+static gboolean
+stat_source (const gchar *source_path,
+             gint64      *mtime,
+             gint64      *size)
+{
+  GStatBuf st;
+
+  if (g_stat (source_path, &st) != 0)
+    return FALSE;
+
+  *mtime = st.st_mtime;
+  *size = st.st_size;
+
+  return TRUE;
+}
+
+static void
+unref_mapped_file (guchar   *pixels,
+                   gpointer  data)
+{
+  g_mapped_file_unref (data);
+}
+
+GdkPixbuf *
+gtk_icon_raster_cache_lookup (GtkIconRasterCache *cache,
+                              const gchar        *key,
+                              const gchar        *source_path,
+                              gdouble            *scale)
+{
+  GdkPixbuf *pixbuf = NULL;
+  GMappedFile *map = NULL;
+  CacheHeader header;
+  const gchar *contents;
+  gsize length, key_length, offset;
+  guint64 pixels_length;
+  gint64 source_mtime, source_size;
+  guint n_channels;
+  gchar *path;
+  GStatBuf st;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (key != NULL, NULL);
+  g_return_val_if_fail (source_path != NULL, NULL);
+
+  path = get_entry_path (cache, key);
+
+  if (g_stat (path, &st) != 0)
+    goto out;
+
+  if (!stat_source (source_path, &source_mtime, &source_size))
+    goto out;
+
+  /* The mapping is private and writable, so pages stay shared with
+   * other processes until somebody modifies the pixels of the icon.
+   */
+  map = g_mapped_file_new (path, TRUE, NULL);
+  if (!map)
+    goto out;
+
+  contents = g_mapped_file_get_contents (map);
+  length = g_mapped_file_get_length (map);
+  key_length = strlen (key);
+
+  if (length < sizeof (CacheHeader))
+    goto out;
+
+  memcpy (&header, contents, sizeof (CacheHeader));
+
+  if (memcmp (header.magic, CACHE_MAGIC, sizeof (header.magic)) != 0 ||
+      header.version != CACHE_VERSION ||
+      header.byte_order != G_BYTE_ORDER)
+    {
+      GTK_NOTE (ICONTHEME, g_message ("icon raster cache: ignoring invalid entry %s", path));
+      goto out;
+    }
+
+  if (header.key_length != key_length)
+    goto out;
+
+  offset = get_pixels_offset (key_length);
+  if (length < offset ||
+      memcmp (contents + sizeof (CacheHeader), key, key_length) != 0)
+    goto out;
+
+  if (header.source_mtime != source_mtime ||
+      header.source_size != source_size)
+    {
+      GTK_NOTE (ICONTHEME, g_message ("icon raster cache: %s changed", source_path));
+      goto out;
+    }
+
+  n_channels = header.has_alpha ? 4 : 3;
+  if (header.width == 0 || header.height == 0 ||
+      header.width > G_MAXINT / n_channels ||
+      header.height > G_MAXINT ||
+      header.rowstride < header.width * n_channels ||
+      header.rowstride > G_MAXINT)
+    goto out;
+
+  pixels_length = (guint64) header.rowstride * (header.height - 1) + header.width * n_channels;
+  if (pixels_length > length - offset)
+    goto out;
+
+  pixbuf = gdk_pixbuf_new_from_data ((guchar *) contents + offset,
+                                     GDK_COLORSPACE_RGB,
+                                     header.has_alpha != 0,
+                                     8,
+                                     header.width, header.height,
+                                     header.rowstride,
+                                     unref_mapped_file,
+                                     g_mapped_file_ref (map));
+
+  *scale = header.scale;
+
+  if (g_get_real_time () / G_USEC_PER_SEC - st.st_mtime > CACHE_TOUCH_INTERVAL)
+    g_utime (path, NULL);
+
+out:
+  if (map)
+    g_mapped_file_unref (map);
+  g_free (path);
+
+  return pixbuf;
+}
+
+typedef struct
+{
+  gchar *name;
+  gint64 mtime;
+  gint64 size;
+} CacheEntry;
+
+static gint
+compare_entries (gconstpointer a,
+                 gconstpointer b)
+{
+  const CacheEntry *ea = a;
+  const CacheEntry *eb = b;
+
+  if (ea->mtime < eb->mtime)
+    return -1;
+  else if (ea->mtime > eb->mtime)
+    return 1;
+  else
+    return 0;
+}
+
+static void
+clear_entry (gpointer data)
+{
+  CacheEntry *entry = data;
+
+  g_free (entry->name);
+}
+
+/* Removes the least recently used entries until the cache uses at
+ * most three quarters of its budget, so that we don't have to trim
+ * again right away.
+ */
+void
+gtk_icon_raster_cache_trim (GtkIconRasterCache *cache)
+{
+  GArray *entries;
+  const gchar *name;
+  gint64 total;
+  GDir *dir;
+  guint i;
+
+  g_return_if_fail (cache != NULL);
+
+  G_LOCK (trim);
+
+  dir = g_dir_open (cache->directory, 0, NULL);
+  if (!dir)
+    {
+      G_UNLOCK (trim);
+      return;
+    }
+
+  entries = g_array_new (FALSE, FALSE, sizeof (CacheEntry));
+  g_array_set_clear_func (entries, clear_entry);
+  total = 0;
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      CacheEntry entry;
+      gchar *path;
+      GStatBuf st;
+
+      /* Skip temporary files of writers in progress */
+      if (strchr (name, '.'))
+        continue;
+
+      path = g_build_filename (cache->directory, name, NULL);
+      if (g_stat (path, &st) == 0)
+        {
+          entry.name = g_strdup (name);
+          entry.mtime = st.st_mtime;
+          entry.size = st.st_size;
+          g_array_append_val (entries, entry);
+          total += entry.size;
+        }
+      g_free (path);
+    }
+
+  g_dir_close (dir);
+
+  if (total > (gint64) cache->budget)
+    {
+      g_array_sort (entries, compare_entries);
+
+      for (i = 0; i < entries->len && total > (gint64) (cache->budget / 4 * 3); i++)
+        {
+          CacheEntry *entry = &g_array_index (entries, CacheEntry, i);
+          gchar *path;
+
+          path = g_build_filename (cache->directory, entry->name, NULL);
+          if (g_unlink (path) == 0)
+            total -= entry->size;
+          g_free (path);
+        }
+
+      GTK_NOTE (ICONTHEME, g_message ("icon raster cache: evicted %u entries", i));
+    }
+
+  g_array_unref (entries);
+
+  G_UNLOCK (trim);
+}
+
+void
+gtk_icon_raster_cache_store (GtkIconRasterCache *cache,
+                             const gchar        *key,
+                             const gchar        *source_path,
+                             GdkPixbuf          *pixbuf,
+                             gdouble             scale)
+{
+  CacheHeader header;
+  gint64 source_mtime, source_size;
+  gsize key_length, offset, pixels_length, length;
+  gchar *path;
+  gchar *data;
+  gint pending;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (key != NULL);
+  g_return_if_fail (source_path != NULL);
+  g_return_if_fail (GDK_IS_PIXBUF (pixbuf));
+
+  if (gdk_pixbuf_get_colorspace (pixbuf) != GDK_COLORSPACE_RGB ||
+      gdk_pixbuf_get_bits_per_sample (pixbuf) != 8 ||
+      gdk_pixbuf_get_n_channels (pixbuf) != (gdk_pixbuf_get_has_alpha (pixbuf) ? 4 : 3))
+    return;
+
+  if (!stat_source (source_path, &source_mtime, &source_size))
+    return;
+
+  key_length = strlen (key);
+  offset = get_pixels_offset (key_length);
+  pixels_length = gdk_pixbuf_get_byte_length (pixbuf);
+  length = offset + pixels_length;
+
+  /* Don't let a single icon take over the cache */
+  if (length > cache->budget / 4)
+    return;
+
+  if (g_mkdir_with_parents (cache->directory, 0700) != 0)
+    return;
+
+  memset (&header, 0, sizeof (CacheHeader));
+  memcpy (header.magic, CACHE_MAGIC, sizeof (header.magic));
+  header.version = CACHE_VERSION;
+  header.byte_order = G_BYTE_ORDER;
+  header.width = gdk_pixbuf_get_width (pixbuf);
+  header.height = gdk_pixbuf_get_height (pixbuf);
+  header.rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  header.has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+  header.key_length = key_length;
+  header.source_mtime = source_mtime;
+  header.source_size = source_size;
+  header.scale = scale;
+
+  data = g_malloc0 (length);
+  memcpy (data, &header, sizeof (CacheHeader));
+  memcpy (data + sizeof (CacheHeader), key, key_length);
+  memcpy (data + offset, gdk_pixbuf_get_pixels (pixbuf), pixels_length);
+
+  path = get_entry_path (cache, key);
+  if (g_file_set_contents (path, data, length, NULL))
+    GTK_NOTE (ICONTHEME, g_message ("icon raster cache: stored %s", source_path));
+  g_free (path);
+  g_free (data);
+
+  /* Trim on the first store, to account for what earlier processes
+   * left behind, and then whenever enough new data has accumulated.
+   */
+  length = MIN (length, (gsize) cache->trim_interval);
+  pending = g_atomic_int_add (&cache->pending, (gint) length);
+  if (pending == 0 || pending + (gint) length >= cache->trim_interval)
+    {
+      g_atomic_int_set (&cache->pending, 1);
+      gtk_icon_raster_cache_trim (cache);
+    }
+}
@@ -0,0 +1,45 @@
+/* gtkiconrastercacheprivate.h
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __GTK_ICON_RASTER_CACHE_PRIVATE_H__
+#define __GTK_ICON_RASTER_CACHE_PRIVATE_H__
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GtkIconRasterCache GtkIconRasterCache;
+
+GtkIconRasterCache *gtk_icon_raster_cache_get_default (void);
+
+GtkIconRasterCache *gtk_icon_raster_cache_new         (const gchar        *directory,
+                                                       gsize               budget);
+void                gtk_icon_raster_cache_free        (GtkIconRasterCache *cache);
+
+GdkPixbuf          *gtk_icon_raster_cache_lookup      (GtkIconRasterCache *cache,
+                                                       const gchar        *key,
+                                                       const gchar        *source_path,
+                                                       gdouble            *scale);
+void                gtk_icon_raster_cache_store       (GtkIconRasterCache *cache,
+                                                       const gchar        *key,
+                                                       const gchar        *source_path,
+                                                       GdkPixbuf          *pixbuf,
+                                                       gdouble             scale);
+void                gtk_icon_raster_cache_trim        (GtkIconRasterCache *cache);
+
+G_END_DECLS
+
+#endif /* __GTK_ICON_RASTER_CACHE_PRIVATE_H__ */
@@ -42,6 +42,7 @@
 #include "gtkcssrgbavalueprivate.h"
 #include "gtkdebug.h"
 #include "gtkiconcacheprivate.h"
+#include "gtkiconrastercacheprivate.h"
 #include "gtkintl.h"
 #include "gtkmain.h"
 #include "gtksettingsprivate.h"
@@ -229,9 +230,6 @@ struct _GtkIconInfo
   gdouble scale;
 
   SymbolicPixbufCache *symbolic_pixbuf_cache;
-
-  gint symbolic_width;
-  gint symbolic_height;
 };
 
 typedef struct
@@ -243,6 +241,11 @@ typedef struct
 
   /* In search order */
   GList *dirs;
+
+  /* Maps icon names to the dirs containing them, in search order.
+   * Built on the first lookup, see theme_ensure_index()
+   */
+  GHashTable *index;
 } IconTheme;
 
 typedef struct
@@ -260,6 +263,7 @@ typedef struct
   gchar *dir;
   gchar *subdir;
   gint subdir_index;
+  gint position;
   
   GtkIconCache *cache;
   
@@ -2623,6 +2627,8 @@ theme_destroy (IconTheme *theme)
   g_free (theme->example);
 
   g_list_free_full (theme->dirs, (GDestroyNotify) theme_dir_destroy);
+  if (theme->index)
+    g_hash_table_unref (theme->index);
   
   g_free (theme);
 }
@@ -2840,6 +2846,169 @@ compare_dir_matches (IconThemeDir *dir_a, gint difference_a,
   return diff_a <= diff_b;
 }
 
+static gint
+compare_dir_positions (gconstpointer a,
+                       gconstpointer b)
+{
+  const IconThemeDir *dir_a = *(const IconThemeDir **) a;
+  const IconThemeDir *dir_b = *(const IconThemeDir **) b;
+
+  return dir_a->position - dir_b->position;
+}
+
+static void
+theme_index_add (IconTheme    *theme,
+                 const gchar  *icon_name,
+                 IconThemeDir *dir)
+{
+  GPtrArray *dirs;
+
+  dirs = g_hash_table_lookup (theme->index, icon_name);
+  if (dirs == NULL)
+    {
+      dirs = g_ptr_array_new ();
+      g_hash_table_insert (theme->index, g_strdup (icon_name), dirs);
+    }
+
+  g_ptr_array_add (dirs, dir);
+}
+
+typedef struct
+{
+  IconTheme *theme;
+  GPtrArray *dirs;
+} IndexCacheData;
+
+static void
+theme_index_add_cached (const gchar *icon_name,
+                        gint         directory_index,
+                        gpointer     user_data)
+{
+  IndexCacheData *data = user_data;
+  gchar *name;
+  GSList *l;
+
+  if ((guint) directory_index >= data->dirs->len)
+    return;
+
+  /* The cache only strips ".png" from foo-symbolic.symbolic.png,
+   * see theme_dir_get_icon_suffix()
+   */
+  if (g_str_has_suffix (icon_name, ".symbolic"))
+    name = g_strndup (icon_name, strlen (icon_name) - strlen (".symbolic"));
+  else
+    name = NULL;
+
+  /* The same subdir can be listed more than once, e.g. both in
+   * Directories and ScaledDirectories, so add every dir using it
+   */
+  for (l = g_ptr_array_index (data->dirs, directory_index); l; l = l->next)
+    {
+      theme_index_add (data->theme, icon_name, l->data);
+      if (name)
+        theme_index_add (data->theme, name, l->data);
+    }
+
+  g_free (name);
+}
+
+/* Looking up an icon used to mean asking every directory of the
+ * theme whether it has the icon, which adds up for themes with many
+ * directories and for names that are missing from most themes in
+ * the inheritance chain. Instead, we collect the contents of all
+ * directories once, so that a lookup is a single hash table probe
+ * followed by a size match among the directories that have the icon.
+ */
+static void
+theme_ensure_index (IconTheme *theme)
+{
+  GHashTable *caches;
+  GHashTableIter iter;
+  gpointer key, value;
+  GList *l;
+  gint position;
+
+  if (theme->index)
+    return;
+
+  theme->index = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, (GDestroyNotify) g_ptr_array_unref);
+
+  /* Maps each icon cache to lists of its dirs, by subdir index */
+  caches = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_ptr_array_unref);
+
+  for (l = theme->dirs, position = 0; l; l = l->next, position++)
+    {
+      IconThemeDir *dir = l->data;
+
+      dir->position = position;
+
+      if (dir->cache)
+        {
+          GPtrArray *dirs;
+
+          if (dir->subdir_index < 0)
+            continue;
+
+          dirs = g_hash_table_lookup (caches, dir->cache);
+          if (dirs == NULL)
+            {
+              dirs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_slist_free);
+              g_hash_table_insert (caches, dir->cache, dirs);
+            }
+
+          if (dirs->len <= (guint) dir->subdir_index)
+            g_ptr_array_set_size (dirs, dir->subdir_index + 1);
+          g_ptr_array_index (dirs, dir->subdir_index) =
+            g_slist_prepend (g_ptr_array_index (dirs, dir->subdir_index), dir);
+        }
+      else if (dir->icons)
+        {
+          g_hash_table_iter_init (&iter, dir->icons);
+          while (g_hash_table_iter_next (&iter, &key, NULL))
+            theme_index_add (theme, key, dir);
+        }
+    }
+
+  /* A theme usually has a single cache for all its dirs, so walking
+   * each cache once is much cheaper than listing it per dir
+   */
+  g_hash_table_iter_init (&iter, caches);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      IndexCacheData data = { theme, value };
+
+      gtk_icon_cache_foreach_icon (key, theme_index_add_cached, &data);
+    }
+
+  g_hash_table_unref (caches);
+
+  /* Restore the search order, which decides between equally good
+   * matches, and drop the duplicates added for symbolic pngs
+   */
+  g_hash_table_iter_init (&iter, theme->index);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      GPtrArray *dirs = value;
+      guint i, j;
+
+      if (dirs->len < 2)
+        continue;
+
+      g_ptr_array_sort (dirs, compare_dir_positions);
+
+      for (i = 1, j = 1; i < dirs->len; i++)
+        {
+          if (g_ptr_array_index (dirs, i) != g_ptr_array_index (dirs, j - 1))
+            g_ptr_array_index (dirs, j++) = g_ptr_array_index (dirs, i);
+        }
+      g_ptr_array_set_size (dirs, j);
+    }
+
+  GTK_NOTE (ICONTHEME, g_message ("indexed %u icons of theme %s",
+                                  g_hash_table_size (theme->index), theme->name));
+}
+
 static GtkIconInfo *
 theme_lookup_icon (IconTheme   *theme,
                    const gchar *icon_name,
@@ -2848,21 +3017,25 @@ theme_lookup_icon (IconTheme   *theme,
                    gboolean     allow_svg,
                    gboolean     use_builtin)
 {
-  GList *dirs, *l;
+  GPtrArray *dirs;
   IconThemeDir *dir, *min_dir;
   gchar *file;
   gint min_difference, difference;
   IconSuffix suffix;
+  guint i;
 
   min_difference = G_MAXINT;
   min_dir = NULL;
 
-  dirs = theme->dirs;
+  theme_ensure_index (theme);
 
-  l = dirs;
-  while (l != NULL)
+  dirs = g_hash_table_lookup (theme->index, icon_name);
+  if (dirs == NULL)
+    return NULL;
+
+  for (i = 0; i < dirs->len; i++)
     {
-      dir = l->data;
+      dir = g_ptr_array_index (dirs, i);
 
       GTK_NOTE (ICONTHEME, g_message ("look up icon dir %s", dir->dir));
       suffix = theme_dir_get_icon_suffix (dir, icon_name, NULL);
@@ -2878,8 +3051,6 @@ theme_lookup_icon (IconTheme   *theme,
               min_difference = difference;
             }
         }
-
-      l = l->next;
     }
 
   if (min_dir)
@@ -2960,25 +3131,9 @@ static gboolean
 theme_has_icon (IconTheme   *theme,
                 const gchar *icon_name)
 {
-  GList *l;
+  theme_ensure_index (theme);
 
-  for (l = theme->dirs; l; l = l->next)
-    {
-      IconThemeDir *dir = l->data;
-
-      if (dir->cache)
-        {
-          if (gtk_icon_cache_has_icon (dir->cache, icon_name))
-            return TRUE;
-        }
-      else
-        {
-          if (g_hash_table_lookup (dir->icons, icon_name) != NULL)
-            return TRUE;
-        }
-    }
-
-  return FALSE;
+  return g_hash_table_contains (theme->index, icon_name);
 }
 
 static void
@@ -3294,8 +3449,6 @@ icon_info_dup (GtkIconInfo *icon_info)
   dup->is_resource = icon_info->is_resource;
   dup->min_size = icon_info->min_size;
   dup->max_size = icon_info->max_size;
-  dup->symbolic_width = icon_info->symbolic_width;
-  dup->symbolic_height = icon_info->symbolic_height;
 
   return dup;
 }
@@ -3443,6 +3596,27 @@ icon_info_get_pixbuf_ready (GtkIconInfo *icon_info)
   return FALSE;
 }
 
+/* The key uses the resolved file instead of the theme and icon name
+ * on purpose, as themes and fallbacks can resolve to the same file.
+ * The path also decides whether the icon is symbolic.
+ */
+static gchar *
+icon_info_get_raster_cache_key (GtkIconInfo *icon_info,
+                                const gchar *path)
+{
+  return g_strdup_printf ("%s\n%d %d %d %d %d %d %d %d %g",
+                          path,
+                          icon_info->desired_size,
+                          icon_info->desired_scale,
+                          icon_info->forced_size,
+                          icon_info->dir_type,
+                          icon_info->dir_size,
+                          icon_info->dir_scale,
+                          icon_info->min_size,
+                          icon_info->max_size,
+                          icon_info->unscaled_scale);
+}
+
 /* This function contains the complicated logic for deciding
  * on the size at which to load the icon and loading it at
  * that size.
@@ -3454,6 +3628,9 @@ icon_info_ensure_scale_and_pixbuf (GtkIconInfo *icon_info)
   gint scaled_desired_size;
   GdkPixbuf *source_pixbuf;
   gdouble dir_scale;
+  GtkIconRasterCache *raster_cache;
+  gchar *raster_path = NULL;
+  gchar *raster_key = NULL;
 
   if (icon_info->pixbuf)
     return TRUE;
@@ -3497,6 +3674,32 @@ icon_info_ensure_scale_and_pixbuf (GtkIconInfo *icon_info)
         icon_info->scale = (gdouble) scaled_desired_size / (icon_info->dir_size * dir_scale);
     }
 
+  /* Loading an icon from a file, in particular rendering an SVG, is
+   * expensive enough that we may have kept the result on disk
+   */
+  raster_cache = gtk_icon_raster_cache_get_default ();
+  if (raster_cache &&
+      !icon_info->cache_pixbuf &&
+      !icon_info->is_resource &&
+      icon_info->icon_file)
+    raster_path = g_file_get_path (icon_info->icon_file);
+
+  if (raster_path)
+    {
+      gdouble raster_scale;
+
+      raster_key = icon_info_get_raster_cache_key (icon_info, raster_path);
+      icon_info->pixbuf = gtk_icon_raster_cache_lookup (raster_cache, raster_key,
+                                                        raster_path, &raster_scale);
+      if (icon_info->pixbuf)
+        {
+          icon_info->scale = raster_scale;
+          g_free (raster_key);
+          g_free (raster_path);
+          return TRUE;
+        }
+    }
+
   /* At this point, we need to actually get the icon; either from the
    * builtin image or by loading the file
    */
@@ -3602,6 +3805,9 @@ icon_info_ensure_scale_and_pixbuf (GtkIconInfo *icon_info)
           warn_about_load_failure = FALSE;
         }
 
+      g_free (raster_key);
+      g_free (raster_path);
+
       return FALSE;
     }
 
@@ -3638,6 +3844,14 @@ icon_info_ensure_scale_and_pixbuf (GtkIconInfo *icon_info)
       g_object_unref (source_pixbuf);
     }
 
+  if (raster_path)
+    {
+      gtk_icon_raster_cache_store (raster_cache, raster_key, raster_path,
+                                   icon_info->pixbuf, icon_info->scale);
+      g_free (raster_key);
+      g_free (raster_path);
+    }
+
   return TRUE;
 }
 
@@ -3915,21 +4129,6 @@ symbolic_cache_get_proxy (SymbolicPixbufCache *symbolic_cache,
   return symbolic_cache->proxy_pixbuf;
 }
 
-#define MAX_RGB_STRING_LENGTH (3 + 1 + ((3 + 1) * 3) + 1 + 1)
-static inline void
-rgba_to_string_noalpha (const GdkRGBA *rgba,
-                        char          *buff)
-{
-  /* gdk_rgba_to_string inlined in here for the alpha == 1 case,
-   * and g_strdup_printf replaced with g_snprintf */
-  g_snprintf (buff,
-              MAX_RGB_STRING_LENGTH,
-              "rgb(%d,%d,%d)",
-              (int)(0.5 + CLAMP (rgba->red, 0., 1.) * 255.),
-              (int)(0.5 + CLAMP (rgba->green, 0., 1.) * 255.),
-              (int)(0.5 + CLAMP (rgba->blue, 0., 1.) * 255.));
-}
-
 static void
 rgba_to_pixel(const GdkRGBA  *rgba,
 	      guint8 pixel[4])
@@ -4024,13 +4223,20 @@ gtk_icon_theme_color_symbolic_pixbuf (GdkPixbuf     *symbolic,
   return colored;
 }
 
+/* Colors the symbolic icon from the mask that icon_info->pixbuf holds
+ * for symbolic icons: the red, green and blue channels are the parts
+ * in the success, warning and error colors, the rest is foreground.
+ * For .symbolic.png files that is the file, SVGs are rendered into
+ * it once per size by gtk_make_symbolic_pixbuf_from_file(), so new
+ * colors don't need the SVG to be parsed and rendered again.
+ */
 static GdkPixbuf *
-gtk_icon_info_load_symbolic_png (GtkIconInfo    *icon_info,
-                                 const GdkRGBA  *fg,
-                                 const GdkRGBA  *success_color,
-                                 const GdkRGBA  *warning_color,
-                                 const GdkRGBA  *error_color,
-                                 GError        **error)
+gtk_icon_info_load_symbolic_mask (GtkIconInfo    *icon_info,
+                                  const GdkRGBA  *fg,
+                                  const GdkRGBA  *success_color,
+                                  const GdkRGBA  *warning_color,
+                                  const GdkRGBA  *error_color,
+                                  GError        **error)
 {
   GdkRGBA fg_default = { 0.7450980392156863, 0.7450980392156863, 0.7450980392156863, 1.0};
   GdkRGBA success_default = { 0.3046921492332342,0.6015716792553597, 0.023437857633325704, 1.0};
@@ -4062,133 +4268,6 @@ gtk_icon_info_load_symbolic_png (GtkIconInfo    *icon_info,
                                                error_color ? error_color : &error_default);
 }
 
-static GdkPixbuf *
-gtk_icon_info_load_symbolic_svg (GtkIconInfo    *icon_info,
-                                 const GdkRGBA  *fg,
-                                 const GdkRGBA  *success_color,
-                                 const GdkRGBA  *warning_color,
-                                 const GdkRGBA  *error_color,
-                                 GError        **error)
-{
-  GInputStream *stream;
-  GdkPixbuf *pixbuf;
-  char css_fg[MAX_RGB_STRING_LENGTH];
-  char css_warning[MAX_RGB_STRING_LENGTH] = "rgb(245,121,62)";
-  char css_success[MAX_RGB_STRING_LENGTH] = "rgb(78,154,6)";
-  char css_error[MAX_RGB_STRING_LENGTH] = "rgb(204,0,0)";
-  gchar *data;
-  gchar *width;
-  gchar *height;
-  gchar *file_data, *escaped_file_data;
-  gsize file_len;
-  gint symbolic_size;
-  double alpha;
-  gchar alphastr[G_ASCII_DTOSTR_BUF_SIZE];
-
-  alpha = fg->alpha;
-
-  rgba_to_string_noalpha (fg, css_fg);
-
-  if (warning_color)
-    rgba_to_string_noalpha (warning_color, css_warning);
-
-  if (error_color)
-    rgba_to_string_noalpha (error_color, css_error);
-
-  if (success_color)
-    rgba_to_string_noalpha (success_color, css_success);
-
-  if (!g_file_load_contents (icon_info->icon_file, NULL, &file_data, &file_len, NULL, error))
-    return NULL;
-
-  if (!icon_info_ensure_scale_and_pixbuf (icon_info))
-    {
-      g_propagate_error (error, icon_info->load_error);
-      icon_info->load_error = NULL;
-      g_free (file_data);
-      return NULL;
-    }
-
-  if (icon_info->symbolic_width == 0 ||
-      icon_info->symbolic_height == 0)
-    {
-      /* Fetch size from the original icon */
-      stream = g_memory_input_stream_new_from_data (file_data, file_len, NULL);
-      pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, error);
-      g_object_unref (stream);
-
-      if (!pixbuf)
-        {
-          g_free (file_data);
-          return NULL;
-        }
-
-      icon_info->symbolic_width = gdk_pixbuf_get_width (pixbuf);
-      icon_info->symbolic_height = gdk_pixbuf_get_height (pixbuf);
-      g_object_unref (pixbuf);
-    }
-
-  symbolic_size = MAX (icon_info->symbolic_width, icon_info->symbolic_height);
-
-  GTK_NOTE (ICONTHEME,
-  if (icon_info->dir_type == ICON_THEME_DIR_UNTHEMED)
-    g_message ("Symbolic icon %s is not in an icon theme directory",
-               icon_info->key.icon_names ? icon_info->key.icon_names[0] : icon_info->filename);
-  else if (icon_info->dir_size * icon_info->dir_scale != symbolic_size)
-    g_message ("Symbolic icon %s of size %d is in an icon theme directory of size %d",
-               icon_info->key.icon_names ? icon_info->key.icon_names[0] : icon_info->filename,
-               symbolic_size,
-               icon_info->dir_size * icon_info->dir_scale)
-  );
-
-  width = g_strdup_printf ("%d", icon_info->symbolic_width);
-  height = g_strdup_printf ("%d", icon_info->symbolic_height);
-
-  escaped_file_data = g_base64_encode ((guchar *) file_data, file_len);
-  g_free (file_data);
-
-  g_ascii_dtostr (alphastr, G_ASCII_DTOSTR_BUF_SIZE, CLAMP (alpha, 0, 1));
-
-  data = g_strconcat ("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
-                      "<svg version=\"1.1\"\n"
-                      "     xmlns=\"http://www.w3.org/2000/svg\"\n"
-                      "     xmlns:xi=\"http://www.w3.org/2001/XInclude\"\n"
-                      "     width=\"", width, "\"\n"
-                      "     height=\"", height, "\">\n"
-                      "  <style type=\"text/css\">\n"
-                      "    rect,path,ellipse,circle,polygon {\n"
-                      "      fill: ", css_fg," !important;\n"
-                      "    }\n"
-                      "    .warning {\n"
-                      "      fill: ", css_warning, " !important;\n"
-                      "    }\n"
-                      "    .error {\n"
-                      "      fill: ", css_error ," !important;\n"
-                      "    }\n"
-                      "    .success {\n"
-                      "      fill: ", css_success, " !important;\n"
-                      "    }\n"
-                      "  </style>\n"
-                      "  <g opacity=\"", alphastr, "\" ><xi:include href=\"data:text/xml;base64,", escaped_file_data, "\"/></g>\n"
-                      "</svg>",
-                      NULL);
-  g_free (escaped_file_data);
-  g_free (width);
-  g_free (height);
-
-  stream = g_memory_input_stream_new_from_data (data, -1, g_free);
-  pixbuf = gdk_pixbuf_new_from_stream_at_scale (stream,
-                                                gdk_pixbuf_get_width (icon_info->pixbuf),
-                                                gdk_pixbuf_get_height (icon_info->pixbuf),
-                                                TRUE,
-                                                NULL,
-                                                error);
-  g_object_unref (stream);
-
-  return pixbuf;
-}
-
-
 static GdkPixbuf *
 gtk_icon_info_load_symbolic_internal (GtkIconInfo    *icon_info,
 				      const GdkRGBA  *fg,
@@ -4200,7 +4279,6 @@ gtk_icon_info_load_symbolic_internal (GtkIconInfo    *icon_info,
 {
   GdkPixbuf *pixbuf;
   SymbolicPixbufCache *symbolic_cache;
-  char *icon_uri;
 
   if (use_cache)
     {
@@ -4215,13 +4293,7 @@ gtk_icon_info_load_symbolic_internal (GtkIconInfo    *icon_info,
    */
   g_return_val_if_fail (fg != NULL, NULL);
 
-  icon_uri = g_file_get_uri (icon_info->icon_file);
-  if (g_str_has_suffix (icon_uri, ".symbolic.png"))
-    pixbuf = gtk_icon_info_load_symbolic_png (icon_info, fg, success_color, warning_color, error_color, error);
-  else
-    pixbuf = gtk_icon_info_load_symbolic_svg (icon_info, fg, success_color, warning_color, error_color, error);
-
-  g_free (icon_uri);
+  pixbuf = gtk_icon_info_load_symbolic_mask (icon_info, fg, success_color, warning_color, error_color, error);
 
   if (pixbuf != NULL)
     {
@@ -259,6 +259,7 @@ struct _GtkLabelPrivate
   PangoAttrList *attrs;
   PangoAttrList *markup_attrs;
   PangoLayout   *layout;
+  PangoLayout  **measure_cache;
 
   gchar   *label;
   gchar   *text;
@@ -285,6 +286,12 @@ struct _GtkLabelPrivate
   gint     lines;
 };
 
+/* Number of layouts for other widths than the one of the label's own
+ * layout that are kept, so that height-for-width measuring and the
+ * following allocation don't lay out the text again.
+ */
+#define MEASURE_CACHE_SIZE 4
+
 /* Notes about the handling of links:
  *
  * Links share the GtkLabelSelectionInfo struct with selectable labels.
@@ -3130,6 +3137,7 @@ gtk_label_set_line_wrap_mode (GtkLabel *label,
       priv->wrap_mode = wrap_mode;
       g_object_notify_by_pspec (G_OBJECT (label), label_props[PROP_WRAP_MODE]);
 
+      gtk_label_clear_layout (label);
       gtk_widget_queue_resize (GTK_WIDGET (label));
     }
 }
@@ -3171,7 +3179,7 @@ gtk_label_finalize (GObject *object)
   g_free (priv->label);
   g_free (priv->text);
 
-  g_clear_object (&priv->layout);
+  gtk_label_clear_layout (label);
   g_clear_pointer (&priv->attrs, pango_attr_list_unref);
   g_clear_pointer (&priv->markup_attrs, pango_attr_list_unref);
 
@@ -3186,18 +3194,132 @@ gtk_label_finalize (GObject *object)
   G_OBJECT_CLASS (gtk_label_parent_class)->finalize (object);
 }
 
+/* Counts new layouts and width changes of layouts. Pango lays out
+ * the text again for each of them when the layout is next used.
+ */
+static guint n_layout_updates;
+
+guint
+_gtk_label_get_n_layout_updates (void)
+{
+  return n_layout_updates;
+}
+
+static void
+gtk_label_clear_measure_cache (GtkLabel *label)
+{
+  GtkLabelPrivate *priv = gtk_label_get_instance_private (label);
+  int i;
+
+  if (priv->measure_cache == NULL)
+    return;
+
+  for (i = 0; i < MEASURE_CACHE_SIZE; i++)
+    g_clear_object (&priv->measure_cache[i]);
+
+  g_clear_pointer (&priv->measure_cache, g_free);
+}
+
+/* Adds the reference to @layout to the front of the cache,
+ * dropping the least recently used layout if it is full.
+ */
+static void
+gtk_label_add_to_measure_cache (GtkLabel    *label,
+                                PangoLayout *layout)
+{
+  GtkLabelPrivate *priv = gtk_label_get_instance_private (label);
+
+  if (priv->measure_cache == NULL)
+    priv->measure_cache = g_new0 (PangoLayout *, MEASURE_CACHE_SIZE);
+
+  g_clear_object (&priv->measure_cache[MEASURE_CACHE_SIZE - 1]);
+  memmove (&priv->measure_cache[1], &priv->measure_cache[0],
+           (MEASURE_CACHE_SIZE - 1) * sizeof (PangoLayout *));
+  priv->measure_cache[0] = layout;
+}
+
+/* Looks for a layout with @width, moving it to the front of the
+ * cache. If @take is %TRUE, it is removed from the cache instead
+ * and the caller gets its reference.
+ */
+static PangoLayout *
+gtk_label_lookup_measure_cache (GtkLabel *label,
+                                int       width,
+                                gboolean  take)
+{
+  GtkLabelPrivate *priv = gtk_label_get_instance_private (label);
+  PangoLayout *layout;
+  int i;
+
+  if (priv->measure_cache == NULL)
+    return NULL;
+
+  for (i = 0; i < MEASURE_CACHE_SIZE && priv->measure_cache[i] != NULL; i++)
+    {
+      layout = priv->measure_cache[i];
+      if (pango_layout_get_width (layout) != width)
+        continue;
+
+      if (take)
+        {
+          memmove (&priv->measure_cache[i], &priv->measure_cache[i + 1],
+                   (MEASURE_CACHE_SIZE - i - 1) * sizeof (PangoLayout *));
+          priv->measure_cache[MEASURE_CACHE_SIZE - 1] = NULL;
+        }
+      else
+        {
+          memmove (&priv->measure_cache[1], &priv->measure_cache[0],
+                   i * sizeof (PangoLayout *));
+          priv->measure_cache[0] = layout;
+        }
+
+      return layout;
+    }
+
+  return NULL;
+}
+
+/* Changes the width of the label's layout, swapping in a layout
+ * that has been measured with that width already if there is one.
+ * This replaces the layout returned by gtk_label_get_layout().
+ */
+static void
+gtk_label_set_layout_width (GtkLabel *label,
+                            int       width)
+{
+  GtkLabelPrivate *priv = gtk_label_get_instance_private (label);
+  PangoLayout *layout;
+
+  if (pango_layout_get_width (priv->layout) == width)
+    return;
+
+  layout = gtk_label_lookup_measure_cache (label, width, TRUE);
+  if (layout != NULL)
+    {
+      gtk_label_add_to_measure_cache (label, priv->layout);
+      priv->layout = layout;
+    }
+  else
+    {
+      pango_layout_set_width (priv->layout, width);
+      n_layout_updates++;
+    }
+}
+
 static void
 gtk_label_clear_layout (GtkLabel *label)
 {
   GtkLabelPrivate *priv = gtk_label_get_instance_private (label);
 
   g_clear_object (&priv->layout);
+  gtk_label_clear_measure_cache (label);
 }
 
 /**
  * gtk_label_get_measuring_layout:
  * @label: the label
- * @existing_layout: %NULL or an existing layout already in use.
+ * @existing_layout: %NULL or a layout returned by an earlier call
+ *   that is no longer needed
  * @width: the width to measure with in pango units, or -1 for infinite
  *
  * Gets a layout that can be used for measuring sizes. The returned
@@ -3205,6 +3327,10 @@ gtk_label_clear_layout (GtkLabel *label)
  * layout’s width, which will be set to @width. Do not modify the returned
  * layout.
  *
+ * Layouts for widths other than the label's own one are kept in a
+ * small cache, so measuring the same widths again in the next size
+ * negotiation doesn't lay out the text again.
+ *
  * Returns: a new reference to a pango layout
  **/
 static PangoLayout *
@@ -3214,18 +3340,10 @@ gtk_label_get_measuring_layout (GtkLabel *   label,
 {
   GtkLabelPrivate *priv = gtk_label_get_instance_private (label);
   PangoRectangle rect;
-  PangoLayout *copy;
+  PangoLayout *layout;
 
   if (existing_layout != NULL)
-    {
-      if (existing_layout != priv->layout)
-        {
-          pango_layout_set_width (existing_layout, width);
-          return existing_layout;
-        }
-
-      g_object_unref (existing_layout);
-    }
+    g_object_unref (existing_layout);
 
   gtk_label_ensure_layout (label);
 
@@ -3241,8 +3359,8 @@ gtk_label_get_measuring_layout (GtkLabel *   label,
    */
   if (gtk_widget_get_width (GTK_WIDGET (label)) <= 1)
     {
+      gtk_label_set_layout_width (label, width);
       g_object_ref (priv->layout);
-      pango_layout_set_width (priv->layout, width);
       return priv->layout;
     }
 
@@ -3260,9 +3378,17 @@ gtk_label_get_measuring_layout (GtkLabel *   label,
       return priv->layout;
     }
 
-  copy = pango_layout_copy (priv->layout);
-  pango_layout_set_width (copy, width);
-  return copy;
+  layout = gtk_label_lookup_measure_cache (label, width, FALSE);
+  if (layout == NULL)
+    {
+      layout = pango_layout_copy (priv->layout);
+      pango_layout_set_width (layout, width);
+      n_layout_updates++;
+      gtk_label_add_to_measure_cache (label, layout);
+    }
+
+  g_object_ref (layout);
+  return layout;
 }
 
 static void
@@ -3320,6 +3446,7 @@ gtk_label_update_layout_attributes (GtkLabel *label)
   attrs = _gtk_pango_attr_list_merge (attrs, priv->attrs);
 
   pango_layout_set_attributes (priv->layout, attrs);
+  gtk_label_clear_measure_cache (label);
 
   if (attrs)
     pango_attr_list_unref (attrs);
@@ -3340,6 +3467,7 @@ gtk_label_ensure_layout (GtkLabel *label)
   align = PANGO_ALIGN_LEFT; /* Quiet gcc */
   rtl = _gtk_widget_get_direction (GTK_WIDGET (label)) == GTK_TEXT_DIR_RTL;
   priv->layout = gtk_widget_create_pango_layout (GTK_WIDGET (label), priv->text);
+  n_layout_updates++;
 
   gtk_label_update_layout_attributes (label);
 
@@ -3574,8 +3702,6 @@ gtk_label_measure (GtkWidget      *widget,
 
   if (orientation == GTK_ORIENTATION_VERTICAL && for_size != -1 && priv->wrap)
     {
-      gtk_label_clear_layout (label);
-
       get_height_for_width (label, for_size, minimum, natural, minimum_baseline, natural_baseline);
     }
   else
@@ -3661,9 +3787,9 @@ gtk_label_size_allocate (GtkWidget *widget,
   if (priv->layout)
     {
       if (priv->ellipsize || priv->wrap)
-        pango_layout_set_width (priv->layout, width * PANGO_SCALE);
+        gtk_label_set_layout_width (label, width * PANGO_SCALE);
       else
-        pango_layout_set_width (priv->layout, -1);
+        gtk_label_set_layout_width (label, -1);
     }
 }
 
@@ -5409,6 +5535,11 @@ gtk_label_get_selection_bounds (GtkLabel  *label,
  * freed by the caller. The @label is free to recreate its layout at
  * any time, so it should be considered read-only.
  *
+ * The label also replaces its layout when its width changes, with
+ * a layout it laid out for that width before. Call this function
+ * again after the label was measured or allocated instead of
+ * holding on to the returned layout.
+ *
  * Returns: (transfer none): the #PangoLayout for this label
  **/
 PangoLayout*
@@ -44,6 +44,9 @@ gboolean     _gtk_label_get_link_visited (GtkLabel *label,
                                           gint      idx);
 gboolean     _gtk_label_get_link_focused (GtkLabel *label,
                                           gint      idx);
+
+GDK_AVAILABLE_IN_ALL
+guint        _gtk_label_get_n_layout_updates (void);
                              
 G_END_DECLS
 
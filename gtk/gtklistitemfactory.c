@@ -0,0 +1,144 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#include "config.h"
+
+#include "gtklistitemfactoryprivate.h"
+
+/* GtkListItemFactory creates the widgets that views display their
+ * items in and recycles them. Released widgets stay children of
+ * their parent, they are just hidden, so reusing them doesn't need
+ * to create new CSS nodes or to restyle them.
+ */
+
+struct _GtkListItemFactory
+{
+  GtkListItemSetupFunc setup_func;
+  GtkListItemBindFunc bind_func;
+  gpointer user_data;
+  GDestroyNotify user_destroy;
+
+  GPtrArray *unused;            /* released widgets */
+};
+
+GtkListItemFactory *
+gtk_list_item_factory_new (GtkListItemSetupFunc setup_func,
+                           GtkListItemBindFunc  bind_func,
+                           gpointer             user_data,
+                           GDestroyNotify       user_destroy)
+{
+  GtkListItemFactory *self;
+
+  g_return_val_if_fail (setup_func != NULL, NULL);
+  g_return_val_if_fail (bind_func != NULL, NULL);
+
+  self = g_slice_new0 (GtkListItemFactory);
+  self->setup_func = setup_func;
+  self->bind_func = bind_func;
+  self->user_data = user_data;
+  self->user_destroy = user_destroy;
+  self->unused = g_ptr_array_new ();
+
+  return self;
+}
+
+/* All acquired widgets must have been released before */
+void
+gtk_list_item_factory_free (GtkListItemFactory *self)
+{
+  gtk_list_item_factory_trim (self, 0);
+  g_ptr_array_unref (self->unused);
+
+  if (self->user_destroy)
+    self->user_destroy (self->user_data);
+
+  g_slice_free (GtkListItemFactory, self);
+}
+
+/*
+ * gtk_list_item_factory_acquire:
+ * @self: a #GtkListItemFactory
+ * @parent: the widget to add the new widget to
+ * @item: the item to display
+ *
+ * Gets a widget that displays @item. If a released widget is
+ * available, it is reused, otherwise a new one is created and added
+ * to @parent. All widgets acquired from @self must have the same
+ * parent.
+ *
+ * Returns: (transfer none): the widget
+ */
+GtkWidget *
+gtk_list_item_factory_acquire (GtkListItemFactory *self,
+                               GtkWidget          *parent,
+                               gpointer            item)
+{
+  GtkWidget *widget;
+
+  if (self->unused->len > 0)
+    {
+      widget = g_ptr_array_index (self->unused, self->unused->len - 1);
+      g_ptr_array_remove_index_fast (self->unused, self->unused->len - 1);
+      gtk_widget_set_child_visible (widget, TRUE);
+    }
+  else
+    {
+      widget = self->setup_func (self->user_data);
+      gtk_widget_set_parent (widget, parent);
+    }
+
+  self->bind_func (widget, item, self->user_data);
+
+  return widget;
+}
+
+/*
+ * gtk_list_item_factory_release:
+ * @self: a #GtkListItemFactory
+ * @widget: a widget acquired from @self
+ *
+ * Unbinds @widget from its item and hides it until it is reused.
+ */
+void
+gtk_list_item_factory_release (GtkListItemFactory *self,
+                               GtkWidget          *widget)
+{
+  self->bind_func (widget, NULL, self->user_data);
+  gtk_widget_set_child_visible (widget, FALSE);
+
+  g_ptr_array_add (self->unused, widget);
+}
+
+/*
+ * gtk_list_item_factory_trim:
+ * @self: a #GtkListItemFactory
+ * @n_unused: the number of released widgets to keep
+ *
+ * Destroys released widgets until at most @n_unused are left.
+ */
+void
+gtk_list_item_factory_trim (GtkListItemFactory *self,
+                            guint               n_unused)
+{
+  while (self->unused->len > n_unused)
+    {
+      gtk_widget_unparent (g_ptr_array_index (self->unused, self->unused->len - 1));
+      g_ptr_array_remove_index_fast (self->unused, self->unused->len - 1);
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#ifndef __GTK_LIST_ITEM_FACTORY_PRIVATE_H__
+#define __GTK_LIST_ITEM_FACTORY_PRIVATE_H__
+
+#include "gtklistview.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GtkListItemFactory GtkListItemFactory;
+
+GtkListItemFactory *    gtk_list_item_factory_new               (GtkListItemSetupFunc    setup_func,
+                                                                 GtkListItemBindFunc     bind_func,
+                                                                 gpointer                user_data,
+                                                                 GDestroyNotify          user_destroy);
+void                    gtk_list_item_factory_free              (GtkListItemFactory     *self);
+
+GtkWidget *             gtk_list_item_factory_acquire           (GtkListItemFactory     *self,
+                                                                 GtkWidget              *parent,
+                                                                 gpointer                item);
+void                    gtk_list_item_factory_release           (GtkListItemFactory     *self,
+                                                                 GtkWidget              *widget);
+void                    gtk_list_item_factory_trim              (GtkListItemFactory     *self,
+                                                                 guint                   n_unused);
+
+G_END_DECLS
+
+#endif /* __GTK_LIST_ITEM_FACTORY_PRIVATE_H__ */
@@ -0,0 +1,1016 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#include "config.h"
+
+#include "gtklistview.h"
+
+#include "gtkadjustment.h"
+#include "gtkcssrbtreeprivate.h"
+#include "gtkintl.h"
+#include "gtklistitemfactoryprivate.h"
+#include "gtkprivate.h"
+#include "gtkscrollable.h"
+#include "gtksnapshot.h"
+
+/**
+ * SECTION:gtklistview
+ * @Title: GtkListView
+ * @Short_description: A widget for displaying large lists
+ * @See_also: #GListModel, #GtkListBox
+ *
+ * GtkListView is a widget to present a view into a large dynamic list
+ * of items.
+ *
+ * Unlike #GtkListBox, it only creates widgets for the items that are
+ * visible and a few items around them. When scrolling, the widgets of
+ * items that scroll out of view are reused for the items that scroll
+ * into view. The widgets are created by a #GtkListItemSetupFunc and
+ * made to display an item by a #GtkListItemBindFunc, see
+ * gtk_list_view_set_functions().
+ *
+ * Items that have never been displayed aren't measured, their height
+ * is estimated from the items that have been.
+ *
+ * GtkListView implements #GtkScrollable, so it is meant to be put
+ * into a #GtkScrolledWindow directly. It only scrolls vertically,
+ * items are as wide as the list view.
+ *
+ * # CSS nodes
+ *
+ * GtkListView has a single CSS node with name listview.
+ */
+
+/* Items that get widgets above and below the visible ones */
+#define GTK_LIST_VIEW_EXTRA_ROWS 4
+
+typedef struct _ListRow ListRow;
+typedef struct _ListRowAugment ListRowAugment;
+
+/* Rows that weren't measured yet are kept in ranges. Every other row
+ * has its own node, so it can remember its height after its widget
+ * was reused for another row.
+ */
+struct _ListRow
+{
+  guint n_rows;
+  guint height;                 /* only if measured */
+  GtkWidget *widget;            /* only if n_rows == 1 */
+  guint measured : 1;           /* only if n_rows == 1 */
+};
+
+struct _ListRowAugment
+{
+  guint n_rows;
+  guint n_measured;
+  guint height;                 /* of the measured rows */
+};
+
+struct _GtkListView
+{
+  GtkWidget parent_instance;
+
+  GListModel *model;
+  GtkListItemFactory *factory;
+  GtkAdjustment *adjustment[2];
+  GtkScrollablePolicy scroll_policy[2];
+
+  GtkCssRbTree *rows;
+  int measured_width;           /* the width rows were measured for */
+
+  /* Only rows in this range may have widgets */
+  guint range_start;
+  guint range_end;
+};
+
+enum
+{
+  PROP_0,
+  PROP_HADJUSTMENT,
+  PROP_HSCROLL_POLICY,
+  PROP_MODEL,
+  PROP_VADJUSTMENT,
+  PROP_VSCROLL_POLICY,
+
+  N_PROPS
+};
+
+G_DEFINE_TYPE_WITH_CODE (GtkListView, gtk_list_view, GTK_TYPE_WIDGET,
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_SCROLLABLE, NULL))
+
+static GParamSpec *properties[N_PROPS] = { NULL, };
+
+static void
+list_row_augment (GtkCssRbTree *tree,
+                  gpointer      node_augment,
+                  gpointer      node,
+                  gpointer      left,
+                  gpointer      right)
+{
+  ListRow *row = node;
+  ListRowAugment *aug = node_augment;
+
+  aug->n_rows = row->n_rows;
+  aug->n_measured = row->measured ? 1 : 0;
+  aug->height = row->measured ? row->height : 0;
+
+  if (left)
+    {
+      ListRowAugment *left_aug = gtk_css_rb_tree_get_augment (tree, left);
+
+      aug->n_rows += left_aug->n_rows;
+      aug->n_measured += left_aug->n_measured;
+      aug->height += left_aug->height;
+    }
+
+  if (right)
+    {
+      ListRowAugment *right_aug = gtk_css_rb_tree_get_augment (tree, right);
+
+      aug->n_rows += right_aug->n_rows;
+      aug->n_measured += right_aug->n_measured;
+      aug->height += right_aug->height;
+    }
+}
+
+static int
+list_row_get_height (ListRow *row,
+                     int      estimate)
+{
+  if (row->measured)
+    return row->height;
+  else
+    return row->n_rows * estimate;
+}
+
+static int
+list_row_augment_get_height (ListRowAugment *aug,
+                             int             estimate)
+{
+  return aug->height + (aug->n_rows - aug->n_measured) * estimate;
+}
+
+/* The height of rows that weren't measured yet */
+static int
+gtk_list_view_estimate_row_height (GtkListView *self)
+{
+  ListRowAugment *aug;
+  ListRow *root;
+
+  root = gtk_css_rb_tree_get_root (self->rows);
+  if (root == NULL)
+    return 1;
+
+  aug = gtk_css_rb_tree_get_augment (self->rows, root);
+  if (aug->n_measured == 0)
+    return 1;
+
+  return MAX (1, aug->height / aug->n_measured);
+}
+
+static int
+gtk_list_view_get_total_height (GtkListView *self,
+                                int          estimate)
+{
+  ListRow *root;
+
+  if (self->rows == NULL)
+    return 0;
+
+  root = gtk_css_rb_tree_get_root (self->rows);
+  if (root == NULL)
+    return 0;
+
+  return list_row_augment_get_height (gtk_css_rb_tree_get_augment (self->rows, root), estimate);
+}
+
+static ListRow *
+gtk_list_view_get_nth (GtkListView *self,
+                       guint        position,
+                       guint       *offset)
+{
+  ListRow *row, *tmp;
+
+  row = gtk_css_rb_tree_get_root (self->rows);
+
+  while (row)
+    {
+      tmp = gtk_css_rb_tree_get_left (self->rows, row);
+      if (tmp)
+        {
+          ListRowAugment *aug = gtk_css_rb_tree_get_augment (self->rows, tmp);
+          if (position < aug->n_rows)
+            {
+              row = tmp;
+              continue;
+            }
+          position -= aug->n_rows;
+        }
+
+      if (position < row->n_rows)
+        break;
+      position -= row->n_rows;
+
+      row = gtk_css_rb_tree_get_right (self->rows, row);
+    }
+
+  if (offset)
+    *offset = row ? position : 0;
+
+  return row;
+}
+
+/* Gets the y coordinate of the top of the row at position */
+static int
+gtk_list_view_get_y (GtkListView *self,
+                     guint        position,
+                     int          estimate)
+{
+  ListRow *row, *tmp;
+  int y;
+
+  y = 0;
+  row = gtk_css_rb_tree_get_root (self->rows);
+
+  while (row)
+    {
+      tmp = gtk_css_rb_tree_get_left (self->rows, row);
+      if (tmp)
+        {
+          ListRowAugment *aug = gtk_css_rb_tree_get_augment (self->rows, tmp);
+          if (position < aug->n_rows)
+            {
+              row = tmp;
+              continue;
+            }
+          position -= aug->n_rows;
+          y += list_row_augment_get_height (aug, estimate);
+        }
+
+      if (position < row->n_rows)
+        return y + position * estimate;
+      position -= row->n_rows;
+      y += list_row_get_height (row, estimate);
+
+      row = gtk_css_rb_tree_get_right (self->rows, row);
+    }
+
+  return y;
+}
+
+/* Finds the row at *y and sets *y to the top of that row.
+ * If *y is below all rows, the number of rows is returned. */
+static guint
+gtk_list_view_get_position_at_y (GtkListView *self,
+                                 int          estimate,
+                                 int         *y)
+{
+  ListRow *row, *tmp;
+  guint position, skip;
+  int top, remaining, height;
+
+  position = 0;
+  top = 0;
+  remaining = MAX (*y, 0);
+  row = gtk_css_rb_tree_get_root (self->rows);
+
+  while (row)
+    {
+      tmp = gtk_css_rb_tree_get_left (self->rows, row);
+      if (tmp)
+        {
+          ListRowAugment *aug = gtk_css_rb_tree_get_augment (self->rows, tmp);
+          height = list_row_augment_get_height (aug, estimate);
+          if (remaining < height)
+            {
+              row = tmp;
+              continue;
+            }
+          remaining -= height;
+          top += height;
+          position += aug->n_rows;
+        }
+
+      height = list_row_get_height (row, estimate);
+      if (remaining < height)
+        {
+          if (!row->measured)
+            {
+              skip = remaining / estimate;
+              position += skip;
+              top += skip * estimate;
+            }
+          break;
+        }
+      remaining -= height;
+      top += height;
+      position += row->n_rows;
+
+      row = gtk_css_rb_tree_get_right (self->rows, row);
+    }
+
+  *y = top;
+
+  return position;
+}
+
+/* Gives the row at position its own node */
+static ListRow *
+gtk_list_view_split (GtkListView *self,
+                     guint        position)
+{
+  ListRow *row, *new_row;
+  guint offset;
+
+  row = gtk_list_view_get_nth (self, position, &offset);
+  g_assert (row != NULL);
+
+  if (offset > 0)
+    {
+      new_row = gtk_css_rb_tree_insert_before (self->rows, row);
+      new_row->n_rows = offset;
+      row->n_rows -= offset;
+      gtk_css_rb_tree_mark_dirty (self->rows, row);
+    }
+
+  if (row->n_rows > 1)
+    {
+      new_row = gtk_css_rb_tree_insert_after (self->rows, row);
+      new_row->n_rows = row->n_rows - 1;
+      row->n_rows = 1;
+      gtk_css_rb_tree_mark_dirty (self->rows, row);
+    }
+
+  return row;
+}
+
+static void
+gtk_list_view_release_row (GtkListView *self,
+                           ListRow     *row)
+{
+  if (row->widget == NULL)
+    return;
+
+  gtk_list_item_factory_release (self->factory, row->widget);
+  row->widget = NULL;
+}
+
+/* Releases the widgets of all rows from start to end */
+static void
+gtk_list_view_release_rows (GtkListView *self,
+                            guint        start,
+                            guint        end)
+{
+  ListRow *row;
+  guint offset, position;
+
+  start = MAX (start, self->range_start);
+  end = MIN (end, self->range_end);
+  if (start >= end)
+    return;
+
+  row = gtk_list_view_get_nth (self, start, &offset);
+  for (position = start - offset;
+       row != NULL && position < end;
+       row = gtk_css_rb_tree_get_next (self->rows, row))
+    {
+      gtk_list_view_release_row (self, row);
+      position += row->n_rows;
+    }
+}
+
+static void
+gtk_list_view_measure_row (GtkListView *self,
+                           ListRow     *row,
+                           int          width)
+{
+  int height;
+
+  gtk_widget_measure (row->widget,
+                      GTK_ORIENTATION_VERTICAL, width,
+                      NULL, &height,
+                      NULL, NULL);
+
+  if (!row->measured || row->height != height)
+    {
+      row->height = height;
+      row->measured = TRUE;
+      gtk_css_rb_tree_mark_dirty (self->rows, row);
+    }
+}
+
+static void
+gtk_list_view_forget_heights (GtkListView *self)
+{
+  ListRow *row;
+
+  for (row = gtk_css_rb_tree_get_first (self->rows);
+       row != NULL;
+       row = gtk_css_rb_tree_get_next (self->rows, row))
+    {
+      if (row->measured)
+        {
+          row->measured = FALSE;
+          gtk_css_rb_tree_mark_dirty (self->rows, row);
+        }
+    }
+}
+
+/* Makes sure the rows that are visible at the current scroll position
+ * and some more around them have widgets, and measures them. Returns
+ * the scroll position to use, which keeps the first visible row in
+ * place when rows turn out to have a different height than estimated.
+ */
+static int
+gtk_list_view_update_rows (GtkListView *self,
+                           int          value,
+                           int          width,
+                           int          height)
+{
+  ListRow *row;
+  gpointer item;
+  guint n_items, position, start, end, pos;
+  int estimate, top, offset, bottom;
+  gboolean filled;
+
+  if (self->rows == NULL || self->factory == NULL)
+    return value;
+
+  n_items = g_list_model_get_n_items (self->model);
+
+  estimate = gtk_list_view_estimate_row_height (self);
+  top = value;
+  position = gtk_list_view_get_position_at_y (self, estimate, &top);
+  offset = MAX (value - top, 0);
+
+  if (width != self->measured_width)
+    {
+      gtk_list_view_forget_heights (self);
+      self->measured_width = width;
+    }
+  start = position > GTK_LIST_VIEW_EXTRA_ROWS ? position - GTK_LIST_VIEW_EXTRA_ROWS : 0;
+
+  /* Free widgets first, so they can be reused. The new range is
+   * probably about as large as the old one. */
+  gtk_list_view_release_rows (self, 0, start);
+  gtk_list_view_release_rows (self, start + self->range_end - self->range_start, G_MAXUINT);
+
+  end = n_items;
+  filled = FALSE;
+  bottom = 0;
+  for (pos = start; pos < end; pos++)
+    {
+      row = gtk_list_view_split (self, pos);
+      if (row->widget == NULL)
+        {
+          item = g_list_model_get_item (self->model, pos);
+          row->widget = gtk_list_item_factory_acquire (self->factory, GTK_WIDGET (self), item);
+          g_object_unref (item);
+        }
+      gtk_list_view_measure_row (self, row, width);
+
+      if (pos >= position && !filled)
+        {
+          bottom += row->height;
+          /* Rows without height must not make us create all widgets */
+          if (bottom >= offset + height || (int) (pos - position) >= height)
+            {
+              end = MIN (end, pos + 1 + GTK_LIST_VIEW_EXTRA_ROWS);
+              filled = TRUE;
+            }
+        }
+    }
+
+  gtk_list_view_release_rows (self, end, G_MAXUINT);
+  self->range_start = start;
+  self->range_end = end;
+  gtk_list_item_factory_trim (self->factory, end - start);
+
+  if (position >= n_items)
+    return value;
+
+  estimate = gtk_list_view_estimate_row_height (self);
+
+  return gtk_list_view_get_y (self, position, estimate) + offset;
+}
+
+static void
+gtk_list_view_size_allocate (GtkWidget *widget,
+                             int        width,
+                             int        height,
+                             int        baseline)
+{
+  GtkListView *self = GTK_LIST_VIEW (widget);
+  GtkAllocation child_allocation;
+  ListRow *row;
+  int value, estimate, total, y;
+  guint pos;
+
+  value = gtk_adjustment_get_value (self->adjustment[GTK_ORIENTATION_VERTICAL]);
+  value = gtk_list_view_update_rows (self, value, width, height);
+  estimate = self->rows ? gtk_list_view_estimate_row_height (self) : 1;
+  total = gtk_list_view_get_total_height (self, estimate);
+
+  /* The rows may be smaller than estimated, so that we scrolled
+   * past the end. */
+  if (value > MAX (total - height, 0))
+    {
+      value = gtk_list_view_update_rows (self, MAX (total - height, 0), width, height);
+      estimate = self->rows ? gtk_list_view_estimate_row_height (self) : 1;
+      total = gtk_list_view_get_total_height (self, estimate);
+    }
+
+  g_object_freeze_notify (G_OBJECT (self->adjustment[GTK_ORIENTATION_HORIZONTAL]));
+  g_object_freeze_notify (G_OBJECT (self->adjustment[GTK_ORIENTATION_VERTICAL]));
+
+  gtk_adjustment_configure (self->adjustment[GTK_ORIENTATION_HORIZONTAL],
+                            0,
+                            0,
+                            width,
+                            width * 0.1,
+                            width * 0.9,
+                            width);
+  gtk_adjustment_configure (self->adjustment[GTK_ORIENTATION_VERTICAL],
+                            value,
+                            0,
+                            MAX (total, height),
+                            height * 0.1,
+                            height * 0.9,
+                            height);
+
+  g_object_thaw_notify (G_OBJECT (self->adjustment[GTK_ORIENTATION_HORIZONTAL]));
+  g_object_thaw_notify (G_OBJECT (self->adjustment[GTK_ORIENTATION_VERTICAL]));
+
+  if (self->range_start >= self->range_end)
+    return;
+
+  /* configuring may have clamped the value */
+  value = gtk_adjustment_get_value (self->adjustment[GTK_ORIENTATION_VERTICAL]);
+  y = gtk_list_view_get_y (self, self->range_start, estimate) - value;
+
+  row = gtk_list_view_get_nth (self, self->range_start, NULL);
+  for (pos = self->range_start; pos < self->range_end; pos++)
+    {
+      child_allocation.x = 0;
+      child_allocation.y = y;
+      child_allocation.width = width;
+      child_allocation.height = row->height;
+      gtk_widget_size_allocate (row->widget, &child_allocation, -1);
+
+      y += row->height;
+      row = gtk_css_rb_tree_get_next (self->rows, row);
+    }
+}
+
+static void
+gtk_list_view_measure (GtkWidget      *widget,
+                       GtkOrientation  orientation,
+                       int             for_size,
+                       int            *minimum,
+                       int            *natural,
+                       int            *minimum_baseline,
+                       int            *natural_baseline)
+{
+  GtkListView *self = GTK_LIST_VIEW (widget);
+  GtkWidget *child;
+  int child_min, child_nat;
+
+  *minimum = 0;
+  *natural = 0;
+
+  if (orientation == GTK_ORIENTATION_VERTICAL)
+    {
+      if (self->rows)
+        *natural = gtk_list_view_get_total_height (self, gtk_list_view_estimate_row_height (self));
+      return;
+    }
+
+  /* Only the rows with widgets are known */
+  for (child = gtk_widget_get_first_child (widget);
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      if (!gtk_widget_get_child_visible (child))
+        continue;
+
+      gtk_widget_measure (child, orientation, -1, &child_min, &child_nat, NULL, NULL);
+      *minimum = MAX (*minimum, child_min);
+      *natural = MAX (*natural, child_nat);
+    }
+}
+
+static void
+gtk_list_view_snapshot (GtkWidget   *widget,
+                        GtkSnapshot *snapshot)
+{
+  gtk_snapshot_push_clip (snapshot,
+                          &GRAPHENE_RECT_INIT(
+                            0, 0,
+                            gtk_widget_get_width (widget),
+                            gtk_widget_get_height (widget)));
+
+  GTK_WIDGET_CLASS (gtk_list_view_parent_class)->snapshot (widget, snapshot);
+
+  gtk_snapshot_pop (snapshot);
+}
+
+static void
+gtk_list_view_adjustment_value_changed_cb (GtkAdjustment *adjustment,
+                                           GtkListView   *self)
+{
+  gtk_widget_queue_allocate (GTK_WIDGET (self));
+}
+
+static void
+gtk_list_view_clear_adjustment (GtkListView    *self,
+                                GtkOrientation  orientation)
+{
+  if (self->adjustment[orientation] == NULL)
+    return;
+
+  g_signal_handlers_disconnect_by_func (self->adjustment[orientation],
+                                        gtk_list_view_adjustment_value_changed_cb,
+                                        self);
+  g_clear_object (&self->adjustment[orientation]);
+}
+
+static void
+gtk_list_view_set_adjustment (GtkListView    *self,
+                              GtkOrientation  orientation,
+                              GtkAdjustment  *adjustment)
+{
+  if (adjustment != NULL && self->adjustment[orientation] == adjustment)
+    return;
+
+  if (adjustment == NULL)
+    adjustment = gtk_adjustment_new (0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+  g_object_ref_sink (adjustment);
+
+  gtk_list_view_clear_adjustment (self, orientation);
+
+  self->adjustment[orientation] = adjustment;
+  g_signal_connect (adjustment, "value-changed",
+                    G_CALLBACK (gtk_list_view_adjustment_value_changed_cb),
+                    self);
+
+  gtk_widget_queue_allocate (GTK_WIDGET (self));
+}
+
+static void
+gtk_list_view_model_items_changed_cb (GListModel  *model,
+                                      guint        position,
+                                      guint        removed,
+                                      guint        added,
+                                      GtkListView *self)
+{
+  ListRow *row, *next;
+  guint offset, n;
+
+  row = gtk_list_view_get_nth (self, position, &offset);
+  if (row && offset > 0)
+    {
+      next = gtk_css_rb_tree_insert_before (self->rows, row);
+      next->n_rows = offset;
+      row->n_rows -= offset;
+      gtk_css_rb_tree_mark_dirty (self->rows, row);
+    }
+
+  for (n = removed; n > 0; )
+    {
+      if (row->n_rows > n)
+        {
+          row->n_rows -= n;
+          gtk_css_rb_tree_mark_dirty (self->rows, row);
+          break;
+        }
+
+      n -= row->n_rows;
+      next = gtk_css_rb_tree_get_next (self->rows, row);
+      gtk_list_view_release_row (self, row);
+      gtk_css_rb_tree_remove (self->rows, row);
+      row = next;
+    }
+
+  if (added > 0)
+    {
+      row = gtk_css_rb_tree_insert_before (self->rows, row);
+      row->n_rows = added;
+    }
+
+  /* Keep the range covering all rows with widgets */
+  if (self->range_end <= position)
+    {
+      /* nothing to do */
+    }
+  else if (position + removed <= self->range_start)
+    {
+      self->range_start = self->range_start + added - removed;
+      self->range_end = self->range_end + added - removed;
+    }
+  else
+    {
+      self->range_start = MIN (self->range_start, position);
+      self->range_end = MAX (self->range_end, position + removed) + added - removed;
+    }
+
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+}
+
+static void
+gtk_list_view_clear_model (GtkListView *self)
+{
+  if (self->model == NULL)
+    return;
+
+  if (self->factory)
+    gtk_list_view_release_rows (self, 0, G_MAXUINT);
+  self->range_start = 0;
+  self->range_end = 0;
+  g_clear_pointer (&self->rows, gtk_css_rb_tree_unref);
+
+  g_signal_handlers_disconnect_by_func (self->model,
+                                        gtk_list_view_model_items_changed_cb,
+                                        self);
+  g_clear_object (&self->model);
+}
+
+static void
+gtk_list_view_dispose (GObject *object)
+{
+  GtkListView *self = GTK_LIST_VIEW (object);
+
+  gtk_list_view_clear_model (self);
+  g_clear_pointer (&self->factory, gtk_list_item_factory_free);
+
+  gtk_list_view_clear_adjustment (self, GTK_ORIENTATION_HORIZONTAL);
+  gtk_list_view_clear_adjustment (self, GTK_ORIENTATION_VERTICAL);
+
+  G_OBJECT_CLASS (gtk_list_view_parent_class)->dispose (object);
+}
+
+static void
+gtk_list_view_get_property (GObject    *object,
+                            guint       property_id,
+                            GValue     *value,
+                            GParamSpec *pspec)
+{
+  GtkListView *self = GTK_LIST_VIEW (object);
+
+  switch (property_id)
+    {
+    case PROP_HADJUSTMENT:
+      g_value_set_object (value, self->adjustment[GTK_ORIENTATION_HORIZONTAL]);
+      break;
+
+    case PROP_HSCROLL_POLICY:
+      g_value_set_enum (value, self->scroll_policy[GTK_ORIENTATION_HORIZONTAL]);
+      break;
+
+    case PROP_MODEL:
+      g_value_set_object (value, self->model);
+      break;
+
+    case PROP_VADJUSTMENT:
+      g_value_set_object (value, self->adjustment[GTK_ORIENTATION_VERTICAL]);
+      break;
+
+    case PROP_VSCROLL_POLICY:
+      g_value_set_enum (value, self->scroll_policy[GTK_ORIENTATION_VERTICAL]);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gtk_list_view_set_scroll_policy (GtkListView         *self,
+                                 GtkOrientation       orientation,
+                                 GtkScrollablePolicy  scroll_policy,
+                                 GParamSpec          *pspec)
+{
+  if (self->scroll_policy[orientation] == scroll_policy)
+    return;
+
+  self->scroll_policy[orientation] = scroll_policy;
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+  g_object_notify_by_pspec (G_OBJECT (self), pspec);
+}
+
+static void
+gtk_list_view_set_property (GObject      *object,
+                            guint         property_id,
+                            const GValue *value,
+                            GParamSpec   *pspec)
+{
+  GtkListView *self = GTK_LIST_VIEW (object);
+
+  switch (property_id)
+    {
+    case PROP_HADJUSTMENT:
+      gtk_list_view_set_adjustment (self, GTK_ORIENTATION_HORIZONTAL, g_value_get_object (value));
+      break;
+
+    case PROP_HSCROLL_POLICY:
+      gtk_list_view_set_scroll_policy (self, GTK_ORIENTATION_HORIZONTAL, g_value_get_enum (value), pspec);
+      break;
+
+    case PROP_MODEL:
+      gtk_list_view_set_model (self, g_value_get_object (value));
+      break;
+
+    case PROP_VADJUSTMENT:
+      gtk_list_view_set_adjustment (self, GTK_ORIENTATION_VERTICAL, g_value_get_object (value));
+      break;
+
+    case PROP_VSCROLL_POLICY:
+      gtk_list_view_set_scroll_policy (self, GTK_ORIENTATION_VERTICAL, g_value_get_enum (value), pspec);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gtk_list_view_class_init (GtkListViewClass *klass)
+{
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  widget_class->measure = gtk_list_view_measure;
+  widget_class->size_allocate = gtk_list_view_size_allocate;
+  widget_class->snapshot = gtk_list_view_snapshot;
+
+  gobject_class->dispose = gtk_list_view_dispose;
+  gobject_class->get_property = gtk_list_view_get_property;
+  gobject_class->set_property = gtk_list_view_set_property;
+
+  g_object_class_override_property (gobject_class, PROP_HADJUSTMENT, "hadjustment");
+  g_object_class_override_property (gobject_class, PROP_HSCROLL_POLICY, "hscroll-policy");
+  g_object_class_override_property (gobject_class, PROP_VADJUSTMENT, "vadjustment");
+  g_object_class_override_property (gobject_class, PROP_VSCROLL_POLICY, "vscroll-policy");
+
+  /**
+   * GtkListView:model:
+   *
+   * Model for the items displayed
+   */
+  properties[PROP_MODEL] =
+      g_param_spec_object ("model",
+                           P_("Model"),
+                           P_("Model for the items displayed"),
+                           G_TYPE_LIST_MODEL,
+                           GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+  g_object_class_install_property (gobject_class, PROP_MODEL, properties[PROP_MODEL]);
+
+  gtk_widget_class_set_css_name (widget_class, I_("listview"));
+}
+
+static void
+gtk_list_view_init (GtkListView *self)
+{
+  gtk_widget_set_has_surface (GTK_WIDGET (self), FALSE);
+
+  self->measured_width = -1;
+
+  gtk_list_view_set_adjustment (self, GTK_ORIENTATION_HORIZONTAL, NULL);
+  gtk_list_view_set_adjustment (self, GTK_ORIENTATION_VERTICAL, NULL);
+}
+
+/**
+ * gtk_list_view_new:
+ *
+ * Creates a new empty #GtkListView.
+ *
+ * You most likely want to call gtk_list_view_set_functions() and
+ * gtk_list_view_set_model() next.
+ *
+ * Returns: a new #GtkListView
+ **/
+GtkWidget *
+gtk_list_view_new (void)
+{
+  return g_object_new (GTK_TYPE_LIST_VIEW, NULL);
+}
+
+/**
+ * gtk_list_view_get_model:
+ * @self: a #GtkListView
+ *
+ * Gets the model that's currently used to read the items displayed.
+ *
+ * Returns: (nullable) (transfer none): The model in use
+ **/
+GListModel *
+gtk_list_view_get_model (GtkListView *self)
+{
+  g_return_val_if_fail (GTK_IS_LIST_VIEW (self), NULL);
+
+  return self->model;
+}
+
+/**
+ * gtk_list_view_set_model:
+ * @self: a #GtkListView
+ * @model: (allow-none) (transfer none): the model to use or %NULL for none
+ *
+ * Sets the #GListModel to use.
+ **/
+void
+gtk_list_view_set_model (GtkListView *self,
+                         GListModel  *model)
+{
+  guint n_items;
+
+  g_return_if_fail (GTK_IS_LIST_VIEW (self));
+  g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
+
+  if (self->model == model)
+    return;
+
+  gtk_list_view_clear_model (self);
+
+  if (model)
+    {
+      self->model = g_object_ref (model);
+      g_signal_connect (model,
+                        "items-changed",
+                        G_CALLBACK (gtk_list_view_model_items_changed_cb),
+                        self);
+
+      self->rows = gtk_css_rb_tree_new (ListRow,
+                                        ListRowAugment,
+                                        list_row_augment,
+                                        NULL, NULL);
+      n_items = g_list_model_get_n_items (model);
+      if (n_items > 0)
+        {
+          ListRow *row = gtk_css_rb_tree_insert_before (self->rows, NULL);
+          row->n_rows = n_items;
+        }
+    }
+
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MODEL]);
+}
+
+/**
+ * gtk_list_view_set_functions:
+ * @self: a #GtkListView
+ * @setup_func: function to create widgets for items
+ * @bind_func: function to make a widget display an item
+ * @user_data: user data to pass to the functions
+ * @user_destroy: destroy notifier for @user_data
+ *
+ * Sets the functions to create the widgets that display the items of
+ * the model. @self only creates widgets for about as many items as
+ * are visible and reuses them while scrolling, by calling @bind_func
+ * with a different item.
+ *
+ * All existing widgets are destroyed and new ones are created using
+ * the new functions.
+ **/
+void
+gtk_list_view_set_functions (GtkListView          *self,
+                             GtkListItemSetupFunc  setup_func,
+                             GtkListItemBindFunc   bind_func,
+                             gpointer              user_data,
+                             GDestroyNotify        user_destroy)
+{
+  g_return_if_fail (GTK_IS_LIST_VIEW (self));
+  g_return_if_fail (setup_func != NULL);
+  g_return_if_fail (bind_func != NULL);
+
+  if (self->factory)
+    {
+      if (self->rows)
+        gtk_list_view_release_rows (self, 0, G_MAXUINT);
+      self->range_start = 0;
+      self->range_end = 0;
+      gtk_list_item_factory_free (self->factory);
+    }
+
+  self->factory = gtk_list_item_factory_new (setup_func, bind_func, user_data, user_destroy);
+
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+}
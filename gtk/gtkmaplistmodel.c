@@ -19,7 +19,7 @@
 
 #include "config.h"
 
-#include "gtkmaplistmodel.h"
+#include "gtkmaplistmodelprivate.h"
 
 #include "gtkcssrbtreeprivate.h"
 #include "gtkintl.h"
@@ -39,10 +39,17 @@
  *
  * #GtkMapListModel will attempt to discard the mapped objects as soon as they are no
  * longer needed and recreate them if necessary.
+ *
+ * If mapping is expensive and the same items are requested repeatedly, for
+ * example by a view that rebinds its widgets while scrolling, a cache can be
+ * enabled with gtk_map_list_model_set_cache_size(). The model then keeps the
+ * most recently requested mapped items alive, up to the given number, and
+ * drops the least recently used ones first.
  */
 
 enum {
   PROP_0,
+  PROP_CACHE_SIZE,
   PROP_HAS_MAP,
   PROP_ITEM_TYPE,
   PROP_MODEL,
@@ -56,6 +63,7 @@ struct _MapNode
 {
   guint n_items;
   gpointer item; /* can only be set when n_items == 1 */
+  GList cache_link; /* data is set if item is in the cache */
 };
 
 struct _MapAugment
@@ -74,6 +82,13 @@ struct _GtkMapListModel
   GDestroyNotify user_destroy;
 
   GtkCssRbTree *items; /* NULL if map_func == NULL */
+
+  guint cache_size;
+  GQueue cache; /* of MapNode with a reference to their item, most recently used first */
+
+  /* statistics */
+  guint n_hits;
+  guint n_misses;
 };
 
 struct _GtkMapListModelClass
@@ -123,6 +138,92 @@ gtk_map_list_model_get_nth (GtkCssRbTree *tree,
   return node;
 }
 
+/* Merges a node that has no item with its neighbours that have none,
+ * so items that were freed don't leave a node each behind.
+ * Adjusts @start_pos to the start of the merged node if given. */
+static MapNode *
+gtk_map_list_model_merge_unmapped (GtkMapListModel *self,
+                                   MapNode         *node,
+                                   guint           *start_pos)
+{
+  MapNode *tmp;
+
+  tmp = gtk_css_rb_tree_get_previous (self->items, node);
+  if (tmp && tmp->item == NULL)
+    {
+      node->n_items += tmp->n_items;
+      if (start_pos)
+        *start_pos -= tmp->n_items;
+      gtk_css_rb_tree_remove (self->items, tmp);
+      gtk_css_rb_tree_mark_dirty (self->items, node);
+    }
+
+  tmp = gtk_css_rb_tree_get_next (self->items, node);
+  if (tmp && tmp->item == NULL)
+    {
+      node->n_items += tmp->n_items;
+      gtk_css_rb_tree_remove (self->items, tmp);
+      gtk_css_rb_tree_mark_dirty (self->items, node);
+    }
+
+  return node;
+}
+
+static void
+gtk_map_list_model_uncache_node (GtkMapListModel *self,
+                                 MapNode         *node)
+{
+  if (node->cache_link.data == NULL)
+    return;
+
+  g_queue_unlink (&self->cache, &node->cache_link);
+  node->cache_link.data = NULL;
+  /* If this was the last reference, the weak pointer clears node->item */
+  g_object_unref (node->item);
+}
+
+static void
+gtk_map_list_model_trim_cache (GtkMapListModel *self)
+{
+  MapNode *node;
+
+  while (self->cache.length > self->cache_size)
+    {
+      node = self->cache.tail->data;
+      gtk_map_list_model_uncache_node (self, node);
+      if (node->item == NULL)
+        gtk_map_list_model_merge_unmapped (self, node, NULL);
+    }
+}
+
+static void
+gtk_map_list_model_clear_cache (GtkMapListModel *self)
+{
+  while (self->cache.head)
+    gtk_map_list_model_uncache_node (self, self->cache.head->data);
+}
+
+static void
+gtk_map_list_model_cache_node (GtkMapListModel *self,
+                               MapNode         *node)
+{
+  if (self->cache_size == 0)
+    return;
+
+  if (node->cache_link.data)
+    {
+      g_queue_unlink (&self->cache, &node->cache_link);
+    }
+  else
+    {
+      node->cache_link.data = node;
+      g_object_ref (node->item);
+    }
+
+  g_queue_push_head_link (&self->cache, &node->cache_link);
+  gtk_map_list_model_trim_cache (self);
+}
+
 static GType
 gtk_map_list_model_get_item_type (GListModel *list)
 {
@@ -161,7 +262,13 @@ gtk_map_list_model_get_item (GListModel *list,
     return NULL;
 
   if (node->item)
-    return g_object_ref (node->item);
+    {
+      self->n_hits++;
+      gtk_map_list_model_cache_node (self, node);
+      return g_object_ref (node->item);
+    }
+
+  node = gtk_map_list_model_merge_unmapped (self, node, &offset);
 
   if (offset != position)
     {
@@ -186,6 +293,8 @@ gtk_map_list_model_get_item (GListModel *list,
                   G_OBJECT_TYPE_NAME (node->item), g_type_name (self->item_type));
     }
   g_object_add_weak_pointer (node->item, &node->item);
+  self->n_misses++;
+  gtk_map_list_model_cache_node (self, node);
 
   return node->item;
 }
@@ -209,7 +318,7 @@ gtk_map_list_model_items_changed_cb (GListModel      *model,
                                      GtkMapListModel *self)
 {
   MapNode *node;
-  guint start, end;
+  guint start, end, n;
 
   if (self->items == NULL)
     {
@@ -220,22 +329,23 @@ gtk_map_list_model_items_changed_cb (GListModel      *model,
   node = gtk_map_list_model_get_nth (self->items, position, &start);
   g_assert (start <= position);
 
-  while (removed > 0)
+  for (n = removed; n > 0; )
     {
       end = start + node->n_items;
-      if (start == position && end <= position + removed)
+      if (start == position && end <= position + n)
         {
           MapNode *next = gtk_css_rb_tree_get_next (self->items, node);
-          removed -= node->n_items;
+          n -= node->n_items;
+          gtk_map_list_model_uncache_node (self, node);
           gtk_css_rb_tree_remove (self->items, node);
           node = next;
         }
       else
         {
-          if (end >= position + removed)
+          if (end >= position + n)
             {
-              node->n_items -= removed;
-              removed = 0;
+              node->n_items -= n;
+              n = 0;
               gtk_css_rb_tree_mark_dirty (self->items, node);
             }
           else if (start < position)
@@ -243,7 +353,7 @@ gtk_map_list_model_items_changed_cb (GListModel      *model,
               guint overlap = node->n_items - (position - start);
               node->n_items -= overlap;
               gtk_css_rb_tree_mark_dirty (self->items, node);
-              removed -= overlap;
+              n -= overlap;
               start = position;
               node = gtk_css_rb_tree_get_next (self->items, node);
             }
@@ -255,7 +365,7 @@ gtk_map_list_model_items_changed_cb (GListModel      *model,
       if (node == NULL)
         node = gtk_css_rb_tree_insert_before (self->items, NULL);
       else if (node->item)
-        node = gtk_css_rb_tree_insert_after (self->items, node);
+        node = gtk_css_rb_tree_insert_before (self->items, node);
 
       node->n_items += added;
       gtk_css_rb_tree_mark_dirty (self->items, node);
@@ -274,6 +384,10 @@ gtk_map_list_model_set_property (GObject      *object,
 
   switch (prop_id)
     {
+    case PROP_CACHE_SIZE:
+      gtk_map_list_model_set_cache_size (self, g_value_get_uint (value));
+      break;
+
     case PROP_ITEM_TYPE:
       self->item_type = g_value_get_gtype (value);
       break;
@@ -298,6 +412,10 @@ gtk_map_list_model_get_property (GObject     *object,
 
   switch (prop_id)
     {
+    case PROP_CACHE_SIZE:
+      g_value_set_uint (value, self->cache_size);
+      break;
+
     case PROP_HAS_MAP:
       g_value_set_boolean (value, self->items != NULL);
       break;
@@ -337,6 +455,7 @@ gtk_map_list_model_dispose (GObject *object)
   self->map_func = NULL;
   self->user_data = NULL;
   self->user_destroy = NULL;
+  gtk_map_list_model_clear_cache (self);
   g_clear_pointer (&self->items, gtk_css_rb_tree_unref);
 
   G_OBJECT_CLASS (gtk_map_list_model_parent_class)->dispose (object);
@@ -351,6 +470,18 @@ gtk_map_list_model_class_init (GtkMapListModelClass *class)
   gobject_class->get_property = gtk_map_list_model_get_property;
   gobject_class->dispose = gtk_map_list_model_dispose;
 
+  /**
+   * GtkMapListModel:cache-size:
+   *
+   * The number of recently used mapped items to keep alive
+   */
+  properties[PROP_CACHE_SIZE] =
+      g_param_spec_uint ("cache-size",
+                         P_("Cache size"),
+                         P_("The number of recently used mapped items to keep alive"),
+                         0, G_MAXUINT, 0,
+                         GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * GtkMapListModel:has-map:
    *
@@ -467,6 +598,8 @@ gtk_map_list_model_clear_node (gpointer _node)
 static void
 gtk_map_list_model_init_items (GtkMapListModel *self)
 {
+  gtk_map_list_model_clear_cache (self);
+
   if (self->map_func && self->model)
     {
       guint n_items;
@@ -630,3 +763,91 @@ gtk_map_list_model_has_map (GtkMapListModel *self)
 
   return self->map_func != NULL;
 }
+
+/**
+ * gtk_map_list_model_set_cache_size:
+ * @self: a #GtkMapListModel
+ * @cache_size: the number of mapped items to keep alive
+ *
+ * Sets the number of mapped items that @self keeps alive after they
+ * were requested, so that requesting them again does not need to call
+ * the map function. When more items are requested, the least recently
+ * used ones are dropped from the cache first.
+ *
+ * Items that are still referenced elsewhere stay alive and are reused
+ * regardless of the cache. The default is 0, so items are only kept
+ * while they are in use.
+ **/
+void
+gtk_map_list_model_set_cache_size (GtkMapListModel *self,
+                                   guint            cache_size)
+{
+  g_return_if_fail (GTK_IS_MAP_LIST_MODEL (self));
+
+  if (self->cache_size == cache_size)
+    return;
+
+  self->cache_size = cache_size;
+  gtk_map_list_model_trim_cache (self);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_CACHE_SIZE]);
+}
+
+/**
+ * gtk_map_list_model_get_cache_size:
+ * @self: a #GtkMapListModel
+ *
+ * Gets the cache size set with gtk_map_list_model_set_cache_size().
+ *
+ * Returns: the number of mapped items kept alive
+ **/
+guint
+gtk_map_list_model_get_cache_size (GtkMapListModel *self)
+{
+  g_return_val_if_fail (GTK_IS_MAP_LIST_MODEL (self), 0);
+
+  return self->cache_size;
+}
+
+/*
+ * gtk_map_list_model_get_stats:
+ * @self: a #GtkMapListModel
+ * @n_hits: (out) (optional): number of requests that did not need mapping
+ * @n_misses: (out) (optional): number of calls to the map function
+ * @n_cached: (out) (optional): number of items in the cache
+ * @n_nodes: (out) (optional): number of nodes in the internal tree
+ *
+ * Gets statistics about the cache for debugging and benchmarks. The
+ * number of nodes is a measure of the memory used, it is counted by
+ * walking all nodes.
+ */
+void
+gtk_map_list_model_get_stats (GtkMapListModel *self,
+                              guint           *n_hits,
+                              guint           *n_misses,
+                              guint           *n_cached,
+                              guint           *n_nodes)
+{
+  MapNode *node;
+
+  g_return_if_fail (GTK_IS_MAP_LIST_MODEL (self));
+
+  if (n_hits)
+    *n_hits = self->n_hits;
+  if (n_misses)
+    *n_misses = self->n_misses;
+  if (n_cached)
+    *n_cached = self->cache.length;
+
+  if (n_nodes)
+    {
+      *n_nodes = 0;
+      if (self->items)
+        {
+          for (node = gtk_css_rb_tree_get_first (self->items);
+               node != NULL;
+               node = gtk_css_rb_tree_get_next (self->items, node))
+            (*n_nodes)++;
+        }
+    }
+}
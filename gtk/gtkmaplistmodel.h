@@ -71,6 +71,11 @@ GDK_AVAILABLE_IN_ALL
 GListModel *            gtk_map_list_model_get_model            (GtkMapListModel        *self);
 GDK_AVAILABLE_IN_ALL
 gboolean                gtk_map_list_model_has_map              (GtkMapListModel        *self);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_map_list_model_set_cache_size       (GtkMapListModel        *self,
+                                                                 guint                   cache_size);
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_map_list_model_get_cache_size       (GtkMapListModel        *self);
 
 G_END_DECLS
 
@@ -0,0 +1,586 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#include "config.h"
+
+#include "gtkselectionmodel.h"
+
+#include "gtkintl.h"
+#include "gtkmarshalers.h"
+#include "gtkprivate.h"
+#include "gtksetprivate.h"
+
+/**
+ * SECTION:gtkselectionmodel
+ * @title: GtkSelectionModel
+ * @short_description: A list model that tracks selected items
+ * @see_also: #GListModel
+ *
+ * #GtkSelectionModel is a list model that passes through the items of
+ * another model and keeps track of which of them are selected.
+ *
+ * The selection is stored as ranges of selected items, so selecting or
+ * unselecting any range of items, including selecting all items of a
+ * huge model, takes time logarithmic in the number of ranges and does
+ * not depend on the number of items.
+ *
+ * Whenever the selection changes, #GtkSelectionModel::selection-changed
+ * is emitted with the smallest range of items that contains all changed
+ * items. When items are added to or removed from the model, selected
+ * items keep their selection and removed items are dropped from it
+ * without emitting the signal.
+ */
+
+enum {
+  PROP_0,
+  PROP_ITEM_TYPE,
+  PROP_MODEL,
+  NUM_PROPERTIES
+};
+
+enum {
+  SELECTION_CHANGED,
+  LAST_SIGNAL
+};
+
+struct _GtkSelectionModel
+{
+  GObject parent_instance;
+
+  GType item_type;
+  GListModel *model;
+
+  GtkSet *selected;
+};
+
+struct _GtkSelectionModelClass
+{
+  GObjectClass parent_class;
+};
+
+static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
+static guint signals[LAST_SIGNAL] = { 0 };
+
+static GType
+gtk_selection_model_get_item_type (GListModel *list)
+{
+  GtkSelectionModel *self = GTK_SELECTION_MODEL (list);
+
+  return self->item_type;
+}
+
+static guint
+gtk_selection_model_get_n_items (GListModel *list)
+{
+  GtkSelectionModel *self = GTK_SELECTION_MODEL (list);
+
+  if (self->model == NULL)
+    return 0;
+
+  return g_list_model_get_n_items (self->model);
+}
+
+static gpointer
+gtk_selection_model_get_item (GListModel *list,
+                              guint       position)
+{
+  GtkSelectionModel *self = GTK_SELECTION_MODEL (list);
+
+  if (self->model == NULL)
+    return NULL;
+
+  return g_list_model_get_item (self->model, position);
+}
+
+static void
+gtk_selection_model_model_init (GListModelInterface *iface)
+{
+  iface->get_item_type = gtk_selection_model_get_item_type;
+  iface->get_n_items = gtk_selection_model_get_n_items;
+  iface->get_item = gtk_selection_model_get_item;
+}
+
+G_DEFINE_TYPE_WITH_CODE (GtkSelectionModel, gtk_selection_model, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_selection_model_model_init))
+
+/* Grows the range from start to end to include the changed items */
+static void
+gtk_selection_model_add_change (guint *start,
+                                guint *end,
+                                guint  changed_start,
+                                guint  changed_n_items)
+{
+  if (changed_n_items == 0)
+    return;
+
+  *start = MIN (*start, changed_start);
+  *end = MAX (*end, changed_start + changed_n_items);
+}
+
+static void
+gtk_selection_model_emit_changed (GtkSelectionModel *self,
+                                  guint              start,
+                                  guint              end)
+{
+  if (start >= end)
+    return;
+
+  g_signal_emit (self, signals[SELECTION_CHANGED], 0, start, end - start);
+}
+
+static void
+gtk_selection_model_items_changed_cb (GListModel        *model,
+                                      guint              position,
+                                      guint              removed,
+                                      guint              added,
+                                      GtkSelectionModel *self)
+{
+  gtk_set_splice (self->selected, position, removed, added);
+
+  g_list_model_items_changed (G_LIST_MODEL (self), position, removed, added);
+}
+
+static void
+gtk_selection_model_set_property (GObject      *object,
+                                  guint         prop_id,
+                                  const GValue *value,
+                                  GParamSpec   *pspec)
+{
+  GtkSelectionModel *self = GTK_SELECTION_MODEL (object);
+
+  switch (prop_id)
+    {
+    case PROP_ITEM_TYPE:
+      self->item_type = g_value_get_gtype (value);
+      break;
+
+    case PROP_MODEL:
+      gtk_selection_model_set_model (self, g_value_get_object (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void 
+gtk_selection_model_get_property (GObject     *object,
+                                  guint        prop_id,
+                                  GValue      *value,
+                                  GParamSpec  *pspec)
+{
+  GtkSelectionModel *self = GTK_SELECTION_MODEL (object);
+
+  switch (prop_id)
+    {
+    case PROP_ITEM_TYPE:
+      g_value_set_gtype (value, self->item_type);
+      break;
+
+    case PROP_MODEL:
+      g_value_set_object (value, self->model);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gtk_selection_model_clear_model (GtkSelectionModel *self)
+{
+  if (self->model == NULL)
+    return;
+
+  g_signal_handlers_disconnect_by_func (self->model, gtk_selection_model_items_changed_cb, self);
+  g_clear_object (&self->model);
+  gtk_set_remove_all (self->selected);
+}
+
+static void
+gtk_selection_model_dispose (GObject *object)
+{
+  GtkSelectionModel *self = GTK_SELECTION_MODEL (object);
+
+  gtk_selection_model_clear_model (self);
+
+  G_OBJECT_CLASS (gtk_selection_model_parent_class)->dispose (object);
+}
+
+static void
+gtk_selection_model_finalize (GObject *object)
+{
+  GtkSelectionModel *self = GTK_SELECTION_MODEL (object);
+
+  gtk_set_free (self->selected);
+
+  G_OBJECT_CLASS (gtk_selection_model_parent_class)->finalize (object);
+}
+
+static void
+gtk_selection_model_class_init (GtkSelectionModelClass *class)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (class);
+
+  gobject_class->set_property = gtk_selection_model_set_property;
+  gobject_class->get_property = gtk_selection_model_get_property;
+  gobject_class->dispose = gtk_selection_model_dispose;
+  gobject_class->finalize = gtk_selection_model_finalize;
+
+  /**
+   * GtkSelectionModel:item-type:
+   *
+   * The #GType for items of this model
+   */
+  properties[PROP_ITEM_TYPE] =
+      g_param_spec_gtype ("item-type",
+                          P_("Item type"),
+                          P_("The type of items of this list"),
+                          G_TYPE_OBJECT,
+                          GTK_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_EXPLICIT_NOTIFY);
+
+  /**
+   * GtkSelectionModel:model:
+   *
+   * The model whose items are selected
+   */
+  properties[PROP_MODEL] =
+      g_param_spec_object ("model",
+                           P_("Model"),
+                           P_("The model whose items are selected"),
+                           G_TYPE_LIST_MODEL,
+                           GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+  g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
+
+  /**
+   * GtkSelectionModel::selection-changed:
+   * @self: a #GtkSelectionModel
+   * @position: the first item that may have changed
+   * @n_items: the number of items with changes
+   *
+   * Emitted when the selection state of some of the items changes.
+   *
+   * All items that changed are in the range from @position to
+   * @position + @n_items, but not all items in that range need
+   * to have changed.
+   */
+  signals[SELECTION_CHANGED] =
+      g_signal_new (I_("selection-changed"),
+                    G_TYPE_FROM_CLASS (class),
+                    G_SIGNAL_RUN_LAST,
+                    0,
+                    NULL, NULL,
+                    _gtk_marshal_VOID__UINT_UINT,
+                    G_TYPE_NONE, 2,
+                    G_TYPE_UINT,
+                    G_TYPE_UINT);
+}
+
+static void
+gtk_selection_model_init (GtkSelectionModel *self)
+{
+  self->selected = gtk_set_new ();
+}
+
+/**
+ * gtk_selection_model_new:
+ * @model: the model to select items from
+ *
+ * Creates a new selection model for the items of @model.
+ * Initially no items are selected.
+ *
+ * Returns: a new #GtkSelectionModel
+ **/
+GtkSelectionModel *
+gtk_selection_model_new (GListModel *model)
+{
+  g_return_val_if_fail (G_IS_LIST_MODEL (model), NULL);
+
+  return g_object_new (GTK_TYPE_SELECTION_MODEL,
+                       "item-type", g_list_model_get_item_type (model),
+                       "model", model,
+                       NULL);
+}
+
+/**
+ * gtk_selection_model_new_for_type:
+ * @item_type: the type of the items that will be returned
+ *
+ * Creates a new empty selection model set up to return items of
+ * type @item_type. It is up to the application to set a model that
+ * matches the item type.
+ *
+ * Returns: a new #GtkSelectionModel
+ **/
+GtkSelectionModel *
+gtk_selection_model_new_for_type (GType item_type)
+{
+  g_return_val_if_fail (g_type_is_a (item_type, G_TYPE_OBJECT), NULL);
+
+  return g_object_new (GTK_TYPE_SELECTION_MODEL,
+                       "item-type", item_type,
+                       NULL);
+}
+
+/**
+ * gtk_selection_model_set_model:
+ * @self: a #GtkSelectionModel
+ * @model: (allow-none): The model to select items from
+ *
+ * Sets the model to select items from. The @model's item type must
+ * conform to the item type of @self.
+ *
+ * The selection is cleared.
+ **/
+void
+gtk_selection_model_set_model (GtkSelectionModel *self,
+                               GListModel        *model)
+{
+  guint removed, added;
+
+  g_return_if_fail (GTK_IS_SELECTION_MODEL (self));
+  g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
+  if (model)
+    {
+      g_return_if_fail (g_type_is_a (g_list_model_get_item_type (model), self->item_type));
+    }
+
+  if (self->model == model)
+    return;
+
+  removed = g_list_model_get_n_items (G_LIST_MODEL (self));
+  gtk_selection_model_clear_model (self);
+
+  if (model)
+    {
+      self->model = g_object_ref (model);
+      g_signal_connect (model, "items-changed", G_CALLBACK (gtk_selection_model_items_changed_cb), self);
+      added = g_list_model_get_n_items (model);
+    }
+  else
+    added = 0;
+
+  if (removed > 0 || added > 0)
+    g_list_model_items_changed (G_LIST_MODEL (self), 0, removed, added);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MODEL]);
+}
+
+/**
+ * gtk_selection_model_get_model:
+ * @self: a #GtkSelectionModel
+ *
+ * Gets the model whose items are selected or %NULL if none.
+ *
+ * Returns: (nullable) (transfer none): The model
+ **/
+GListModel *
+gtk_selection_model_get_model (GtkSelectionModel *self)
+{
+  g_return_val_if_fail (GTK_IS_SELECTION_MODEL (self), NULL);
+
+  return self->model;
+}
+
+/**
+ * gtk_selection_model_is_selected:
+ * @self: a #GtkSelectionModel
+ * @position: the position of the item
+ *
+ * Checks if the item at @position is selected.
+ *
+ * Returns: %TRUE if the item is selected
+ **/
+gboolean
+gtk_selection_model_is_selected (GtkSelectionModel *self,
+                                 guint              position)
+{
+  g_return_val_if_fail (GTK_IS_SELECTION_MODEL (self), FALSE);
+
+  return gtk_set_contains (self->selected, position);
+}
+
+/**
+ * gtk_selection_model_get_n_selected:
+ * @self: a #GtkSelectionModel
+ *
+ * Counts the selected items.
+ *
+ * Returns: the number of selected items
+ **/
+guint
+gtk_selection_model_get_n_selected (GtkSelectionModel *self)
+{
+  g_return_val_if_fail (GTK_IS_SELECTION_MODEL (self), 0);
+
+  return gtk_set_get_size (self->selected);
+}
+
+/**
+ * gtk_selection_model_get_next_selected:
+ * @self: a #GtkSelectionModel
+ * @position: where to start looking
+ * @start: (out): the first selected item at or after @position
+ * @n_items: (out): the number of consecutive selected items from @start
+ *
+ * Finds the first range of selected items at or after @position.
+ * This is the fastest way to iterate over the selection:
+ * |[<!-- language="C" -->
+ *   guint start, n_items;
+ *
+ *   for (start = 0;
+ *        gtk_selection_model_get_next_selected (self, start, &start, &n_items);
+ *        start += n_items)
+ *     handle_selected_items (start, n_items);
+ * ]|
+ *
+ * Returns: %FALSE if no items at or after @position are selected
+ **/
+gboolean
+gtk_selection_model_get_next_selected (GtkSelectionModel *self,
+                                       guint              position,
+                                       guint             *start,
+                                       guint             *n_items)
+{
+  g_return_val_if_fail (GTK_IS_SELECTION_MODEL (self), FALSE);
+  g_return_val_if_fail (start != NULL, FALSE);
+  g_return_val_if_fail (n_items != NULL, FALSE);
+
+  return gtk_set_get_next_range (self->selected, position, start, n_items);
+}
+
+/**
+ * gtk_selection_model_select_range:
+ * @self: a #GtkSelectionModel
+ * @position: the first item to select
+ * @n_items: the number of items to select
+ * @exclusive: %TRUE to unselect all other items
+ *
+ * Selects the items from @position to @position + @n_items.
+ **/
+void
+gtk_selection_model_select_range (GtkSelectionModel *self,
+                                  guint              position,
+                                  guint              n_items,
+                                  gboolean           exclusive)
+{
+  guint model_items, start, end, changed_start, changed_n_items;
+
+  g_return_if_fail (GTK_IS_SELECTION_MODEL (self));
+  model_items = g_list_model_get_n_items (G_LIST_MODEL (self));
+  g_return_if_fail (position <= model_items && n_items <= model_items - position);
+
+  start = G_MAXUINT;
+  end = 0;
+
+  if (exclusive)
+    {
+      if (gtk_set_remove_range (self->selected, 0, position, &changed_start, &changed_n_items))
+        gtk_selection_model_add_change (&start, &end, changed_start, changed_n_items);
+      if (gtk_set_remove_range (self->selected, position + n_items, model_items - position - n_items, &changed_start, &changed_n_items))
+        gtk_selection_model_add_change (&start, &end, changed_start, changed_n_items);
+    }
+
+  if (gtk_set_add_range (self->selected, position, n_items, &changed_start, &changed_n_items))
+    gtk_selection_model_add_change (&start, &end, changed_start, changed_n_items);
+
+  gtk_selection_model_emit_changed (self, start, end);
+}
+
+/**
+ * gtk_selection_model_unselect_range:
+ * @self: a #GtkSelectionModel
+ * @position: the first item to unselect
+ * @n_items: the number of items to unselect
+ *
+ * Unselects the items from @position to @position + @n_items.
+ **/
+void
+gtk_selection_model_unselect_range (GtkSelectionModel *self,
+                                    guint              position,
+                                    guint              n_items)
+{
+  guint model_items, changed_start, changed_n_items;
+
+  g_return_if_fail (GTK_IS_SELECTION_MODEL (self));
+  model_items = g_list_model_get_n_items (G_LIST_MODEL (self));
+  g_return_if_fail (position <= model_items && n_items <= model_items - position);
+
+  if (gtk_set_remove_range (self->selected, position, n_items, &changed_start, &changed_n_items))
+    gtk_selection_model_emit_changed (self, changed_start, changed_start + changed_n_items);
+}
+
+/**
+ * gtk_selection_model_invert_range:
+ * @self: a #GtkSelectionModel
+ * @position: the first item to invert
+ * @n_items: the number of items to invert
+ *
+ * Unselects the selected items and selects the unselected items from
+ * @position to @position + @n_items.
+ **/
+void
+gtk_selection_model_invert_range (GtkSelectionModel *self,
+                                  guint              position,
+                                  guint              n_items)
+{
+  guint model_items;
+
+  g_return_if_fail (GTK_IS_SELECTION_MODEL (self));
+  model_items = g_list_model_get_n_items (G_LIST_MODEL (self));
+  g_return_if_fail (position <= model_items && n_items <= model_items - position);
+
+  if (n_items == 0)
+    return;
+
+  gtk_set_invert_range (self->selected, position, n_items);
+
+  gtk_selection_model_emit_changed (self, position, position + n_items);
+}
+
+/**
+ * gtk_selection_model_select_all:
+ * @self: a #GtkSelectionModel
+ *
+ * Selects all items.
+ **/
+void
+gtk_selection_model_select_all (GtkSelectionModel *self)
+{
+  g_return_if_fail (GTK_IS_SELECTION_MODEL (self));
+
+  gtk_selection_model_select_range (self, 0, g_list_model_get_n_items (G_LIST_MODEL (self)), FALSE);
+}
+
+/**
+ * gtk_selection_model_unselect_all:
+ * @self: a #GtkSelectionModel
+ *
+ * Unselects all items.
+ **/
+void
+gtk_selection_model_unselect_all (GtkSelectionModel *self)
+{
+  g_return_if_fail (GTK_IS_SELECTION_MODEL (self));
+
+  gtk_selection_model_unselect_range (self, 0, g_list_model_get_n_items (G_LIST_MODEL (self)));
+}
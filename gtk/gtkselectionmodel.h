@@ -0,0 +1,81 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#ifndef __GTK_SELECTION_MODEL_H__
+#define __GTK_SELECTION_MODEL_H__
+
+
+#if !defined (__GTK_H_INSIDE__) && !defined (GTK_COMPILATION)
+#error "Only <gtk/gtk.h> can be included directly."
+#endif
+
+#include <gio/gio.h>
+#include <gtk/gtkwidget.h>
+
+
+G_BEGIN_DECLS
+
+#define GTK_TYPE_SELECTION_MODEL (gtk_selection_model_get_type ())
+
+GDK_AVAILABLE_IN_ALL
+G_DECLARE_FINAL_TYPE (GtkSelectionModel, gtk_selection_model, GTK, SELECTION_MODEL, GObject)
+
+GDK_AVAILABLE_IN_ALL
+GtkSelectionModel *     gtk_selection_model_new                 (GListModel             *model);
+GDK_AVAILABLE_IN_ALL
+GtkSelectionModel *     gtk_selection_model_new_for_type        (GType                   item_type);
+
+GDK_AVAILABLE_IN_ALL
+void                    gtk_selection_model_set_model           (GtkSelectionModel      *self,
+                                                                 GListModel             *model);
+GDK_AVAILABLE_IN_ALL
+GListModel *            gtk_selection_model_get_model           (GtkSelectionModel      *self);
+
+GDK_AVAILABLE_IN_ALL
+gboolean                gtk_selection_model_is_selected         (GtkSelectionModel      *self,
+                                                                 guint                   position);
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_selection_model_get_n_selected      (GtkSelectionModel      *self);
+GDK_AVAILABLE_IN_ALL
+gboolean                gtk_selection_model_get_next_selected   (GtkSelectionModel      *self,
+                                                                 guint                   position,
+                                                                 guint                  *start,
+                                                                 guint                  *n_items);
+
+GDK_AVAILABLE_IN_ALL
+void                    gtk_selection_model_select_range        (GtkSelectionModel      *self,
+                                                                 guint                   position,
+                                                                 guint                   n_items,
+                                                                 gboolean                exclusive);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_selection_model_unselect_range      (GtkSelectionModel      *self,
+                                                                 guint                   position,
+                                                                 guint                   n_items);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_selection_model_invert_range        (GtkSelectionModel      *self,
+                                                                 guint                   position,
+                                                                 guint                   n_items);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_selection_model_select_all          (GtkSelectionModel      *self);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_selection_model_unselect_all        (GtkSelectionModel      *self);
+
+G_END_DECLS
+
+#endif /* __GTK_SELECTION_MODEL_H__ */
@@ -0,0 +1,552 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#include "config.h"
+
+#include "gtksetprivate.h"
+
+#include "gtkcssrbtreeprivate.h"
+
+/* GtkSet is a set of unsigned integers, like the positions of the
+ * selected items in a list. It stores ranges of consecutive members,
+ * so even a set of all items of a huge list is small, and keeps the
+ * ranges in a tree, so that adding, removing and looking up ranges
+ * takes O(log n) for n ranges, plus the number of ranges that are
+ * merged or removed.
+ *
+ * Every node stores a gap of non-members followed by a range of
+ * members, so positions are relative to the end of the previous
+ * node. This way inserting or removing positions, like when items
+ * are added to or removed from a list, only changes a single node.
+ * Ranges never touch, so only the first node can have an empty gap.
+ */
+
+typedef struct _SetNode SetNode;
+typedef struct _SetAugment SetAugment;
+
+struct _SetNode
+{
+  guint gap;
+  guint n_items;
+};
+
+struct _SetAugment
+{
+  guint length;                 /* gaps and members */
+  guint n_items;                /* members */
+};
+
+struct _GtkSet
+{
+  GtkCssRbTree *ranges;
+};
+
+static void
+gtk_set_augment (GtkCssRbTree *tree,
+                 gpointer      node_augment,
+                 gpointer      node,
+                 gpointer      left,
+                 gpointer      right)
+{
+  SetNode *n = node;
+  SetAugment *aug = node_augment;
+
+  aug->length = n->gap + n->n_items;
+  aug->n_items = n->n_items;
+
+  if (left)
+    {
+      SetAugment *left_aug = gtk_css_rb_tree_get_augment (tree, left);
+
+      aug->length += left_aug->length;
+      aug->n_items += left_aug->n_items;
+    }
+
+  if (right)
+    {
+      SetAugment *right_aug = gtk_css_rb_tree_get_augment (tree, right);
+
+      aug->length += right_aug->length;
+      aug->n_items += right_aug->n_items;
+    }
+}
+
+/* Finds the node whose gap or range contains position and sets
+ * span_start to the start of its gap. If position is after the last
+ * range, NULL is returned and span_start is set to the end of that
+ * range. */
+static SetNode *
+gtk_set_find (GtkSet *set,
+              guint   position,
+              guint  *span_start)
+{
+  SetNode *node, *tmp;
+  guint offset;
+
+  offset = 0;
+  node = gtk_css_rb_tree_get_root (set->ranges);
+
+  while (node)
+    {
+      tmp = gtk_css_rb_tree_get_left (set->ranges, node);
+      if (tmp)
+        {
+          SetAugment *aug = gtk_css_rb_tree_get_augment (set->ranges, tmp);
+          if (position < offset + aug->length)
+            {
+              node = tmp;
+              continue;
+            }
+          offset += aug->length;
+        }
+
+      if (position < offset + node->gap + node->n_items)
+        break;
+      offset += node->gap + node->n_items;
+
+      node = gtk_css_rb_tree_get_right (set->ranges, node);
+    }
+
+  *span_start = offset;
+
+  return node;
+}
+
+GtkSet *
+gtk_set_new (void)
+{
+  GtkSet *set;
+
+  set = g_slice_new (GtkSet);
+  set->ranges = gtk_css_rb_tree_new (SetNode,
+                                     SetAugment,
+                                     gtk_set_augment,
+                                     NULL, NULL);
+
+  return set;
+}
+
+void
+gtk_set_free (GtkSet *set)
+{
+  gtk_css_rb_tree_unref (set->ranges);
+
+  g_slice_free (GtkSet, set);
+}
+
+gboolean
+gtk_set_contains (GtkSet *set,
+                  guint   item)
+{
+  SetNode *node;
+  guint span;
+
+  node = gtk_set_find (set, item, &span);
+
+  return node != NULL && item >= span + node->gap;
+}
+
+gboolean
+gtk_set_is_empty (GtkSet *set)
+{
+  return gtk_css_rb_tree_get_root (set->ranges) == NULL;
+}
+
+guint
+gtk_set_get_size (GtkSet *set)
+{
+  SetNode *root;
+  SetAugment *aug;
+
+  root = gtk_css_rb_tree_get_root (set->ranges);
+  if (root == NULL)
+    return 0;
+
+  aug = gtk_css_rb_tree_get_augment (set->ranges, root);
+
+  return aug->n_items;
+}
+
+/*
+ * gtk_set_get_next_range:
+ * @set: a #GtkSet
+ * @position: where to start looking
+ * @start: (out): the first member at or after @position
+ * @n_items: (out): the number of consecutive members from @start
+ *
+ * Finds the first range of members at or after @position. Use this to
+ * iterate over all members.
+ *
+ * Returns: %FALSE if there are no members at or after @position
+ */
+gboolean
+gtk_set_get_next_range (GtkSet *set,
+                        guint   position,
+                        guint  *start,
+                        guint  *n_items)
+{
+  SetNode *node;
+  guint span, range_start;
+
+  node = gtk_set_find (set, position, &span);
+  if (node == NULL)
+    return FALSE;
+
+  range_start = span + node->gap;
+  *start = MAX (range_start, position);
+  *n_items = range_start + node->n_items - *start;
+
+  return TRUE;
+}
+
+static void
+set_changed (guint  first,
+             guint  end,
+             guint *changed_start,
+             guint *changed_n_items)
+{
+  if (changed_start)
+    *changed_start = first < end ? first : 0;
+  if (changed_n_items)
+    *changed_n_items = first < end ? end - first : 0;
+}
+
+/*
+ * gtk_set_add_range:
+ * @set: a #GtkSet
+ * @start: first item to add
+ * @n_items: number of items to add
+ * @changed_start: (out) (optional): first item that was not a member
+ * @changed_n_items: (out) (optional): number of items from
+ *     @changed_start up to the last item that was not a member
+ *
+ * Adds all items from @start to @start + @n_items.
+ *
+ * Returns: %TRUE if items were added
+ */
+gboolean
+gtk_set_add_range (GtkSet *set,
+                   guint   start,
+                   guint   n_items,
+                   guint  *changed_start,
+                   guint  *changed_n_items)
+{
+  SetNode *node, *first, *next;
+  guint end, span, first_span, range_start, range_end, pos;
+  guint new_start, new_end, first_changed, last_changed;
+
+  if (n_items == 0)
+    {
+      set_changed (0, 0, changed_start, changed_n_items);
+      return FALSE;
+    }
+
+  end = start + n_items;
+
+  /* Look at the item before, so a range that ends at start is found */
+  node = gtk_set_find (set, start > 0 ? start - 1 : 0, &span);
+
+  if (node == NULL)
+    {
+      node = gtk_css_rb_tree_insert_before (set->ranges, NULL);
+      node->gap = start - span;
+      node->n_items = n_items;
+      gtk_css_rb_tree_mark_dirty (set->ranges, node);
+      set_changed (start, end, changed_start, changed_n_items);
+      return TRUE;
+    }
+
+  range_start = span + node->gap;
+  if (range_start > end)
+    {
+      first = gtk_css_rb_tree_insert_before (set->ranges, node);
+      first->gap = start - span;
+      first->n_items = n_items;
+      gtk_css_rb_tree_mark_dirty (set->ranges, first);
+      node->gap = range_start - end;
+      gtk_css_rb_tree_mark_dirty (set->ranges, node);
+      set_changed (start, end, changed_start, changed_n_items);
+      return TRUE;
+    }
+
+  /* Merge all ranges that overlap or touch into the first one */
+  first = node;
+  first_span = span;
+  new_start = MIN (start, range_start);
+  new_end = end;
+  first_changed = G_MAXUINT;
+  last_changed = 0;
+  pos = start;
+
+  while (node)
+    {
+      range_start = span + node->gap;
+      if (range_start > end)
+        break;
+      range_end = range_start + node->n_items;
+
+      if (range_start > pos)
+        {
+          first_changed = MIN (first_changed, pos);
+          last_changed = range_start;
+        }
+      pos = MAX (pos, range_end);
+      new_end = MAX (new_end, range_end);
+
+      next = gtk_css_rb_tree_get_next (set->ranges, node);
+      if (node != first)
+        gtk_css_rb_tree_remove (set->ranges, node);
+      span = range_end;
+      node = next;
+    }
+
+  if (pos < end)
+    {
+      first_changed = MIN (first_changed, pos);
+      last_changed = end;
+    }
+
+  first->gap = new_start - first_span;
+  first->n_items = new_end - new_start;
+  gtk_css_rb_tree_mark_dirty (set->ranges, first);
+
+  if (node)
+    {
+      node->gap = span + node->gap - new_end;
+      gtk_css_rb_tree_mark_dirty (set->ranges, node);
+    }
+
+  set_changed (first_changed, last_changed, changed_start, changed_n_items);
+
+  return first_changed < last_changed;
+}
+
+/*
+ * gtk_set_remove_range:
+ * @set: a #GtkSet
+ * @start: first item to remove
+ * @n_items: number of items to remove
+ * @changed_start: (out) (optional): first item that was a member
+ * @changed_n_items: (out) (optional): number of items from
+ *     @changed_start up to the last item that was a member
+ *
+ * Removes all items from @start to @start + @n_items.
+ *
+ * Returns: %TRUE if items were removed
+ */
+gboolean
+gtk_set_remove_range (GtkSet *set,
+                      guint   start,
+                      guint   n_items,
+                      guint  *changed_start,
+                      guint  *changed_n_items)
+{
+  SetNode *node, *next, *after;
+  guint end, span, range_start, range_end, pending;
+  guint first_changed, last_changed;
+
+  end = start + n_items;
+  first_changed = G_MAXUINT;
+  last_changed = 0;
+  /* the gap that removed ranges add to the next node */
+  pending = 0;
+
+  if (n_items > 0)
+    node = gtk_set_find (set, start, &span);
+  else
+    node = NULL;
+
+  while (node)
+    {
+      range_start = span + node->gap;
+      if (range_start >= end)
+        break;
+      range_end = range_start + node->n_items;
+      next = gtk_css_rb_tree_get_next (set->ranges, node);
+
+      first_changed = MIN (first_changed, MAX (range_start, start));
+      last_changed = MIN (range_end, end);
+
+      if (range_start < start && range_end > end)
+        {
+          after = gtk_css_rb_tree_insert_after (set->ranges, node);
+          after->gap = end - start;
+          after->n_items = range_end - end;
+          gtk_css_rb_tree_mark_dirty (set->ranges, after);
+          node->n_items = start - range_start;
+          gtk_css_rb_tree_mark_dirty (set->ranges, node);
+          node = NULL;
+          break;
+        }
+      else if (range_start < start)
+        {
+          node->n_items = start - range_start;
+          gtk_css_rb_tree_mark_dirty (set->ranges, node);
+          pending += range_end - start;
+        }
+      else if (range_end > end)
+        {
+          node->gap += pending + end - range_start;
+          node->n_items = range_end - end;
+          gtk_css_rb_tree_mark_dirty (set->ranges, node);
+          pending = 0;
+          break;
+        }
+      else
+        {
+          pending += node->gap + node->n_items;
+          gtk_css_rb_tree_remove (set->ranges, node);
+        }
+
+      span = range_end;
+      node = next;
+    }
+
+  if (node && pending > 0)
+    {
+      node->gap += pending;
+      gtk_css_rb_tree_mark_dirty (set->ranges, node);
+    }
+
+  set_changed (first_changed, last_changed, changed_start, changed_n_items);
+
+  return first_changed < last_changed;
+}
+
+/*
+ * gtk_set_invert_range:
+ * @set: a #GtkSet
+ * @start: first item to invert
+ * @n_items: number of items to invert
+ *
+ * Removes all members from @start to @start + @n_items and adds
+ * all items in that range that weren't members.
+ */
+void
+gtk_set_invert_range (GtkSet *set,
+                      guint   start,
+                      guint   n_items)
+{
+  GArray *added;
+  guint end, pos, range_start, range_n_items, i;
+
+  end = start + n_items;
+  added = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (pos = start; pos < end; pos = range_start + range_n_items)
+    {
+      if (!gtk_set_get_next_range (set, pos, &range_start, &range_n_items) ||
+          range_start >= end)
+        {
+          g_array_append_val (added, pos);
+          g_array_append_val (added, end);
+          break;
+        }
+
+      if (range_start > pos)
+        {
+          g_array_append_val (added, pos);
+          g_array_append_val (added, range_start);
+        }
+    }
+
+  gtk_set_remove_range (set, start, n_items, NULL, NULL);
+
+  for (i = 0; i < added->len; i += 2)
+    {
+      pos = g_array_index (added, guint, i);
+      gtk_set_add_range (set, pos, g_array_index (added, guint, i + 1) - pos, NULL, NULL);
+    }
+
+  g_array_free (added, TRUE);
+}
+
+void
+gtk_set_remove_all (GtkSet *set)
+{
+  gtk_css_rb_tree_remove_all (set->ranges);
+}
+
+/*
+ * gtk_set_splice:
+ * @set: a #GtkSet
+ * @position: the position of the change
+ * @removed: number of items removed at @position
+ * @added: number of items added at @position
+ *
+ * Updates @set for a change in the list it refers to, like a
+ * GListModel::items-changed signal. Removed items are no longer
+ * members, added items aren't members and the members after them
+ * move by @added - @removed.
+ */
+void
+gtk_set_splice (GtkSet *set,
+                guint   position,
+                guint   removed,
+                guint   added)
+{
+  SetNode *node, *prev, *after;
+  guint span, range_start;
+
+  if (removed > 0)
+    {
+      gtk_set_remove_range (set, position, removed, NULL, NULL);
+
+      /* All removed items are in the gap of this node now */
+      node = gtk_set_find (set, position, &span);
+      if (node)
+        {
+          node->gap -= removed;
+          prev = gtk_css_rb_tree_get_previous (set->ranges, node);
+          if (node->gap == 0 && prev)
+            {
+              prev->n_items += node->n_items;
+              gtk_css_rb_tree_mark_dirty (set->ranges, prev);
+              gtk_css_rb_tree_remove (set->ranges, node);
+            }
+          else
+            {
+              gtk_css_rb_tree_mark_dirty (set->ranges, node);
+            }
+        }
+    }
+
+  if (added > 0)
+    {
+      node = gtk_set_find (set, position, &span);
+      if (node)
+        {
+          range_start = span + node->gap;
+          if (position <= range_start)
+            {
+              node->gap += added;
+              gtk_css_rb_tree_mark_dirty (set->ranges, node);
+            }
+          else
+            {
+              after = gtk_css_rb_tree_insert_after (set->ranges, node);
+              after->gap = added;
+              after->n_items = range_start + node->n_items - position;
+              gtk_css_rb_tree_mark_dirty (set->ranges, after);
+              node->n_items = position - range_start;
+              gtk_css_rb_tree_mark_dirty (set->ranges, node);
+            }
+        }
+    }
+}
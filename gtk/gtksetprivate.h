@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2018 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors: Benjamin Otte <otte@gnome.org>
+ */
+
+#ifndef __GTK_SET_PRIVATE_H__
+#define __GTK_SET_PRIVATE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GtkSet GtkSet;
+
+GtkSet *        gtk_set_new                     (void);
+void            gtk_set_free                    (GtkSet         *set);
+
+gboolean        gtk_set_contains                (GtkSet         *set,
+                                                 guint           item);
+gboolean        gtk_set_is_empty                (GtkSet         *set);
+guint           gtk_set_get_size                (GtkSet         *set);
+gboolean        gtk_set_get_next_range          (GtkSet         *set,
+                                                 guint           position,
+                                                 guint          *start,
+                                                 guint          *n_items);
+
+gboolean        gtk_set_add_range               (GtkSet         *set,
+                                                 guint           start,
+                                                 guint           n_items,
+                                                 guint          *changed_start,
+                                                 guint          *changed_n_items);
+gboolean        gtk_set_remove_range            (GtkSet         *set,
+                                                 guint           start,
+                                                 guint           n_items,
+                                                 guint          *changed_start,
+                                                 guint          *changed_n_items);
+void            gtk_set_invert_range            (GtkSet         *set,
+                                                 guint           start,
+                                                 guint           n_items);
+void            gtk_set_remove_all              (GtkSet         *set);
+
+void            gtk_set_splice                  (GtkSet         *set,
+                                                 guint           position,
+                                                 guint           removed,
+                                                 guint           added);
+
+G_END_DECLS
+
+#endif /* __GTK_SET_PRIVATE_H__ */
@@ -24,6 +24,8 @@
 #include "gtkintl.h"
 #include "gtkprivate.h"
 
+#include <string.h>
+
 /**
  * SECTION:gtksortlistmodel
  * @title: GtkSortListModel
@@ -31,20 +33,45 @@
  * @see_also: #GListModel
  *
  * #GtkSortListModel is a list model that takes a list model and
- * sorts its elements according to a compare function.
+ * sorts its elements according to a compare function. Sorting is
+ * stable, items that compare equal keep the order of the model.
  *
  * #GtkSortListModel is a generic model and because of that it
  * cannot take advantage of any external knowledge when sorting.
  * If you run into performance issues with #GtkSortListModel, it
  * is strongly recommended that you write your own sorting list
  * model.
+ *
+ * When sorting takes too long, #GtkSortListModel:incremental can be
+ * set. The model will then sort in small steps while the main loop is
+ * idle, emitting #GListModel::items-changed for the parts that have
+ * been sorted. The #GtkSortListModel:pending property tells how much
+ * sorting remains.
+ */
+
+/* The items are kept in an array in the order of the model. Sorting
+ * happens on an array of indexes into that array, so that comparing
+ * items is the only thing that needs to touch them.
+ * Items that compare equal are sorted by their position in the model,
+ * that way sorting is stable and added items can be sorted separately
+ * and then merged with the sorted items.
  */
 
+/* Runs shorter than this are sorted with insertion sort */
+#define RUN_SIZE 16
+
+/* Incremental sorting checks the time after this many compares */
+#define SORT_STEP_SIZE 512
+/* Time incremental sorting may take per main loop iteration, in µs */
+#define SORT_SLICE_USEC 1000
+
 enum {
   PROP_0,
   PROP_HAS_SORT,
+  PROP_INCREMENTAL,
   PROP_ITEM_TYPE,
   PROP_MODEL,
+  PROP_PENDING,
   NUM_PROPERTIES
 };
 
@@ -58,8 +85,18 @@ struct _GtkSortListModel
   gpointer user_data;
   GDestroyNotify user_destroy;
 
-  GSequence *sorted; /* NULL if sort_func == NULL */
-  GSequence *unsorted; /* NULL if sort_func == NULL */
+  GPtrArray *items; /* NULL if sort_func == NULL, the items in model order */
+  guint *sorted; /* index into items of the item at every position */
+  guint *positions; /* position of every item in items, reverse of sorted */
+
+  guint incremental : 1;
+
+  guint sort_source; /* idle source of incremental sorting, 0 if not sorting */
+  guint sort_width; /* length of the sorted runs, 0 while sorting them */
+  guint sort_position; /* start of the next runs to sort or merge */
+  guint merged_a; /* items of the first run merged so far */
+  guint merged_b; /* items of the second run merged so far */
+  guint *sort_buffer;
 };
 
 struct _GtkSortListModelClass
@@ -85,8 +122,8 @@ gtk_sort_list_model_get_n_items (GListModel *list)
   if (self->model == NULL)
     return 0;
 
-  if (self->sorted)
-    return g_sequence_get_length (self->sorted);
+  if (self->items)
+    return self->items->len;
 
   return g_list_model_get_n_items (self->model);
 }
@@ -96,19 +133,17 @@ gtk_sort_list_model_get_item (GListModel *list,
                               guint       position)
 {
   GtkSortListModel *self = GTK_SORT_LIST_MODEL (list);
-  GSequenceIter *iter;
 
   if (self->model == NULL)
     return NULL;
 
-  if (self->unsorted == NULL)
+  if (self->items == NULL)
     return g_list_model_get_item (self->model, position);
 
-  iter = g_sequence_get_iter_at_pos (self->sorted, position);
-  if (g_sequence_iter_is_end (iter))
-      return NULL;
+  if (position >= self->items->len)
+    return NULL;
 
-  return g_object_ref (g_sequence_get (iter));
+  return g_object_ref (g_ptr_array_index (self->items, self->sorted[position]));
 }
 
 static void
@@ -122,6 +157,320 @@ gtk_sort_list_model_model_init (GListModelInterface *iface)
 G_DEFINE_TYPE_WITH_CODE (GtkSortListModel, gtk_sort_list_model, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_sort_list_model_model_init))
 
+static inline int
+gtk_sort_list_model_compare (GtkSortListModel *self,
+                             guint             a,
+                             guint             b)
+{
+  int result;
+
+  result = self->sort_func (g_ptr_array_index (self->items, a),
+                            g_ptr_array_index (self->items, b),
+                            self->user_data);
+  if (result != 0)
+    return result;
+
+  return (a > b) - (a < b);
+}
+
+static void
+gtk_sort_list_model_insertion_sort (GtkSortListModel *self,
+                                    guint            *indexes,
+                                    guint             n_indexes)
+{
+  guint i, j, index;
+
+  for (i = 1; i < n_indexes; i++)
+    {
+      index = indexes[i];
+      for (j = i; j > 0 && gtk_sort_list_model_compare (self, indexes[j - 1], index) > 0; j--)
+        indexes[j] = indexes[j - 1];
+      indexes[j] = index;
+    }
+}
+
+/* Merges the sorted runs a and b into result, which must not
+ * overlap with them. */
+static void
+gtk_sort_list_model_merge (GtkSortListModel *self,
+                           const guint      *a,
+                           guint             n_a,
+                           const guint      *b,
+                           guint             n_b,
+                           guint            *result)
+{
+  const guint *a_end = a + n_a;
+  const guint *b_end = b + n_b;
+
+  while (a < a_end && b < b_end)
+    {
+      if (gtk_sort_list_model_compare (self, *b, *a) < 0)
+        *result++ = *b++;
+      else
+        *result++ = *a++;
+    }
+
+  if (a < a_end)
+    memcpy (result, a, (a_end - a) * sizeof (guint));
+  else if (b < b_end)
+    memcpy (result, b, (b_end - b) * sizeof (guint));
+}
+
+/* Sorts indexes into self->items with a bottom-up merge sort */
+static void
+gtk_sort_list_model_sort (GtkSortListModel *self,
+                          guint            *indexes,
+                          guint             n_indexes)
+{
+  guint *buffer, *src, *dest, *tmp;
+  guint i, width, mid, end;
+
+  for (i = 0; i < n_indexes; i += RUN_SIZE)
+    gtk_sort_list_model_insertion_sort (self, indexes + i, MIN (RUN_SIZE, n_indexes - i));
+
+  if (n_indexes <= RUN_SIZE)
+    return;
+
+  buffer = g_new (guint, n_indexes);
+  src = indexes;
+  dest = buffer;
+
+  for (width = RUN_SIZE; width < n_indexes; width *= 2)
+    {
+      for (i = 0; i < n_indexes; i += 2 * width)
+        {
+          mid = MIN (i + width, n_indexes);
+          end = MIN (i + 2 * width, n_indexes);
+          gtk_sort_list_model_merge (self,
+                                     src + i, mid - i,
+                                     src + mid, end - mid,
+                                     dest + i);
+        }
+
+      tmp = src;
+      src = dest;
+      dest = tmp;
+    }
+
+  if (src != indexes)
+    memcpy (indexes, src, n_indexes * sizeof (guint));
+
+  g_free (buffer);
+}
+
+static void
+gtk_sort_list_model_update_positions (GtkSortListModel *self)
+{
+  guint i;
+
+  self->positions = g_renew (guint, self->positions, self->items->len);
+
+  for (i = 0; i < self->items->len; i++)
+    self->positions[self->sorted[i]] = i;
+}
+
+/* Copies the n items of run into the sorted items at start, and
+ * extends the range from changed_start to changed_end by the items
+ * that are different. */
+static void
+gtk_sort_list_model_replace_run (GtkSortListModel *self,
+                                 guint             start,
+                                 const guint      *run,
+                                 guint             n,
+                                 guint            *changed_start,
+                                 guint            *changed_end)
+{
+  guint first, last;
+
+  for (first = 0; first < n && run[first] == self->sorted[start + first]; first++)
+    ;
+  if (first == n)
+    return;
+
+  for (last = n; run[last - 1] == self->sorted[start + last - 1]; last--)
+    ;
+
+  memcpy (self->sorted + start + first, run + first, (last - first) * sizeof (guint));
+  *changed_start = MIN (*changed_start, start + first);
+  *changed_end = MAX (*changed_end, start + last);
+}
+
+/* Does the next step of the merge sort done by gtk_sort_list_model_sort(),
+ * but at most SORT_STEP_SIZE compares of it. Runs are merged into
+ * sort_buffer, so the sorted items stay valid in between steps.
+ *
+ * Returns: %TRUE if all items are sorted
+ */
+static gboolean
+gtk_sort_list_model_sort_step (GtkSortListModel *self,
+                               guint            *changed_start,
+                               guint            *changed_end)
+{
+  guint n_items, start, mid, end, n_compares;
+  const guint *a, *a_end, *b, *b_end;
+  guint *out;
+
+  n_items = self->items->len;
+  start = self->sort_position;
+
+  if (self->sort_width == 0)
+    {
+      end = MIN (start + RUN_SIZE, n_items);
+      memcpy (self->sort_buffer, self->sorted + start, (end - start) * sizeof (guint));
+      gtk_sort_list_model_insertion_sort (self, self->sort_buffer, end - start);
+      gtk_sort_list_model_replace_run (self, start, self->sort_buffer, end - start, changed_start, changed_end);
+      self->sort_position = end;
+
+      if (self->sort_position >= n_items)
+        {
+          self->sort_width = RUN_SIZE;
+          self->sort_position = 0;
+        }
+
+      return self->sort_width >= n_items;
+    }
+
+  mid = MIN (start + self->sort_width, n_items);
+  end = MIN (start + 2 * self->sort_width, n_items);
+
+  if (self->merged_a == 0 && self->merged_b == 0 &&
+      (mid >= end || gtk_sort_list_model_compare (self, self->sorted[mid - 1], self->sorted[mid]) <= 0))
+    {
+      /* The runs are in order already, which is common when resorting */
+      self->sort_position = end;
+    }
+  else
+    {
+      a = self->sorted + start + self->merged_a;
+      a_end = self->sorted + mid;
+      b = self->sorted + mid + self->merged_b;
+      b_end = self->sorted + end;
+      out = self->sort_buffer + self->merged_a + self->merged_b;
+
+      for (n_compares = 0; n_compares < SORT_STEP_SIZE && a < a_end && b < b_end; n_compares++)
+        {
+          if (gtk_sort_list_model_compare (self, *b, *a) < 0)
+            *out++ = *b++;
+          else
+            *out++ = *a++;
+        }
+
+      if (a < a_end && b < b_end)
+        {
+          self->merged_a = a - (self->sorted + start);
+          self->merged_b = b - (self->sorted + mid);
+          return FALSE;
+        }
+
+      if (a < a_end)
+        memcpy (out, a, (a_end - a) * sizeof (guint));
+      else if (b < b_end)
+        memcpy (out, b, (b_end - b) * sizeof (guint));
+
+      gtk_sort_list_model_replace_run (self, start, self->sort_buffer, end - start, changed_start, changed_end);
+      self->merged_a = 0;
+      self->merged_b = 0;
+      self->sort_position = end;
+    }
+
+  if (self->sort_position >= n_items)
+    {
+      self->sort_width *= 2;
+      self->sort_position = 0;
+    }
+
+  return self->sort_width >= n_items;
+}
+
+static void
+gtk_sort_list_model_stop_sorting (GtkSortListModel *self)
+{
+  if (self->sort_source == 0)
+    return;
+
+  g_source_remove (self->sort_source);
+  self->sort_source = 0;
+  g_clear_pointer (&self->sort_buffer, g_free);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+}
+
+/* Sorts incrementally until all items are sorted or end_time is reached
+ * and emits the changes. */
+static void
+gtk_sort_list_model_run_sort (GtkSortListModel *self,
+                              gint64            end_time)
+{
+  guint i, changed_start, changed_end;
+  gboolean done;
+
+  changed_start = G_MAXUINT;
+  changed_end = 0;
+
+  do
+    {
+      done = gtk_sort_list_model_sort_step (self, &changed_start, &changed_end);
+    }
+  while (!done && g_get_monotonic_time () < end_time);
+
+  for (i = changed_start; i < changed_end; i++)
+    self->positions[self->sorted[i]] = i;
+
+  if (done)
+    gtk_sort_list_model_stop_sorting (self);
+  else
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+
+  if (changed_start < changed_end)
+    g_list_model_items_changed (G_LIST_MODEL (self),
+                                changed_start,
+                                changed_end - changed_start,
+                                changed_end - changed_start);
+}
+
+static gboolean
+gtk_sort_list_model_sort_cb (gpointer data)
+{
+  GtkSortListModel *self = data;
+
+  gtk_sort_list_model_run_sort (self, g_get_monotonic_time () + SORT_SLICE_USEC);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Sorts all items right away or, if incremental, (re)starts sorting
+ * them in the background. Callers need to emit the changes when not
+ * sorting incrementally. */
+static void
+gtk_sort_list_model_start_sorting (GtkSortListModel *self)
+{
+  self->sort_width = 0;
+  self->sort_position = 0;
+  self->merged_a = 0;
+  self->merged_b = 0;
+
+  if (!self->incremental)
+    {
+      gtk_sort_list_model_stop_sorting (self);
+      gtk_sort_list_model_sort (self, self->sorted, self->items->len);
+      gtk_sort_list_model_update_positions (self);
+      return;
+    }
+
+  self->sort_buffer = g_renew (guint, self->sort_buffer, MAX (self->items->len, RUN_SIZE));
+
+  if (self->sort_source == 0)
+    {
+      self->sort_source = g_idle_add_full (GDK_PRIORITY_REDRAW + 1,
+                                           gtk_sort_list_model_sort_cb,
+                                           self,
+                                           NULL);
+      g_source_set_name_by_id (self->sort_source, "[gtk+] gtk_sort_list_model_sort_cb");
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+}
+
 static void
 gtk_sort_list_model_remove_items (GtkSortListModel *self,
                                   guint             position,
@@ -129,30 +478,35 @@ gtk_sort_list_model_remove_items (GtkSortListModel *self,
                                   guint            *unmodified_start,
                                   guint            *unmodified_end)
 {
-  GSequenceIter *unsorted_iter;
-  guint i, pos, start, end, length_before;
+  guint i, j, pos, index, start, end, length_before;
 
-  start = end = length_before = g_sequence_get_length (self->sorted);
-  unsorted_iter = g_sequence_get_iter_at_pos (self->unsorted, position);
+  start = end = length_before = self->items->len;
 
-  for (i = 0; i < n_items ; i++)
+  if (n_items == 0)
     {
-      GSequenceIter *sorted_iter;
-      GSequenceIter *next;
-
-      next = g_sequence_iter_next (unsorted_iter);
+      *unmodified_start = start;
+      *unmodified_end = end;
+      return;
+    }
 
-      sorted_iter = g_sequence_get (unsorted_iter);
-      pos = g_sequence_iter_get_position (sorted_iter);
+  for (i = position; i < position + n_items; i++)
+    {
+      pos = self->positions[i];
       start = MIN (start, pos);
-      end = MIN (end, length_before - i - 1 - pos);
-
-      g_sequence_remove (sorted_iter);
-      g_sequence_remove (unsorted_iter);
+      end = MIN (end, length_before - 1 - pos);
+    }
 
-      unsorted_iter = next;
+  for (i = 0, j = 0; i < length_before; i++)
+    {
+      index = self->sorted[i];
+      if (index < position)
+        self->sorted[j++] = index;
+      else if (index >= position + n_items)
+        self->sorted[j++] = index - n_items;
     }
 
+  g_ptr_array_remove_range (self->items, position, n_items);
+
   *unmodified_start = start;
   *unmodified_end = end;
 }
@@ -164,22 +518,65 @@ gtk_sort_list_model_add_items (GtkSortListModel *self,
                                guint            *unmodified_start,
                                guint            *unmodified_end)
 {
-  GSequenceIter *unsorted_iter, *sorted_iter;
+  guint *added, *sorted;
   guint i, pos, start, end, length_before;
 
-  unsorted_iter = g_sequence_get_iter_at_pos (self->unsorted, position);
-  start = end = length_before = g_sequence_get_length (self->sorted);
+  start = end = length_before = self->items->len;
+
+  if (n_items == 0)
+    {
+      if (unmodified_start)
+        *unmodified_start = start;
+      if (unmodified_end)
+        *unmodified_end = end;
+      return;
+    }
 
+  for (i = 0; i < length_before; i++)
+    {
+      if (self->sorted[i] >= position)
+        self->sorted[i] += n_items;
+    }
+
+  g_ptr_array_set_size (self->items, length_before + n_items);
+  memmove (self->items->pdata + position + n_items,
+           self->items->pdata + position,
+           (length_before - position) * sizeof (gpointer));
+  added = g_new (guint, n_items);
   for (i = 0; i < n_items; i++)
     {
-      gpointer item = g_list_model_get_item (self->model, position + i);
-      sorted_iter = g_sequence_insert_sorted (self->sorted, item, self->sort_func, self->user_data);
-      g_sequence_insert_before (unsorted_iter, sorted_iter);
-      if (unmodified_start != NULL || unmodified_end != NULL)
+      g_ptr_array_index (self->items, position + i) = g_list_model_get_item (self->model, position + i);
+      added[i] = position + i;
+    }
+
+  gtk_sort_list_model_sort (self, added, n_items);
+
+  sorted = g_new (guint, length_before + n_items);
+  gtk_sort_list_model_merge (self,
+                             self->sorted, length_before,
+                             added, n_items,
+                             sorted);
+  g_free (self->sorted);
+  self->sorted = sorted;
+  g_free (added);
+
+  if (unmodified_start != NULL || unmodified_end != NULL)
+    {
+      for (i = 0; i < length_before + n_items; i++)
+        {
+          if (self->sorted[i] >= position && self->sorted[i] < position + n_items)
+            {
+              start = MIN (start, i);
+              break;
+            }
+        }
+      for (pos = length_before + n_items; pos-- > 0; )
         {
-          pos = g_sequence_iter_get_position (sorted_iter);
-          start = MIN (start, pos);
-          end = MIN (end, length_before + i - pos);
+          if (self->sorted[pos] >= position && self->sorted[pos] < position + n_items)
+            {
+              end = MIN (end, length_before + n_items - 1 - pos);
+              break;
+            }
         }
     }
 
@@ -201,7 +598,7 @@ gtk_sort_list_model_items_changed_cb (GListModel       *model,
   if (removed == 0 && added == 0)
     return;
 
-  if (self->sorted == NULL)
+  if (self->items == NULL)
     {
       g_list_model_items_changed (G_LIST_MODEL (self), position, removed, added);
       return;
@@ -209,10 +606,15 @@ gtk_sort_list_model_items_changed_cb (GListModel       *model,
 
   gtk_sort_list_model_remove_items (self, position, removed, &start, &end);
   gtk_sort_list_model_add_items (self, position, added, &start2, &end2);
+  gtk_sort_list_model_update_positions (self);
   start = MIN (start, start2);
   end = MIN (end, end2);
 
-  n_items = g_sequence_get_length (self->sorted) - start - end;
+  /* The runs being sorted changed, so start over */
+  if (self->sort_source)
+    gtk_sort_list_model_start_sorting (self);
+
+  n_items = self->items->len - start - end;
   g_list_model_items_changed (G_LIST_MODEL (self), start, n_items - added + removed, n_items);
 }
 
@@ -226,6 +628,10 @@ gtk_sort_list_model_set_property (GObject      *object,
 
   switch (prop_id)
     {
+    case PROP_INCREMENTAL:
+      gtk_sort_list_model_set_incremental (self, g_value_get_boolean (value));
+      break;
+
     case PROP_ITEM_TYPE:
       self->item_type = g_value_get_gtype (value);
       break;
@@ -254,6 +660,10 @@ gtk_sort_list_model_get_property (GObject     *object,
       g_value_set_boolean (value, self->sort_func != NULL);
       break;
 
+    case PROP_INCREMENTAL:
+      g_value_set_boolean (value, self->incremental);
+      break;
+
     case PROP_ITEM_TYPE:
       g_value_set_gtype (value, self->item_type);
       break;
@@ -262,12 +672,25 @@ gtk_sort_list_model_get_property (GObject     *object,
       g_value_set_object (value, self->model);
       break;
 
+    case PROP_PENDING:
+      g_value_set_uint (value, gtk_sort_list_model_get_pending (self));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
     }
 }
 
+static void
+gtk_sort_list_model_clear_items (GtkSortListModel *self)
+{
+  gtk_sort_list_model_stop_sorting (self);
+  g_clear_pointer (&self->items, g_ptr_array_unref);
+  g_clear_pointer (&self->sorted, g_free);
+  g_clear_pointer (&self->positions, g_free);
+}
+
 static void
 gtk_sort_list_model_clear_model (GtkSortListModel *self)
 {
@@ -276,8 +699,7 @@ gtk_sort_list_model_clear_model (GtkSortListModel *self)
 
   g_signal_handlers_disconnect_by_func (self->model, gtk_sort_list_model_items_changed_cb, self);
   g_clear_object (&self->model);
-  g_clear_pointer (&self->sorted, g_sequence_free);
-  g_clear_pointer (&self->unsorted, g_sequence_free);
+  gtk_sort_list_model_clear_items (self);
 }
 
 static void
@@ -316,6 +738,18 @@ gtk_sort_list_model_class_init (GtkSortListModelClass *class)
                             FALSE,
                             GTK_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkSortListModel:incremental:
+   *
+   * If the model should sort items incrementally
+   */
+  properties[PROP_INCREMENTAL] =
+      g_param_spec_boolean ("incremental",
+                            P_("Incremental"),
+                            P_("Sort items incrementally"),
+                            FALSE,
+                            GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * GtkSortListModel:item-type:
    *
@@ -340,6 +774,18 @@ gtk_sort_list_model_class_init (GtkSortListModelClass *class)
                            G_TYPE_LIST_MODEL,
                            GTK_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkSortListModel:pending:
+   *
+   * Estimate of unsorted items remaining
+   */
+  properties[PROP_PENDING] =
+      g_param_spec_uint ("pending",
+                         P_("Pending"),
+                         P_("Estimate of unsorted items remaining"),
+                         0, G_MAXUINT, 0,
+                         GTK_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 }
 
@@ -402,15 +848,26 @@ gtk_sort_list_model_new_for_type (GType item_type)
 }
 
 static void
-gtk_sort_list_model_create_sequences (GtkSortListModel *self)
+gtk_sort_list_model_create_items (GtkSortListModel *self)
 {
+  guint i, n_items;
+
   if (!self->sort_func || self->model == NULL)
     return;
 
-  self->sorted = g_sequence_new (g_object_unref);
-  self->unsorted = g_sequence_new (NULL);
+  n_items = g_list_model_get_n_items (self->model);
+
+  self->items = g_ptr_array_new_full (n_items, g_object_unref);
+  self->sorted = g_new (guint, n_items);
+
+  for (i = 0; i < n_items; i++)
+    {
+      g_ptr_array_add (self->items, g_list_model_get_item (self->model, i));
+      self->sorted[i] = i;
+    }
 
-  gtk_sort_list_model_add_items (self, 0, g_list_model_get_n_items (self->model), NULL, NULL);
+  gtk_sort_list_model_update_positions (self);
+  gtk_sort_list_model_start_sorting (self);
 }
 
 /**
@@ -442,15 +899,28 @@ gtk_sort_list_model_set_sort_func (GtkSortListModel *self,
   if (self->user_destroy)
     self->user_destroy (self->user_data);
 
-  g_clear_pointer (&self->unsorted, g_sequence_free);
-  g_clear_pointer (&self->sorted, g_sequence_free);
   self->sort_func = sort_func;
   self->user_data = user_data;
   self->user_destroy = user_destroy;
-  
-    gtk_sort_list_model_create_sequences (self);
-    
+
   n_items = g_list_model_get_n_items (G_LIST_MODEL (self));
+
+  if (sort_func == NULL)
+    {
+      gtk_sort_list_model_clear_items (self);
+    }
+  else if (self->items == NULL)
+    {
+      gtk_sort_list_model_create_items (self);
+    }
+  else
+    {
+      /* Resort starting from the current order */
+      gtk_sort_list_model_start_sorting (self);
+      if (self->incremental)
+        n_items = 0;
+    }
+
   if (n_items > 1)
     g_list_model_items_changed (G_LIST_MODEL (self), 0, n_items, n_items);
 
@@ -490,7 +960,7 @@ gtk_sort_list_model_set_model (GtkSortListModel *self,
       g_signal_connect (model, "items-changed", G_CALLBACK (gtk_sort_list_model_items_changed_cb), self);
       added = g_list_model_get_n_items (model);
 
-      gtk_sort_list_model_create_sequences (self);
+      gtk_sort_list_model_create_items (self);
     }
   else
     added = 0;
@@ -541,6 +1011,9 @@ gtk_sort_list_model_has_sort (GtkSortListModel *self)
  *
  * Calling this function is necessary when data used by the sort
  * function has changed.
+ *
+ * If @self is incremental, this starts sorting the items again in the
+ * background.
  **/
 void
 gtk_sort_list_model_resort (GtkSortListModel *self)
@@ -549,15 +1022,106 @@ gtk_sort_list_model_resort (GtkSortListModel *self)
 
   g_return_if_fail (GTK_IS_SORT_LIST_MODEL (self));
   
-  if (self->sorted == NULL)
+  if (self->items == NULL)
     return;
 
-  n_items = g_list_model_get_n_items (self->model);
+  n_items = self->items->len;
   if (n_items <= 1)
     return;
 
-  g_sequence_sort (self->sorted, self->sort_func, self->user_data);
+  gtk_sort_list_model_start_sorting (self);
+
+  if (!self->incremental)
+    g_list_model_items_changed (G_LIST_MODEL (self), 0, n_items, n_items);
+}
+
+/**
+ * gtk_sort_list_model_set_incremental:
+ * @self: a #GtkSortListModel
+ * @incremental: %TRUE to sort incrementally
+ *
+ * Sets whether @self sorts incrementally.
+ *
+ * When sorting incrementally, @self sorts a bit of its items at a time
+ * while the main loop is idle, and emits #GListModel::items-changed
+ * for the items it sorted. Until it is done, the items are only
+ * partially sorted. This keeps the application responsive when
+ * sorting large models.
+ *
+ * Use gtk_sort_list_model_get_pending() to find out how much sorting
+ * remains.
+ *
+ * When incremental sorting is turned off while items are sorted, they
+ * are sorted right away.
+ **/
+void
+gtk_sort_list_model_set_incremental (GtkSortListModel *self,
+                                     gboolean          incremental)
+{
+  g_return_if_fail (GTK_IS_SORT_LIST_MODEL (self));
+
+  incremental = !!incremental;
+  if (self->incremental == incremental)
+    return;
+
+  self->incremental = incremental;
+
+  if (!incremental && self->sort_source)
+    gtk_sort_list_model_run_sort (self, G_MAXINT64);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_INCREMENTAL]);
+}
+
+/**
+ * gtk_sort_list_model_get_incremental:
+ * @self: a #GtkSortListModel
+ *
+ * Returns whether incremental sorting was enabled via
+ * gtk_sort_list_model_set_incremental().
+ *
+ * Returns: %TRUE if incremental sorting is enabled
+ **/
+gboolean
+gtk_sort_list_model_get_incremental (GtkSortListModel *self)
+{
+  g_return_val_if_fail (GTK_IS_SORT_LIST_MODEL (self), FALSE);
+
+  return self->incremental;
+}
+
+/**
+ * gtk_sort_list_model_get_pending:
+ * @self: a #GtkSortListModel
+ *
+ * Estimates the number of items that still need to be sorted when
+ * sorting incrementally. The estimate decreases while sorting and
+ * is 0 once all items are sorted.
+ *
+ * You can use this value to show progress to the user.
+ *
+ * Returns: an estimate of the items that still need to be sorted
+ **/
+guint
+gtk_sort_list_model_get_pending (GtkSortListModel *self)
+{
+  guint n_items, n_passes, pass, width;
+
+  g_return_val_if_fail (GTK_IS_SORT_LIST_MODEL (self), 0);
+
+  if (self->sort_source == 0)
+    return 0;
+
+  /* Every pass over the items counts the same */
+  n_items = self->items->len;
+  n_passes = 1;
+  pass = 0;
+  for (width = RUN_SIZE; width < n_items; width *= 2)
+    {
+      n_passes++;
+      if (width <= self->sort_width)
+        pass++;
+    }
 
-  g_list_model_items_changed (G_LIST_MODEL (self), 0, n_items, n_items);
+  return n_items - ((guint64) pass * n_items + self->sort_position) / n_passes;
 }
 
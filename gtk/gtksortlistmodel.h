@@ -60,6 +60,14 @@ GListModel *            gtk_sort_list_model_get_model           (GtkSortListMode
 GDK_AVAILABLE_IN_ALL
 void                    gtk_sort_list_model_resort              (GtkSortListModel       *self);
 
+GDK_AVAILABLE_IN_ALL
+void                    gtk_sort_list_model_set_incremental     (GtkSortListModel       *self,
+                                                                 gboolean                incremental);
+GDK_AVAILABLE_IN_ALL
+gboolean                gtk_sort_list_model_get_incremental     (GtkSortListModel       *self);
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_sort_list_model_get_pending         (GtkSortListModel       *self);
+
 G_END_DECLS
 
 #endif /* __GTK_SORT_LIST_MODEL_H__ */
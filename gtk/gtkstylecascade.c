@@ -223,6 +223,27 @@ gtk_style_cascade_lookup (GtkStyleProvider    *provider,
   gtk_style_cascade_iter_clear (&iter);
 }
 
+static gboolean
+gtk_style_cascade_get_change_properties (GtkStyleProvider  *provider,
+                                         GtkCssChange       change,
+                                         GtkBitmask       **properties)
+{
+  GtkStyleCascade *cascade = GTK_STYLE_CASCADE (provider);
+  GtkStyleCascadeIter iter;
+  GtkStyleProvider *item;
+  gboolean result = TRUE;
+
+  for (item = gtk_style_cascade_iter_init (cascade, &iter);
+       item && result;
+       item = gtk_style_cascade_iter_next (cascade, &iter))
+    {
+      result = gtk_style_provider_get_change_properties (item, change, properties);
+    }
+  gtk_style_cascade_iter_clear (&iter);
+
+  return result;
+}
+
 static void
 gtk_style_cascade_provider_iface_init (GtkStyleProviderInterface *iface)
 {
@@ -231,6 +252,7 @@ gtk_style_cascade_provider_iface_init (GtkStyleProviderInterface *iface)
   iface->get_scale = gtk_style_cascade_get_scale;
   iface->get_keyframes = gtk_style_cascade_get_keyframes;
   iface->lookup = gtk_style_cascade_lookup;
+  iface->get_change_properties = gtk_style_cascade_get_change_properties;
 }
 
 G_DEFINE_TYPE_EXTENDED (GtkStyleCascade, _gtk_style_cascade, G_TYPE_OBJECT, 0,
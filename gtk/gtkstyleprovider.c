@@ -19,6 +19,8 @@
 
 #include "gtkstyleproviderprivate.h"
 
+#include "gtkcssnodestylecacheprivate.h"
+#include "gtkcssprefetchprivate.h"
 #include "gtkintl.h"
 #include "gtkprivate.h"
 #include "gtkwidgetpath.h"
@@ -115,11 +117,49 @@ gtk_style_provider_lookup (GtkStyleProvider    *provider,
   iface->lookup (provider, matcher, lookup, out_change);
 }
 
+/*
+ * gtk_style_provider_get_change_properties:
+ * @provider: a #GtkStyleProvider
+ * @change: the change that happened to a node
+ * @properties: (inout): bitmask to add the affected properties to
+ *
+ * Adds all properties whose cascaded value may differ after @change
+ * to @properties. This is used to only recompute the affected parts
+ * of a style on e.g. state changes.
+ *
+ * Returns: %FALSE if the provider cannot tell which properties are
+ *     affected and everything needs to be recomputed
+ */
+gboolean
+gtk_style_provider_get_change_properties (GtkStyleProvider  *provider,
+                                          GtkCssChange       change,
+                                          GtkBitmask       **properties)
+{
+  GtkStyleProviderInterface *iface;
+
+  gtk_internal_return_val_if_fail (GTK_IS_STYLE_PROVIDER (provider), FALSE);
+  gtk_internal_return_val_if_fail (properties != NULL, FALSE);
+
+  iface = GTK_STYLE_PROVIDER_GET_INTERFACE (provider);
+
+  /* Providers that don't look up anything can't affect anything */
+  if (!iface->lookup)
+    return TRUE;
+
+  if (!iface->get_change_properties)
+    return FALSE;
+
+  return iface->get_change_properties (provider, change, properties);
+}
+
 void
 gtk_style_provider_changed (GtkStyleProvider *provider)
 {
   gtk_internal_return_if_fail (GTK_IS_STYLE_PROVIDER (provider));
 
+  gtk_css_node_style_cache_clear_shared ();
+  gtk_css_prefetch_tree_changed ();
+
   g_signal_emit (provider, signals[CHANGED], 0);
 }
 
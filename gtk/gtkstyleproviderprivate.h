@@ -45,6 +45,9 @@ struct _GtkStyleProviderInterface
                                                  const GtkCssMatcher     *matcher,
                                                  GtkCssLookup            *lookup,
                                                  GtkCssChange            *out_change);
+  gboolean              (* get_change_properties) (GtkStyleProvider *provider,
+                                                 GtkCssChange             change,
+                                                 GtkBitmask             **properties);
   void                  (* emit_error)          (GtkStyleProvider *provider,
                                                  GtkCssSection           *section,
                                                  const GError            *error);
@@ -62,6 +65,9 @@ void                    gtk_style_provider_lookup                (GtkStyleProvid
                                                                   const GtkCssMatcher     *matcher,
                                                                   GtkCssLookup            *lookup,
                                                                   GtkCssChange            *out_change);
+gboolean                gtk_style_provider_get_change_properties (GtkStyleProvider *provider,
+                                                                  GtkCssChange             change,
+                                                                  GtkBitmask             **properties);
 
 void                    gtk_style_provider_changed               (GtkStyleProvider *provider);
 
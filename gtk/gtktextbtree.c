@@ -244,6 +244,11 @@ struct _GtkTextBTree {
 #define MIN_CHILDREN 3
 #endif
 
+/* How many lines to put into the nodes created when inserting
+ * many lines at once. This leaves room for edits in both directions.
+ */
+#define BULK_CHILDREN ((MAX_CHILDREN + MIN_CHILDREN) / 2)
+
 /*
  * Prototypes
  */
@@ -257,6 +262,12 @@ static void              post_insert_fixup                       (GtkTextBTree
                                                                   GtkTextLine      *insert_line,
                                                                   gint              char_count_delta,
                                                                   gint              line_count_delta);
+static void              link_lines_in_new_nodes                 (GtkTextBTree     *tree,
+                                                                  GtkTextLine      *line,
+                                                                  GtkTextLine      *first,
+                                                                  GtkTextLine      *last,
+                                                                  gint              line_count_delta,
+                                                                  gint              char_count_delta);
 static void              gtk_text_btree_node_adjust_toggle_count (GtkTextBTreeNode *node,
                                                                   GtkTextTagInfo   *info,
                                                                   gint              adjust);
@@ -317,6 +328,9 @@ static void tag_changed_cb        (GtkTextTagTable  *table,
                                    gboolean          size_changed,
                                    GtkTextBTree     *tree);
 static void cleanup_line          (GtkTextLine      *line);
+static gboolean find_toggle_outside_current_line (GtkTextLine  *line,
+                                                  GtkTextBTree *tree,
+                                                  GtkTextTag   *tag);
 static void recompute_node_counts (GtkTextBTree     *tree,
                                    GtkTextBTreeNode *node);
 static void inc_count             (GtkTextTag       *tag,
@@ -1104,7 +1118,11 @@ _gtk_text_btree_insert (GtkTextIter *iter,
   GtkTextLine *line;           /* Current line (new segments are
                                 * added to this line). */
   GtkTextLineSegment *seg;
+  GtkTextLineSegment *tail;             /* The rest of the line after the
+                                         * insertion point. */
+  GtkTextLineSegment **append_p;        /* Where to put the next segment. */
   GtkTextLine *newline;
+  GtkTextLine *first_line, *last_line;  /* The chain of new lines. */
   int chunk_len;                        /* # characters in current chunk. */
   gint sol;                           /* start of line */
   gint eol;                           /* Pointer to character just after last
@@ -1147,10 +1165,24 @@ _gtk_text_btree_insert (GtkTextIter *iter,
   
   /*
    * Chop the text up into lines and create a new segment for
-   * each line, plus a new line for the leftovers from the
-   * previous line.
+   * each line. The new lines are collected in a chain and linked
+   * into the tree when we know how many there are. The last one
+   * gets the leftovers from the previous line.
    */
 
+  if (cur_seg == NULL)
+    {
+      tail = line->segments;
+      append_p = &line->segments;
+    }
+  else
+    {
+      tail = cur_seg->next;
+      append_p = &cur_seg->next;
+    }
+
+  first_line = NULL;
+  last_line = NULL;
   eol = 0;
   sol = 0;
   line_count_delta = 0;
@@ -1181,16 +1213,8 @@ _gtk_text_btree_insert (GtkTextIter *iter,
 
       char_count_delta += seg->char_count;
 
-      if (cur_seg == NULL)
-        {
-          seg->next = line->segments;
-          line->segments = seg;
-        }
-      else
-        {
-          seg->next = cur_seg->next;
-          cur_seg->next = seg;
-        }
+      *append_p = seg;
+      append_p = &seg->next;
 
       if (delim == eol)
         {
@@ -1200,33 +1224,59 @@ _gtk_text_btree_insert (GtkTextIter *iter,
         }
 
       /*
-       * The chunk ended with a newline, so create a new GtkTextLine
-       * and move the remainder of the old line to it.
+       * The chunk ended with a newline, so continue in a new
+       * GtkTextLine.
        */
 
       newline = gtk_text_line_new ();
-      gtk_text_line_set_parent (newline, line->parent);
-      newline->next = line->next;
-      line->next = newline;
-      newline->segments = seg->next;
-      seg->next = NULL;
-      line = newline;
-      cur_seg = NULL;
+      if (last_line != NULL)
+        last_line->next = newline;
+      else
+        first_line = newline;
+      last_line = newline;
+      append_p = &newline->segments;
       line_count_delta++;
     }
 
+  *append_p = tail;
+
   /*
-   * Cleanup the starting line for the insertion, plus the ending
-   * line if it's different.
+   * Link the new lines into the tree and cleanup the starting line
+   * for the insertion, plus the ending line if it's different.
    */
 
-  cleanup_line (start_line);
-  if (line != start_line)
+  if (line_count_delta == 0)
     {
-      cleanup_line (line);
+      cleanup_line (start_line);
+      post_insert_fixup (tree, start_line, 0, char_count_delta);
     }
+  else if (line_count_delta < MAX_CHILDREN)
+    {
+      for (newline = first_line; newline != NULL; newline = newline->next)
+        gtk_text_line_set_parent (newline, start_line->parent);
+
+      last_line->next = start_line->next;
+      start_line->next = first_line;
 
-  post_insert_fixup (tree, line, line_count_delta, char_count_delta);
+      cleanup_line (start_line);
+      cleanup_line (last_line);
+      post_insert_fixup (tree, last_line, line_count_delta, char_count_delta);
+    }
+  else
+    {
+      link_lines_in_new_nodes (tree, start_line, first_line, last_line,
+                               line_count_delta, char_count_delta);
+
+      cleanup_line (start_line);
+      cleanup_line (last_line);
+
+      gtk_text_btree_rebalance (tree, start_line->parent);
+
+#ifdef G_ENABLE_DEBUG
+      if (GTK_DEBUG_CHECK (TEXT))
+        _gtk_text_btree_check (tree);
+#endif
+    }
 
   /* Invalidate our region, and reset the iterator the user
      passed in to point to the end of the inserted text. */
@@ -2022,6 +2072,418 @@ _gtk_text_btree_tag (const GtkTextIter *start_orig,
 }
 
 
+/*
+ * Tag many ranges at once
+ */
+
+typedef struct {
+  GtkTextTagInfo *info;
+  gint last_end;        /* end of the last range, to merge overlapping ones */
+  guint last_event;     /* index of the end event of the last range */
+  gint delta;           /* toggle count change not yet added to the node */
+  gint off_pos;         /* where a range ended with a new toggle off */
+  guint on : 1;         /* whether the tag was on before the next segment */
+  guint active : 1;     /* whether the next segment is in one of the ranges */
+} TagRangeState;
+
+typedef struct {
+  gint offset;
+  guint state : 31;
+  guint start : 1;
+} TagRangeEvent;
+
+typedef struct {
+  GtkTextBTree *tree;
+  GArray *states;
+  GHashTable *infos;    /* GtkTextTagInfo -> TagRangeState */
+  TagRangeEvent *events;
+  guint n_events;
+  guint next_event;
+  guint n_active;
+  GtkTextBTreeNode *node;
+} TagRangeBatch;
+
+static int
+compare_tag_ranges (gconstpointer a,
+                    gconstpointer b)
+{
+  const GtkTextTagRange *ra = a;
+  const GtkTextTagRange *rb = b;
+
+  return MIN (ra->start, ra->end) - MIN (rb->start, rb->end);
+}
+
+static int
+compare_tag_range_events (gconstpointer a,
+                          gconstpointer b)
+{
+  return ((const TagRangeEvent *) a)->offset - ((const TagRangeEvent *) b)->offset;
+}
+
+static void
+tag_range_batch_add_event (GArray *events,
+                           gint    offset,
+                           guint   state,
+                           guint   start)
+{
+  TagRangeEvent event = { offset, state, start };
+
+  g_array_append_val (events, event);
+}
+
+/* Adds the toggle count changes to the node of the last lines */
+static void
+tag_range_batch_flush (TagRangeBatch *batch)
+{
+  TagRangeState *state;
+  guint i;
+
+  for (i = 0; i < batch->states->len; i++)
+    {
+      state = &g_array_index (batch->states, TagRangeState, i);
+      if (state->delta != 0)
+        {
+          _gtk_change_node_toggle_count (batch->node, state->info, state->delta);
+          state->delta = 0;
+        }
+    }
+}
+
+static void
+tag_range_batch_start_at_line (TagRangeBatch *batch,
+                               GtkTextLine   *line)
+{
+  TagRangeState *state;
+  guint i;
+
+  for (i = 0; i < batch->states->len; i++)
+    {
+      state = &g_array_index (batch->states, TagRangeState, i);
+      state->on = find_toggle_outside_current_line (line, batch->tree, state->info->tag);
+    }
+}
+
+/* Tags the ranges in a single walk over the segments of @line,
+ * returning the number of characters in the line.
+ */
+static gint
+tag_ranges_in_line (TagRangeBatch *batch,
+                    GtkTextLine   *line,
+                    gint           line_offset)
+{
+  GtkTextLineSegment *seg, **prev_p;
+  GtkTextLineSegment *pending, *pending_tail, *toggle;
+  TagRangeState *state;
+  TagRangeEvent *event;
+  gboolean changed, pairs;
+  gint pos, handled_pos, index;
+
+  if (line->parent != batch->node)
+    {
+      tag_range_batch_flush (batch);
+      batch->node = line->parent;
+    }
+
+  pos = line_offset;
+  handled_pos = -1;
+  pending = pending_tail = NULL;
+  changed = FALSE;
+  pairs = FALSE;
+
+  prev_p = &line->segments;
+  while ((seg = *prev_p) != NULL)
+    {
+      /* Start and end the ranges at this position, the toggles are
+       * inserted where gtk_text_line_segment_split() would put them.
+       */
+      if (pos != handled_pos)
+        {
+          handled_pos = pos;
+
+          for (;
+               batch->next_event < batch->n_events &&
+               batch->events[batch->next_event].offset == pos;
+               batch->next_event++)
+            {
+              event = &batch->events[batch->next_event];
+              state = &g_array_index (batch->states, TagRangeState, event->state);
+
+              state->active = event->start;
+              if (event->start)
+                batch->n_active++;
+              else
+                batch->n_active--;
+
+              if (state->on)
+                continue;
+
+              if (!event->start)
+                state->off_pos = pos;
+
+              toggle = _gtk_toggle_segment_new (state->info, event->start);
+              toggle->body.toggle.inNodeCounts = TRUE;
+              state->delta++;
+
+              if (pending == NULL)
+                pending = toggle;
+              else
+                pending_tail->next = toggle;
+              pending_tail = toggle;
+            }
+        }
+
+      if (pending != NULL &&
+          !(seg->byte_count == 0 && seg->type->leftGravity))
+        {
+          pending_tail->next = seg;
+          *prev_p = pending;
+          prev_p = &pending_tail->next;
+          pending = NULL;
+          changed = TRUE;
+        }
+
+      if (seg->type == &gtk_text_toggle_on_type ||
+          seg->type == &gtk_text_toggle_off_type)
+        {
+          state = g_hash_table_lookup (batch->infos, seg->body.toggle.info);
+          if (state != NULL)
+            {
+              /* A range ending here is followed by the tag again,
+               * cleanup_line() will remove both toggles.
+               */
+              if (seg->type == &gtk_text_toggle_on_type &&
+                  state->off_pos == pos)
+                pairs = TRUE;
+
+              state->on = seg->type == &gtk_text_toggle_on_type;
+
+              /* Remove the toggles inside the ranges */
+              if (state->active)
+                {
+                  *prev_p = seg->next;
+                  if (seg->body.toggle.inNodeCounts)
+                    state->delta--;
+                  _gtk_toggle_segment_free (seg);
+                  changed = TRUE;
+                  continue;
+                }
+            }
+        }
+      else if (seg->char_count > 0)
+        {
+          if (batch->next_event < batch->n_events &&
+              batch->events[batch->next_event].offset < pos + seg->char_count)
+            {
+              g_assert (seg->type == &gtk_text_char_type);
+
+              index = g_utf8_offset_to_pointer (seg->body.chars,
+                                                batch->events[batch->next_event].offset - pos)
+                      - seg->body.chars;
+              seg = (*seg->type->splitFunc) (seg, index);
+              *prev_p = seg;
+              changed = TRUE;
+            }
+
+          pos += seg->char_count;
+        }
+
+      prev_p = &seg->next;
+    }
+
+  /* All positions in the buffer are before a character of their line */
+  g_assert (pending == NULL);
+
+  if (changed)
+    {
+      /* cleanup_line() removes toggle pairs from the node counts */
+      if (pairs)
+        tag_range_batch_flush (batch);
+
+      cleanup_line (line);
+    }
+
+  return pos - line_offset;
+}
+
+static void
+queue_tag_ranges_redisplay (TagRangeBatch *batch)
+{
+  GtkTextIter start, end;
+  gboolean affects_size, affects_appearance;
+  TagRangeState *state;
+  guint i;
+
+  affects_size = affects_appearance = FALSE;
+  for (i = 0; i < batch->states->len; i++)
+    {
+      state = &g_array_index (batch->states, TagRangeState, i);
+      affects_size |= _gtk_text_tag_affects_size (state->info->tag);
+      affects_appearance |= _gtk_text_tag_affects_nonsize_appearance (state->info->tag);
+    }
+
+  if (!affects_size && !affects_appearance)
+    return;
+
+  _gtk_text_btree_get_iter_at_char (batch->tree, &start, batch->events[0].offset);
+  _gtk_text_btree_get_iter_at_char (batch->tree, &end, batch->events[batch->n_events - 1].offset);
+
+  if (affects_size)
+    _gtk_text_btree_invalidate_region (batch->tree, &start, &end, FALSE);
+  else
+    redisplay_region (batch->tree, &start, &end, FALSE);
+}
+
+/* Applies the tags to the ranges with one walk over the lines from
+ * the first to the last range, adding the toggle count changes to
+ * the tree once per node and invalidating the region once.
+ */
+void
+_gtk_text_btree_tag_ranges (GtkTextBTree          *tree,
+                            const GtkTextTagRange *ranges,
+                            guint                  n_ranges)
+{
+  TagRangeBatch batch;
+  GtkTextTagRange *sorted;
+  TagRangeState *state;
+  TagRangeEvent *event;
+  GArray *events;
+  GtkTextLine *line, *next;
+  gint n_chars, start, end, line_offset, line_chars, real_offset;
+  gpointer index;
+  guint i;
+
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (ranges != NULL || n_ranges == 0);
+
+  /* Overlapping ranges can only be merged in order */
+  sorted = NULL;
+  for (i = 1; i < n_ranges; i++)
+    {
+      if (compare_tag_ranges (&ranges[i - 1], &ranges[i]) > 0)
+        {
+          sorted = g_memdup (ranges, n_ranges * sizeof (GtkTextTagRange));
+          qsort (sorted, n_ranges, sizeof (GtkTextTagRange), compare_tag_ranges);
+          ranges = sorted;
+          break;
+        }
+    }
+
+  batch.tree = tree;
+  batch.states = g_array_new (FALSE, TRUE, sizeof (TagRangeState));
+  batch.infos = g_hash_table_new (NULL, NULL);
+  events = g_array_sized_new (FALSE, FALSE, sizeof (TagRangeEvent), 2 * n_ranges);
+
+  n_chars = _gtk_text_btree_char_count (tree);
+
+  for (i = 0; i < n_ranges; i++)
+    {
+      start = CLAMP (MIN (ranges[i].start, ranges[i].end), 0, n_chars);
+      end = CLAMP (MAX (ranges[i].start, ranges[i].end), 0, n_chars);
+      if (start == end)
+        continue;
+
+      /* The hash table maps to the index + 1 until the array is complete */
+      index = g_hash_table_lookup (batch.infos, ranges[i].tag);
+      if (index == NULL)
+        {
+          TagRangeState new_state = { gtk_text_btree_get_tag_info (tree, ranges[i].tag), };
+
+          new_state.off_pos = -1;
+
+          g_array_append_val (batch.states, new_state);
+          index = GUINT_TO_POINTER (batch.states->len);
+          g_hash_table_insert (batch.infos, ranges[i].tag, index);
+        }
+      else
+        {
+          state = &g_array_index (batch.states, TagRangeState, GPOINTER_TO_UINT (index) - 1);
+          if (start <= state->last_end)
+            {
+              if (end > state->last_end)
+                {
+                  g_array_index (events, TagRangeEvent, state->last_event).offset = end;
+                  state->last_end = end;
+                }
+              continue;
+            }
+        }
+
+      state = &g_array_index (batch.states, TagRangeState, GPOINTER_TO_UINT (index) - 1);
+      tag_range_batch_add_event (events, start, GPOINTER_TO_UINT (index) - 1, TRUE);
+      tag_range_batch_add_event (events, end, GPOINTER_TO_UINT (index) - 1, FALSE);
+      state->last_end = end;
+      state->last_event = events->len - 1;
+    }
+
+  g_free (sorted);
+
+  if (events->len == 0)
+    goto out;
+
+  g_array_sort (events, compare_tag_range_events);
+
+  g_hash_table_remove_all (batch.infos);
+  for (i = 0; i < batch.states->len; i++)
+    {
+      state = &g_array_index (batch.states, TagRangeState, i);
+      g_hash_table_insert (batch.infos, state->info, state);
+    }
+
+  batch.events = (TagRangeEvent *) events->data;
+  batch.n_events = events->len;
+  batch.next_event = 0;
+  batch.n_active = 0;
+  batch.node = NULL;
+
+  event = &batch.events[0];
+  line = _gtk_text_btree_get_line_at_char (tree, event->offset, &line_offset, &real_offset);
+  tag_range_batch_start_at_line (&batch, line);
+
+  while (TRUE)
+    {
+      line_chars = tag_ranges_in_line (&batch, line, line_offset);
+      if (batch.next_event == batch.n_events)
+        break;
+
+      line_offset += line_chars;
+      next = _gtk_text_line_next (line);
+      event = &batch.events[batch.next_event];
+
+      /* Skip to the next range, instead of walking over the lines
+       * in between to follow the state of the tags
+       */
+      if (batch.n_active == 0 &&
+          event->offset >= line_offset + _gtk_text_line_char_count (next))
+        {
+          tag_range_batch_flush (&batch);
+          line = _gtk_text_btree_get_line_at_char (tree, event->offset, &line_offset, &real_offset);
+          tag_range_batch_start_at_line (&batch, line);
+        }
+      else
+        line = next;
+    }
+
+  tag_range_batch_flush (&batch);
+
+  segments_changed (tree);
+
+  /* Tagging doesn't move any text, so invalidating the region
+   * afterwards covers the old and the new look of the ranges
+   */
+  queue_tag_ranges_redisplay (&batch);
+
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (TEXT))
+    _gtk_text_btree_check (tree);
+#endif
+
+out:
+  g_array_unref (events);
+  g_array_unref (batch.states);
+  g_hash_table_unref (batch.infos);
+}
+
+
 /*
  * "Getters"
  */
@@ -5454,6 +5916,66 @@ _gtk_text_btree_validate_line (GtkTextBTree     *tree,
     }
 }
 
+/* Returns the first line without valid line data for @view_id,
+ * or %NULL if the view is valid.
+ */
+GtkTextLine *
+_gtk_text_btree_find_first_invalid_line (GtkTextBTree *tree,
+                                         gpointer      view_id)
+{
+  GtkTextBTreeNode *node;
+  GtkTextLine *line;
+  NodeData *nd;
+
+  g_return_val_if_fail (tree != NULL, NULL);
+
+  node = tree->root_node;
+  nd = node_data_find (node->node_data, view_id);
+  if (nd && nd->valid)
+    return NULL;
+
+  while (node->level > 0)
+    {
+      GtkTextBTreeNode *child;
+
+      for (child = node->children.node; child != NULL; child = child->next)
+        {
+          nd = node_data_find (child->node_data, view_id);
+          if (nd == NULL || !nd->valid)
+            break;
+        }
+
+      if (child == NULL)
+        return NULL;
+
+      node = child;
+    }
+
+  for (line = node->children.line; line != NULL; line = line->next)
+    {
+      GtkTextLineData *ld = _gtk_text_line_get_data (line, view_id);
+
+      if (ld == NULL || !ld->valid)
+        return line;
+    }
+
+  return NULL;
+}
+
+/* Updates the sizes of the nodes above @line after the view changed
+ * the line data of @line and possibly its siblings.
+ */
+void
+_gtk_text_btree_line_data_changed (GtkTextBTree *tree,
+                                   GtkTextLine  *line,
+                                   gpointer      view_id)
+{
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (line != NULL);
+
+  gtk_text_btree_node_check_valid_upward (line->parent, view_id);
+}
+
 static void
 gtk_text_btree_node_remove_view (BTreeView *view, GtkTextBTreeNode *node, gpointer view_id)
 {
@@ -6003,6 +6525,92 @@ post_insert_fixup (GtkTextBTree *tree,
 #endif
 }
 
+/*
+ * Links the chain of new lines from @first to @last into the tree
+ * after @line. Instead of adding them all to the node of @line and
+ * splitting that up again MIN_CHILDREN lines at a time, like
+ * post_insert_fixup() would, this puts them into new leaf nodes of
+ * BULK_CHILDREN lines each, together with the lines that followed
+ * @line in its node. The caller needs to rebalance the node of @line
+ * afterwards, which only leaves the levels above to split up.
+ */
+static void
+link_lines_in_new_nodes (GtkTextBTree *tree,
+                         GtkTextLine  *line,
+                         GtkTextLine  *first,
+                         GtkTextLine  *last,
+                         gint          line_count_delta,
+                         gint          char_count_delta)
+{
+  GtkTextBTreeNode *leaf, *parent, *node, *prev;
+  GtkTextLine *next;
+  gint n_lines, n_nodes, n, i;
+
+  g_assert (line_count_delta >= MAX_CHILDREN);
+
+  leaf = line->parent;
+
+  last->next = line->next;
+  line->next = NULL;
+
+  n_lines = line_count_delta;
+  for (next = last->next; next != NULL; next = next->next)
+    n_lines++;
+
+  /* Both bounds keep the nodes between MIN_CHILDREN and MAX_CHILDREN */
+  n_nodes = MIN ((n_lines + BULK_CHILDREN - 1) / BULK_CHILDREN,
+                 n_lines / MIN_CHILDREN);
+
+  parent = leaf->parent;
+  if (parent == NULL)
+    {
+      /* Like gtk_text_btree_rebalance() does when splitting the root */
+      parent = gtk_text_btree_node_new ();
+      parent->parent = NULL;
+      parent->next = NULL;
+      parent->summary = NULL;
+      parent->level = 1;
+      parent->children.node = leaf;
+      recompute_node_counts (tree, parent);
+      tree->root_node = parent;
+    }
+
+  prev = leaf;
+  for (i = 0; i < n_nodes; i++)
+    {
+      node = gtk_text_btree_node_new ();
+      node->parent = parent;
+      node->next = prev->next;
+      prev->next = node;
+      node->summary = NULL;
+      node->level = 0;
+      node->children.line = first;
+
+      for (n = n_lines / n_nodes + (i < n_lines % n_nodes ? 1 : 0); n > 1; n--)
+        first = first->next;
+      next = first->next;
+      first->next = NULL;
+      first = next;
+
+      recompute_node_counts (tree, node);
+      prev = node;
+    }
+
+  g_assert (first == NULL);
+
+  recompute_node_counts (tree, leaf);
+
+  parent->num_children += n_nodes;
+  for (node = parent; node != NULL; node = node->parent)
+    {
+      node->num_lines += line_count_delta;
+      node->num_chars += char_count_delta;
+    }
+
+  /* The views haven't seen the new lines yet */
+  gtk_text_btree_node_invalidate_upward (parent, NULL);
+}
+
 static GtkTextTagInfo*
 gtk_text_btree_get_existing_tag_info (GtkTextBTree *tree,
                                       GtkTextTag   *tag)
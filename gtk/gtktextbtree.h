@@ -107,6 +107,11 @@ gboolean     _gtk_text_btree_validate          (GtkTextBTree      *tree,
 void         _gtk_text_btree_validate_line     (GtkTextBTree      *tree,
                                                 GtkTextLine       *line,
                                                 gpointer           view_id);
+GtkTextLine *_gtk_text_btree_find_first_invalid_line (GtkTextBTree *tree,
+                                                     gpointer      view_id);
+void         _gtk_text_btree_line_data_changed (GtkTextBTree      *tree,
+                                                GtkTextLine       *line,
+                                                gpointer           view_id);
 
 /* Tag */
 
@@ -114,6 +119,9 @@ void _gtk_text_btree_tag (const GtkTextIter *start,
                           const GtkTextIter *end,
                           GtkTextTag        *tag,
                           gboolean           apply);
+void _gtk_text_btree_tag_ranges (GtkTextBTree          *tree,
+                                 const GtkTextTagRange *ranges,
+                                 guint                  n_ranges);
 
 /* "Getters" */
 
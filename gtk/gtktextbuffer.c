@@ -1071,6 +1071,336 @@ gtk_text_buffer_set_text (GtkTextBuffer *buffer,
 
  
 
+/*
+ * Loading
+ */
+
+/* How much text gets inserted at once when loading. Every chunk
+ * emits ::insert-text and ::changed once.
+ */
+#define LOAD_CHUNK_SIZE (1024 * 1024)
+
+/* Returns how many bytes from the start of @text to insert next:
+ * everything up to the last newline in the next LOAD_CHUNK_SIZE
+ * bytes. Lines longer than that get split at a character boundary,
+ * but never between \r and \n. If more text is coming, returns 0
+ * when it's better to wait for the rest of the line.
+ */
+static gsize
+load_chunk_length (const char *text,
+                   gsize       len,
+                   gboolean    at_end)
+{
+  gsize i;
+
+  if (at_end && len <= LOAD_CHUNK_SIZE)
+    return len;
+
+  for (i = MIN (len, LOAD_CHUNK_SIZE); i > 0; i--)
+    {
+      if (text[i - 1] == '\n')
+        return i;
+    }
+
+  if (len < LOAD_CHUNK_SIZE)
+    return 0;
+
+  i = g_utf8_find_prev_char (text, text + LOAD_CHUNK_SIZE) - text;
+  if (text[i - 1] == '\r')
+    i--;
+
+  return i;
+}
+
+static void
+set_invalid_utf8_error (GError  **error,
+                        goffset   offset)
+{
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+               _("Invalid UTF-8 data at byte %" G_GOFFSET_FORMAT), offset);
+}
+
+static void
+gtk_text_buffer_load_begin (GtkTextBuffer *buffer)
+{
+  GtkTextIter start, end;
+
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  gtk_text_buffer_delete (buffer, &start, &end);
+}
+
+/* Appends @len bytes of already validated @text at the end of
+ * @buffer, without going through the checks of
+ * gtk_text_buffer_insert().
+ */
+static void
+gtk_text_buffer_load_append (GtkTextBuffer *buffer,
+                             const char    *text,
+                             gsize          len,
+                             gboolean       first)
+{
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  g_signal_emit (buffer, signals[INSERT_TEXT], 0, &iter, text, (gint) len);
+
+  /* Keep the cursor at the start instead of moving it
+   * along with every chunk.
+   */
+  if (first)
+    {
+      gtk_text_buffer_get_start_iter (buffer, &iter);
+      gtk_text_buffer_place_cursor (buffer, &iter);
+    }
+}
+
+static void
+gtk_text_buffer_load_end (GtkTextBuffer *buffer)
+{
+  gtk_text_buffer_set_modified (buffer, FALSE);
+}
+
+/**
+ * gtk_text_buffer_load_bytes:
+ * @buffer: a #GtkTextBuffer
+ * @bytes: UTF-8 text
+ * @error: return location for an error
+ *
+ * Replaces the contents of @buffer with the text in @bytes, placing
+ * the cursor at the start and marking the buffer as unmodified.
+ *
+ * Unlike gtk_text_buffer_set_text(), this works for text of any size
+ * and reports invalid UTF-8 as an error, in which case @buffer isn't
+ * changed. Large text is inserted in chunks of whole lines, with an
+ * emission of #GtkTextBuffer::insert-text for each.
+ *
+ * Returns: %TRUE if the text was loaded
+ */
+gboolean
+gtk_text_buffer_load_bytes (GtkTextBuffer  *buffer,
+                            GBytes         *bytes,
+                            GError        **error)
+{
+  const char *text, *end;
+  gsize len, n;
+  gboolean first;
+
+  g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (bytes != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  text = g_bytes_get_data (bytes, &len);
+
+  if (len > 0 && !g_utf8_validate (text, len, &end))
+    {
+      set_invalid_utf8_error (error, end - text);
+      return FALSE;
+    }
+
+  gtk_text_buffer_load_begin (buffer);
+
+  for (first = TRUE; len > 0; first = FALSE)
+    {
+      n = load_chunk_length (text, len, TRUE);
+      gtk_text_buffer_load_append (buffer, text, n, first);
+      text += n;
+      len -= n;
+    }
+
+  gtk_text_buffer_load_end (buffer);
+
+  return TRUE;
+}
+
+typedef struct
+{
+  GInputStream *stream;
+  GFileProgressCallback progress_callback;
+  gpointer progress_data;
+
+  /* Read, but not inserted yet */
+  GByteArray *pending;
+  goffset n_read;
+  gboolean first;
+} LoadData;
+
+static void
+load_data_free (gpointer data)
+{
+  LoadData *load = data;
+
+  g_object_unref (load->stream);
+  g_byte_array_unref (load->pending);
+
+  g_slice_free (LoadData, load);
+}
+
+static void gtk_text_buffer_load_read_cb (GObject      *source,
+                                          GAsyncResult *result,
+                                          gpointer      data);
+
+static void
+gtk_text_buffer_load_read_next (GTask *task)
+{
+  LoadData *load = g_task_get_task_data (task);
+
+  g_input_stream_read_bytes_async (load->stream,
+                                   LOAD_CHUNK_SIZE,
+                                   g_task_get_priority (task),
+                                   g_task_get_cancellable (task),
+                                   gtk_text_buffer_load_read_cb,
+                                   task);
+}
+
+static void
+gtk_text_buffer_load_read_cb (GObject      *source,
+                              GAsyncResult *result,
+                              gpointer      data)
+{
+  GTask *task = data;
+  GtkTextBuffer *buffer = g_task_get_source_object (task);
+  LoadData *load = g_task_get_task_data (task);
+  GError *error = NULL;
+  GBytes *bytes;
+  const char *text, *end;
+  gsize len, valid, n, inserted;
+  gboolean at_end;
+
+  bytes = g_input_stream_read_bytes_finish (G_INPUT_STREAM (source), result, &error);
+  if (bytes == NULL)
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  at_end = g_bytes_get_size (bytes) == 0;
+  g_byte_array_append (load->pending,
+                       g_bytes_get_data (bytes, NULL),
+                       g_bytes_get_size (bytes));
+  load->n_read += g_bytes_get_size (bytes);
+  g_bytes_unref (bytes);
+
+  text = (const char *) load->pending->data;
+  len = load->pending->len;
+
+  /* The last character may be incomplete, it continues in the next read */
+  if (len > 0 && !g_utf8_validate (text, len, &end) &&
+      (at_end || g_utf8_get_char_validated (end, text + len - end) != (gunichar) -2))
+    {
+      set_invalid_utf8_error (&error, load->n_read - (text + len - end));
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+  valid = len > 0 ? end - text : 0;
+
+  for (inserted = 0; inserted < valid; inserted += n)
+    {
+      n = load_chunk_length (text + inserted, valid - inserted, at_end);
+      if (n == 0)
+        break;
+
+      gtk_text_buffer_load_append (buffer, text + inserted, n, load->first);
+      load->first = FALSE;
+    }
+
+  g_byte_array_remove_range (load->pending, 0, inserted);
+
+  if (load->progress_callback)
+    load->progress_callback (load->n_read, -1, load->progress_data);
+
+  if (at_end)
+    {
+      gtk_text_buffer_load_end (buffer);
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  gtk_text_buffer_load_read_next (task);
+}
+
+/**
+ * gtk_text_buffer_load_stream_async:
+ * @buffer: a #GtkTextBuffer
+ * @stream: a #GInputStream to read UTF-8 text from
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (nullable): optional #GCancellable object, %NULL to ignore
+ * @progress_callback: (nullable) (scope notified): function to call with
+ *   the number of bytes read so far. The total number of bytes passed to
+ *   it is always -1, since it's not known
+ * @progress_data: (closure progress_callback): user data for @progress_callback
+ * @callback: (scope async): callback to call when the text is loaded
+ * @user_data: (closure): the data to pass to the callback function
+ *
+ * Asynchronously replaces the contents of @buffer with the text read
+ * from @stream, like gtk_text_buffer_load_bytes() does.
+ *
+ * The buffer is cleared right away and the text is inserted as it
+ * arrives, so the beginning can be shown while the rest is loading.
+ * If loading fails, the buffer keeps the text that was loaded.
+ *
+ * When the operation is finished, @callback will be called. You
+ * can then call gtk_text_buffer_load_stream_finish() to get the
+ * result of the operation.
+ */
+void
+gtk_text_buffer_load_stream_async (GtkTextBuffer         *buffer,
+                                   GInputStream          *stream,
+                                   int                    io_priority,
+                                   GCancellable          *cancellable,
+                                   GFileProgressCallback  progress_callback,
+                                   gpointer               progress_data,
+                                   GAsyncReadyCallback    callback,
+                                   gpointer               user_data)
+{
+  LoadData *load;
+  GTask *task;
+
+  g_return_if_fail (GTK_IS_TEXT_BUFFER (buffer));
+  g_return_if_fail (G_IS_INPUT_STREAM (stream));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  load = g_slice_new0 (LoadData);
+  load->stream = g_object_ref (stream);
+  load->progress_callback = progress_callback;
+  load->progress_data = progress_data;
+  load->pending = g_byte_array_new ();
+  load->first = TRUE;
+
+  task = g_task_new (buffer, cancellable, callback, user_data);
+  g_task_set_priority (task, io_priority);
+  g_task_set_source_tag (task, gtk_text_buffer_load_stream_async);
+  g_task_set_task_data (task, load, load_data_free);
+
+  gtk_text_buffer_load_begin (buffer);
+
+  gtk_text_buffer_load_read_next (task);
+}
+
+/**
+ * gtk_text_buffer_load_stream_finish:
+ * @buffer: a #GtkTextBuffer
+ * @result: a #GAsyncResult
+ * @error: return location for an error
+ *
+ * Finishes an asynchronous load started with
+ * gtk_text_buffer_load_stream_async().
+ *
+ * Returns: %TRUE if the whole stream was loaded
+ */
+gboolean
+gtk_text_buffer_load_stream_finish (GtkTextBuffer  *buffer,
+                                    GAsyncResult   *result,
+                                    GError        **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, buffer), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gtk_text_buffer_load_stream_async, FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 /*
  * Insertion
  */
@@ -3037,6 +3367,56 @@ gtk_text_buffer_remove_all_tags (GtkTextBuffer     *buffer,
   g_slist_free_full (tags, g_object_unref);
 }
 
+/**
+ * gtk_text_buffer_apply_tag_ranges:
+ * @buffer: a #GtkTextBuffer
+ * @ranges: (array length=n_ranges): the ranges to tag
+ * @n_ranges: the number of ranges
+ *
+ * Applies tags to many ranges of text at once. This has the same
+ * effect as calling gtk_text_buffer_apply_tag() for each range, but
+ * all ranges are tagged in a single pass over the buffer and the
+ * display is updated only once, which makes a big difference for
+ * syntax highlighters that tag thousands of small ranges.
+ *
+ * The ranges are given as character offsets, and should be sorted
+ * by their start. Ranges may overlap.
+ *
+ * The #GtkTextBuffer::apply-tag signal is only emitted for each of
+ * the ranges if there are handlers connected to it.
+ **/
+void
+gtk_text_buffer_apply_tag_ranges (GtkTextBuffer         *buffer,
+                                  const GtkTextTagRange *ranges,
+                                  guint                  n_ranges)
+{
+  GtkTextIter start, end;
+  guint i;
+
+  g_return_if_fail (GTK_IS_TEXT_BUFFER (buffer));
+  g_return_if_fail (ranges != NULL || n_ranges == 0);
+
+  for (i = 0; i < n_ranges; i++)
+    {
+      g_return_if_fail (GTK_IS_TEXT_TAG (ranges[i].tag));
+      g_return_if_fail (ranges[i].tag->priv->table == buffer->priv->tag_table);
+    }
+
+  if (GTK_TEXT_BUFFER_GET_CLASS (buffer)->apply_tag != gtk_text_buffer_real_apply_tag ||
+      g_signal_has_handler_pending (buffer, signals[APPLY_TAG], 0, FALSE))
+    {
+      for (i = 0; i < n_ranges; i++)
+        {
+          gtk_text_buffer_get_iter_at_offset (buffer, &start, ranges[i].start);
+          gtk_text_buffer_get_iter_at_offset (buffer, &end, ranges[i].end);
+          gtk_text_buffer_emit_tag (buffer, ranges[i].tag, TRUE, &start, &end);
+        }
+      return;
+    }
+
+  _gtk_text_btree_tag_ranges (get_btree (buffer), ranges, n_ranges);
+}
+
 
 /*
  * Obtain various iterators
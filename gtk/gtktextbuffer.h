@@ -62,6 +62,23 @@ typedef enum
   GTK_TEXT_BUFFER_TARGET_INFO_TEXT            = - 3
 } GtkTextBufferTargetInfo;
 
+/**
+ * GtkTextTagRange:
+ * @tag: the tag to apply
+ * @start: character offset of the start of the range
+ * @end: character offset of the end of the range
+ *
+ * A range of text to tag, used with gtk_text_buffer_apply_tag_ranges().
+ */
+typedef struct _GtkTextTagRange GtkTextTagRange;
+
+struct _GtkTextTagRange
+{
+  GtkTextTag *tag;
+  gint start;
+  gint end;
+};
+
 typedef struct _GtkTextBTree GtkTextBTree;
 
 #define GTK_TYPE_TEXT_BUFFER            (gtk_text_buffer_get_type ())
@@ -179,6 +196,25 @@ void gtk_text_buffer_set_text          (GtkTextBuffer *buffer,
                                         const gchar   *text,
                                         gint           len);
 
+/* Load into the buffer */
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_buffer_load_bytes         (GtkTextBuffer          *buffer,
+                                             GBytes                 *bytes,
+                                             GError                **error);
+GDK_AVAILABLE_IN_ALL
+void     gtk_text_buffer_load_stream_async  (GtkTextBuffer          *buffer,
+                                             GInputStream           *stream,
+                                             int                     io_priority,
+                                             GCancellable           *cancellable,
+                                             GFileProgressCallback   progress_callback,
+                                             gpointer                progress_data,
+                                             GAsyncReadyCallback     callback,
+                                             gpointer                user_data);
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_buffer_load_stream_finish (GtkTextBuffer          *buffer,
+                                             GAsyncResult           *result,
+                                             GError                **error);
+
 /* Insert into the buffer */
 GDK_AVAILABLE_IN_ALL
 void gtk_text_buffer_insert            (GtkTextBuffer *buffer,
@@ -352,6 +388,10 @@ GDK_AVAILABLE_IN_ALL
 void gtk_text_buffer_remove_all_tags       (GtkTextBuffer     *buffer,
                                             const GtkTextIter *start,
                                             const GtkTextIter *end);
+GDK_AVAILABLE_IN_ALL
+void gtk_text_buffer_apply_tag_ranges      (GtkTextBuffer         *buffer,
+                                            const GtkTextTagRange *ranges,
+                                            guint                  n_ranges);
 
 
 /* You can either ignore the return value, or use it to
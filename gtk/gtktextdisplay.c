@@ -558,19 +558,27 @@ get_selected_clip (GtkTextRenderer    *text_renderer,
   return clip_region;
 }
 
+/* Renders @layout, which is either the layout of @line_display or
+ * the one of the chunk of it starting at byte @start and @y pixels
+ * below the top of its text, with @last telling whether that is
+ * the last chunk.
+ */
 static void
 render_para (GtkTextRenderer    *text_renderer,
              GtkTextLineDisplay *line_display,
+             PangoLayout        *layout,
+             int                 start,
+             int                 y,
+             gboolean            last,
              int                 selection_start_index,
              int                 selection_end_index)
 {
   GtkStyleContext *context;
-  PangoLayout *layout = line_display->layout;
-  int byte_offset = 0;
+  int byte_offset = start;
   PangoLayoutIter *iter;
   int screen_width;
   GdkRGBA selection;
-  gboolean first = TRUE;
+  gboolean first = start == 0;
   GtkCssNode *selection_node;
 
   iter = pango_layout_get_iter (layout);
@@ -602,13 +610,13 @@ G_GNUC_END_IGNORE_DEPRECATIONS
       /* Adjust for margins */
 
       line_rect.x += line_display->x_offset * PANGO_SCALE;
-      line_rect.y += line_display->top_margin * PANGO_SCALE;
-      baseline += line_display->top_margin * PANGO_SCALE;
+      line_rect.y += (line_display->top_margin + y) * PANGO_SCALE;
+      baseline += (line_display->top_margin + y) * PANGO_SCALE;
 
       /* Selection is the height of the line, plus top/bottom
        * margin if we're the first/last line
        */
-      selection_y = PANGO_PIXELS (first_y) + line_display->top_margin;
+      selection_y = PANGO_PIXELS (first_y) + line_display->top_margin + y;
       selection_height = PANGO_PIXELS (last_y) - PANGO_PIXELS (first_y);
 
       if (first)
@@ -617,7 +625,7 @@ G_GNUC_END_IGNORE_DEPRECATIONS
           selection_height += line_display->top_margin;
         }
 
-      at_last_line = pango_layout_iter_at_last_line (iter);
+      at_last_line = last && pango_layout_iter_at_last_line (iter);
       if (at_last_line)
         selection_height += line_display->bottom_margin;
       
@@ -670,7 +678,7 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 	   * paragraph counts as part of the line for this
 	   */
           if ((selection_start_index < byte_offset + line->length ||
-	       (selection_start_index == byte_offset + line->length && pango_layout_iter_at_last_line (iter))) &&
+	       (selection_start_index == byte_offset + line->length && at_last_line)) &&
 	      selection_end_index > byte_offset)
             {
               cairo_t *cr = text_renderer->cr;
@@ -678,7 +686,8 @@ G_GNUC_END_IGNORE_DEPRECATIONS
                                                           line_display->x_offset,
                                                           selection_y,
                                                           selection_height,
-                                                          selection_start_index, selection_end_index);
+                                                          selection_start_index - start,
+                                                          selection_end_index - start);
 
               cairo_save (cr);
               gdk_cairo_region (cr, clip_region);
@@ -811,6 +820,111 @@ get_text_renderer (void)
   return text_renderer;
 }
 
+/* Checks whether the colors we draw with changed since the
+ * render nodes of the cached line displays were created and
+ * makes sure they get redrawn if so. Everything else that
+ * affects rendering invalidates the line displays.
+ */
+static void
+update_node_colors (GtkTextLayout *layout,
+                    GtkWidget     *widget)
+{
+  GtkStyleContext *context;
+  GdkRGBA *selection_fg, *selection_bg;
+  GdkRGBA fg;
+
+  context = gtk_widget_get_style_context (widget);
+
+  gtk_style_context_save_to_node (context, gtk_text_view_get_text_node ((GtkTextView *)widget));
+  gtk_style_context_get_color (context, &fg);
+  gtk_style_context_restore (context);
+
+  gtk_style_context_save_to_node (context, gtk_text_view_get_selection_node ((GtkTextView *)widget));
+  gtk_style_context_get (context,
+                         "color", &selection_fg,
+                         "background-color", &selection_bg,
+                         NULL);
+  gtk_style_context_restore (context);
+
+  if (!gdk_rgba_equal (&fg, &layout->node_fg_rgba) ||
+      !gdk_rgba_equal (selection_fg, &layout->node_selection_fg_rgba) ||
+      !gdk_rgba_equal (selection_bg, &layout->node_selection_bg_rgba))
+    {
+      layout->node_fg_rgba = fg;
+      layout->node_selection_fg_rgba = *selection_fg;
+      layout->node_selection_bg_rgba = *selection_bg;
+      layout->node_serial++;
+    }
+
+  gdk_rgba_free (selection_fg);
+  gdk_rgba_free (selection_bg);
+}
+
+static guint n_rendered_nodes = 0;
+
+/* Renders @pango_layout, see render_para(). The node covers the
+ * whole line display if it has a single layout.
+ */
+static GskRenderNode *
+render_line_display (GtkTextRenderer    *text_renderer,
+                     GtkWidget          *widget,
+                     GtkTextLayout      *layout,
+                     GtkTextLineDisplay *line_display,
+                     PangoLayout        *pango_layout,
+                     int                 start,
+                     int                 y,
+                     gboolean            last,
+                     int                 selection_start_index,
+                     int                 selection_end_index)
+{
+  GskRenderNode *node;
+  PangoRectangle ink, logical;
+  int x1, y1, x2, y2;
+  int top, bottom;
+  cairo_t *cr;
+
+  n_rendered_nodes++;
+
+  /* Cover the whole line, not just the visible part, so the
+   * node can be reused when scrolling horizontally.
+   */
+  pango_layout_get_pixel_extents (pango_layout, &ink, &logical);
+  top = start == 0 ? 0 : line_display->top_margin + y;
+  bottom = last ? line_display->height : line_display->top_margin + y + logical.height;
+  x1 = MIN (0, line_display->x_offset + ink.x);
+  y1 = MIN (top, line_display->top_margin + y + ink.y);
+  x2 = MAX (MAX (layout->screen_width, layout->width),
+            line_display->x_offset + ink.x + ink.width);
+  y2 = MAX (bottom,
+            line_display->top_margin + y + ink.y + ink.height);
+
+  node = gsk_cairo_node_new (&GRAPHENE_RECT_INIT (x1, y1, x2 - x1, y2 - y1));
+  cr = gsk_cairo_node_get_draw_context (node);
+
+  text_renderer_begin (text_renderer, widget, cr);
+  render_para (text_renderer, line_display, pango_layout, start, y, last,
+               selection_start_index, selection_end_index);
+  text_renderer_end (text_renderer);
+
+  cairo_destroy (cr);
+
+  return node;
+}
+
+/*
+ * gtk_text_layout_get_render_stats:
+ * @rendered: (out) (optional): number of render nodes that were
+ *     rendered for paragraphs or chunks of paragraphs
+ *
+ * Gets statistics about render node reuse. This is meant for tests.
+ */
+void
+gtk_text_layout_get_render_stats (guint *rendered)
+{
+  if (rendered)
+    *rendered = n_rendered_nodes;
+}
+
 void
 gtk_text_layout_snapshot (GtkTextLayout      *layout,
                           GtkWidget          *widget,
@@ -824,7 +938,7 @@ gtk_text_layout_snapshot (GtkTextLayout      *layout,
   gboolean have_selection;
   GSList *line_list;
   GSList *tmp_list;
-  cairo_t *cr;
+  guint n_lines;
 
   g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
   g_return_if_fail (layout->default_style != NULL);
@@ -838,13 +952,15 @@ gtk_text_layout_snapshot (GtkTextLayout      *layout,
   if (line_list == NULL)
     return; /* nothing on the screen */
 
-  cr = gtk_snapshot_append_cairo (snapshot,
-                                  &GRAPHENE_RECT_INIT(clip->x, clip->y, clip->width, clip->height));
+  /* Keep the visible lines and some margin for scrolling cached */
+  n_lines = g_slist_length (line_list);
+  gtk_text_layout_set_display_cache_lines (layout, n_lines);
+
+  update_node_colors (layout, widget);
+
   text_renderer = get_text_renderer ();
-  text_renderer_begin (text_renderer, widget, cr);
 
-  /* text_renderer_begin/end does cairo_save/restore */
-  cairo_translate (cr, 0, offset_y);
+  gtk_snapshot_offset (snapshot, 0, offset_y);
 
   gtk_text_layout_wrap_loop_start (layout);
 
@@ -852,17 +968,26 @@ gtk_text_layout_snapshot (GtkTextLayout      *layout,
                                                          &selection_start,
                                                          &selection_end);
 
+  gtk_style_context_save_to_node (context, gtk_text_view_get_text_node ((GtkTextView *)widget));
+
   tmp_list = line_list;
   while (tmp_list != NULL)
     {
       GtkTextLineDisplay *line_display;
       gint selection_start_index = -1;
       gint selection_end_index = -1;
+      gint height;
 
       GtkTextLine *line = tmp_list->data;
 
       line_display = gtk_text_layout_get_line_display (layout, line, FALSE);
 
+      /* Shaping chunks of long paragraphs can change the height of
+       * the display, but the lines below only move when the layout
+       * gets revalidated.
+       */
+      height = line_display->height;
+
       if (line_display->height > 0)
         {
           g_assert (line_display->layout != NULL);
@@ -895,8 +1020,71 @@ gtk_text_layout_snapshot (GtkTextLayout      *layout,
                 }
             }
 
-          render_para (text_renderer, line_display,
-                       selection_start_index, selection_end_index);
+          /* Reuse the paragraph we rendered last time if nothing
+           * changed. The block cursor depends on focus, so lines
+           * with it are always rendered.
+           */
+          if (line_display->chunks != NULL)
+            {
+              guint i;
+
+              /* Only the chunks of long paragraphs that show get
+               * shaped and rendered.
+               */
+              for (i = 0; i < line_display->chunks->len; i++)
+                {
+                  GtkTextLineChunk *chunk = &g_array_index (line_display->chunks, GtkTextLineChunk, i);
+                  gint chunk_top = offset_y + line_display->top_margin + chunk->y;
+                  gboolean last = i + 1 == line_display->chunks->len;
+                  PangoLayout *pango_layout;
+
+                  if (chunk_top >= clip->y + clip->height)
+                    break;
+
+                  if (chunk_top + chunk->height <= clip->y)
+                    continue;
+
+                  pango_layout = _gtk_text_layout_get_chunk_layout (layout, line_display, i);
+
+                  if (chunk->node == NULL ||
+                      chunk->node_serial != layout->node_serial ||
+                      chunk->node_selection_start != selection_start_index ||
+                      chunk->node_selection_end != selection_end_index ||
+                      (line_display->has_block_cursor &&
+                       _gtk_text_line_display_get_chunk_at_index (line_display,
+                                                                  line_display->insert_index) == i))
+                    {
+                      g_clear_pointer (&chunk->node, gsk_render_node_unref);
+                      chunk->node = render_line_display (text_renderer, widget, layout, line_display,
+                                                         pango_layout, chunk->start, chunk->y, last,
+                                                         selection_start_index, selection_end_index);
+                      chunk->node_serial = layout->node_serial;
+                      chunk->node_selection_start = selection_start_index;
+                      chunk->node_selection_end = selection_end_index;
+                    }
+
+                  gtk_snapshot_append_node (snapshot, chunk->node);
+                }
+            }
+          else
+            {
+              if (line_display->node == NULL ||
+                  line_display->node_serial != layout->node_serial ||
+                  line_display->node_selection_start != selection_start_index ||
+                  line_display->node_selection_end != selection_end_index ||
+                  line_display->has_block_cursor)
+                {
+                  g_clear_pointer (&line_display->node, gsk_render_node_unref);
+                  line_display->node = render_line_display (text_renderer, widget, layout, line_display,
+                                                            line_display->layout, 0, 0, TRUE,
+                                                            selection_start_index, selection_end_index);
+                  line_display->node_serial = layout->node_serial;
+                  line_display->node_selection_start = selection_start_index;
+                  line_display->node_selection_end = selection_end_index;
+                }
+
+              gtk_snapshot_append_node (snapshot, line_display->node);
+            }
 
           /* We paint the cursors last, because they overlap another chunk
            * and need to appear on top.
@@ -908,27 +1096,48 @@ gtk_text_layout_snapshot (GtkTextLayout      *layout,
               for (i = 0; i < line_display->cursors->len; i++)
                 {
                   int index;
+                  int cursor_y;
+                  PangoLayout *pango_layout;
                   PangoDirection dir;
 
                   index = g_array_index(line_display->cursors, int, i);
+                  pango_layout = line_display->layout;
+                  cursor_y = line_display->top_margin;
+
+                  if (line_display->chunks != NULL)
+                    {
+                      guint c = _gtk_text_line_display_get_chunk_at_index (line_display, index);
+                      GtkTextLineChunk *chunk = &g_array_index (line_display->chunks, GtkTextLineChunk, c);
+
+                      cursor_y += chunk->y;
+                      if (offset_y + cursor_y >= clip->y + clip->height ||
+                          offset_y + cursor_y + chunk->height <= clip->y)
+                        continue;
+
+                      pango_layout = _gtk_text_layout_get_chunk_layout (layout, line_display, c);
+                      index -= chunk->start;
+                    }
+
                   dir = (line_display->direction == GTK_TEXT_DIR_RTL) ? PANGO_DIRECTION_RTL : PANGO_DIRECTION_LTR;
-                  gtk_render_insertion_cursor (context, cr,
-                                               line_display->x_offset, line_display->top_margin,
-                                               line_display->layout, index, dir);
+                  gtk_snapshot_render_insertion_cursor (snapshot, context,
+                                                        line_display->x_offset, cursor_y,
+                                                        pango_layout, index, dir);
                 }
             }
         } /* line_display->height > 0 */
 
-      cairo_translate (cr, 0, line_display->height);
+      gtk_snapshot_offset (snapshot, 0, height);
+      offset_y += height;
       gtk_text_layout_free_line_display (layout, line_display);
       
       tmp_list = tmp_list->next;
     }
 
+  gtk_style_context_restore (context);
+
   gtk_text_layout_wrap_loop_end (layout);
-  text_renderer_end (text_renderer);
 
-  g_slist_free (line_list);
+  gtk_snapshot_offset (snapshot, 0, - offset_y);
 
-  cairo_destroy (cr);
+  g_slist_free (line_list);
 }
@@ -95,6 +95,9 @@ void gtk_text_layout_snapshot (GtkTextLayout        *layout,
                                GtkSnapshot          *snapshot,
                                const GdkRectangle   *clip);
 
+GDK_AVAILABLE_IN_ALL
+void gtk_text_layout_get_render_stats (guint *rendered);
+
 
 G_END_DECLS
 
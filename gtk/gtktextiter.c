@@ -5311,6 +5311,354 @@ gtk_text_iter_backward_search (const GtkTextIter *iter,
   return retval;
 }
 
+/*
+ * Searching for all matches
+ */
+
+typedef struct
+{
+  const gchar *str;
+  gsize len;
+  guint n_chars;
+  guint n_newlines;
+  GtkTextSearchFlags flags;
+  guint fast : 1;        /* lines can be searched in place */
+  guint ascii_fold : 1;  /* case insensitive search for an ASCII string */
+  gchar *folded;         /* @str in ASCII lowercase when folding */
+  GString *line;         /* text of lines spread over several segments */
+  GString *fold;         /* folded text of the current line */
+  GArray *matches;
+} SearchAll;
+
+/* Like memmem(), memchr() is vectorized by the C library, so let it
+ * skip to the candidates.
+ */
+static const gchar *
+find_bytes (const gchar *haystack,
+            gsize        haystack_len,
+            const gchar *needle,
+            gsize        needle_len)
+{
+  const gchar *p, *last;
+
+  if (haystack_len < needle_len)
+    return NULL;
+
+  p = haystack;
+  last = haystack + haystack_len - needle_len;
+
+  while (p <= last)
+    {
+      p = memchr (p, needle[0], last - p + 1);
+      if (p == NULL)
+        return NULL;
+
+      if (memcmp (p + 1, needle + 1, needle_len - 1) == 0)
+        return p;
+
+      p++;
+    }
+
+  return NULL;
+}
+
+static void
+search_all_add_match (SearchAll *search,
+                      guint      start,
+                      guint      end)
+{
+  guint offsets[2] = { start, end };
+
+  g_array_append_vals (search->matches, offsets, 2);
+}
+
+/* Looks for matches between @start and @end on the same line,
+ * directly in the char segments of the line. Returns %FALSE if the
+ * line needs the generic search.
+ */
+static gboolean
+search_all_in_line (SearchAll         *search,
+                    const GtkTextIter *start,
+                    const GtkTextIter *end)
+{
+  GtkTextLine *line;
+  GtkTextLineSegment *seg;
+  const gchar *text, *chars, *haystack, *needle, *p, *found;
+  gsize text_len, chars_len, haystack_len, i;
+  guint n_pieces, offset;
+  gint start_index, end_index;
+
+  line = _gtk_text_iter_get_text_line (start);
+
+  /* Use the text in place when the line is a single char segment,
+   * which is the common case. Paintables and child anchors are
+   * U+FFFC like in gtk_text_iter_get_slice().
+   */
+  text = NULL;
+  text_len = 0;
+  n_pieces = 0;
+  g_string_truncate (search->line, 0);
+
+  for (seg = line->segments; seg != NULL; seg = seg->next)
+    {
+      if (seg->type == &gtk_text_char_type)
+        {
+          chars = seg->body.chars;
+          chars_len = seg->byte_count;
+        }
+      else if (seg->char_count > 0)
+        {
+          if (search->flags & GTK_TEXT_SEARCH_TEXT_ONLY)
+            return FALSE;
+
+          chars = _gtk_text_unknown_char_utf8;
+          chars_len = GTK_TEXT_UNKNOWN_CHAR_UTF8_LEN;
+        }
+      else
+        continue;
+
+      if (n_pieces == 0)
+        {
+          text = chars;
+          text_len = chars_len;
+        }
+      else
+        {
+          if (n_pieces == 1)
+            g_string_append_len (search->line, text, text_len);
+          g_string_append_len (search->line, chars, chars_len);
+        }
+
+      n_pieces++;
+    }
+
+  if (n_pieces > 1)
+    {
+      text = search->line->str;
+      text_len = search->line->len;
+    }
+
+  start_index = gtk_text_iter_get_line_index (start);
+  if (_gtk_text_iter_get_text_line (end) == line)
+    end_index = gtk_text_iter_get_line_index (end);
+  else
+    end_index = text_len;
+
+  haystack = text + start_index;
+  haystack_len = end_index - start_index;
+  needle = search->str;
+
+  if (search->ascii_fold)
+    {
+      for (i = 0; i < haystack_len; i++)
+        {
+          if (haystack[i] & 0x80)
+            return FALSE;
+        }
+
+      g_string_set_size (search->fold, haystack_len);
+      for (i = 0; i < haystack_len; i++)
+        search->fold->str[i] = g_ascii_tolower (haystack[i]);
+
+      haystack = search->fold->str;
+      needle = search->folded;
+    }
+
+  offset = gtk_text_iter_get_offset (start);
+  p = haystack;
+
+  while ((found = find_bytes (p, haystack + haystack_len - p, needle, search->len)))
+    {
+      offset += g_utf8_strlen (p, found - p);
+      search_all_add_match (search, offset, offset + search->n_chars);
+      offset += search->n_chars;
+      p = found + search->len;
+    }
+
+  return TRUE;
+}
+
+/* Finds the matches that start between @start and @stop with
+ * gtk_text_iter_forward_search() and sets @resume to where the
+ * search continues.
+ */
+static void
+search_all_generic (SearchAll         *search,
+                    const GtkTextIter *start,
+                    const GtkTextIter *stop,
+                    const GtkTextIter *limit,
+                    GtkTextIter       *resume)
+{
+  GtkTextIter iter, search_limit, match_start, match_end;
+  guint i;
+
+  /* A match that starts before @stop ends at most that many lines later */
+  search_limit = *stop;
+  for (i = 0; i < search->n_newlines; i++)
+    {
+      if (!gtk_text_iter_forward_line (&search_limit))
+        break;
+    }
+  if (gtk_text_iter_compare (&search_limit, limit) > 0)
+    search_limit = *limit;
+
+  iter = *start;
+  while (gtk_text_iter_forward_search (&iter, search->str, search->flags,
+                                       &match_start, &match_end, &search_limit) &&
+         gtk_text_iter_compare (&match_start, stop) < 0)
+    {
+      search_all_add_match (search,
+                            gtk_text_iter_get_offset (&match_start),
+                            gtk_text_iter_get_offset (&match_end));
+      iter = match_end;
+    }
+
+  if (gtk_text_iter_compare (&iter, stop) > 0)
+    *resume = iter;
+  else
+    *resume = *stop;
+}
+
+/**
+ * gtk_text_iter_forward_search_all:
+ * @iter: start of search, set to where the search continues
+ * @str: a search string
+ * @flags: flags affecting how the search is done
+ * @limit: (allow-none): end of the search, or %NULL for the end of the buffer
+ * @max_chars: number of characters to look at before returning,
+ *   or 0 to search up to @limit
+ * @matches: (element-type guint): array to append the matches to
+ *
+ * Searches forward for all non-overlapping occurrences of @str
+ * and appends the character offsets of their start and end to
+ * @matches, which must be an array of #guint. The matches are found
+ * the same way as with gtk_text_iter_forward_search(), but text is
+ * searched directly in the buffer where possible, which makes this
+ * much faster than calling gtk_text_iter_forward_search() repeatedly,
+ * for example to highlight all occurrences of a word.
+ *
+ * If @max_chars is positive, the search stops at the first line
+ * boundary after that many characters were searched. @iter is then
+ * moved to where the search should continue and %TRUE is returned,
+ * so that a long search can be done in steps, e.g. in an idle
+ * handler. Otherwise, @iter is moved to @limit and %FALSE is
+ * returned.
+ *
+ * Like with gtk_text_iter_forward_search(), matches have to end
+ * before @limit. An empty @str does not match anything.
+ *
+ * Returns: whether the search needs to be continued
+ **/
+gboolean
+gtk_text_iter_forward_search_all (GtkTextIter        *iter,
+                                  const gchar        *str,
+                                  GtkTextSearchFlags  flags,
+                                  const GtkTextIter  *limit,
+                                  gint                max_chars,
+                                  GArray             *matches)
+{
+  SearchAll search;
+  GtkTextIter end, line_end, resume;
+  const gchar *p;
+  gboolean more;
+  gint scanned;
+
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (str != NULL, FALSE);
+  g_return_val_if_fail (matches != NULL, FALSE);
+  g_return_val_if_fail (g_array_get_element_size (matches) == sizeof (guint), FALSE);
+
+  if (limit)
+    end = *limit;
+  else
+    {
+      end = *iter;
+      gtk_text_iter_forward_to_end (&end);
+    }
+
+  if (gtk_text_iter_compare (iter, &end) >= 0)
+    return FALSE;
+
+  if (*str == '\0')
+    {
+      *iter = end;
+      return FALSE;
+    }
+
+  memset (&search, 0, sizeof (search));
+  search.str = str;
+  search.len = strlen (str);
+  search.n_chars = g_utf8_strlen (str, -1);
+  search.flags = flags;
+  search.matches = matches;
+
+  search.fast = (flags & GTK_TEXT_SEARCH_VISIBLE_ONLY) == 0;
+  for (p = str; *p; p++)
+    {
+      if (*p == '\n')
+        {
+          search.n_newlines++;
+          search.fast = FALSE;
+        }
+    }
+
+  if (flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE)
+    {
+      for (p = str; *p; p++)
+        {
+          if (*p & 0x80)
+            break;
+        }
+
+      /* Full Unicode case folding can change the length of the text,
+       * leave that to the generic search.
+       */
+      if (*p == '\0')
+        {
+          search.ascii_fold = TRUE;
+          search.folded = g_ascii_strdown (str, -1);
+        }
+      else
+        search.fast = FALSE;
+    }
+
+  search.line = g_string_new (NULL);
+  search.fold = g_string_new (NULL);
+
+  more = FALSE;
+  scanned = 0;
+
+  while (gtk_text_iter_compare (iter, &end) < 0)
+    {
+      if (max_chars > 0 && scanned >= max_chars)
+        {
+          more = TRUE;
+          break;
+        }
+
+      line_end = *iter;
+      gtk_text_iter_forward_line (&line_end);
+      if (gtk_text_iter_compare (&line_end, &end) > 0)
+        line_end = end;
+
+      scanned += gtk_text_iter_get_offset (&line_end) - gtk_text_iter_get_offset (iter);
+
+      if (search.fast && search_all_in_line (&search, iter, &line_end))
+        *iter = line_end;
+      else
+        {
+          search_all_generic (&search, iter, &line_end, &end, &resume);
+          *iter = resume;
+        }
+    }
+
+  g_string_free (search.line, TRUE);
+  g_string_free (search.fold, TRUE);
+  g_free (search.folded);
+
+  return more;
+}
+
 /*
  * Comparisons
  */
@@ -384,6 +384,14 @@ gboolean gtk_text_iter_backward_search (const GtkTextIter *iter,
                                         GtkTextIter       *match_end,
                                         const GtkTextIter *limit);
 
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_iter_forward_search_all (GtkTextIter        *iter,
+                                           const gchar        *str,
+                                           GtkTextSearchFlags  flags,
+                                           const GtkTextIter  *limit,
+                                           gint                max_chars,
+                                           GArray             *matches);
+
 /*
  * Comparisons
  */
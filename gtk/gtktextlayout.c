@@ -97,6 +97,24 @@ struct _GtkTextLayoutPrivate
      direction only influences the direction of the cursor line.
   */
   GtkTextLine *cursor_line;
+
+  /* Measuring invalid lines in worker threads, see
+   * gtk_text_layout_validate_in_thread(). Invalidating a line drops
+   * it from measure_lines, so only its result gets thrown away.
+   * Changes to the whole layout bump measure_serial instead, which
+   * makes results of running jobs stale.
+   */
+  GCancellable *measure_cancellable;
+  guint measure_serial;
+  guint n_measure_jobs;
+  GHashTable *measure_lines; /* GtkTextLine => MeasureJob measuring it */
+  GtkTextLine *measure_line; /* next line to look at, or NULL */
+  guint measure_in_thread : 1;
+
+  /* Sizes of the shaped chunks of long paragraphs, so they survive
+   * their line displays. Dropped when the line is invalidated.
+   */
+  GHashTable *chunk_sizes; /* GtkTextLine => GArray of ChunkSize */
 };
 
 static GtkTextLineData *gtk_text_layout_real_wrap (GtkTextLayout *layout,
@@ -117,6 +135,10 @@ static void gtk_text_layout_invalidate_cache       (GtkTextLayout     *layout,
 						    gboolean           cursors_only);
 static void gtk_text_layout_invalidate_cursor_line (GtkTextLayout     *layout,
 						    gboolean           cursors_only);
+static void gtk_text_layout_clear_display_cache    (GtkTextLayout     *layout);
+static void gtk_text_layout_cancel_measuring       (GtkTextLayout     *layout);
+static void gtk_text_layout_forget_measuring       (GtkTextLayout     *layout,
+                                                    GtkTextLine       *line);
 static void gtk_text_layout_real_free_line_data    (GtkTextLayout     *layout,
 						    GtkTextLine       *line,
 						    GtkTextLineData   *line_data);
@@ -127,6 +149,17 @@ static void gtk_text_layout_emit_changed           (GtkTextLayout     *layout,
 
 static void gtk_text_layout_invalidate_all (GtkTextLayout *layout);
 
+static PangoLayout *line_display_get_layout_at_index (GtkTextLayout      *layout,
+                                                      GtkTextLineDisplay *display,
+                                                      gint                index,
+                                                      gint               *start,
+                                                      gint               *y);
+static gboolean gtk_text_layout_shape_visible_chunks (GtkTextLayout   *layout,
+                                                      GtkTextLine     *line,
+                                                      GtkTextLineData *line_data,
+                                                      gint             top,
+                                                      gint             bottom);
+
 static PangoAttribute *gtk_text_attr_appearance_new (const GtkTextAppearance *appearance);
 
 static void gtk_text_layout_mark_set_handler    (GtkTextBuffer     *buffer,
@@ -169,6 +202,12 @@ enum {
 
 #define PIXEL_BOUND(d) (((d) + PANGO_SCALE - 1) / PANGO_SCALE)
 
+/* The minimum number of line displays we keep cached. Drawing
+ * raises the limit to cover what is visible on screen, see
+ * gtk_text_layout_set_display_cache_lines().
+ */
+#define DEFAULT_DISPLAY_CACHE_SIZE 64
+
 static guint signals[LAST_SIGNAL] = { 0 };
 
 PangoAttrType gtk_text_attr_appearance_type = 0;
@@ -193,12 +232,8 @@ gtk_text_layout_dispose (GObject *object)
   g_clear_object (&layout->ltr_context);
   g_clear_object (&layout->rtl_context);
 
-  if (layout->one_display_cache)
-    {
-      GtkTextLineDisplay *tmp_display = layout->one_display_cache;
-      layout->one_display_cache = NULL;
-      gtk_text_layout_free_line_display (layout, tmp_display);
-    }
+  gtk_text_layout_clear_display_cache (layout);
+  gtk_text_layout_cancel_measuring (layout);
 
   if (layout->preedit_attrs != NULL)
     {
@@ -213,11 +248,17 @@ static void
 gtk_text_layout_finalize (GObject *object)
 {
   GtkTextLayout *layout;
+  GtkTextLayoutPrivate *priv;
 
   layout = GTK_TEXT_LAYOUT (object);
+  priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
 
   g_free (layout->preedit_string);
 
+  g_hash_table_unref (layout->display_cache);
+  g_hash_table_unref (priv->chunk_sizes);
+  g_hash_table_unref (priv->measure_lines);
+
   G_OBJECT_CLASS (gtk_text_layout_parent_class)->finalize (object);
 }
 
@@ -276,7 +317,15 @@ gtk_text_layout_class_init (GtkTextLayoutClass *klass)
 static void
 gtk_text_layout_init (GtkTextLayout *text_layout)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (text_layout);
+
   text_layout->cursor_visible = TRUE;
+
+  text_layout->display_cache = g_hash_table_new (NULL, NULL);
+  text_layout->display_cache_size = DEFAULT_DISPLAY_CACHE_SIZE;
+
+  priv->chunk_sizes = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+  priv->measure_lines = g_hash_table_new (NULL, NULL);
 }
 
 GtkTextLayout*
@@ -310,6 +359,8 @@ gtk_text_layout_set_buffer (GtkTextLayout *layout,
     return;
 
   free_style_cache (layout);
+  gtk_text_layout_clear_display_cache (layout);
+  gtk_text_layout_cancel_measuring (layout);
 
   if (layout->buffer)
     {
@@ -635,17 +686,22 @@ text_layout_changed (GtkTextLayout *layout,
                      gint           new_height,
                      gboolean       cursors_only)
 {
-  /* Check if the range intersects our cached line display,
-   * and invalidate the cached line if so.
+  GList *l, *next;
+
+  /* Check if the range intersects our cached line displays,
+   * and invalidate the cached lines if so.
    */
-  if (layout->one_display_cache)
+  for (l = layout->display_lru.head; l != NULL; l = next)
     {
-      GtkTextLine *line = layout->one_display_cache->line;
+      GtkTextLineDisplay *display = l->data;
+      GtkTextLine *line = display->line;
       gint cache_y = _gtk_text_btree_find_line_top (_gtk_text_buffer_get_btree (layout->buffer),
 						    line, layout);
-      gint cache_height = layout->one_display_cache->height;
 
-      if (cache_y + cache_height > y && cache_y < y + old_height)
+      /* Invalidating may remove the display from the cache */
+      next = l->next;
+
+      if (cache_y + display->height > y && cache_y < y + old_height)
 	gtk_text_layout_invalidate_cache (layout, line, cursors_only);
     }
 
@@ -813,29 +869,94 @@ gtk_text_layout_invalidate_all (GtkTextLayout *layout)
   gtk_text_layout_invalidate (layout, &start, &end);
 }
 
+static void
+gtk_text_layout_uncache_display (GtkTextLayout      *layout,
+                                 GtkTextLineDisplay *display)
+{
+  if (display->cache_link.data == NULL)
+    return;
+
+  g_hash_table_remove (layout->display_cache, display->line);
+  g_queue_unlink (&layout->display_lru, &display->cache_link);
+  display->cache_link.data = NULL;
+  gtk_text_layout_free_line_display (layout, display);
+}
+
+static void
+gtk_text_layout_cache_display (GtkTextLayout      *layout,
+                               GtkTextLineDisplay *display)
+{
+  /* Only cache lines we hold line data for, we get told when those
+   * go away via free_line_data().
+   */
+  if (_gtk_text_line_get_data (display->line, layout) == NULL)
+    return;
+
+  display->ref_count++;
+  display->cache_link.data = display;
+  g_queue_push_head_link (&layout->display_lru, &display->cache_link);
+  g_hash_table_insert (layout->display_cache, display->line, display);
+
+  while (layout->display_lru.length > layout->display_cache_size)
+    gtk_text_layout_uncache_display (layout, layout->display_lru.tail->data);
+}
+
+/* Sizes the display cache for @n_lines visible lines plus the same
+ * again as margin for scrolling. The limit follows the visible line
+ * count, so it shrinks again when the view gets smaller.
+ */
+void
+gtk_text_layout_set_display_cache_lines (GtkTextLayout *layout,
+                                         guint          n_lines)
+{
+  layout->display_cache_size = MAX (DEFAULT_DISPLAY_CACHE_SIZE, 2 * n_lines);
+
+  while (layout->display_lru.length > layout->display_cache_size)
+    gtk_text_layout_uncache_display (layout, layout->display_lru.tail->data);
+}
+
+static void
+gtk_text_layout_clear_display_cache (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  while (layout->display_lru.head)
+    gtk_text_layout_uncache_display (layout, layout->display_lru.head->data);
+
+  g_hash_table_remove_all (priv->chunk_sizes);
+}
+
+static void
+gtk_text_layout_forget_chunk_sizes (GtkTextLayout *layout,
+                                    GtkTextLine   *line)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  if (g_hash_table_size (priv->chunk_sizes) > 0)
+    g_hash_table_remove (priv->chunk_sizes, line);
+}
+
 static void
 gtk_text_layout_invalidate_cache (GtkTextLayout *layout,
                                   GtkTextLine   *line,
 				  gboolean       cursors_only)
 {
-  if (layout->one_display_cache && line == layout->one_display_cache->line)
-    {
-      GtkTextLineDisplay *display = layout->one_display_cache;
+  GtkTextLineDisplay *display;
 
-      if (cursors_only)
-	{
-          if (display->cursors)
-            g_array_free (display->cursors, TRUE);
-	  display->cursors = NULL;
-	  display->cursors_invalid = TRUE;
-	  display->has_block_cursor = FALSE;
-	}
-      else
-	{
-	  layout->one_display_cache = NULL;
-	  gtk_text_layout_free_line_display (layout, display);
-	}
+  display = g_hash_table_lookup (layout->display_cache, line);
+  if (display == NULL)
+    return;
+
+  if (cursors_only)
+    {
+      if (display->cursors)
+        g_array_free (display->cursors, TRUE);
+      display->cursors = NULL;
+      display->cursors_invalid = TRUE;
+      display->has_block_cursor = FALSE;
     }
+  else
+    gtk_text_layout_uncache_display (layout, display);
 }
 
 /* Now invalidate the paragraph containing the cursor
@@ -858,6 +979,8 @@ gtk_text_layout_invalidate_cursor_line (GtkTextLayout *layout,
       else
 	{
 	  gtk_text_layout_invalidate_cache (layout, priv->cursor_line, FALSE);
+          gtk_text_layout_forget_chunk_sizes (layout, priv->cursor_line);
+          gtk_text_layout_forget_measuring (layout, priv->cursor_line);
 	  _gtk_text_line_invalidate_wrap (priv->cursor_line, line_data);
 	}
 
@@ -908,7 +1031,9 @@ gtk_text_layout_real_invalidate (GtkTextLayout *layout,
       GtkTextLineData *line_data = _gtk_text_line_get_data (line, layout);
 
       gtk_text_layout_invalidate_cache (layout, line, FALSE);
-      
+      gtk_text_layout_forget_chunk_sizes (layout, line);
+      gtk_text_layout_forget_measuring (layout, line);
+
       if (line_data)
         _gtk_text_line_invalidate_wrap (line, line_data);
 
@@ -926,32 +1051,32 @@ gtk_text_layout_real_invalidate_cursors (GtkTextLayout     *layout,
 					 const GtkTextIter *start,
 					 const GtkTextIter *end)
 {
-  /* Check if the range intersects our cached line display,
-   * and invalidate the cached line if so.
+  GList *l;
+  gint start_line, end_line;
+
+  /* Check if the range intersects our cached line displays,
+   * and invalidate the cached lines if so.
    */
-  if (layout->one_display_cache)
+  if (layout->display_lru.length > 0)
     {
-      GtkTextIter line_start, line_end;
-      GtkTextLine *line = layout->one_display_cache->line;
-
-      gtk_text_layout_get_iter_at_line (layout, &line_start, line, 0);
+      start_line = gtk_text_iter_get_line (start);
+      end_line = gtk_text_iter_get_line (end);
 
-      line_end = line_start;
-      if (!gtk_text_iter_ends_line (&line_end))
-	gtk_text_iter_forward_to_line_end (&line_end);
+      if (start_line > end_line)
+        {
+          gint tmp = start_line;
+          start_line = end_line;
+          end_line = tmp;
+        }
 
-      if (gtk_text_iter_compare (start, end) > 0)
-	{
-	  const GtkTextIter *tmp = start;
-	  start = end;
-	  end = tmp;
-	}
+      for (l = layout->display_lru.head; l != NULL; l = l->next)
+        {
+          GtkTextLineDisplay *display = l->data;
+          gint line = _gtk_text_line_get_number (display->line);
 
-      if (gtk_text_iter_compare (&line_start, end) <= 0 &&
-	  gtk_text_iter_compare (start, &line_end) <= 0)
-	{
-	  gtk_text_layout_invalidate_cache (layout, line, TRUE);
-	}
+          if (start_line <= line && line <= end_line)
+            gtk_text_layout_invalidate_cache (layout, display->line, TRUE);
+        }
     }
 
   gtk_text_layout_invalidated (layout);
@@ -963,6 +1088,8 @@ gtk_text_layout_real_free_line_data (GtkTextLayout     *layout,
                                      GtkTextLineData   *line_data)
 {
   gtk_text_layout_invalidate_cache (layout, line, FALSE);
+  gtk_text_layout_forget_chunk_sizes (layout, line);
+  gtk_text_layout_forget_measuring (layout, line);
 
   g_slice_free (GtkTextLineData, line_data);
 }
@@ -1036,6 +1163,10 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
   while (line && seen < -y0)
     {
       GtkTextLineData *line_data = _gtk_text_line_get_data (line, layout);
+      if (line_data && line_data->valid)
+        gtk_text_layout_shape_visible_chunks (layout, line, line_data,
+                                              y0 + seen + line_data->height,
+                                              seen + line_data->height);
       if (!line_data || !line_data->valid)
         {
           gint old_height, new_height;
@@ -1049,6 +1180,19 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
                                          line, layout);
           line_data = _gtk_text_line_get_data (line, layout);
 
+          /* Shape the chunks of long paragraphs that show, their
+           * heights were only estimated
+           */
+          if (line_data &&
+              gtk_text_layout_shape_visible_chunks (layout, line, line_data,
+                                                    y0 + seen + line_data->height,
+                                                    seen + line_data->height))
+            {
+              _gtk_text_btree_validate_line (_gtk_text_buffer_get_btree (layout->buffer),
+                                             line, layout);
+              line_data = _gtk_text_line_get_data (line, layout);
+            }
+
 	  new_height = line_data ? line_data->height : 0;
           if (line_data)
             {
@@ -1077,6 +1221,8 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
   while (line && seen < y1)
     {
       GtkTextLineData *line_data = _gtk_text_line_get_data (line, layout);
+      if (line_data && line_data->valid)
+        gtk_text_layout_shape_visible_chunks (layout, line, line_data, -seen, y1 - seen);
       if (!line_data || !line_data->valid)
         {
           gint old_height, new_height;
@@ -1089,6 +1235,13 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
           _gtk_text_btree_validate_line (_gtk_text_buffer_get_btree (layout->buffer),
                                          line, layout);
           line_data = _gtk_text_line_get_data (line, layout);
+          if (line_data &&
+              gtk_text_layout_shape_visible_chunks (layout, line, line_data, -seen, y1 - seen))
+            {
+              _gtk_text_btree_validate_line (_gtk_text_buffer_get_btree (layout->buffer),
+                                             line, layout);
+              line_data = _gtk_text_line_get_data (line, layout);
+            }
 	  new_height = line_data ? line_data->height : 0;
           if (line_data)
             {
@@ -1181,9 +1334,18 @@ gtk_text_layout_real_wrap (GtkTextLayout   *layout,
   line_data->width = display->width;
   line_data->height = display->height;
   line_data->valid = TRUE;
-  pango_layout_get_pixel_extents (display->layout, &ink_rect, &logical_rect);
-  line_data->top_ink = MAX (0, logical_rect.x - ink_rect.x);
-  line_data->bottom_ink = MAX (0, logical_rect.x + logical_rect.width - ink_rect.x - ink_rect.width);
+  if (display->chunks != NULL)
+    {
+      /* Most of the paragraph isn't shaped yet */
+      line_data->top_ink = 0;
+      line_data->bottom_ink = 0;
+    }
+  else
+    {
+      pango_layout_get_pixel_extents (display->layout, &ink_rect, &logical_rect);
+      line_data->top_ink = MAX (0, logical_rect.x - ink_rect.x);
+      line_data->bottom_ink = MAX (0, logical_rect.x + logical_rect.width - ink_rect.x - ink_rect.width);
+    }
   gtk_text_layout_free_line_display (layout, display);
 
   return line_data;
@@ -1805,18 +1967,24 @@ get_block_cursor (GtkTextLayout      *layout,
 		  gboolean           *cursor_at_line_end)
 {
   PangoRectangle pango_pos;
+  PangoLayout *pango_layout;
+  gint start, y;
 
-  if (layout->overwrite_mode &&
-      gtk_text_iter_editable (insert_iter, TRUE) &&
-      _gtk_text_util_get_block_cursor_location (display->layout,
-						insert_index,
+  if (!layout->overwrite_mode ||
+      !gtk_text_iter_editable (insert_iter, TRUE))
+    return FALSE;
+
+  pango_layout = line_display_get_layout_at_index (layout, display, insert_index, &start, &y);
+
+  if (_gtk_text_util_get_block_cursor_location (pango_layout,
+						insert_index - start,
 						&pango_pos,
     					        cursor_at_line_end))
     {
       if (pos)
 	{
 	  pos->x = PANGO_PIXELS (pango_pos.x);
-	  pos->y = PANGO_PIXELS (pango_pos.y);
+	  pos->y = PANGO_PIXELS (pango_pos.y) + y;
 	  pos->width = PANGO_PIXELS (pango_pos.width);
 	  pos->height = PANGO_PIXELS (pango_pos.height);
 	}
@@ -2240,398 +2408,1465 @@ tags_array_toggle_tag (GPtrArray  *array,
   return array;
 }
 
-GtkTextLineDisplay *
-gtk_text_layout_get_line_display (GtkTextLayout *layout,
-                                  GtkTextLine   *line,
-                                  gboolean       size_only)
+enum {
+  LINE_DISPLAY_INVISIBLE = 1 << 0,
+  LINE_DISPLAY_HAS_WIDGETS = 1 << 1,
+  LINE_DISPLAY_HAS_TEXTURES = 1 << 2,
+  LINE_DISPLAY_CHUNKED = 1 << 3
+};
+
+/*
+ * Long paragraphs
+ *
+ * Shaping a paragraph takes time proportional to its length, and
+ * nothing in it can be drawn or measured before it is done. When
+ * wrapping, paragraphs with more than LONG_LINE_MIN_SIZE bytes of text
+ * are split into chunks that are laid out with their own PangoLayout,
+ * each starting on a new display line. Only the first chunk is shaped
+ * when the display is created, the heights of the others are estimated
+ * from it until they get drawn or the cursor moves into them.
+ */
+
+#define LONG_LINE_CHUNK_SIZE (16 * 1024)
+#define LONG_LINE_MIN_SIZE (4 * LONG_LINE_CHUNK_SIZE)
+
+typedef struct _ChunkSize ChunkSize;
+
+struct _ChunkSize
 {
-  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
-  GtkTextLineDisplay *display;
-  GtkTextLineSegment *seg;
-  GtkTextIter iter;
-  GtkTextAttributes *style;
-  gchar *text;
-  gint text_pixel_width;
-  PangoAttrList *attrs;
-  gint text_allocated, layout_byte_offset, buffer_byte_offset;
-  PangoRectangle extents;
-  gboolean para_values_set = FALSE;
-  GSList *cursor_byte_offsets = NULL;
-  GSList *cursor_segs = NULL;
-  GSList *tmp_list1, *tmp_list2;
-  gboolean saw_widget = FALSE;
-  PangoDirection base_dir;
-  GPtrArray *tags;
-  gboolean initial_toggle_segments;
-  gint h_margin;
-  gint h_padding;
-  
-  g_return_val_if_fail (line != NULL, NULL);
+  gint width;
+  gint height; /* -1 if the chunk was not shaped */
+};
 
-  if (layout->one_display_cache)
-    {
-      if (line == layout->one_display_cache->line &&
-          (size_only || !layout->one_display_cache->size_only))
-	{
-	  if (!size_only)
-            update_text_display_cursors (layout, line, layout->one_display_cache);
-	  return layout->one_display_cache;
-	}
-      else
-        {
-          GtkTextLineDisplay *tmp_display = layout->one_display_cache;
-          layout->one_display_cache = NULL;
-          gtk_text_layout_free_line_display (layout, tmp_display);
-        }
-    }
+static void
+line_chunk_clear (gpointer data)
+{
+  GtkTextLineChunk *chunk = data;
 
-  DV (g_print ("creating one line display cache (%s)\n", G_STRLOC));
+  g_clear_object (&chunk->layout);
+  g_clear_pointer (&chunk->attrs, pango_attr_list_unref);
+  g_clear_pointer (&chunk->node, gsk_render_node_unref);
+}
 
-  display = g_slice_new0 (GtkTextLineDisplay);
+/* Finds where the chunk starting at @start should end. We prefer
+ * ending it after whitespace, where the paragraph is likely to wrap
+ * anyway, and never end it inside a cluster.
+ */
+static gint
+find_chunk_end (const gchar *text,
+                gint         start,
+                gint         length)
+{
+  const gchar *p, *end, *limit;
+  gunichar ch, prev;
 
-  display->size_only = size_only;
-  display->line = line;
-  display->insert_index = -1;
+  /* Don't leave a short chunk at the end */
+  if (length - start < 2 * LONG_LINE_CHUNK_SIZE)
+    return length;
 
-  /* Special-case optimization for completely
-   * invisible lines; makes it faster to deal
-   * with sequences of invisible lines.
-   */
-  if (totally_invisible_line (layout, line, &iter))
+  end = text + start + LONG_LINE_CHUNK_SIZE;
+  limit = end + LONG_LINE_CHUNK_SIZE / 8;
+
+  for (p = end; p < limit; p++)
     {
-      display->layout = pango_layout_new (layout->ltr_context);
-      return display;
+      if (*p == ' ' || *p == '\t')
+        return p + 1 - text;
     }
 
-  /* Find the bidi base direction */
-  base_dir = line->dir_propagated_forward;
-  if (base_dir == PANGO_DIRECTION_NEUTRAL)
-    base_dir = line->dir_propagated_back;
+  p = end;
+  while ((*p & 0xc0) == 0x80)
+    p++;
 
-  if (line == priv->cursor_line &&
-      line->dir_strong == PANGO_DIRECTION_NEUTRAL)
+  prev = g_utf8_get_char (g_utf8_prev_char (p));
+  while (p < limit)
     {
-      base_dir = (layout->keyboard_direction == GTK_TEXT_DIR_LTR) ?
-	 PANGO_DIRECTION_LTR : PANGO_DIRECTION_RTL;
+      ch = g_utf8_get_char (p);
+      if (!g_unichar_ismark (ch) && ch != 0x200d && prev != 0x200d)
+        break;
+
+      prev = ch;
+      p = g_utf8_next_char (p);
     }
-  
-  /* Allocate space for flat text for buffer
-   */
-  text_allocated = _gtk_text_line_byte_count (line);
-  text = g_malloc (text_allocated);
 
-  attrs = pango_attr_list_new ();
+  return p - text;
+}
 
-  /* Iterate over segments, creating display chunks for them, and updating the tags array. */
-  layout_byte_offset = 0; /* current length of layout text (includes preedit, does not include invisible text) */
-  buffer_byte_offset = 0; /* position in the buffer line */
-  seg = _gtk_text_iter_get_any_segment (&iter);
-  tags = get_tags_array_at_iter (&iter);
-  initial_toggle_segments = TRUE;
-  while (seg != NULL)
+static guint
+find_chunk (GArray *chunks,
+            gint    index)
+{
+  guint lo, hi, mid;
+
+  lo = 0;
+  hi = chunks->len;
+  while (hi - lo > 1)
     {
-      /* Displayable segments */
-      if (seg->type == &gtk_text_char_type ||
-          seg->type == &gtk_text_texture_type ||
-          seg->type == &gtk_text_child_type)
-        {
-          style = get_style (layout, tags);
-	  initial_toggle_segments = FALSE;
+      mid = (lo + hi) / 2;
+      if (g_array_index (chunks, GtkTextLineChunk, mid).start <= index)
+        lo = mid;
+      else
+        hi = mid;
+    }
 
-          /* We have to delay setting the paragraph values until we
-           * hit the first texture or text segment because toggles at
-           * the beginning of the paragraph should affect the
-           * paragraph-global values
-           */
-          if (!para_values_set)
-            {
-              set_para_values (layout, base_dir, style, display);
-              para_values_set = TRUE;
-            }
+  return lo;
+}
 
-          /* First see if the chunk is invisible, and ignore it if so. Tk
-           * looked at tabs, wrap mode, etc. before doing this, but
-           * that made no sense to me, so I am just skipping the
-           * invisible chunks
-           */
-          if (!style->invisible)
-            {
-              if (seg->type == &gtk_text_char_type)
-                {
-                  /* We don't want to split segments because of marks,
-                   * so we scan forward for more segments only
-                   * separated from us by marks. In theory, we should
-                   * also merge segments with identical styles, even
-                   * if there are toggles in-between
-                   */
+/**
+ * _gtk_text_line_display_get_chunk_at_index:
+ * @display: a #GtkTextLineDisplay
+ * @index: a byte index into the text of @display
+ *
+ * Returns: the chunk of @display containing @index, or 0 if
+ *   @display isn't split into chunks
+ */
+guint
+_gtk_text_line_display_get_chunk_at_index (GtkTextLineDisplay *display,
+                                           gint                index)
+{
+  if (display->chunks == NULL)
+    return 0;
 
-                  gint bytes = 0;
- 		  GtkTextLineSegment *prev_seg = NULL;
-  
- 		  while (seg)
-                    {
-                      if (seg->type == &gtk_text_char_type)
-                        {
-                          memcpy (text + layout_byte_offset, seg->body.chars, seg->byte_count);
-                          layout_byte_offset += seg->byte_count;
-                          buffer_byte_offset += seg->byte_count;
-                          bytes += seg->byte_count;
-                        }
- 		      else if (seg->type == &gtk_text_right_mark_type ||
- 			       seg->type == &gtk_text_left_mark_type)
-                        {
- 			  /* If we have preedit string, break out of this loop - we'll almost
- 			   * certainly have different attributes on the preedit string
- 			   */
+  return find_chunk (display->chunks, index);
+}
 
- 			  if (layout->preedit_len > 0 &&
- 			      _gtk_text_btree_mark_is_insert (_gtk_text_buffer_get_btree (layout->buffer),
- 							     seg->body.mark.obj))
-			    break;
+static gboolean
+add_attr_to_chunks (PangoAttribute *attr,
+                    gpointer        data)
+{
+  GArray *chunks = data;
+  guint i;
 
- 			  if (seg->body.mark.visible)
- 			    {
-			      cursor_byte_offsets = g_slist_prepend (cursor_byte_offsets, GINT_TO_POINTER (layout_byte_offset));
-			      cursor_segs = g_slist_prepend (cursor_segs, seg);
-			      if (_gtk_text_btree_mark_is_insert (_gtk_text_buffer_get_btree (layout->buffer),
-								  seg->body.mark.obj))
-				display->insert_index = layout_byte_offset;
-			    }
-                        }
-		      else
-			break;
+  for (i = find_chunk (chunks, attr->start_index); i < chunks->len; i++)
+    {
+      GtkTextLineChunk *chunk = &g_array_index (chunks, GtkTextLineChunk, i);
+      guint start = chunk->start;
+      guint end = chunk->start + chunk->length;
+      PangoAttribute *copy;
 
- 		      prev_seg = seg;
-                      seg = seg->next;
-                    }
+      if (attr->end_index <= start)
+        break;
 
- 		  seg = prev_seg; /* Back up one */
-                  add_generic_attrs (layout, &style->appearance,
-                                     bytes,
-                                     attrs, layout_byte_offset - bytes,
-                                     size_only, TRUE);
-                  add_text_attrs (layout, style, bytes, attrs,
-                                  layout_byte_offset - bytes, size_only);
-                }
-              else if (seg->type == &gtk_text_texture_type)
-                {
-                  add_generic_attrs (layout,
-                                     &style->appearance,
-                                     seg->byte_count,
-                                     attrs, layout_byte_offset,
-                                     size_only, FALSE);
-                  add_texture_attrs (layout, display, style,
-                                     seg, attrs, layout_byte_offset);
-                  memcpy (text + layout_byte_offset, _gtk_text_unknown_char_utf8,
-                          seg->byte_count);
-                  layout_byte_offset += seg->byte_count;
-                  buffer_byte_offset += seg->byte_count;
-                }
-              else if (seg->type == &gtk_text_child_type)
-                {
-                  saw_widget = TRUE;
-                  
-                  add_generic_attrs (layout, &style->appearance,
-                                     seg->byte_count,
-                                     attrs, layout_byte_offset,
-                                     size_only, FALSE);
-                  add_child_attrs (layout, display, style,
-                                   seg, attrs, layout_byte_offset);
-                  memcpy (text + layout_byte_offset, _gtk_text_unknown_char_utf8,
-                          seg->byte_count);
-                  layout_byte_offset += seg->byte_count;
-                  buffer_byte_offset += seg->byte_count;
-                }
-              else
-                {
-                  /* We don't know this segment type */
-                  g_assert_not_reached ();
-                }
-              
-            } /* if (segment was visible) */
-          else
-            {
-              /* Invisible segment */
-              buffer_byte_offset += seg->byte_count;
-            }
+      copy = pango_attribute_copy (attr);
+      copy->start_index = MAX (attr->start_index, start) - start;
+      copy->end_index = MIN (attr->end_index, end) - start;
+      pango_attr_list_insert (chunk->attrs, copy);
+    }
 
-          release_style (layout, style);
+  /* Keep the attribute */
+  return FALSE;
+}
+
+static void
+gtk_text_layout_set_chunk_size (GtkTextLayout      *layout,
+                                GtkTextLineDisplay *display,
+                                guint               chunk,
+                                gint                width,
+                                gint                height)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  ChunkSize *size;
+  GArray *sizes;
+
+  /* We only get told when lines with line data go away */
+  if (_gtk_text_line_get_data (display->line, layout) == NULL)
+    return;
+
+  sizes = g_hash_table_lookup (priv->chunk_sizes, display->line);
+  if (sizes == NULL || sizes->len != display->chunks->len)
+    {
+      sizes = g_array_sized_new (FALSE, FALSE, sizeof (ChunkSize), display->chunks->len);
+      g_array_set_size (sizes, display->chunks->len);
+      for (size = &g_array_index (sizes, ChunkSize, 0);
+           size < &g_array_index (sizes, ChunkSize, sizes->len);
+           size++)
+        size->height = -1;
+
+      g_hash_table_insert (priv->chunk_sizes, display->line, sizes);
+    }
+
+  size = &g_array_index (sizes, ChunkSize, chunk);
+  size->width = width;
+  size->height = height;
+}
+
+/* Lays out @chunk with a copy of the (empty) layout of @display */
+static void
+gtk_text_line_display_layout_chunk (GtkTextLayout      *layout,
+                                    GtkTextLineDisplay *display,
+                                    guint               chunk,
+                                    gint               *width,
+                                    gint               *height)
+{
+  GtkTextLineChunk *c = &g_array_index (display->chunks, GtkTextLineChunk, chunk);
+  PangoRectangle extents;
+
+  c->layout = pango_layout_copy (display->layout);
+  /* Only the first line of the paragraph is indented */
+  if (chunk > 0)
+    pango_layout_set_indent (c->layout, 0);
+  pango_layout_set_text (c->layout, display->chunk_text + c->start, c->length);
+  pango_layout_set_attributes (c->layout, c->attrs);
+
+  pango_layout_get_extents (c->layout, NULL, &extents);
+  *width = PIXEL_BOUND (extents.width);
+  *height = PANGO_PIXELS (extents.height);
+
+  /* Chunks are as far apart as the lines of the paragraph */
+  if (chunk + 1 < display->chunks->len)
+    *height += PANGO_PIXELS (pango_layout_get_spacing (display->layout));
+
+  gtk_text_layout_set_chunk_size (layout, display, chunk, *width, *height);
+}
+
+/* Splits the text of a long paragraph into chunks, taking ownership
+ * of @text, and computes the size of @display from the sizes of
+ * the chunks that were shaped before, or from the first one.
+ */
+static void
+gtk_text_line_display_split (GtkTextLayout      *layout,
+                             GtkTextLineDisplay *display,
+                             gchar              *text,
+                             gint                length,
+                             PangoAttrList      *attrs)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextLineChunk *chunk;
+  GArray *sizes;
+  gint64 known_length, known_height;
+  gint start, y, width;
+  guint i;
+
+  display->chunk_text = text;
+  display->chunks = g_array_new (FALSE, TRUE, sizeof (GtkTextLineChunk));
+  g_array_set_clear_func (display->chunks, line_chunk_clear);
+
+  for (start = 0; start < length; start += chunk->length)
+    {
+      g_array_set_size (display->chunks, display->chunks->len + 1);
+      chunk = &g_array_index (display->chunks, GtkTextLineChunk, display->chunks->len - 1);
+      chunk->start = start;
+      chunk->length = find_chunk_end (text, start, length) - start;
+      chunk->attrs = pango_attr_list_new ();
+    }
+
+  pango_attr_list_filter (attrs, add_attr_to_chunks, display->chunks);
+
+  sizes = g_hash_table_lookup (priv->chunk_sizes, display->line);
+  if (sizes != NULL && sizes->len != display->chunks->len)
+    sizes = NULL;
+
+  known_length = 0;
+  known_height = 0;
+  for (i = 0; i < display->chunks->len; i++)
+    {
+      chunk = &g_array_index (display->chunks, GtkTextLineChunk, i);
+      chunk->height = -1;
+
+      if (sizes && g_array_index (sizes, ChunkSize, i).height >= 0)
+        {
+          chunk->width = g_array_index (sizes, ChunkSize, i).width;
+          chunk->height = g_array_index (sizes, ChunkSize, i).height;
+          known_length += chunk->length;
+          known_height += chunk->height;
         }
+    }
 
-      /* Toggles */
-      else if (seg->type == &gtk_text_toggle_on_type ||
-               seg->type == &gtk_text_toggle_off_type)
+  if (known_length == 0)
+    {
+      chunk = &g_array_index (display->chunks, GtkTextLineChunk, 0);
+      gtk_text_line_display_layout_chunk (layout, display, 0, &chunk->width, &chunk->height);
+      known_length = chunk->length;
+      known_height = chunk->height;
+    }
+
+  y = 0;
+  width = 0;
+  for (i = 0; i < display->chunks->len; i++)
+    {
+      chunk = &g_array_index (display->chunks, GtkTextLineChunk, i);
+
+      if (chunk->height < 0)
+        chunk->height = known_height * chunk->length / known_length;
+
+      chunk->y = y;
+      y += chunk->height;
+      width = MAX (width, chunk->width);
+    }
+
+  display->width = width + display->left_margin + display->right_margin +
+                   layout->left_padding + layout->right_padding;
+  display->height += y;
+}
+
+/* Shapes @chunk if it wasn't yet and moves the chunks below it if
+ * the estimated height was off. Returns %TRUE if the size of @display
+ * changed.
+ */
+static gboolean
+gtk_text_line_display_shape_chunk (GtkTextLayout      *layout,
+                                   GtkTextLineDisplay *display,
+                                   guint               chunk)
+{
+  GtkTextLineChunk *c = &g_array_index (display->chunks, GtkTextLineChunk, chunk);
+  gint width, height;
+  guint i;
+
+  if (c->layout != NULL)
+    return FALSE;
+
+  gtk_text_line_display_layout_chunk (layout, display, chunk, &width, &height);
+
+  if (height != c->height)
+    {
+      /* The nodes of the chunks below were rendered where they were */
+      for (i = chunk + 1; i < display->chunks->len; i++)
         {
-          /* Style may have changed, drop our
-             current cached style */
-          invalidate_cached_style (layout);
-	  /* Add the tag only after we have seen some non-toggle non-mark segment,
-	   * otherwise the tag is already accounted for by _gtk_text_btree_get_tags(). */
-	  if (!initial_toggle_segments)
-	    tags = tags_array_toggle_tag (tags, seg->body.toggle.info->tag);
+          GtkTextLineChunk *below = &g_array_index (display->chunks, GtkTextLineChunk, i);
+
+          below->y += height - c->height;
+          g_clear_pointer (&below->node, gsk_render_node_unref);
         }
 
-      /* Marks */
-      else if (seg->type == &gtk_text_right_mark_type ||
-               seg->type == &gtk_text_left_mark_type)
+      display->height += height - c->height;
+      c->height = height;
+    }
+  else if (width <= c->width)
+    return FALSE;
+
+  c->width = width;
+
+  display->width = MAX (display->width,
+                        width + display->left_margin + display->right_margin +
+                        layout->left_padding + layout->right_padding);
+
+  return TRUE;
+}
+
+/**
+ * _gtk_text_layout_get_chunk_layout:
+ * @layout: a #GtkTextLayout
+ * @display: a #GtkTextLineDisplay that is split into chunks
+ * @chunk: the chunk
+ *
+ * Gets the #PangoLayout of a chunk of a long paragraph, shaping it
+ * if that didn't happen yet. If the chunk turns out to have another
+ * size than estimated, the line is invalidated, so it gets measured
+ * again.
+ *
+ * Returns: (transfer none): the #PangoLayout of @chunk
+ */
+PangoLayout *
+_gtk_text_layout_get_chunk_layout (GtkTextLayout      *layout,
+                                   GtkTextLineDisplay *display,
+                                   guint               chunk)
+{
+  GtkTextLineData *line_data;
+
+  if (gtk_text_line_display_shape_chunk (layout, display, chunk))
+    {
+      line_data = _gtk_text_line_get_data (display->line, layout);
+      if (line_data && line_data->valid &&
+          (line_data->width != display->width || line_data->height != display->height))
         {
-	  gint cursor_offset = 0;
- 	  
-	  /* At the insertion point, add the preedit string, if any */
-	  
-	  if (_gtk_text_btree_mark_is_insert (_gtk_text_buffer_get_btree (layout->buffer),
-					     seg->body.mark.obj))
-	    {
-	      display->insert_index = layout_byte_offset;
-	      
-	      if (layout->preedit_len > 0)
-		{
-		  text_allocated += layout->preedit_len;
-		  text = g_realloc (text, text_allocated);
+          _gtk_text_line_invalidate_wrap (display->line, line_data);
+          gtk_text_layout_invalidated (layout);
+        }
+    }
 
-		  style = get_style (layout, tags);
-		  add_preedit_attrs (layout, style, attrs, layout_byte_offset, size_only);
-		  release_style (layout, style);
-                  
-		  memcpy (text + layout_byte_offset, layout->preedit_string, layout->preedit_len);
-		  layout_byte_offset += layout->preedit_len;
-                  /* DO NOT increment the buffer byte offset for preedit */
-                  
-		  cursor_offset = layout->preedit_cursor - layout->preedit_len;
-		}
-	    }
-	  
+  return g_array_index (display->chunks, GtkTextLineChunk, chunk).layout;
+}
+
+/* Shapes the chunks of a cached long paragraph in the range from
+ * @top to @bottom, relative to the top of the paragraph, so that it
+ * is measured with them before it gets drawn. Returns %TRUE if that
+ * invalidated @line_data.
+ */
+static gboolean
+gtk_text_layout_shape_visible_chunks (GtkTextLayout   *layout,
+                                      GtkTextLine     *line,
+                                      GtkTextLineData *line_data,
+                                      gint             top,
+                                      gint             bottom)
+{
+  GtkTextLineDisplay *display;
+  gboolean changed = FALSE;
+  guint i;
+
+  display = g_hash_table_lookup (layout->display_cache, line);
+  if (display == NULL || display->chunks == NULL)
+    return FALSE;
+
+  for (i = 0; i < display->chunks->len; i++)
+    {
+      GtkTextLineChunk *chunk = &g_array_index (display->chunks, GtkTextLineChunk, i);
+      gint chunk_top = display->top_margin + chunk->y;
+
+      if (chunk_top >= bottom)
+        break;
+
+      if (chunk_top + chunk->height > top)
+        changed |= gtk_text_line_display_shape_chunk (layout, display, i);
+    }
+
+  if (!changed || !line_data->valid ||
+      (line_data->width == display->width && line_data->height == display->height))
+    return FALSE;
+
+  _gtk_text_line_invalidate_wrap (line, line_data);
+
+  return TRUE;
+}
+
+/* Returns the PangoLayout for chunk @i of @display and where it is in
+ * the paragraph, or the layout of the whole paragraph if @display is
+ * not split into chunks.
+ */
+static PangoLayout *
+line_display_get_layout (GtkTextLayout      *layout,
+                         GtkTextLineDisplay *display,
+                         guint               i,
+                         gint               *start,
+                         gint               *y)
+{
+  GtkTextLineChunk *chunk;
+  PangoLayout *pango_layout;
+
+  if (display->chunks == NULL)
+    {
+      if (start)
+        *start = 0;
+      if (y)
+        *y = 0;
+      return display->layout;
+    }
+
+  pango_layout = _gtk_text_layout_get_chunk_layout (layout, display, i);
+  chunk = &g_array_index (display->chunks, GtkTextLineChunk, i);
+  if (start)
+    *start = chunk->start;
+  if (y)
+    *y = chunk->y;
+
+  return pango_layout;
+}
+
+static guint
+line_display_get_n_layouts (GtkTextLineDisplay *display)
+{
+  return display->chunks ? display->chunks->len : 1;
+}
+
+/* Returns the PangoLayout containing byte @index of the text of @display */
+static PangoLayout *
+line_display_get_layout_at_index (GtkTextLayout      *layout,
+                                  GtkTextLineDisplay *display,
+                                  gint                index,
+                                  gint               *start,
+                                  gint               *y)
+{
+  return line_display_get_layout (layout, display,
+                                  _gtk_text_line_display_get_chunk_at_index (display, index),
+                                  start, y);
+}
+
+/* Returns the PangoLayout at @y pixels below the top of the text of @display */
+static PangoLayout *
+line_display_get_layout_at_y (GtkTextLayout      *layout,
+                              GtkTextLineDisplay *display,
+                              gint                y,
+                              gint               *start,
+                              gint               *chunk_y)
+{
+  guint lo, hi, mid;
+
+  lo = 0;
+  if (display->chunks != NULL)
+    {
+      hi = display->chunks->len;
+      while (hi - lo > 1)
+        {
+          mid = (lo + hi) / 2;
+          if (g_array_index (display->chunks, GtkTextLineChunk, mid).y <= y)
+            lo = mid;
+          else
+            hi = mid;
+        }
+    }
+
+  return line_display_get_layout (layout, display, lo, start, chunk_y);
+}
+
+/* Creates the display for @line with the text and attributes
+ * set on its PangoLayout, but doesn't lay it out yet. */
+static GtkTextLineDisplay *
+gtk_text_layout_create_line_display (GtkTextLayout *layout,
+                                     GtkTextLine   *line,
+                                     gboolean       size_only,
+                                     guint         *flags)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextLineDisplay *display;
+  GtkTextLineSegment *seg;
+  GtkTextIter iter;
+  GtkTextAttributes *style;
+  gchar *text;
+  PangoAttrList *attrs;
+  gint text_allocated, layout_byte_offset, buffer_byte_offset;
+  gboolean para_values_set = FALSE;
+  GSList *cursor_byte_offsets = NULL;
+  GSList *cursor_segs = NULL;
+  GSList *tmp_list1, *tmp_list2;
+  PangoDirection base_dir;
+  GPtrArray *tags;
+  gboolean initial_toggle_segments;
+
+  *flags = 0;
+
+  display = g_slice_new0 (GtkTextLineDisplay);
+
+  display->ref_count = 1;
+  display->size_only = size_only;
+  display->line = line;
+  display->insert_index = -1;
+
+  /* Special-case optimization for completely
+   * invisible lines; makes it faster to deal
+   * with sequences of invisible lines.
+   */
+  if (totally_invisible_line (layout, line, &iter))
+    {
+      display->layout = pango_layout_new (layout->ltr_context);
+      *flags |= LINE_DISPLAY_INVISIBLE;
+      return display;
+    }
+
+  /* Find the bidi base direction */
+  base_dir = line->dir_propagated_forward;
+  if (base_dir == PANGO_DIRECTION_NEUTRAL)
+    base_dir = line->dir_propagated_back;
+
+  if (line == priv->cursor_line &&
+      line->dir_strong == PANGO_DIRECTION_NEUTRAL)
+    {
+      base_dir = (layout->keyboard_direction == GTK_TEXT_DIR_LTR) ?
+	 PANGO_DIRECTION_LTR : PANGO_DIRECTION_RTL;
+    }
+  
+  /* Allocate space for flat text for buffer
+   */
+  text_allocated = _gtk_text_line_byte_count (line);
+  text = g_malloc (text_allocated);
+
+  attrs = pango_attr_list_new ();
+
+  /* Iterate over segments, creating display chunks for them, and updating the tags array. */
+  layout_byte_offset = 0; /* current length of layout text (includes preedit, does not include invisible text) */
+  buffer_byte_offset = 0; /* position in the buffer line */
+  seg = _gtk_text_iter_get_any_segment (&iter);
+  tags = get_tags_array_at_iter (&iter);
+  initial_toggle_segments = TRUE;
+  while (seg != NULL)
+    {
+      /* Displayable segments */
+      if (seg->type == &gtk_text_char_type ||
+          seg->type == &gtk_text_texture_type ||
+          seg->type == &gtk_text_child_type)
+        {
+          style = get_style (layout, tags);
+	  initial_toggle_segments = FALSE;
+
+          /* We have to delay setting the paragraph values until we
+           * hit the first texture or text segment because toggles at
+           * the beginning of the paragraph should affect the
+           * paragraph-global values
+           */
+          if (!para_values_set)
+            {
+              set_para_values (layout, base_dir, style, display);
+              para_values_set = TRUE;
+            }
+
+          /* First see if the chunk is invisible, and ignore it if so. Tk
+           * looked at tabs, wrap mode, etc. before doing this, but
+           * that made no sense to me, so I am just skipping the
+           * invisible chunks
+           */
+          if (!style->invisible)
+            {
+              if (seg->type == &gtk_text_char_type)
+                {
+                  /* We don't want to split segments because of marks,
+                   * so we scan forward for more segments only
+                   * separated from us by marks. In theory, we should
+                   * also merge segments with identical styles, even
+                   * if there are toggles in-between
+                   */
+
+                  gint bytes = 0;
+ 		  GtkTextLineSegment *prev_seg = NULL;
+  
+ 		  while (seg)
+                    {
+                      if (seg->type == &gtk_text_char_type)
+                        {
+                          memcpy (text + layout_byte_offset, seg->body.chars, seg->byte_count);
+                          layout_byte_offset += seg->byte_count;
+                          buffer_byte_offset += seg->byte_count;
+                          bytes += seg->byte_count;
+                        }
+ 		      else if (seg->type == &gtk_text_right_mark_type ||
+ 			       seg->type == &gtk_text_left_mark_type)
+                        {
+ 			  /* If we have preedit string, break out of this loop - we'll almost
+ 			   * certainly have different attributes on the preedit string
+ 			   */
+
+ 			  if (layout->preedit_len > 0 &&
+ 			      _gtk_text_btree_mark_is_insert (_gtk_text_buffer_get_btree (layout->buffer),
+ 							     seg->body.mark.obj))
+			    break;
+
+ 			  if (seg->body.mark.visible)
+ 			    {
+			      cursor_byte_offsets = g_slist_prepend (cursor_byte_offsets, GINT_TO_POINTER (layout_byte_offset));
+			      cursor_segs = g_slist_prepend (cursor_segs, seg);
+			      if (_gtk_text_btree_mark_is_insert (_gtk_text_buffer_get_btree (layout->buffer),
+								  seg->body.mark.obj))
+				display->insert_index = layout_byte_offset;
+			    }
+                        }
+		      else
+			break;
+
+ 		      prev_seg = seg;
+                      seg = seg->next;
+                    }
+
+ 		  seg = prev_seg; /* Back up one */
+                  add_generic_attrs (layout, &style->appearance,
+                                     bytes,
+                                     attrs, layout_byte_offset - bytes,
+                                     size_only, TRUE);
+                  add_text_attrs (layout, style, bytes, attrs,
+                                  layout_byte_offset - bytes, size_only);
+                }
+              else if (seg->type == &gtk_text_texture_type)
+                {
+                  add_generic_attrs (layout,
+                                     &style->appearance,
+                                     seg->byte_count,
+                                     attrs, layout_byte_offset,
+                                     size_only, FALSE);
+                  add_texture_attrs (layout, display, style,
+                                     seg, attrs, layout_byte_offset);
+                  *flags |= LINE_DISPLAY_HAS_TEXTURES;
+                  memcpy (text + layout_byte_offset, _gtk_text_unknown_char_utf8,
+                          seg->byte_count);
+                  layout_byte_offset += seg->byte_count;
+                  buffer_byte_offset += seg->byte_count;
+                }
+              else if (seg->type == &gtk_text_child_type)
+                {
+                  *flags |= LINE_DISPLAY_HAS_WIDGETS;
+
+                  add_generic_attrs (layout, &style->appearance,
+                                     seg->byte_count,
+                                     attrs, layout_byte_offset,
+                                     size_only, FALSE);
+                  add_child_attrs (layout, display, style,
+                                   seg, attrs, layout_byte_offset);
+                  memcpy (text + layout_byte_offset, _gtk_text_unknown_char_utf8,
+                          seg->byte_count);
+                  layout_byte_offset += seg->byte_count;
+                  buffer_byte_offset += seg->byte_count;
+                }
+              else
+                {
+                  /* We don't know this segment type */
+                  g_assert_not_reached ();
+                }
+              
+            } /* if (segment was visible) */
+          else
+            {
+              /* Invisible segment */
+              buffer_byte_offset += seg->byte_count;
+            }
+
+          release_style (layout, style);
+        }
+
+      /* Toggles */
+      else if (seg->type == &gtk_text_toggle_on_type ||
+               seg->type == &gtk_text_toggle_off_type)
+        {
+          /* Style may have changed, drop our
+             current cached style */
+          invalidate_cached_style (layout);
+	  /* Add the tag only after we have seen some non-toggle non-mark segment,
+	   * otherwise the tag is already accounted for by _gtk_text_btree_get_tags(). */
+	  if (!initial_toggle_segments)
+	    tags = tags_array_toggle_tag (tags, seg->body.toggle.info->tag);
+        }
+
+      /* Marks */
+      else if (seg->type == &gtk_text_right_mark_type ||
+               seg->type == &gtk_text_left_mark_type)
+        {
+	  gint cursor_offset = 0;
+ 	  
+	  /* At the insertion point, add the preedit string, if any */
+	  
+	  if (_gtk_text_btree_mark_is_insert (_gtk_text_buffer_get_btree (layout->buffer),
+					     seg->body.mark.obj))
+	    {
+	      display->insert_index = layout_byte_offset;
+	      
+	      if (layout->preedit_len > 0)
+		{
+		  text_allocated += layout->preedit_len;
+		  text = g_realloc (text, text_allocated);
+
+		  style = get_style (layout, tags);
+		  add_preedit_attrs (layout, style, attrs, layout_byte_offset, size_only);
+		  release_style (layout, style);
+                  
+		  memcpy (text + layout_byte_offset, layout->preedit_string, layout->preedit_len);
+		  layout_byte_offset += layout->preedit_len;
+                  /* DO NOT increment the buffer byte offset for preedit */
+                  
+		  cursor_offset = layout->preedit_cursor - layout->preedit_len;
+		}
+	    }
+	  
+
+          /* Display visible marks */
+
+          if (seg->body.mark.visible)
+            {
+              cursor_byte_offsets = g_slist_prepend (cursor_byte_offsets,
+                                                     GINT_TO_POINTER (layout_byte_offset + cursor_offset));
+              cursor_segs = g_slist_prepend (cursor_segs, seg);
+            }
+        }
+
+      else
+        g_error ("Unknown segment type: %s", seg->type->name);
+
+      seg = seg->next;
+    }
+  
+  if (!para_values_set)
+    {
+      style = get_style (layout, tags);
+      set_para_values (layout, base_dir, style, display);
+      release_style (layout, style);
+    }
+  
+  /* Pango doesn't want the trailing paragraph delimiters */
+
+  {
+    /* Only one character has type G_UNICODE_PARAGRAPH_SEPARATOR in
+     * Unicode 3.0; update this if that changes.
+     */
+#define PARAGRAPH_SEPARATOR 0x2029
+    gunichar ch = 0;
+
+    if (layout_byte_offset > 0)
+      {
+        const char *prev = g_utf8_prev_char (text + layout_byte_offset);
+        ch = g_utf8_get_char (prev);
+        if (ch == PARAGRAPH_SEPARATOR || ch == '\r' || ch == '\n')
+          layout_byte_offset = prev - text; /* chop off */
+
+        if (ch == '\n' && layout_byte_offset > 0)
+          {
+            /* Possibly chop a CR as well */
+            prev = g_utf8_prev_char (text + layout_byte_offset);
+            if (*prev == '\r')
+              --layout_byte_offset;
+          }
+      }
+  }
+  
+  if (layout_byte_offset > LONG_LINE_MIN_SIZE &&
+      pango_layout_get_width (display->layout) >= 0 &&
+      (*flags & LINE_DISPLAY_HAS_WIDGETS) == 0)
+    {
+      gtk_text_line_display_split (layout, display, text, layout_byte_offset, attrs);
+      text = NULL;
+      *flags |= LINE_DISPLAY_CHUNKED;
+    }
+  else
+    {
+      pango_layout_set_text (display->layout, text, layout_byte_offset);
+      pango_layout_set_attributes (display->layout, attrs);
+    }
+
+  tmp_list1 = cursor_byte_offsets;
+  tmp_list2 = cursor_segs;
+  while (tmp_list1)
+    {
+      add_cursor (layout, display, tmp_list2->data,
+                  GPOINTER_TO_INT (tmp_list1->data));
+      tmp_list1 = tmp_list1->next;
+      tmp_list2 = tmp_list2->next;
+    }
+  g_slist_free (cursor_byte_offsets);
+  g_slist_free (cursor_segs);
+
+  /* Free this if we aren't in a loop */
+  if (layout->wrap_loop_count == 0)
+    invalidate_cached_style (layout);
+
+  g_free (text);
+  pango_attr_list_unref (attrs);
+  if (tags != NULL)
+    g_ptr_array_free (tags, TRUE);
+
+  return display;
+}
+
+/* Lays out the PangoLayout of @display and computes its size */
+static void
+gtk_text_layout_measure_line_display (GtkTextLayout      *layout,
+                                      GtkTextLineDisplay *display)
+{
+  PangoRectangle extents;
+  gint text_pixel_width;
+  gint h_margin;
+  gint h_padding;
+
+  /* Already measured when it was split */
+  if (display->chunks != NULL)
+    return;
+
+  pango_layout_get_extents (display->layout, NULL, &extents);
+
+  text_pixel_width = PIXEL_BOUND (extents.width);
+  display->width = text_pixel_width + display->left_margin + display->right_margin;
+
+  h_margin = display->left_margin + display->right_margin;
+  h_padding = layout->left_padding + layout->right_padding;
+
+  display->width = text_pixel_width + h_margin + h_padding;
+  display->height += PANGO_PIXELS (extents.height);
+
+  /* If we aren't wrapping, we need to do the alignment of each
+   * paragraph ourselves.
+   */
+  if (pango_layout_get_width (display->layout) < 0)
+    {
+      gint excess = display->total_width - text_pixel_width;
+
+      switch (pango_layout_get_alignment (display->layout))
+	{
+	case PANGO_ALIGN_LEFT:
+        default:
+	  break;
+	case PANGO_ALIGN_CENTER:
+	  display->x_offset += excess / 2;
+	  break;
+	case PANGO_ALIGN_RIGHT:
+	  display->x_offset += excess;
+	  break;
+	}
+    }
+}
+
+GtkTextLineDisplay *
+gtk_text_layout_get_line_display (GtkTextLayout *layout,
+                                  GtkTextLine   *line,
+                                  gboolean       size_only)
+{
+  GtkTextLineDisplay *display;
+  guint flags;
+
+  g_return_val_if_fail (line != NULL, NULL);
+
+  display = g_hash_table_lookup (layout->display_cache, line);
+  if (display)
+    {
+      if (size_only || !display->size_only)
+	{
+          g_queue_unlink (&layout->display_lru, &display->cache_link);
+          g_queue_push_head_link (&layout->display_lru, &display->cache_link);
+
+	  if (!size_only)
+            update_text_display_cursors (layout, line, display);
+
+          display->ref_count++;
+	  return display;
+	}
+      else
+        gtk_text_layout_uncache_display (layout, display);
+    }
+
+  DV (g_print ("creating line display (%s)\n", G_STRLOC));
+
+  display = gtk_text_layout_create_line_display (layout, line, size_only, &flags);
+
+  if (flags & LINE_DISPLAY_INVISIBLE)
+    return display;
+
+  gtk_text_layout_measure_line_display (layout, display);
+
+  gtk_text_layout_cache_display (layout, display);
+
+  if (flags & LINE_DISPLAY_HAS_WIDGETS)
+    allocate_child_widgets (layout, display);
+  
+  return display;
+}
+
+/* Releases a display returned by gtk_text_layout_get_line_display().
+ * Displays stay alive while they are in the display cache.
+ */
+void
+gtk_text_layout_free_line_display (GtkTextLayout      *layout,
+                                   GtkTextLineDisplay *display)
+{
+  g_return_if_fail (display->ref_count > 0);
+
+  display->ref_count--;
+  if (display->ref_count > 0)
+    return;
+
+  if (display->layout)
+    g_object_unref (display->layout);
+
+  if (display->chunks)
+    g_array_unref (display->chunks);
+  g_free (display->chunk_text);
+
+  if (display->cursors)
+    g_array_free (display->cursors, TRUE);
+
+  if (display->pg_bg_rgba)
+    gdk_rgba_free (display->pg_bg_rgba);
+
+  g_clear_pointer (&display->node, gsk_render_node_unref);
+
+  g_slice_free (GtkTextLineDisplay, display);
+}
+
+/*
+ * Measuring lines in worker threads
+ *
+ * Computing the size of a line means shaping its text with Pango,
+ * which is what makes validating large buffers slow. The text and
+ * attributes of invalid lines are collected on the main thread, the
+ * lines are laid out in worker threads using their own font map, and
+ * the sizes are stored in the line data on the main thread again.
+ */
+
+#define MEASURE_LINES_PER_JOB 200
+
+typedef struct _MeasureLine MeasureLine;
+typedef struct _MeasureJob MeasureJob;
+
+struct _MeasureLine
+{
+  GtkTextLine *line; /* only used on the main thread */
+
+  gchar *text;
+  PangoAttrList *attrs;
+  PangoTabArray *tabs;
+  PangoDirection base_dir;
+  PangoAlignment alignment;
+  gboolean justify;
+  PangoWrapMode wrap;
+  gint wrap_width;
+  gint indent;
+  gint spacing;
+  gint extra_width;  /* margins and padding */
+  gint extra_height; /* pixels above and below */
+
+  /* results */
+  gint width;
+  gint height;
+  gint top_ink;
+  gint bottom_ink;
+};
+
+struct _MeasureJob
+{
+  guint serial;
+
+  PangoFontDescription *font;
+  PangoLanguage *language;
+  PangoMatrix *matrix;
+  PangoGravity gravity;
+  PangoGravityHint gravity_hint;
+  cairo_font_options_t *font_options;
+  double resolution;
+
+  GArray *lines;
+};
+
+static void
+measure_line_clear (gpointer data)
+{
+  MeasureLine *ml = data;
+
+  g_free (ml->text);
+  pango_attr_list_unref (ml->attrs);
+  if (ml->tabs)
+    pango_tab_array_free (ml->tabs);
+}
+
+static MeasureJob *
+measure_job_new (GtkTextLayout *layout,
+                 guint          serial)
+{
+  PangoContext *context = layout->ltr_context;
+  const cairo_font_options_t *font_options;
+  MeasureJob *job;
+
+  job = g_slice_new0 (MeasureJob);
+  job->serial = serial;
+  job->font = pango_font_description_copy (pango_context_get_font_description (context));
+  job->language = pango_context_get_language (context);
+  job->matrix = pango_matrix_copy (pango_context_get_matrix (context));
+  job->gravity = pango_context_get_base_gravity (context);
+  job->gravity_hint = pango_context_get_gravity_hint (context);
+  font_options = pango_cairo_context_get_font_options (context);
+  if (font_options)
+    job->font_options = cairo_font_options_copy (font_options);
+  job->resolution = pango_cairo_context_get_resolution (context);
+  job->lines = g_array_sized_new (FALSE, FALSE, sizeof (MeasureLine), MEASURE_LINES_PER_JOB);
+  g_array_set_clear_func (job->lines, measure_line_clear);
+
+  return job;
+}
+
+static void
+measure_job_free (gpointer data)
+{
+  MeasureJob *job = data;
+
+  pango_font_description_free (job->font);
+  if (job->matrix)
+    pango_matrix_free (job->matrix);
+  if (job->font_options)
+    cairo_font_options_destroy (job->font_options);
+  g_array_unref (job->lines);
+
+  g_slice_free (MeasureJob, job);
+}
+
+static PangoContext *
+measure_job_create_context (MeasureJob     *job,
+                            PangoDirection  base_dir)
+{
+  PangoContext *context;
+
+  /* The default font map is per thread */
+  context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+  pango_context_set_font_description (context, job->font);
+  pango_context_set_language (context, job->language);
+  pango_context_set_matrix (context, job->matrix);
+  pango_context_set_base_gravity (context, job->gravity);
+  pango_context_set_gravity_hint (context, job->gravity_hint);
+  pango_context_set_base_dir (context, base_dir);
+  pango_cairo_context_set_font_options (context, job->font_options);
+  pango_cairo_context_set_resolution (context, job->resolution);
+
+  return context;
+}
+
+/* Runs in a worker thread */
+static void
+measure_job_run (GTask        *task,
+                 gpointer      source_object,
+                 gpointer      task_data,
+                 GCancellable *cancellable)
+{
+  MeasureJob *job = task_data;
+  PangoContext *ltr_context, *rtl_context;
+  guint i;
+
+  ltr_context = measure_job_create_context (job, PANGO_DIRECTION_LTR);
+  rtl_context = measure_job_create_context (job, PANGO_DIRECTION_RTL);
+
+  for (i = 0; i < job->lines->len; i++)
+    {
+      MeasureLine *ml = &g_array_index (job->lines, MeasureLine, i);
+      PangoRectangle ink_rect, logical_rect;
+      PangoLayout *layout;
+
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
+      /* Same as set_para_values() and gtk_text_layout_measure_line_display() */
+      layout = pango_layout_new (ml->base_dir == PANGO_DIRECTION_RTL ? rtl_context : ltr_context);
+      pango_layout_set_alignment (layout, ml->alignment);
+      pango_layout_set_justify (layout, ml->justify);
+      pango_layout_set_spacing (layout, ml->spacing);
+      if (ml->tabs)
+        pango_layout_set_tabs (layout, ml->tabs);
+      pango_layout_set_indent (layout, ml->indent);
+      pango_layout_set_width (layout, ml->wrap_width);
+      pango_layout_set_wrap (layout, ml->wrap);
+      pango_layout_set_text (layout, ml->text, -1);
+      pango_layout_set_attributes (layout, ml->attrs);
+
+      pango_layout_get_extents (layout, NULL, &logical_rect);
+      ml->width = PIXEL_BOUND (logical_rect.width) + ml->extra_width;
+      ml->height = PANGO_PIXELS (logical_rect.height) + ml->extra_height;
+
+      /* Same as gtk_text_layout_real_wrap() */
+      pango_layout_get_pixel_extents (layout, &ink_rect, &logical_rect);
+      ml->top_ink = MAX (0, logical_rect.x - ink_rect.x);
+      ml->bottom_ink = MAX (0, logical_rect.x + logical_rect.width - ink_rect.x - ink_rect.width);
+
+      g_object_unref (layout);
+    }
+
+  g_object_unref (ltr_context);
+  g_object_unref (rtl_context);
+
+  g_task_return_boolean (task, i == job->lines->len);
+}
+
+static void
+gtk_text_layout_cancel_measuring (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  priv->measure_serial++;
+  priv->measure_line = NULL;
+  g_hash_table_remove_all (priv->measure_lines);
+
+  if (priv->measure_cancellable)
+    {
+      g_cancellable_cancel (priv->measure_cancellable);
+      g_clear_object (&priv->measure_cancellable);
+    }
+}
+
+/* Drops the result for @line of the job measuring it, if any. The
+ * other lines of the job are still good. Also called when @line
+ * goes away, so we must not look at it.
+ */
+static void
+gtk_text_layout_forget_measuring (GtkTextLayout *layout,
+                                  GtkTextLine   *line)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  if (priv->measure_line == line)
+    priv->measure_line = NULL;
+
+  if (g_hash_table_size (priv->measure_lines) > 0)
+    g_hash_table_remove (priv->measure_lines, line);
+}
+
+/* Whether the lines of @layout can be measured in another thread.
+ * Worker threads use their own default font map, so this only works
+ * if the layout uses the default font map, too.
+ */
+static gboolean
+gtk_text_layout_can_measure_in_thread (GtkTextLayout *layout)
+{
+  static int enabled = -1;
+  PangoFontMap *font_map;
+
+  if (enabled < 0)
+    enabled = g_strcmp0 (g_getenv ("GTK_TEXT_VALIDATE_THREADS"), "0") != 0;
+
+  if (!enabled || layout->buffer == NULL ||
+      layout->ltr_context == NULL || layout->rtl_context == NULL)
+    return FALSE;
+
+  font_map = pango_cairo_font_map_get_default ();
+
+  return pango_context_get_font_map (layout->ltr_context) == font_map &&
+         pango_context_get_font_map (layout->rtl_context) == font_map;
+}
+
+/* Collects the text and paragraph values for @line. Returns %FALSE
+ * if the line needs to be measured on the main thread. */
+static gboolean
+gtk_text_layout_prepare_measure_line (GtkTextLayout *layout,
+                                      GtkTextLine   *line,
+                                      MeasureLine   *ml)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextLineDisplay *display;
+  PangoLayout *pango_layout;
+  guint flags;
+
+  /* The cursor line depends on preedit and cursor state */
+  if (line == priv->cursor_line)
+    return FALSE;
+
+  display = gtk_text_layout_create_line_display (layout, line, TRUE, &flags);
+
+  if (flags != 0)
+    {
+      gtk_text_layout_free_line_display (layout, display);
+      return FALSE;
+    }
+
+  pango_layout = display->layout;
+
+  ml->line = line;
+  ml->text = g_strdup (pango_layout_get_text (pango_layout));
+  ml->attrs = pango_attr_list_copy (pango_layout_get_attributes (pango_layout));
+  ml->tabs = pango_layout_get_tabs (pango_layout);
+  ml->base_dir = pango_context_get_base_dir (pango_layout_get_context (pango_layout));
+  ml->alignment = pango_layout_get_alignment (pango_layout);
+  ml->justify = pango_layout_get_justify (pango_layout);
+  ml->wrap = pango_layout_get_wrap (pango_layout);
+  ml->wrap_width = pango_layout_get_width (pango_layout);
+  ml->indent = pango_layout_get_indent (pango_layout);
+  ml->spacing = pango_layout_get_spacing (pango_layout);
+  ml->extra_width = display->left_margin + display->right_margin +
+                    layout->left_padding + layout->right_padding;
+  ml->extra_height = display->height;
+
+  gtk_text_layout_free_line_display (layout, display);
+
+  return TRUE;
+}
+
+static void gtk_text_layout_queue_measuring (GtkTextLayout *layout);
+
+static void
+measure_job_done (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      data)
+{
+  GtkTextLayout *layout = GTK_TEXT_LAYOUT (source);
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  MeasureJob *job = g_task_get_task_data (G_TASK (result));
+  GtkTextBTree *btree;
+  GtkTextLine *prev;
+  gint y, old_height, new_height;
+  gboolean done;
+  guint i;
+
+  priv->n_measure_jobs--;
+
+  done = g_task_propagate_boolean (G_TASK (result), NULL);
+
+  if (!done ||
+      job->serial != priv->measure_serial ||
+      layout->buffer == NULL)
+    {
+      /* Stale results, continue with the current state. Lines that
+       * went away are not in measure_lines, so we only compare the
+       * pointers here.
+       */
+      for (i = 0; i < job->lines->len; i++)
+        {
+          GtkTextLine *line = g_array_index (job->lines, MeasureLine, i).line;
 
-          /* Display visible marks */
+          if (g_hash_table_lookup (priv->measure_lines, line) == job)
+            g_hash_table_remove (priv->measure_lines, line);
+        }
 
-          if (seg->body.mark.visible)
-            {
-              cursor_byte_offsets = g_slist_prepend (cursor_byte_offsets,
-                                                     GINT_TO_POINTER (layout_byte_offset + cursor_offset));
-              cursor_segs = g_slist_prepend (cursor_segs, seg);
-            }
+      gtk_text_layout_queue_measuring (layout);
+      return;
+    }
+
+  btree = _gtk_text_buffer_get_btree (layout->buffer);
+
+  /* Lines that were invalidated while the job ran have been dropped
+   * from measure_lines, their results are stale and they stay
+   * invalid. The remaining lines are reported as one change per run
+   * of consecutive lines.
+   */
+  prev = NULL;
+  y = old_height = new_height = 0;
+
+  for (i = 0; i < job->lines->len; i++)
+    {
+      MeasureLine *ml = &g_array_index (job->lines, MeasureLine, i);
+      GtkTextLineData *ld;
+
+      if (g_hash_table_lookup (priv->measure_lines, ml->line) != job)
+        continue;
+
+      g_hash_table_remove (priv->measure_lines, ml->line);
+
+      if (prev != NULL && _gtk_text_line_next_excluding_last (prev) != ml->line)
+        {
+          _gtk_text_btree_line_data_changed (btree, prev, layout);
+          update_layout_size (layout);
+          gtk_text_layout_emit_changed (layout, y, old_height, new_height);
+          prev = NULL;
         }
 
-      else
-        g_error ("Unknown segment type: %s", seg->type->name);
+      if (prev == NULL)
+        {
+          y = _gtk_text_btree_find_line_top (btree, ml->line, layout);
+          old_height = new_height = 0;
+        }
+      else if (prev->parent != ml->line->parent)
+        _gtk_text_btree_line_data_changed (btree, prev, layout);
 
-      seg = seg->next;
+      ld = _gtk_text_line_get_data (ml->line, layout);
+      old_height += ld->height;
+
+      /* The line may have been validated on screen in the meantime */
+      if (!ld->valid)
+        {
+          ld->width = ml->width;
+          ld->height = ml->height;
+          ld->top_ink = ml->top_ink;
+          ld->bottom_ink = ml->bottom_ink;
+          ld->valid = TRUE;
+        }
+
+      new_height += ld->height;
+      prev = ml->line;
     }
-  
-  if (!para_values_set)
+
+  if (prev != NULL)
     {
-      style = get_style (layout, tags);
-      set_para_values (layout, base_dir, style, display);
-      release_style (layout, style);
+      _gtk_text_btree_line_data_changed (btree, prev, layout);
+      update_layout_size (layout);
+      gtk_text_layout_emit_changed (layout, y, old_height, new_height);
     }
-  
-  /* Pango doesn't want the trailing paragraph delimiters */
 
-  {
-    /* Only one character has type G_UNICODE_PARAGRAPH_SEPARATOR in
-     * Unicode 3.0; update this if that changes.
-     */
-#define PARAGRAPH_SEPARATOR 0x2029
-    gunichar ch = 0;
+  gtk_text_layout_queue_measuring (layout);
+}
 
-    if (layout_byte_offset > 0)
-      {
-        const char *prev = g_utf8_prev_char (text + layout_byte_offset);
-        ch = g_utf8_get_char (prev);
-        if (ch == PARAGRAPH_SEPARATOR || ch == '\r' || ch == '\n')
-          layout_byte_offset = prev - text; /* chop off */
+static void
+gtk_text_layout_queue_measuring (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextBTree *btree;
+  guint max_jobs;
 
-        if (ch == '\n' && layout_byte_offset > 0)
-          {
-            /* Possibly chop a CR as well */
-            prev = g_utf8_prev_char (text + layout_byte_offset);
-            if (*prev == '\r')
-              --layout_byte_offset;
-          }
-      }
-  }
-  
-  pango_layout_set_text (display->layout, text, layout_byte_offset);
-  pango_layout_set_attributes (display->layout, attrs);
+  if (!priv->measure_in_thread || layout->buffer == NULL)
+    return;
 
-  tmp_list1 = cursor_byte_offsets;
-  tmp_list2 = cursor_segs;
-  while (tmp_list1)
+  if (gtk_text_layout_is_valid (layout))
     {
-      add_cursor (layout, display, tmp_list2->data,
-                  GPOINTER_TO_INT (tmp_list1->data));
-      tmp_list1 = tmp_list1->next;
-      tmp_list2 = tmp_list2->next;
+      priv->measure_in_thread = FALSE;
+      return;
     }
-  g_slist_free (cursor_byte_offsets);
-  g_slist_free (cursor_segs);
 
-  pango_layout_get_extents (display->layout, NULL, &extents);
+  btree = _gtk_text_buffer_get_btree (layout->buffer);
+  max_jobs = CLAMP (g_get_num_processors (), 1, 4);
 
-  text_pixel_width = PIXEL_BOUND (extents.width);
-  display->width = text_pixel_width + display->left_margin + display->right_margin;
+  while (priv->n_measure_jobs < max_jobs)
+    {
+      GtkTextLine *line;
+      MeasureJob *job;
+      GTask *task;
 
-  h_margin = display->left_margin + display->right_margin;
-  h_padding = layout->left_padding + layout->right_padding;
+      line = priv->measure_line;
+      if (line == NULL)
+        {
+          /* Don't look for invalid lines while jobs are running, we'd
+           * find the lines they are measuring.
+           */
+          if (priv->n_measure_jobs > 0)
+            break;
 
-  display->width = text_pixel_width + h_margin + h_padding;
-  display->height += PANGO_PIXELS (extents.height);
+          line = _gtk_text_btree_find_first_invalid_line (btree, layout);
+          if (line == NULL)
+            break;
+        }
 
-  /* If we aren't wrapping, we need to do the alignment of each
-   * paragraph ourselves.
-   */
-  if (pango_layout_get_width (display->layout) < 0)
-    {
-      gint excess = display->total_width - text_pixel_width;
+      job = measure_job_new (layout, priv->measure_serial);
 
-      switch (pango_layout_get_alignment (display->layout))
-	{
-	case PANGO_ALIGN_LEFT:
-        default:
-	  break;
-	case PANGO_ALIGN_CENTER:
-	  display->x_offset += excess / 2;
-	  break;
-	case PANGO_ALIGN_RIGHT:
-	  display->x_offset += excess;
-	  break;
-	}
-    }
-  
-  /* Free this if we aren't in a loop */
-  if (layout->wrap_loop_count == 0)
-    invalidate_cached_style (layout);
+      gtk_text_layout_wrap_loop_start (layout);
 
-  g_free (text);
-  pango_attr_list_unref (attrs);
-  if (tags != NULL)
-    g_ptr_array_free (tags, TRUE);
+      while (line != NULL && job->lines->len < MEASURE_LINES_PER_JOB)
+        {
+          GtkTextLineData *ld = _gtk_text_line_get_data (line, layout);
+          MeasureLine ml = { NULL, };
 
-  layout->one_display_cache = display;
+          if (ld && ld->valid)
+            {
+              /* Keep the lines of a job consecutive */
+              if (job->lines->len > 0)
+                break;
 
-  if (saw_widget)
-    allocate_child_widgets (layout, display);
-  
-  return display;
+              /* We skip the toggles in this line */
+              invalidate_cached_style (layout);
+            }
+          else if (gtk_text_layout_prepare_measure_line (layout, line, &ml))
+            {
+              if (ld == NULL)
+                {
+                  ld = _gtk_text_line_data_new (layout, line);
+                  _gtk_text_line_add_data (line, ld);
+                }
+              g_array_append_val (job->lines, ml);
+              g_hash_table_insert (priv->measure_lines, line, job);
+            }
+          else
+            {
+              if (job->lines->len > 0)
+                break;
+
+              _gtk_text_btree_validate_line (btree, line, layout);
+            }
+
+          line = _gtk_text_line_next_excluding_last (line);
+        }
+
+      gtk_text_layout_wrap_loop_end (layout);
+
+      priv->measure_line = line;
+
+      if (job->lines->len == 0)
+        {
+          measure_job_free (job);
+          continue;
+        }
+
+      if (priv->measure_cancellable == NULL)
+        priv->measure_cancellable = g_cancellable_new ();
+
+      task = g_task_new (layout, priv->measure_cancellable, measure_job_done, NULL);
+      g_task_set_source_tag (task, gtk_text_layout_queue_measuring);
+      g_task_set_task_data (task, job, measure_job_free);
+      g_task_run_in_thread (task, measure_job_run);
+      g_object_unref (task);
+
+      priv->n_measure_jobs++;
+    }
+
+  if (priv->n_measure_jobs == 0 && gtk_text_layout_is_valid (layout))
+    priv->measure_in_thread = FALSE;
 }
 
-void
-gtk_text_layout_free_line_display (GtkTextLayout      *layout,
-                                   GtkTextLineDisplay *display)
+/**
+ * gtk_text_layout_validate_in_thread:
+ * @layout: a #GtkTextLayout
+ *
+ * Starts validating @layout by measuring its invalid lines in worker
+ * threads. The results are stored in the main loop, emitting
+ * #GtkTextLayout::changed for them like gtk_text_layout_validate()
+ * does, until the layout is valid.
+ *
+ * Lines that can't be measured in a thread, such as lines with
+ * embedded widgets, get validated right away.
+ *
+ * Returns: %TRUE if validation is going on in threads, %FALSE if
+ *   the caller needs to validate with gtk_text_layout_validate()
+ */
+gboolean
+gtk_text_layout_validate_in_thread (GtkTextLayout *layout)
 {
-  if (display != layout->one_display_cache)
-    {
-      if (display->layout)
-        g_object_unref (display->layout);
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
 
-      if (display->cursors)
-        g_array_free (display->cursors, TRUE);
+  g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), FALSE);
 
-      if (display->pg_bg_rgba)
-        gdk_rgba_free (display->pg_bg_rgba);
+  if (!gtk_text_layout_can_measure_in_thread (layout))
+    return FALSE;
 
-      g_slice_free (GtkTextLineDisplay, display);
-    }
+  priv->measure_in_thread = TRUE;
+  gtk_text_layout_queue_measuring (layout);
+
+  return priv->measure_in_thread;
 }
 
 /* Functions to convert iter <=> index for the line of a GtkTextLineDisplay
@@ -2772,6 +4007,8 @@ gtk_text_layout_get_iter_at_position (GtkTextLayout *layout,
   gint byte_index;
   gint line_top;
   GtkTextLineDisplay *display;
+  PangoLayout *pango_layout;
+  gint start, chunk_y;
   gboolean inside;
 
   g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), FALSE);
@@ -2801,8 +4038,10 @@ gtk_text_layout_get_iter_at_position (GtkTextLayout *layout,
         * the right thing even if we are outside the layout in the
         * x-direction.
         */
-      inside = pango_layout_xy_to_index (display->layout, x * PANGO_SCALE, y * PANGO_SCALE,
+      pango_layout = line_display_get_layout_at_y (layout, display, y, &start, &chunk_y);
+      inside = pango_layout_xy_to_index (pango_layout, x * PANGO_SCALE, (y - chunk_y) * PANGO_SCALE,
                                          &byte_index, trailing);
+      byte_index += start;
     }
 
   line_display_index_to_iter (layout, display, target_iter, byte_index, 0);
@@ -2840,6 +4079,8 @@ gtk_text_layout_get_cursor_locations (GtkTextLayout  *layout,
   gint line_top;
   gint index;
   GtkTextIter insert_iter;
+  PangoLayout *pango_layout;
+  gint start, chunk_y;
 
   PangoRectangle pango_strong_pos;
   PangoRectangle pango_weak_pos;
@@ -2860,14 +4101,15 @@ gtk_text_layout_get_cursor_locations (GtkTextLayout  *layout,
   if (gtk_text_iter_equal (iter, &insert_iter))
     index += layout->preedit_cursor - layout->preedit_len;
   
-  pango_layout_get_cursor_pos (display->layout, index,
+  pango_layout = line_display_get_layout_at_index (layout, display, index, &start, &chunk_y);
+  pango_layout_get_cursor_pos (pango_layout, index - start,
 			       strong_pos ? &pango_strong_pos : NULL,
 			       weak_pos ? &pango_weak_pos : NULL);
 
   if (strong_pos)
     {
       strong_pos->x = display->x_offset + pango_strong_pos.x / PANGO_SCALE;
-      strong_pos->y = line_top + display->top_margin + pango_strong_pos.y / PANGO_SCALE;
+      strong_pos->y = line_top + display->top_margin + chunk_y + pango_strong_pos.y / PANGO_SCALE;
       strong_pos->width = 0;
       strong_pos->height = pango_strong_pos.height / PANGO_SCALE;
     }
@@ -2875,7 +4117,7 @@ gtk_text_layout_get_cursor_locations (GtkTextLayout  *layout,
   if (weak_pos)
     {
       weak_pos->x = display->x_offset + pango_weak_pos.x / PANGO_SCALE;
-      weak_pos->y = line_top + display->top_margin + pango_weak_pos.y / PANGO_SCALE;
+      weak_pos->y = line_top + display->top_margin + chunk_y + pango_weak_pos.y / PANGO_SCALE;
       weak_pos->width = 0;
       weak_pos->height = pango_weak_pos.height / PANGO_SCALE;
     }
@@ -2981,6 +4223,71 @@ gtk_text_layout_get_line_yrange (GtkTextLayout     *layout,
     }
 }
 
+/*
+ * gtk_text_layout_get_line_metrics:
+ * @layout: a #GtkTextLayout
+ * @iter: a #GtkTextIter
+ * @width: (out) (optional): the width of the paragraph
+ * @height: (out) (optional): the height of the paragraph
+ * @top_ink: (out) (optional): ink above the paragraph
+ * @bottom_ink: (out) (optional): ink below the paragraph
+ *
+ * Gets the size that was stored for the paragraph containing @iter
+ * when it was validated. This is meant for tests.
+ *
+ * Returns: %TRUE if the paragraph is valid
+ */
+gboolean
+gtk_text_layout_get_line_metrics (GtkTextLayout     *layout,
+                                  const GtkTextIter *iter,
+                                  gint              *width,
+                                  gint              *height,
+                                  gint              *top_ink,
+                                  gint              *bottom_ink)
+{
+  GtkTextLineData *line_data;
+
+  g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), FALSE);
+  g_return_val_if_fail (_gtk_text_iter_get_btree (iter) == _gtk_text_buffer_get_btree (layout->buffer), FALSE);
+
+  line_data = _gtk_text_line_get_data (_gtk_text_iter_get_text_line (iter), layout);
+  if (line_data == NULL || !line_data->valid)
+    return FALSE;
+
+  if (width)
+    *width = line_data->width;
+  if (height)
+    *height = line_data->height;
+  if (top_ink)
+    *top_ink = line_data->top_ink;
+  if (bottom_ink)
+    *bottom_ink = line_data->bottom_ink;
+
+  return TRUE;
+}
+
+/*
+ * gtk_text_layout_has_chunk_sizes:
+ * @layout: a #GtkTextLayout
+ * @iter: a #GtkTextIter
+ *
+ * Checks whether sizes of shaped chunks are kept for the long
+ * paragraph containing @iter. This is meant for tests.
+ *
+ * Returns: %TRUE if chunk sizes are kept for the paragraph
+ */
+gboolean
+gtk_text_layout_has_chunk_sizes (GtkTextLayout     *layout,
+                                 const GtkTextIter *iter)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), FALSE);
+  g_return_val_if_fail (_gtk_text_iter_get_btree (iter) == _gtk_text_buffer_get_btree (layout->buffer), FALSE);
+
+  return g_hash_table_contains (priv->chunk_sizes, _gtk_text_iter_get_text_line (iter));
+}
+
 void
 gtk_text_layout_get_iter_location (GtkTextLayout     *layout,
                                    const GtkTextIter *iter,
@@ -2990,8 +4297,10 @@ gtk_text_layout_get_iter_location (GtkTextLayout     *layout,
   GtkTextLine *line;
   GtkTextBTree *tree;
   GtkTextLineDisplay *display;
+  PangoLayout *pango_layout;
   gint byte_index;
   gint x_offset;
+  gint start, chunk_y;
   
   g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
   g_return_if_fail (_gtk_text_iter_get_btree (iter) == _gtk_text_buffer_get_btree (layout->buffer));
@@ -3008,10 +4317,11 @@ gtk_text_layout_get_iter_location (GtkTextLayout     *layout,
 
   byte_index = gtk_text_iter_get_line_index (iter);
   
-  pango_layout_index_to_pos (display->layout, byte_index, &pango_rect);
+  pango_layout = line_display_get_layout_at_index (layout, display, byte_index, &start, &chunk_y);
+  pango_layout_index_to_pos (pango_layout, byte_index - start, &pango_rect);
   
   rect->x = PANGO_PIXELS (x_offset + pango_rect.x);
-  rect->y += PANGO_PIXELS (pango_rect.y) + display->top_margin;
+  rect->y += PANGO_PIXELS (pango_rect.y) + display->top_margin + chunk_y;
   rect->width = PANGO_PIXELS (pango_rect.width);
   rect->height = PANGO_PIXELS (pango_rect.height);
 
@@ -3050,32 +4360,48 @@ find_display_line_below (GtkTextLayout *layout,
     {
       GtkTextLineDisplay *display = gtk_text_layout_get_line_display (layout, line, FALSE);
       PangoLayoutIter *layout_iter;
-
-      layout_iter = pango_layout_get_iter (display->layout);
+      gint tmp_top;
+      guint i;
 
       line_top += display->top_margin;
+      tmp_top = line_top;
 
-      do
+      for (i = 0; i < line_display_get_n_layouts (display) && !found_line; i++)
         {
-          gint first_y, last_y;
-          PangoLayoutLine *layout_line = pango_layout_iter_get_line_readonly (layout_iter);
+          PangoLayout *pango_layout;
+          gint start, chunk_y;
 
-          found_byte = layout_line->start_index;
-          
-          if (line_top >= y)
+          /* Skip chunks that end above y without shaping them */
+          if (i + 1 < line_display_get_n_layouts (display) &&
+              line_top + g_array_index (display->chunks, GtkTextLineChunk, i + 1).y <= y)
+            continue;
+
+          pango_layout = line_display_get_layout (layout, display, i, &start, &chunk_y);
+          layout_iter = pango_layout_get_iter (pango_layout);
+          tmp_top = line_top + chunk_y;
+
+          do
             {
-              found_line = line;
-              break;
+              gint first_y, last_y;
+              PangoLayoutLine *layout_line = pango_layout_iter_get_line_readonly (layout_iter);
+
+              found_byte = start + layout_line->start_index;
+
+              if (tmp_top >= y)
+                {
+                  found_line = line;
+                  break;
+                }
+
+              pango_layout_iter_get_line_yrange (layout_iter, &first_y, &last_y);
+              tmp_top += (last_y - first_y) / PANGO_SCALE;
             }
+          while (pango_layout_iter_next_line (layout_iter));
 
-          pango_layout_iter_get_line_yrange (layout_iter, &first_y, &last_y);
-          line_top += (last_y - first_y) / PANGO_SCALE;
+          pango_layout_iter_free (layout_iter);
         }
-      while (pango_layout_iter_next_line (layout_iter));
 
-      pango_layout_iter_free (layout_iter);
-      
-      line_top += display->bottom_margin;
+      line_top = tmp_top + display->bottom_margin;
       gtk_text_layout_free_line_display (layout, display);
 
       next = _gtk_text_line_next_excluding_last (line);
@@ -3116,36 +4442,49 @@ find_display_line_above (GtkTextLayout *layout,
       PangoRectangle logical_rect;
       PangoLayoutIter *layout_iter;
       gint tmp_top;
+      guint i;
 
-      layout_iter = pango_layout_get_iter (display->layout);
-      
       line_top -= display->top_margin + display->bottom_margin;
-      pango_layout_iter_get_layout_extents (layout_iter, NULL, &logical_rect);
-      line_top -= logical_rect.height / PANGO_SCALE;
+      if (display->chunks != NULL)
+        line_top -= display->height - display->top_margin - display->bottom_margin;
+      else
+        {
+          pango_layout_get_extents (display->layout, NULL, &logical_rect);
+          line_top -= logical_rect.height / PANGO_SCALE;
+        }
 
       tmp_top = line_top + display->top_margin;
 
-      do
+      for (i = 0; i < line_display_get_n_layouts (display); i++)
         {
-          gint first_y, last_y;
-          PangoLayoutLine *layout_line = pango_layout_iter_get_line_readonly (layout_iter);
+          PangoLayout *pango_layout;
+          gint start;
 
-          found_byte = layout_line->start_index;
+          pango_layout = line_display_get_layout (layout, display, i, &start, NULL);
+          layout_iter = pango_layout_get_iter (pango_layout);
 
-          pango_layout_iter_get_line_yrange (layout_iter, &first_y, &last_y);
-          
-          tmp_top -= (last_y - first_y) / PANGO_SCALE;
-
-          if (tmp_top < y)
+          do
             {
-              found_line = line;
-	      pango_layout_iter_free (layout_iter);
-              goto done;
+              gint first_y, last_y;
+              PangoLayoutLine *layout_line = pango_layout_iter_get_line_readonly (layout_iter);
+
+              found_byte = start + layout_line->start_index;
+
+              pango_layout_iter_get_line_yrange (layout_iter, &first_y, &last_y);
+
+              tmp_top -= (last_y - first_y) / PANGO_SCALE;
+
+              if (tmp_top < y)
+                {
+                  found_line = line;
+                  pango_layout_iter_free (layout_iter);
+                  goto done;
+                }
             }
-        }
-      while (pango_layout_iter_next_line (layout_iter));
+          while (pango_layout_iter_next_line (layout_iter));
 
-      pango_layout_iter_free (layout_iter);
+          pango_layout_iter_free (layout_iter);
+        }
       
       gtk_text_layout_free_line_display (layout, display);
 
@@ -3220,7 +4559,9 @@ gtk_text_layout_move_iter_to_previous_line (GtkTextLayout *layout,
 {
   GtkTextLine *line;
   GtkTextLineDisplay *display;
+  PangoLayout *pango_layout;
   gint line_byte;
+  gint start;
   GSList *tmp_list;
   PangoLayoutLine *layout_line;
   GtkTextIter orig;
@@ -3258,15 +4599,32 @@ gtk_text_layout_move_iter_to_previous_line (GtkTextLayout *layout,
       update_byte = TRUE;
     }
   
-  tmp_list = pango_layout_get_lines_readonly (display->layout);
-  layout_line = tmp_list->data;
-
   if (update_byte)
     {
+      pango_layout = line_display_get_layout (layout, display, 0, NULL, NULL);
+      layout_line = pango_layout_get_lines_readonly (pango_layout)->data;
       line_byte = layout_line->start_index + layout_line->length;
     }
 
-  if (line_byte < layout_line->length || !tmp_list->next) /* first line of paragraph */
+  pango_layout = line_display_get_layout_at_index (layout, display, line_byte, &start, NULL);
+  line_byte -= start;
+
+  tmp_list = pango_layout_get_lines_readonly (pango_layout);
+  layout_line = tmp_list->data;
+
+  if (start > 0 &&
+      (line_byte < layout_line->length || !tmp_list->next)) /* first line of a chunk */
+    {
+      guint chunk;
+
+      chunk = _gtk_text_line_display_get_chunk_at_index (display, start);
+      pango_layout = line_display_get_layout (layout, display, chunk - 1, &start, NULL);
+      layout_line = g_slist_last (pango_layout_get_lines_readonly (pango_layout))->data;
+
+      line_display_index_to_iter (layout, display, iter,
+                                  start + layout_line->start_index, 0);
+    }
+  else if (line_byte < layout_line->length || !tmp_list->next) /* first line of paragraph */
     {
       GtkTextLine *prev_line;
 
@@ -3284,11 +4642,14 @@ gtk_text_layout_move_iter_to_previous_line (GtkTextLayout *layout,
 
           if (display->height > 0)
             {
-              tmp_list = g_slist_last (pango_layout_get_lines_readonly (display->layout));
+              pango_layout = line_display_get_layout (layout, display,
+                                                      line_display_get_n_layouts (display) - 1,
+                                                      &start, NULL);
+              tmp_list = g_slist_last (pango_layout_get_lines_readonly (pango_layout));
               layout_line = tmp_list->data;
 
               line_display_index_to_iter (layout, display, iter,
-                                          layout_line->start_index + layout_line->length, 0);
+                                          start + layout_line->start_index + layout_line->length, 0);
               break;
             }
 
@@ -3307,7 +4668,7 @@ gtk_text_layout_move_iter_to_previous_line (GtkTextLayout *layout,
           if (line_byte < layout_line->start_index + layout_line->length ||
               !tmp_list->next)
             {
- 	      line_display_index_to_iter (layout, display, iter, prev_offset, 0);
+ 	      line_display_index_to_iter (layout, display, iter, start + prev_offset, 0);
               break;
             }
 
@@ -3356,6 +4717,7 @@ gtk_text_layout_move_iter_to_next_line (GtkTextLayout *layout,
   while (line && !found_after)
     {
       GSList *tmp_list;
+      guint i;
 
       display = gtk_text_layout_get_line_display (layout, line, FALSE);
 
@@ -3369,22 +4731,33 @@ gtk_text_layout_move_iter_to_next_line (GtkTextLayout *layout,
 	}
       else
 	line_byte = 0;
-	
-      tmp_list = pango_layout_get_lines_readonly (display->layout);
-      while (tmp_list && !found_after)
+
+      for (i = _gtk_text_line_display_get_chunk_at_index (display, line_byte);
+           i < line_display_get_n_layouts (display) && !found_after;
+           i++)
         {
-          PangoLayoutLine *layout_line = tmp_list->data;
+          PangoLayout *pango_layout;
+          gint start;
+
+          pango_layout = line_display_get_layout (layout, display, i, &start, NULL);
 
-          if (found)
+          tmp_list = pango_layout_get_lines_readonly (pango_layout);
+          while (tmp_list && !found_after)
             {
-	      line_display_index_to_iter (layout, display, iter,
-                                          layout_line->start_index, 0);
-              found_after = TRUE;
+              PangoLayoutLine *layout_line = tmp_list->data;
+
+              if (found)
+                {
+                  line_display_index_to_iter (layout, display, iter,
+                                              start + layout_line->start_index, 0);
+                  found_after = TRUE;
+                }
+              else if (line_byte < start + layout_line->start_index + layout_line->length ||
+                       !tmp_list->next)
+                found = TRUE;
+
+              tmp_list = tmp_list->next;
             }
-          else if (line_byte < layout_line->start_index + layout_line->length || !tmp_list->next)
-            found = TRUE;
-          
-          tmp_list = tmp_list->next;
         }
 
     next:
@@ -3417,7 +4790,9 @@ gtk_text_layout_move_iter_to_line_end (GtkTextLayout *layout,
 {
   GtkTextLine *line;
   GtkTextLineDisplay *display;
+  PangoLayout *pango_layout;
   gint line_byte;
+  gint start;
   GSList *tmp_list;
   GtkTextIter orig;
   
@@ -3430,7 +4805,10 @@ gtk_text_layout_move_iter_to_line_end (GtkTextLayout *layout,
   display = gtk_text_layout_get_line_display (layout, line, FALSE);
   line_byte = line_display_iter_to_index (layout, display, iter);
 
-  tmp_list = pango_layout_get_lines_readonly (display->layout);
+  pango_layout = line_display_get_layout_at_index (layout, display, line_byte, &start, NULL);
+  line_byte -= start;
+
+  tmp_list = pango_layout_get_lines_readonly (pango_layout);
   while (tmp_list)
     {
       PangoLayoutLine *layout_line = tmp_list->data;
@@ -3438,7 +4816,7 @@ gtk_text_layout_move_iter_to_line_end (GtkTextLayout *layout,
       if (line_byte < layout_line->start_index + layout_line->length || !tmp_list->next)
         {
  	  line_display_index_to_iter (layout, display, iter,
- 				      direction < 0 ? layout_line->start_index : layout_line->start_index + layout_line->length,
+ 				      start + (direction < 0 ? layout_line->start_index : layout_line->start_index + layout_line->length),
  				      0);
 
           /* FIXME: As a bad hack, we move back one position when we
@@ -3476,7 +4854,9 @@ gtk_text_layout_iter_starts_line (GtkTextLayout       *layout,
 {
   GtkTextLine *line;
   GtkTextLineDisplay *display;
+  PangoLayout *pango_layout;
   gint line_byte;
+  gint start;
   GSList *tmp_list;
   
   g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), FALSE);
@@ -3486,7 +4866,10 @@ gtk_text_layout_iter_starts_line (GtkTextLayout       *layout,
   display = gtk_text_layout_get_line_display (layout, line, FALSE);
   line_byte = line_display_iter_to_index (layout, display, iter);
 
-  tmp_list = pango_layout_get_lines_readonly (display->layout);
+  pango_layout = line_display_get_layout_at_index (layout, display, line_byte, &start, NULL);
+  line_byte -= start;
+
+  tmp_list = pango_layout_get_lines_readonly (pango_layout);
   while (tmp_list)
     {
       PangoLayoutLine *layout_line = tmp_list->data;
@@ -3494,15 +4877,15 @@ gtk_text_layout_iter_starts_line (GtkTextLayout       *layout,
       if (line_byte < layout_line->start_index + layout_line->length ||
           !tmp_list->next)
         {
+          gboolean result;
+
           /* We're located on this line or the para delimiters before
            * it
            */
+          result = line_byte == layout_line->start_index;
           gtk_text_layout_free_line_display (layout, display);
-          
-          if (line_byte == layout_line->start_index)
-            return TRUE;
-          else
-            return FALSE;
+
+          return result;
         }
       
       tmp_list = tmp_list->next;
@@ -3539,7 +4922,9 @@ gtk_text_layout_move_iter_to_x (GtkTextLayout *layout,
 {
   GtkTextLine *line;
   GtkTextLineDisplay *display;
+  PangoLayout *pango_layout;
   gint line_byte;
+  gint start;
   PangoLayoutIter *layout_iter;
   
   g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
@@ -3550,7 +4935,10 @@ gtk_text_layout_move_iter_to_x (GtkTextLayout *layout,
   display = gtk_text_layout_get_line_display (layout, line, FALSE);
   line_byte = line_display_iter_to_index (layout, display, iter);
 
-  layout_iter = pango_layout_get_iter (display->layout);
+  pango_layout = line_display_get_layout_at_index (layout, display, line_byte, &start, NULL);
+  line_byte -= start;
+
+  layout_iter = pango_layout_get_iter (pango_layout);
 
   do
     {
@@ -3569,7 +4957,7 @@ gtk_text_layout_move_iter_to_x (GtkTextLayout *layout,
                                         x * PANGO_SCALE - x_offset - logical_rect.x,
                                         &byte_index, &trailing);
 
- 	  line_display_index_to_iter (layout, display, iter, byte_index, trailing);
+ 	  line_display_index_to_iter (layout, display, iter, start + byte_index, trailing);
 
           break;
         }
@@ -3581,6 +4969,46 @@ gtk_text_layout_move_iter_to_x (GtkTextLayout *layout,
   gtk_text_layout_free_line_display (layout, display);
 }
 
+/* Like pango_layout_move_cursor_visually(), but for all of @display,
+ * continuing in the neighbouring chunk when moving off one.
+ */
+static void
+line_display_move_cursor_visually (GtkTextLayout      *layout,
+                                   GtkTextLineDisplay *display,
+                                   gboolean            strong,
+                                   gint                index,
+                                   gint                direction,
+                                   gint               *new_index,
+                                   gint               *new_trailing)
+{
+  PangoLayout *pango_layout;
+  guint i;
+  gint start;
+
+  i = _gtk_text_line_display_get_chunk_at_index (display, index);
+  pango_layout = line_display_get_layout (layout, display, i, &start, NULL);
+  pango_layout_move_cursor_visually (pango_layout, strong, index - start, 0, direction,
+                                     new_index, new_trailing);
+
+  if (*new_index < 0 && i > 0)
+    {
+      GtkTextLineChunk *prev = &g_array_index (display->chunks, GtkTextLineChunk, i - 1);
+
+      pango_layout = line_display_get_layout (layout, display, i - 1, &start, NULL);
+      pango_layout_move_cursor_visually (pango_layout, strong, prev->length, 0, direction,
+                                         new_index, new_trailing);
+    }
+  else if (*new_index == G_MAXINT && i + 1 < line_display_get_n_layouts (display))
+    {
+      /* The end of this chunk is the start of the next one */
+      *new_index = g_array_index (display->chunks, GtkTextLineChunk, i).length;
+      *new_trailing = 0;
+    }
+
+  if (*new_index >= 0 && *new_index != G_MAXINT)
+    *new_index += start;
+}
+
 /**
  * gtk_text_layout_move_iter_visually:
  * @layout:  a #GtkTextLayout
@@ -3638,12 +5066,12 @@ gtk_text_layout_move_iter_visually (GtkTextLayout *layout,
 
       if (count > 0)
         {
-          pango_layout_move_cursor_visually (display->layout, strong, line_byte, 0, 1, &new_index, &new_trailing);
+          line_display_move_cursor_visually (layout, display, strong, line_byte, 1, &new_index, &new_trailing);
           count--;
         }
       else
         {
-          pango_layout_move_cursor_visually (display->layout, strong, line_byte, 0, -1, &new_index, &new_trailing);
+          line_display_move_cursor_visually (layout, display, strong, line_byte, -1, &new_index, &new_trailing);
           count++;
         }
 
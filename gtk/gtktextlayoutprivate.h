@@ -99,6 +99,7 @@ typedef struct _GtkTextLineData GtkTextLineData;
 typedef struct _GtkTextLayout         GtkTextLayout;
 typedef struct _GtkTextLayoutClass    GtkTextLayoutClass;
 typedef struct _GtkTextLineDisplay    GtkTextLineDisplay;
+typedef struct _GtkTextLineChunk      GtkTextLineChunk;
 typedef struct _GtkTextAttrAppearance GtkTextAttrAppearance;
 
 struct _GtkTextLayout
@@ -138,10 +139,22 @@ struct _GtkTextLayout
    * over long runs with the same style. */
   GtkTextAttributes *one_style_cache;
 
-  /* A cache of one line display. Getting the same line
-   * many times in a row is the most common case.
+  /* A cache of recently used line displays, keyed by line.
+   * Drawing and cursor movement get the same lines over and
+   * over, so we keep the most recently used ones around.
    */
-  GtkTextLineDisplay *one_display_cache;
+  GHashTable *display_cache;
+  GQueue display_lru; /* of GtkTextLineDisplay, most recently used first */
+  guint display_cache_size;
+
+  /* Colors the render nodes of the cached line displays were
+   * drawn with. If they change, node_serial is bumped and the
+   * nodes get redrawn.
+   */
+  GdkRGBA node_fg_rgba;
+  GdkRGBA node_selection_fg_rgba;
+  GdkRGBA node_selection_bg_rgba;
+  guint node_serial;
 
   /* Whether we are allowed to wrap right now */
   gint wrap_loop_count;
@@ -218,6 +231,27 @@ struct _GtkTextAttrAppearance
   GtkTextAppearance appearance;
 };
 
+/* A part of a very long paragraph. When wrapping, such paragraphs
+ * are split into chunks that are shaped independently and only
+ * once they are needed, see _gtk_text_layout_get_chunk_layout().
+ */
+struct _GtkTextLineChunk
+{
+  PangoLayout *layout;          /* NULL until the chunk is shaped */
+  PangoAttrList *attrs;
+  gint start;                   /* Byte index of the chunk within para */
+  gint length;
+  gint y;                       /* Offset from the top of the para text */
+  gint width;
+  gint height;                  /* Estimated until the chunk is shaped */
+
+  /* The rendered chunk, like the node of the line display */
+  GskRenderNode *node;
+  gint node_selection_start;
+  gint node_selection_end;
+  guint node_serial;
+};
+
 struct _GtkTextLineDisplay
 {
   PangoLayout *layout;
@@ -247,6 +281,25 @@ struct _GtkTextLineDisplay
   guint size_only : 1;
 
   GdkRGBA *pg_bg_rgba;
+
+  /* The rendered paragraph, so unchanged lines can be redrawn
+   * without going through Pango again. Only valid for the
+   * selection and node serial it was drawn with.
+   */
+  GskRenderNode *node;
+  gint node_selection_start;
+  gint node_selection_end;
+  guint node_serial;
+
+  /* The chunks of a very long paragraph, or NULL. The layout of
+   * such a display has no text, its chunks are laid out with copies
+   * of it.
+   */
+  GArray *chunks;               /* of GtkTextLineChunk */
+  gchar *chunk_text;
+
+  guint ref_count;
+  GList cache_link; /* data is set while in the layout's display cache */
 };
 
 #ifdef GTK_COMPILATION
@@ -367,6 +420,11 @@ void     gtk_text_layout_validate_yrange (GtkTextLayout *layout,
 GDK_AVAILABLE_IN_ALL
 void     gtk_text_layout_validate        (GtkTextLayout *layout,
                                           gint           max_pixels);
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_layout_validate_in_thread (GtkTextLayout *layout);
+
+void     gtk_text_layout_set_display_cache_lines (GtkTextLayout *layout,
+                                                  guint          n_lines);
 
 /* This function should return the passed-in line data,
  * OR remove the existing line data from the line, and
@@ -399,12 +457,28 @@ void     gtk_text_layout_get_line_yrange      (GtkTextLayout     *layout,
                                                gint              *y,
                                                gint              *height);
 GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_layout_get_line_metrics     (GtkTextLayout     *layout,
+                                               const GtkTextIter *iter,
+                                               gint              *width,
+                                               gint              *height,
+                                               gint              *top_ink,
+                                               gint              *bottom_ink);
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_layout_has_chunk_sizes      (GtkTextLayout     *layout,
+                                               const GtkTextIter *iter);
+GDK_AVAILABLE_IN_ALL
 void     gtk_text_layout_get_cursor_locations (GtkTextLayout     *layout,
                                                GtkTextIter       *iter,
                                                GdkRectangle      *strong_pos,
                                                GdkRectangle      *weak_pos);
 gboolean _gtk_text_layout_get_block_cursor    (GtkTextLayout     *layout,
 					       GdkRectangle      *pos);
+
+guint        _gtk_text_line_display_get_chunk_at_index (GtkTextLineDisplay *display,
+                                                        gint                index);
+PangoLayout *_gtk_text_layout_get_chunk_layout         (GtkTextLayout      *layout,
+                                                        GtkTextLineDisplay *display,
+                                                        guint               chunk);
 GDK_AVAILABLE_IN_ALL
 gboolean gtk_text_layout_clamp_iter_to_vrange (GtkTextLayout     *layout,
                                                GtkTextIter       *iter,
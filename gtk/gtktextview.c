@@ -4288,6 +4288,15 @@ incremental_validate_callback (gpointer data)
   gboolean result = TRUE;
 
   DV(g_print(G_STRLOC"\n"));
+
+  /* Offscreen lines get measured in threads if possible, the layout
+   * keeps going on its own and emits ::changed as lines get done.
+   */
+  if (gtk_text_layout_validate_in_thread (text_view->priv->layout))
+    {
+      text_view->priv->incremental_validate_idle = 0;
+      return FALSE;
+    }
   
   gtk_text_layout_validate (text_view->priv->layout, 2000);
 
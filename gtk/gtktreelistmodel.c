@@ -33,11 +33,22 @@
  *
  * #GtkTreeListModel is a #GListModel implementation that can expand rows
  * by creating new child list models on demand.
+ *
+ * With #GtkTreeListModel:autoexpand set, rows are expanded as soon as
+ * they are added, which creates the child models of the whole tree up
+ * front. #GtkTreeListModel:autoexpand-depth limits how deep rows are
+ * expanded. When #GtkTreeListModel:lazy is set, rows are instead
+ * expanded the first time they are requested, so only the parts of the
+ * tree that are actually looked at get created. These rows get expanded
+ * while the main loop is idle, emitting #GListModel::items-changed for
+ * their children.
  */
 
 enum {
   PROP_0,
   PROP_AUTOEXPAND,
+  PROP_AUTOEXPAND_DEPTH,
+  PROP_LAZY,
   PROP_MODEL,
   PROP_PASSTHROUGH,
   NUM_PROPERTIES
@@ -58,6 +69,8 @@ struct _TreeNode
 
   guint empty : 1;
   guint is_root : 1;
+  guint autoexpand_checked : 1; /* lazy autoexpanding has looked at this node */
+  guint autoexpand_pending : 1; /* node is in list->autoexpand_pending */
 };
 
 struct _TreeAugment
@@ -76,8 +89,14 @@ struct _GtkTreeListModel
   gpointer user_data;
   GDestroyNotify user_destroy;
 
+  guint autoexpand_depth;
+
   guint autoexpand : 1;
   guint passthrough : 1;
+  guint lazy : 1;
+
+  GPtrArray *autoexpand_pending; /* nodes to expand in the idle handler */
+  guint autoexpand_source; /* idle source expanding pending nodes, 0 if none */
 };
 
 struct _GtkTreeListModelClass
@@ -108,6 +127,18 @@ tree_node_get_tree_list_model (TreeNode *node)
   return node->list;
 }
 
+/* Depth of the rows that are the children of node */
+static guint
+tree_node_get_children_depth (TreeNode *node)
+{
+  guint depth;
+
+  for (depth = 0; !node->is_root; node = node->parent)
+    depth++;
+
+  return depth;
+}
+
 static TreeNode *
 tree_node_get_nth_child (TreeNode *node,
                          guint     position)
@@ -266,6 +297,10 @@ tree_node_mark_dirty (TreeNode *node)
     }
 }
 
+static void
+gtk_tree_list_model_check_autoexpand (GtkTreeListModel *self,
+                                      TreeNode         *node);
+
 static TreeNode *
 gtk_tree_list_model_get_nth (GtkTreeListModel *self,
                              guint             position)
@@ -296,7 +331,11 @@ gtk_tree_list_model_get_nth (GtkTreeListModel *self,
         }
 
       if (position == 0)
-        return node;
+        {
+          if (self->lazy && !node->autoexpand_checked)
+            gtk_tree_list_model_check_autoexpand (self, node);
+          return node;
+        }
 
       position--;
 
@@ -371,7 +410,7 @@ gtk_tree_list_model_items_changed_cb (GListModel *model,
                                       TreeNode   *node)
 {
   GtkTreeListModel *self;
-  TreeNode *child;
+  TreeNode *child, *first;
   guint i, tree_position, tree_removed, tree_added, n_local;
 
   self = tree_node_get_tree_list_model (node);
@@ -416,14 +455,16 @@ gtk_tree_list_model_items_changed_cb (GListModel *model,
     }
 
   tree_added = added;
-  for (i = 0; i < added; i++)
+  first = gtk_css_rb_tree_insert_n_before (node->children, child, added);
+  for (i = 0, child = first; i < added; i++)
     {
-      child = gtk_css_rb_tree_insert_before (node->children, child);
       child->parent = node;
+      child = gtk_css_rb_tree_get_next (node->children, child);
     }
-  if (self->autoexpand)
+  if (self->autoexpand && !self->lazy &&
+      tree_node_get_children_depth (node) < self->autoexpand_depth)
     {
-      for (i = 0; i < added; i++)
+      for (i = 0, child = first; i < added; i++)
         {
           tree_added += gtk_tree_list_model_expand_node (self, child);
           child = gtk_css_rb_tree_get_next (node->children, child);
@@ -440,11 +481,26 @@ gtk_tree_list_model_items_changed_cb (GListModel *model,
 
 static void gtk_tree_list_row_destroy (GtkTreeListRow *row);
 
+static void
+tree_node_unqueue_autoexpand (TreeNode *node)
+{
+  GtkTreeListModel *self;
+
+  if (!node->autoexpand_pending)
+    return;
+
+  self = tree_node_get_tree_list_model (node);
+  g_ptr_array_remove_fast (self->autoexpand_pending, node);
+  node->autoexpand_pending = FALSE;
+}
+
 static void
 gtk_tree_list_model_clear_node (gpointer data)
 {
   TreeNode *node = data;
 
+  tree_node_unqueue_autoexpand (node);
+
   if (node->row)
     gtk_tree_list_row_destroy (node->row);
 
@@ -493,6 +549,7 @@ gtk_tree_list_model_init_node (GtkTreeListModel *list,
 {
   gsize i, n;
   TreeNode *node;
+  gboolean autoexpand;
 
   self->model = model;
   g_signal_connect (model,
@@ -505,14 +562,17 @@ gtk_tree_list_model_init_node (GtkTreeListModel *list,
                                         gtk_tree_list_model_clear_node,
                                         NULL);
 
+  autoexpand = list->autoexpand && !list->lazy &&
+               tree_node_get_children_depth (self) < list->autoexpand_depth;
+
   n = g_list_model_get_n_items (model);
-  node = NULL;
+  node = gtk_css_rb_tree_insert_n_before (self->children, NULL, n);
   for (i = 0; i < n; i++)
     {
-      node = gtk_css_rb_tree_insert_after (self->children, node);
       node->parent = self;
-      if (list->autoexpand)
+      if (autoexpand)
         gtk_tree_list_model_expand_node (list, node);
+      node = gtk_css_rb_tree_get_next (self->children, node);
     }
 }
 
@@ -569,6 +629,63 @@ gtk_tree_list_model_collapse_node (GtkTreeListModel *self,
   return n_items;
 }
 
+static void
+gtk_tree_list_row_notify_expanded (GtkTreeListRow *self);
+
+static gboolean
+gtk_tree_list_model_autoexpand_cb (gpointer data)
+{
+  GtkTreeListModel *self = data;
+  TreeNode *node;
+  guint n_items;
+
+  /* Handlers of items-changed may request rows and queue more nodes,
+   * those are expanded right away. */
+  while (self->autoexpand_pending->len > 0)
+    {
+      node = g_ptr_array_index (self->autoexpand_pending, self->autoexpand_pending->len - 1);
+      g_ptr_array_remove_index (self->autoexpand_pending, self->autoexpand_pending->len - 1);
+      node->autoexpand_pending = FALSE;
+
+      n_items = gtk_tree_list_model_expand_node (self, node);
+      if (n_items > 0)
+        g_list_model_items_changed (G_LIST_MODEL (self), tree_node_get_position (node) + 1, 0, n_items);
+      if (node->row && node->model)
+        gtk_tree_list_row_notify_expanded (node->row);
+    }
+
+  self->autoexpand_source = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called when a node is requested for the first time while the model
+ * is lazy. Creating the child model has to wait until the idle handler,
+ * because emitting items-changed while items are being looked up
+ * confuses the code doing the lookup. */
+static void
+gtk_tree_list_model_check_autoexpand (GtkTreeListModel *self,
+                                      TreeNode         *node)
+{
+  node->autoexpand_checked = TRUE;
+
+  if (!self->autoexpand || node->empty || node->model != NULL ||
+      tree_node_get_children_depth (node->parent) >= self->autoexpand_depth)
+    return;
+
+  node->autoexpand_pending = TRUE;
+  g_ptr_array_add (self->autoexpand_pending, node);
+
+  if (self->autoexpand_source == 0)
+    {
+      self->autoexpand_source = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                                 gtk_tree_list_model_autoexpand_cb,
+                                                 self,
+                                                 NULL);
+      g_source_set_name_by_id (self->autoexpand_source, "[gtk+] gtk_tree_list_model_autoexpand_cb");
+    }
+}
+
 
 static GType
 gtk_tree_list_model_get_item_type (GListModel *list)
@@ -635,6 +752,14 @@ gtk_tree_list_model_set_property (GObject      *object,
       gtk_tree_list_model_set_autoexpand (self, g_value_get_boolean (value));
       break;
 
+    case PROP_AUTOEXPAND_DEPTH:
+      gtk_tree_list_model_set_autoexpand_depth (self, g_value_get_uint (value));
+      break;
+
+    case PROP_LAZY:
+      gtk_tree_list_model_set_lazy (self, g_value_get_boolean (value));
+      break;
+
     case PROP_PASSTHROUGH:
       self->passthrough = g_value_get_boolean (value);
       break;
@@ -659,6 +784,14 @@ gtk_tree_list_model_get_property (GObject     *object,
       g_value_set_boolean (value, self->autoexpand);
       break;
 
+    case PROP_AUTOEXPAND_DEPTH:
+      g_value_set_uint (value, self->autoexpand_depth);
+      break;
+
+    case PROP_LAZY:
+      g_value_set_boolean (value, self->lazy);
+      break;
+
     case PROP_MODEL:
       g_value_set_object (value, self->root_node.model);
       break;
@@ -678,7 +811,13 @@ gtk_tree_list_model_finalize (GObject *object)
 {
   GtkTreeListModel *self = GTK_TREE_LIST_MODEL (object);
 
+  if (self->autoexpand_source)
+    {
+      g_source_remove (self->autoexpand_source);
+      self->autoexpand_source = 0;
+    }
   gtk_tree_list_model_clear_node (&self->root_node);
+  g_ptr_array_unref (self->autoexpand_pending);
   if (self->user_destroy)
     self->user_destroy (self->user_data);
 
@@ -706,6 +845,31 @@ gtk_tree_list_model_class_init (GtkTreeListModelClass *class)
                             FALSE,
                             GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkTreeListModel:autoexpand-depth:
+   *
+   * The depth up to which rows are expanded by default
+   */
+  properties[PROP_AUTOEXPAND_DEPTH] =
+      g_param_spec_uint ("autoexpand-depth",
+                         P_("Autoexpand depth"),
+                         P_("The depth up to which rows are expanded by default"),
+                         0, G_MAXUINT, G_MAXUINT,
+                         GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+  /**
+   * GtkTreeListModel:lazy:
+   *
+   * If rows are autoexpanded when they are first requested instead of
+   * when they are added
+   */
+  properties[PROP_LAZY] =
+      g_param_spec_boolean ("lazy",
+                            P_("Lazy"),
+                            P_("If rows are autoexpanded when they are first requested"),
+                            FALSE,
+                            GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * GtkTreeListModel:model:
    *
@@ -740,6 +904,8 @@ gtk_tree_list_model_init (GtkTreeListModel *self)
 {
   self->root_node.list = self;
   self->root_node.is_root = TRUE;
+  self->autoexpand_depth = G_MAXUINT;
+  self->autoexpand_pending = g_ptr_array_new ();
 }
 
 /**
@@ -863,6 +1029,97 @@ gtk_tree_list_model_get_autoexpand (GtkTreeListModel *self)
   return self->autoexpand;
 }
 
+/**
+ * gtk_tree_list_model_set_autoexpand_depth:
+ * @self: a #GtkTreeListModel
+ * @depth: the depth of rows that are no longer expanded
+ *
+ * Limits #GtkTreeListModel:autoexpand to rows with a depth smaller than
+ * @depth. So with a @depth of 1, only the rows of the root model are
+ * expanded. The default is %G_MAXUINT, which expands rows at any depth.
+ *
+ * Like #GtkTreeListModel:autoexpand, this only affects rows that get
+ * added afterwards.
+ **/
+void
+gtk_tree_list_model_set_autoexpand_depth (GtkTreeListModel *self,
+                                          guint             depth)
+{
+  g_return_if_fail (GTK_IS_TREE_LIST_MODEL (self));
+
+  if (self->autoexpand_depth == depth)
+    return;
+
+  self->autoexpand_depth = depth;
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_AUTOEXPAND_DEPTH]);
+}
+
+/**
+ * gtk_tree_list_model_get_autoexpand_depth:
+ * @self: a #GtkTreeListModel
+ *
+ * Gets the depth set via gtk_tree_list_model_set_autoexpand_depth().
+ *
+ * Returns: the depth of rows that are no longer autoexpanded
+ **/
+guint
+gtk_tree_list_model_get_autoexpand_depth (GtkTreeListModel *self)
+{
+  g_return_val_if_fail (GTK_IS_TREE_LIST_MODEL (self), G_MAXUINT);
+
+  return self->autoexpand_depth;
+}
+
+/**
+ * gtk_tree_list_model_set_lazy:
+ * @self: a #GtkTreeListModel
+ * @lazy: %TRUE to autoexpand rows when they are first requested
+ *
+ * If set to %TRUE, #GtkTreeListModel:autoexpand does not expand rows
+ * when they are added. Instead rows are expanded the first time they
+ * are requested via g_list_model_get_item() or
+ * gtk_tree_list_model_get_row(), so child models only get created for
+ * rows that are looked at. The children are added while the main loop
+ * is idle.
+ *
+ * Rows that have been looked at before are not expanded again, so
+ * rows collapsed by the user stay collapsed.
+ *
+ * To create a lazy model, create it without autoexpand, then call this
+ * function and gtk_tree_list_model_set_autoexpand().
+ **/
+void
+gtk_tree_list_model_set_lazy (GtkTreeListModel *self,
+                              gboolean          lazy)
+{
+  g_return_if_fail (GTK_IS_TREE_LIST_MODEL (self));
+
+  if (self->lazy == lazy)
+    return;
+
+  self->lazy = lazy;
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LAZY]);
+}
+
+/**
+ * gtk_tree_list_model_get_lazy:
+ * @self: a #GtkTreeListModel
+ *
+ * Gets whether rows are autoexpanded when they are first requested.
+ * See gtk_tree_list_model_set_lazy().
+ *
+ * Returns: %TRUE if the model is lazy
+ **/
+gboolean
+gtk_tree_list_model_get_lazy (GtkTreeListModel *self)
+{
+  g_return_val_if_fail (GTK_IS_TREE_LIST_MODEL (self), FALSE);
+
+  return self->lazy;
+}
+
 /**
  * gtk_tree_list_model_get_row:
  * @self: a #GtkTreeListModel
@@ -961,6 +1218,13 @@ gtk_tree_list_row_destroy (GtkTreeListRow *self)
   g_object_thaw_notify (G_OBJECT (self));
 }
 
+static void
+gtk_tree_list_row_notify_expanded (GtkTreeListRow *self)
+{
+  g_object_notify_by_pspec (G_OBJECT (self), row_properties[ROW_PROP_EXPANDED]);
+  g_object_notify_by_pspec (G_OBJECT (self), row_properties[ROW_PROP_CHILDREN]);
+}
+
 static void
 gtk_tree_list_row_set_property (GObject      *object,
                                 guint         prop_id,
@@ -1141,21 +1405,12 @@ gtk_tree_list_row_get_position (GtkTreeListRow *self)
 guint
 gtk_tree_list_row_get_depth (GtkTreeListRow *self)
 {
-  TreeNode *node;
-  guint depth;
-
   g_return_val_if_fail (GTK_IS_TREE_LIST_ROW (self), 0);
 
   if (self->node == NULL)
     return 0;
 
-  depth = 0;
-  for (node = self->node->parent;
-       !node->is_root;
-       node = node->parent)
-    depth++;
-
-  return depth;
+  return tree_node_get_children_depth (self->node->parent);
 }
 
 /**
@@ -1185,6 +1440,10 @@ gtk_tree_list_row_set_expanded (GtkTreeListRow *self,
   if (self->node == NULL)
     return;
 
+  /* Don't autoexpand rows that were explicitly expanded or collapsed */
+  self->node->autoexpand_checked = TRUE;
+  tree_node_unqueue_autoexpand (self->node);
+
   was_expanded = self->node->children != NULL;
   if (was_expanded == expanded)
     return;
@@ -1204,8 +1463,7 @@ gtk_tree_list_row_set_expanded (GtkTreeListRow *self,
         g_list_model_items_changed (G_LIST_MODEL (list), tree_node_get_position (self->node) + 1, n_items, 0);
     }
 
-  g_object_notify_by_pspec (G_OBJECT (self), row_properties[ROW_PROP_EXPANDED]);
-  g_object_notify_by_pspec (G_OBJECT (self), row_properties[ROW_PROP_CHILDREN]);
+  gtk_tree_list_row_notify_expanded (self);
 }
 
 /**
@@ -74,6 +74,16 @@ void                    gtk_tree_list_model_set_autoexpand      (GtkTreeListMode
                                                                  gboolean                autoexpand);
 GDK_AVAILABLE_IN_ALL
 gboolean                gtk_tree_list_model_get_autoexpand      (GtkTreeListModel       *self);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_tree_list_model_set_autoexpand_depth (GtkTreeListModel      *self,
+                                                                 guint                   depth);
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_tree_list_model_get_autoexpand_depth (GtkTreeListModel      *self);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_tree_list_model_set_lazy            (GtkTreeListModel       *self,
+                                                                 gboolean                lazy);
+GDK_AVAILABLE_IN_ALL
+gboolean                gtk_tree_list_model_get_lazy            (GtkTreeListModel       *self);
 
 GDK_AVAILABLE_IN_ALL
 GtkTreeListRow *        gtk_tree_list_model_get_child_row       (GtkTreeListModel       *self,
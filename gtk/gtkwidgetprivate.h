@@ -178,6 +178,7 @@ struct _GtkWidgetPrivate
   GdkCursor *cursor;
 };
 
+GDK_AVAILABLE_IN_ALL
 GtkCssNode *  gtk_widget_get_css_node       (GtkWidget *widget);
 void         _gtk_widget_set_visible_flag   (GtkWidget *widget,
                                              gboolean   visible);
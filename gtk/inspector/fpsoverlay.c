@@ -22,6 +22,7 @@
 #include "fpsoverlay.h"
 
 #include "gtkintl.h"
+#include "gtklabelprivate.h"
 #include "gtkwidget.h"
 #include "gtkwindow.h"
 
@@ -33,6 +34,8 @@
 typedef struct _GtkFpsInfo {
   gint64 last_frame;
   GskRenderNode *last_node;
+  guint last_label_layouts;
+  guint label_layouts; /* layout updates since the previous frame */
 } GtkFpsInfo;
 
 struct _GtkFpsOverlay
@@ -166,6 +169,7 @@ gtk_fps_overlay_snapshot (GtkInspectorOverlay *overlay,
   if (info == NULL)
     {
       info = g_slice_new0 (GtkFpsInfo);
+      info->last_label_layouts = _gtk_label_get_n_layout_updates ();
       g_hash_table_insert (self->infos, widget, info);
     }
   if (info->last_node != node)
@@ -173,6 +177,8 @@ gtk_fps_overlay_snapshot (GtkInspectorOverlay *overlay,
       g_clear_pointer (&info->last_node, gsk_render_node_unref);
       info->last_node = gsk_render_node_ref (node);
       info->last_frame = now;
+      info->label_layouts = _gtk_label_get_n_layout_updates () - info->last_label_layouts;
+      info->last_label_layouts = _gtk_label_get_n_layout_updates ();
       overlay_opacity = 1.0;
     }
   else
@@ -195,9 +201,9 @@ gtk_fps_overlay_snapshot (GtkInspectorOverlay *overlay,
 
   fps = gtk_fps_overlay_get_fps (widget);
   if (fps == 0.0)
-    fps_string = g_strdup ("--- fps");
+    fps_string = g_strdup_printf ("--- fps\n%u label layout updates", info->label_layouts);
   else
-    fps_string = g_strdup_printf ("%.2f fps", fps);
+    fps_string = g_strdup_printf ("%.2f fps\n%u label layout updates", fps, info->label_layouts);
 
   if (GTK_IS_WINDOW (widget))
     {
@@ -0,0 +1,112 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <gtk/gtkcssproviderprivate.h>
+
+#define N_RUNS 20
+
+static double
+time_load (const char *path)
+{
+  GtkCssProvider *provider;
+  GTimer *timer;
+  double msec;
+  int i;
+
+  timer = g_timer_new ();
+
+  /* Warm up the page cache and the value caches */
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_path (provider, path);
+  g_object_unref (provider);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_RUNS; i++)
+    {
+      provider = gtk_css_provider_new ();
+      gtk_css_provider_load_from_path (provider, path);
+      g_object_unref (provider);
+    }
+  msec = g_timer_elapsed (timer, NULL) * 1000 / N_RUNS;
+
+  g_timer_destroy (timer);
+
+  return msec;
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *resource;
+  GtkCssProvider *provider;
+  GError *error = NULL;
+  GBytes *css, *compiled;
+  char *dir, *path, *compiled_path;
+  double parsed_msec, compiled_msec;
+
+  gtk_init ();
+
+  if (argc > 1)
+    resource = argv[1];
+  else
+    resource = "/org/gtk/libgtk/theme/Adwaita/gtk-contained.css";
+
+  css = g_resources_lookup_data (resource, 0, &error);
+  if (css == NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  dir = g_dir_make_tmp ("css-load-performance-XXXXXX", &error);
+  if (dir == NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  path = g_build_filename (dir, "gtk.css", NULL);
+  compiled_path = g_strconcat (path, ".compiled", NULL);
+  g_file_set_contents (path, g_bytes_get_data (css, NULL), g_bytes_get_size (css), NULL);
+
+  parsed_msec = time_load (path);
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_path (provider, path);
+  g_assert_false (gtk_css_provider_is_compiled (provider));
+  compiled = gtk_css_provider_compile (provider, &error);
+  g_object_unref (provider);
+  if (compiled == NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_file_set_contents (compiled_path, g_bytes_get_data (compiled, NULL), g_bytes_get_size (compiled), NULL);
+
+  /* Make sure we don't time parsing twice */
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_path (provider, path);
+  g_assert_true (gtk_css_provider_is_compiled (provider));
+  g_object_unref (provider);
+
+  compiled_msec = time_load (path);
+
+  g_print ("%s (%" G_GSIZE_FORMAT " bytes, %" G_GSIZE_FORMAT " bytes compiled)\n",
+           resource, g_bytes_get_size (css), g_bytes_get_size (compiled));
+  g_print ("parsed:   %.2f msec\n", parsed_msec);
+  g_print ("compiled: %.2f msec\n", compiled_msec);
+
+  g_unlink (compiled_path);
+  g_unlink (path);
+  g_rmdir (dir);
+
+  g_free (compiled_path);
+  g_free (path);
+  g_free (dir);
+  g_bytes_unref (compiled);
+  g_bytes_unref (css);
+
+  return 0;
+}
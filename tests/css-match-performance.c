@@ -0,0 +1,137 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <gtk/gtk.h>
+#include <gtk/gtkcssprefetchprivate.h>
+#include <gtk/gtkwidgetprivate.h>
+
+#define N_RUNS 20
+
+static int depth = 50;
+static int width = 3;
+static int threads = 0;
+
+static GOptionEntry options[] = {
+  { "depth", 'd', 0, G_OPTION_ARG_INT, &depth, "Number of nested boxes", "N" },
+  { "width", 'w', 0, G_OPTION_ARG_INT, &width, "Number of buttons per box", "N" },
+  { "threads", 't', 0, G_OPTION_ARG_INT, &threads, "Number of threads to look up styles in", "N" },
+  { NULL }
+};
+
+/* A deep tree of boxes, each with some buttons, so that the many
+ * descendant selectors in the theme have lots of ancestors to look at.
+ */
+static GtkWidget *
+create_tree (int *n_widgets)
+{
+  GtkWidget *root, *box, *child;
+  int i, j;
+
+  root = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  g_object_ref_sink (root);
+  *n_widgets = 1;
+
+  box = root;
+  for (i = 0; i < depth; i++)
+    {
+      for (j = 0; j < width; j++)
+        {
+          child = gtk_button_new_with_label ("Button");
+          gtk_container_add (GTK_CONTAINER (box), child);
+          *n_widgets += 2;
+        }
+
+      child = gtk_box_new (i % 2 ? GTK_ORIENTATION_VERTICAL : GTK_ORIENTATION_HORIZONTAL, 0);
+      gtk_style_context_add_class (gtk_widget_get_style_context (child), i % 2 ? "linked" : "view");
+      gtk_container_add (GTK_CONTAINER (box), child);
+      *n_widgets += 1;
+
+      box = child;
+    }
+
+  return root;
+}
+
+static void
+validate_style (GtkWidget *widget,
+                gpointer   unused)
+{
+  GdkRGBA color;
+
+  gtk_style_context_get_color (gtk_widget_get_style_context (widget), &color);
+
+  if (GTK_IS_CONTAINER (widget))
+    gtk_container_forall (GTK_CONTAINER (widget), validate_style, NULL);
+}
+
+/* Restyles the tree like a theme change does for a window */
+static double
+time_restyle (GtkWidget *tree,
+              int        n_threads)
+{
+  GTimer *timer;
+  double msec;
+  int i;
+
+  gtk_css_prefetch_set_n_threads (n_threads);
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_RUNS; i++)
+    {
+      gtk_widget_reset_style (tree);
+      gtk_css_node_validate (gtk_widget_get_css_node (tree));
+    }
+  msec = g_timer_elapsed (timer, NULL) * 1000 / N_RUNS;
+
+  g_timer_destroy (timer);
+
+  return msec;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkWidget *tree;
+  GTimer *timer;
+  double msec, serial_msec, parallel_msec;
+  int i, n_widgets;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  gtk_init ();
+
+  tree = create_tree (&n_widgets);
+
+  /* warmup */
+  validate_style (tree, NULL);
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_RUNS; i++)
+    {
+      gtk_widget_reset_style (tree);
+      validate_style (tree, NULL);
+    }
+  msec = g_timer_elapsed (timer, NULL) * 1000 / N_RUNS;
+
+  g_print ("depth %d, %d widgets: %.2f msec per restyle, %.2f usec per widget\n",
+           depth, n_widgets, msec, msec * 1000 / n_widgets);
+
+  serial_msec = time_restyle (tree, 1);
+  parallel_msec = time_restyle (tree, threads);
+
+  g_print ("validate, 1 thread: %.2f msec\n", serial_msec);
+  g_print ("validate, %u threads: %.2f msec\n", gtk_css_prefetch_get_n_threads (), parallel_msec);
+
+  g_timer_destroy (timer);
+  g_object_unref (tree);
+  g_option_context_free (context);
+
+  return 0;
+}
@@ -0,0 +1,280 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <gtk/gtk.h>
+
+#include <string.h>
+
+/* Simulates a syntax highlighter over a large C source file:
+ *
+ * single: one gtk_text_buffer_apply_tag() call per token
+ * ranges: gtk_text_buffer_apply_tag_ranges() with all tokens
+ *
+ * "full" is the time to highlight the whole buffer, "edit" the
+ * average time to retag a window of lines around a change, like
+ * highlighters do after every keystroke. The buffer is shown in a
+ * text view so that layout invalidation is included.
+ */
+
+static int n_lines = 50000;
+static int window_lines = 200;
+static int n_edits = 100;
+
+static GOptionEntry options[] = {
+  { "lines", 'n', 0, G_OPTION_ARG_INT, &n_lines, "Number of lines in the file", "N" },
+  { "window", 'w', 0, G_OPTION_ARG_INT, &window_lines, "Number of lines to retag per edit", "N" },
+  { "edits", 'e', 0, G_OPTION_ARG_INT, &n_edits, "Number of edits to simulate", "N" },
+  { NULL }
+};
+
+enum {
+  KEYWORD,
+  TYPE,
+  NUMBER,
+  STRING,
+  COMMENT,
+  N_TAGS
+};
+
+static GtkTextTag *tags[N_TAGS];
+
+static char *
+create_source (void)
+{
+  static const char *statements[] = {
+    "  if (n_items > 0 && items[i] != NULL)\n",
+    "    return g_strdup (\"some string\");\n",
+    "  /* a comment about the next line */\n",
+    "  for (int i = 0; i < 42; i++)\n",
+    "    total += items[i]->size * 3;\n",
+    "  static const char *name = \"name\";\n",
+    "  while (node != NULL) node = node->next; // walk\n",
+    "  unsigned long value = 0x1234;\n",
+    "\n",
+  };
+  GString *text;
+  GRand *rand;
+  int i;
+
+  rand = g_rand_new_with_seed (0);
+  text = g_string_new (NULL);
+
+  for (i = 0; i < n_lines; i++)
+    g_string_append (text, statements[g_rand_int_range (rand, 0, G_N_ELEMENTS (statements))]);
+
+  g_rand_free (rand);
+
+  return g_string_free (text, FALSE);
+}
+
+static const char *keywords[] = { "if", "for", "while", "return", "static", "const", NULL };
+static const char *types[] = { "int", "char", "unsigned", "long", NULL };
+
+static gboolean
+is_one_of (const char  *word,
+           gsize        len,
+           const char **words)
+{
+  for (; *words; words++)
+    {
+      if (strlen (*words) == len && strncmp (*words, word, len) == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* A crude tokenizer, good enough to produce a realistic number of
+ * tag ranges. The text is ASCII, so bytes are characters.
+ */
+static GArray *
+tokenize (const char *text,
+          int         offset)
+{
+  GArray *ranges;
+  GtkTextTagRange range;
+  const char *p, *start;
+
+  ranges = g_array_new (FALSE, FALSE, sizeof (GtkTextTagRange));
+
+  for (p = text; *p; )
+    {
+      start = p;
+      range.tag = NULL;
+
+      if (p[0] == '/' && p[1] == '*')
+        {
+          p = strstr (p, "*/");
+          p = p ? p + 2 : p + strlen (p);
+          range.tag = tags[COMMENT];
+        }
+      else if (p[0] == '/' && p[1] == '/')
+        {
+          p += strcspn (p, "\n");
+          range.tag = tags[COMMENT];
+        }
+      else if (*p == '"')
+        {
+          p = strchr (p + 1, '"');
+          p = p ? p + 1 : start + strlen (start);
+          range.tag = tags[STRING];
+        }
+      else if (g_ascii_isdigit (*p))
+        {
+          while (g_ascii_isalnum (*p))
+            p++;
+          range.tag = tags[NUMBER];
+        }
+      else if (g_ascii_isalpha (*p) || *p == '_')
+        {
+          while (g_ascii_isalnum (*p) || *p == '_')
+            p++;
+          if (is_one_of (start, p - start, keywords))
+            range.tag = tags[KEYWORD];
+          else if (is_one_of (start, p - start, types))
+            range.tag = tags[TYPE];
+        }
+      else
+        p++;
+
+      if (range.tag)
+        {
+          range.start = offset + (start - text);
+          range.end = offset + (p - text);
+          g_array_append_val (ranges, range);
+        }
+    }
+
+  return ranges;
+}
+
+static void
+tag_single (GtkTextBuffer *buffer,
+            GArray        *ranges)
+{
+  GtkTextTagRange *range;
+  GtkTextIter start, end;
+  guint i;
+
+  for (i = 0; i < ranges->len; i++)
+    {
+      range = &g_array_index (ranges, GtkTextTagRange, i);
+      gtk_text_buffer_get_iter_at_offset (buffer, &start, range->start);
+      gtk_text_buffer_get_iter_at_offset (buffer, &end, range->end);
+      gtk_text_buffer_apply_tag (buffer, range->tag, &start, &end);
+    }
+}
+
+static void
+tag_ranges (GtkTextBuffer *buffer,
+            GArray        *ranges)
+{
+  gtk_text_buffer_apply_tag_ranges (buffer, (GtkTextTagRange *) ranges->data, ranges->len);
+}
+
+static struct {
+  const char *name;
+  void (* tag) (GtkTextBuffer *buffer,
+                GArray        *ranges);
+} modes[] = {
+  { "single", tag_single },
+  { "ranges", tag_ranges },
+};
+
+static void
+retag (GtkTextBuffer *buffer,
+       int            first_line,
+       guint          mode)
+{
+  GtkTextIter start, end;
+  GArray *ranges;
+  char *text;
+
+  gtk_text_buffer_get_iter_at_line (buffer, &start, first_line);
+  gtk_text_buffer_get_iter_at_line (buffer, &end, first_line + window_lines);
+  gtk_text_buffer_remove_all_tags (buffer, &start, &end);
+
+  text = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+  ranges = tokenize (text, gtk_text_iter_get_offset (&start));
+  modes[mode].tag (buffer, ranges);
+
+  g_array_unref (ranges);
+  g_free (text);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkWidget *window, *scrolled_window, *view;
+  GtkTextBuffer *buffer;
+  GArray *ranges;
+  GRand *rand;
+  gint64 start, full, edit;
+  char *text;
+  guint i, j;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  gtk_init ();
+
+  text = create_source ();
+  ranges = NULL;
+
+  g_print ("%-8s %8s %10s %10s %10s\n", "mode", "lines", "ranges", "full", "edit");
+  g_print ("%-8s %8s %10s %10s %10s\n", "", "", "", "msec", "msec");
+
+  for (i = 0; i < G_N_ELEMENTS (modes); i++)
+    {
+      window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+      gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+      scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+      gtk_container_add (GTK_CONTAINER (window), scrolled_window);
+      view = gtk_text_view_new ();
+      gtk_container_add (GTK_CONTAINER (scrolled_window), view);
+      gtk_widget_show (window);
+
+      buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (view));
+      tags[KEYWORD] = gtk_text_buffer_create_tag (buffer, NULL, "weight", PANGO_WEIGHT_BOLD, NULL);
+      tags[TYPE] = gtk_text_buffer_create_tag (buffer, NULL, "foreground", "green", NULL);
+      tags[NUMBER] = gtk_text_buffer_create_tag (buffer, NULL, "foreground", "red", NULL);
+      tags[STRING] = gtk_text_buffer_create_tag (buffer, NULL, "foreground", "magenta", NULL);
+      tags[COMMENT] = gtk_text_buffer_create_tag (buffer, NULL, "style", PANGO_STYLE_ITALIC, NULL);
+
+      gtk_text_buffer_set_text (buffer, text, -1);
+      while (g_main_context_pending (NULL))
+        g_main_context_iteration (NULL, FALSE);
+
+      g_clear_pointer (&ranges, g_array_unref);
+      ranges = tokenize (text, 0);
+
+      start = g_get_monotonic_time ();
+      modes[i].tag (buffer, ranges);
+      full = g_get_monotonic_time () - start;
+
+      rand = g_rand_new_with_seed (0);
+      start = g_get_monotonic_time ();
+      for (j = 0; j < n_edits; j++)
+        retag (buffer, g_rand_int_range (rand, 0, MAX (n_lines - window_lines, 1)), i);
+      edit = (g_get_monotonic_time () - start) / MAX (n_edits, 1);
+      g_rand_free (rand);
+
+      g_print ("%-8s %8d %10u %10.1f %10.2f\n",
+               modes[i].name, n_lines, ranges->len,
+               full / 1000., edit / 1000.);
+
+      gtk_widget_destroy (window);
+    }
+
+  g_array_unref (ranges);
+  g_free (text);
+  g_option_context_free (context);
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <gtk/gtk.h>
+
+/* Measures looking up icons by name, as done when populating large
+ * lists of icons:
+ *
+ * first:    loading the theme and looking up the first icon
+ * hit:      looking up every icon of the theme at a few sizes
+ * miss:     looking up names that are in no theme
+ * fallback: looking up names that only match after dropping dashed
+ *           suffixes, with GTK_ICON_LOOKUP_GENERIC_FALLBACK
+ *
+ * Only the lookup is measured, no icons are loaded.
+ */
+
+static char *theme_name = NULL;
+static int runs = 10;
+
+static GOptionEntry options[] = {
+  { "theme", 't', 0, G_OPTION_ARG_STRING, &theme_name, "Icon theme to use", "NAME" },
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Number of passes over all names", "N" },
+  { NULL }
+};
+
+static const int sizes[] = { 16, 24, 32, 48 };
+
+static GtkIconTheme *
+create_theme (void)
+{
+  GtkIconTheme *icon_theme;
+
+  icon_theme = gtk_icon_theme_new ();
+  gtk_icon_theme_set_custom_theme (icon_theme, theme_name);
+
+  return icon_theme;
+}
+
+static GPtrArray *
+collect_names (GtkIconTheme *icon_theme,
+               const char   *suffix)
+{
+  GPtrArray *names;
+  GList *icons, *l;
+
+  names = g_ptr_array_new_with_free_func (g_free);
+
+  icons = gtk_icon_theme_list_icons (icon_theme, NULL);
+  for (l = icons; l; l = l->next)
+    g_ptr_array_add (names, g_strconcat (l->data, suffix, NULL));
+  g_list_free_full (icons, g_free);
+
+  return names;
+}
+
+static guint
+lookup_names (GtkIconTheme       *icon_theme,
+              GPtrArray          *names,
+              GtkIconLookupFlags  flags)
+{
+  GtkIconInfo *info;
+  guint i, j, found;
+  int run;
+
+  found = 0;
+  for (run = 0; run < runs; run++)
+    for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+      for (j = 0; j < names->len; j++)
+        {
+          info = gtk_icon_theme_lookup_icon (icon_theme,
+                                             g_ptr_array_index (names, j),
+                                             sizes[i],
+                                             flags);
+          if (info)
+            {
+              found++;
+              g_object_unref (info);
+            }
+        }
+
+  return found;
+}
+
+static void
+run_mode (GtkIconTheme       *icon_theme,
+          const char         *mode,
+          const char         *suffix,
+          GtkIconLookupFlags  flags)
+{
+  GPtrArray *names;
+  guint lookups, found;
+  gint64 start, elapsed;
+
+  names = collect_names (icon_theme, suffix);
+  lookups = runs * G_N_ELEMENTS (sizes) * names->len;
+
+  start = g_get_monotonic_time ();
+  found = lookup_names (icon_theme, names, flags);
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%-8s %10u %10u %10.1f %10.2f\n",
+           mode, lookups, found,
+           elapsed / 1000.,
+           lookups ? (double) elapsed / lookups : 0.);
+
+  g_ptr_array_unref (names);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkIconTheme *icon_theme;
+  GtkIconInfo *info;
+  gint64 start;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (theme_name == NULL)
+    theme_name = g_strdup ("Adwaita");
+
+  gtk_init ();
+
+  g_print ("%-8s %10s %10s %10s %10s\n", "mode", "lookups", "found", "time", "per lookup");
+  g_print ("%-8s %10s %10s %10s %10s\n", "", "", "", "msec", "usec");
+
+  icon_theme = create_theme ();
+  start = g_get_monotonic_time ();
+  info = gtk_icon_theme_lookup_icon (icon_theme, "image-missing", 16, 0);
+  g_print ("%-8s %10u %10u %10.1f\n",
+           "first", 1, (guint) (info != NULL),
+           (g_get_monotonic_time () - start) / 1000.);
+  g_clear_object (&info);
+
+  run_mode (icon_theme, "hit", "", 0);
+  run_mode (icon_theme, "miss", "-no-such-icon-anywhere", 0);
+  run_mode (icon_theme, "fallback", "-no-such-variant", GTK_ICON_LOOKUP_GENERIC_FALLBACK);
+
+  g_object_unref (icon_theme);
+  g_free (theme_name);
+  g_option_context_free (context);
+
+  return 0;
+}
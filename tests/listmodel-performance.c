@@ -0,0 +1,511 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+
+#include <math.h>
+#ifdef HAVE_MALLINFO
+#include <malloc.h>
+#endif
+#ifdef HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+/* Measures the list models in typical situations: creating them for
+ * a store full of items, looking up random items, inserting and
+ * removing random items in the underlying stores and changing the
+ * filter or sort function.
+ *
+ * Times are per item for creating and per operation otherwise.
+ * The heap column is the memory allocated while creating the model
+ * and its store, divided by the number of items.
+ */
+
+static char *sizes_arg = NULL;
+static char *model_arg = NULL;
+static int n_ops = 1000;
+static int seed = 0;
+
+static GOptionEntry options[] = {
+  { "sizes", 's', 0, G_OPTION_ARG_STRING, &sizes_arg, "Comma-separated numbers of items", "N,..." },
+  { "model", 'm', 0, G_OPTION_ARG_STRING, &model_arg, "Only measure this model", "NAME" },
+  { "ops", 'o', 0, G_OPTION_ARG_INT, &n_ops, "Number of random operations", "N" },
+  { "seed", 0, 0, G_OPTION_ARG_INT, &seed, "Seed for random numbers", "SEED" },
+  { NULL }
+};
+
+/*** ITEMS ***/
+
+typedef struct
+{
+  GObject parent;
+
+  guint value;
+  GListModel *children;
+} BenchItem;
+
+typedef struct
+{
+  GObjectClass parent_class;
+} BenchItemClass;
+
+#define BENCH_TYPE_ITEM (bench_item_get_type ())
+
+G_DEFINE_TYPE (BenchItem, bench_item, G_TYPE_OBJECT)
+
+static void
+bench_item_finalize (GObject *object)
+{
+  BenchItem *item = (BenchItem *) object;
+
+  g_clear_object (&item->children);
+
+  G_OBJECT_CLASS (bench_item_parent_class)->finalize (object);
+}
+
+static void
+bench_item_class_init (BenchItemClass *class)
+{
+  G_OBJECT_CLASS (class)->finalize = bench_item_finalize;
+}
+
+static void
+bench_item_init (BenchItem *item)
+{
+}
+
+static GRand *bench_rand;
+
+static BenchItem *
+bench_item_new (void)
+{
+  BenchItem *item;
+
+  item = g_object_new (BENCH_TYPE_ITEM, NULL);
+  item->value = g_rand_int (bench_rand);
+
+  return item;
+}
+
+static GListStore *
+create_store (guint n_items)
+{
+  GListStore *store;
+  gpointer *items;
+  guint i;
+
+  items = g_new (gpointer, n_items);
+  for (i = 0; i < n_items; i++)
+    items[i] = bench_item_new ();
+
+  store = g_list_store_new (BENCH_TYPE_ITEM);
+  g_list_store_splice (store, 0, 0, items, n_items);
+
+  for (i = 0; i < n_items; i++)
+    g_object_unref (items[i]);
+  g_free (items);
+
+  return store;
+}
+
+/*** MODELS ***/
+
+/* Changed between updates so that filtering and sorting have an
+ * effect */
+static gboolean flipped = FALSE;
+
+static gboolean
+filter_item (gpointer item,
+             gpointer data)
+{
+  return (((BenchItem *) item)->value & 1) == flipped;
+}
+
+static int
+compare_items (gconstpointer a,
+               gconstpointer b,
+               gpointer      data)
+{
+  guint value_a = ((const BenchItem *) a)->value;
+  guint value_b = ((const BenchItem *) b)->value;
+
+  if (flipped)
+    return (value_a < value_b) - (value_a > value_b);
+  else
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static gpointer
+map_item (gpointer item,
+          gpointer data)
+{
+  BenchItem *result;
+
+  result = g_object_new (BENCH_TYPE_ITEM, NULL);
+  result->value = ((BenchItem *) item)->value / 2;
+  g_object_unref (item);
+
+  return result;
+}
+
+static GListModel *
+create_child_model (gpointer item,
+                    gpointer data)
+{
+  BenchItem *self = item;
+
+  if (self->children == NULL)
+    return NULL;
+
+  return g_object_ref (self->children);
+}
+
+/* Creates a model of n_items and adds the stores that can be changed
+ * to stores */
+typedef GListModel * (* CreateModelFunc) (guint      n_items,
+                                          GPtrArray *stores);
+/* Makes the model update all its items, or does nothing if the model
+ * has nothing to update */
+typedef void (* UpdateModelFunc) (GListModel *model);
+
+static GListModel *
+create_list_store (guint      n_items,
+                   GPtrArray *stores)
+{
+  GListStore *store = create_store (n_items);
+
+  g_ptr_array_add (stores, store);
+
+  return G_LIST_MODEL (g_object_ref (store));
+}
+
+static GListModel *
+create_sort_model (guint      n_items,
+                   GPtrArray *stores)
+{
+  GListStore *store = create_store (n_items);
+
+  g_ptr_array_add (stores, store);
+
+  return G_LIST_MODEL (gtk_sort_list_model_new (G_LIST_MODEL (store), compare_items, NULL, NULL));
+}
+
+static void
+update_sort_model (GListModel *model)
+{
+  gtk_sort_list_model_resort (GTK_SORT_LIST_MODEL (model));
+}
+
+static GListModel *
+create_filter_model (guint      n_items,
+                     GPtrArray *stores)
+{
+  GListStore *store = create_store (n_items);
+
+  g_ptr_array_add (stores, store);
+
+  return G_LIST_MODEL (gtk_filter_list_model_new (G_LIST_MODEL (store), filter_item, NULL, NULL));
+}
+
+static void
+update_filter_model (GListModel *model)
+{
+  gtk_filter_list_model_refilter (GTK_FILTER_LIST_MODEL (model));
+}
+
+static GListModel *
+create_map_model (guint      n_items,
+                  GPtrArray *stores)
+{
+  GListStore *store = create_store (n_items);
+
+  g_ptr_array_add (stores, store);
+
+  return G_LIST_MODEL (gtk_map_list_model_new (BENCH_TYPE_ITEM, G_LIST_MODEL (store), map_item, NULL, NULL));
+}
+
+static GListModel *
+create_slice_model (guint      n_items,
+                    GPtrArray *stores)
+{
+  GListStore *store = create_store (n_items);
+
+  g_ptr_array_add (stores, store);
+
+  return G_LIST_MODEL (gtk_slice_list_model_new (G_LIST_MODEL (store), n_items / 4, n_items / 2));
+}
+
+/* The items are split into about sqrt(n_items) stores */
+static GListModel *
+create_flatten_model (guint      n_items,
+                      GPtrArray *stores)
+{
+  GListModel *result;
+  GListStore *models, *store;
+  guint i, n_stores, n;
+
+  n_stores = MAX (1, sqrt (n_items));
+  models = g_list_store_new (G_TYPE_LIST_MODEL);
+
+  for (i = 0; i < n_stores; i++)
+    {
+      n = n_items / n_stores + (i < n_items % n_stores ? 1 : 0);
+      store = create_store (n);
+      g_list_store_append (models, store);
+      g_ptr_array_add (stores, store);
+    }
+
+  result = G_LIST_MODEL (gtk_flatten_list_model_new (BENCH_TYPE_ITEM, G_LIST_MODEL (models)));
+  g_object_unref (models);
+
+  return result;
+}
+
+/* A fully expanded tree of about sqrt(n_items) rows with about
+ * sqrt(n_items) children each. Only the children get changed. */
+static GListModel *
+create_tree_model (guint      n_items,
+                   GPtrArray *stores)
+{
+  GListModel *result;
+  GListStore *root;
+  guint i, n_rows, n;
+
+  n_rows = MAX (1, sqrt (n_items));
+  root = create_store (n_rows);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      BenchItem *item = g_list_model_get_item (G_LIST_MODEL (root), i);
+
+      n = (n_items - n_rows) / n_rows + (i < (n_items - n_rows) % n_rows ? 1 : 0);
+      item->children = G_LIST_MODEL (create_store (n));
+      g_ptr_array_add (stores, g_object_ref (item->children));
+      g_object_unref (item);
+    }
+
+  result = G_LIST_MODEL (gtk_tree_list_model_new (TRUE, G_LIST_MODEL (root), TRUE, create_child_model, NULL, NULL));
+  g_object_unref (root);
+
+  return result;
+}
+
+static const struct {
+  const char *name;
+  CreateModelFunc create;
+  UpdateModelFunc update;
+} models[] = {
+  { "store", create_list_store, NULL },
+  { "sort", create_sort_model, update_sort_model },
+  { "filter", create_filter_model, update_filter_model },
+  { "map", create_map_model, NULL },
+  { "slice", create_slice_model, NULL },
+  { "flatten", create_flatten_model, NULL },
+  { "tree", create_tree_model, NULL },
+};
+
+/*** MEASURING ***/
+
+static gsize
+get_heap_size (void)
+{
+#ifdef HAVE_MALLINFO
+  struct mallinfo info = mallinfo ();
+
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+/* in kilobytes */
+static glong
+get_peak_rss (void)
+{
+#ifdef HAVE_GETRUSAGE
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+  return 0;
+}
+
+static double
+get_item_ns (GListModel *model)
+{
+  guint n_items;
+  int i;
+  gint64 start;
+
+  n_items = g_list_model_get_n_items (model);
+  if (n_items == 0)
+    return 0;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_ops; i++)
+    g_object_unref (g_list_model_get_item (model, g_rand_int_range (bench_rand, 0, n_items)));
+
+  return (g_get_monotonic_time () - start) * 1000.0 / n_ops;
+}
+
+static double
+insert_ns (GPtrArray *stores)
+{
+  BenchItem **items;
+  GListStore *store;
+  gint64 start;
+  int i;
+
+  items = g_new (BenchItem *, n_ops);
+  for (i = 0; i < n_ops; i++)
+    items[i] = bench_item_new ();
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_ops; i++)
+    {
+      store = g_ptr_array_index (stores, g_rand_int_range (bench_rand, 0, stores->len));
+      g_list_store_insert (store,
+                           g_rand_int_range (bench_rand, 0, g_list_model_get_n_items (G_LIST_MODEL (store)) + 1),
+                           items[i]);
+    }
+  start = g_get_monotonic_time () - start;
+
+  for (i = 0; i < n_ops; i++)
+    g_object_unref (items[i]);
+  g_free (items);
+
+  return start * 1000.0 / n_ops;
+}
+
+static double
+remove_ns (GPtrArray *stores)
+{
+  GListStore *store;
+  gint64 start;
+  guint n;
+  int i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_ops; i++)
+    {
+      store = g_ptr_array_index (stores, g_rand_int_range (bench_rand, 0, stores->len));
+      n = g_list_model_get_n_items (G_LIST_MODEL (store));
+      if (n > 0)
+        g_list_store_remove (store, g_rand_int_range (bench_rand, 0, n));
+    }
+
+  return (g_get_monotonic_time () - start) * 1000.0 / n_ops;
+}
+
+#define N_UPDATES 4
+
+static double
+update_ns (GListModel      *model,
+           UpdateModelFunc  update)
+{
+  gint64 start;
+  guint i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_UPDATES; i++)
+    {
+      flipped = !flipped;
+      update (model);
+    }
+
+  return (g_get_monotonic_time () - start) * 1000.0 / N_UPDATES;
+}
+
+static void
+measure (guint model,
+         guint n_items)
+{
+  GListModel *list;
+  GPtrArray *stores;
+  gsize heap;
+  gint64 start;
+  double create, get_item, insert, remove, update;
+
+  stores = g_ptr_array_new_with_free_func (g_object_unref);
+  flipped = FALSE;
+
+  heap = get_heap_size ();
+  start = g_get_monotonic_time ();
+  list = models[model].create (n_items, stores);
+  g_list_model_get_n_items (list);
+  create = (g_get_monotonic_time () - start) * 1000.0 / n_items;
+  heap = get_heap_size () - heap;
+
+  get_item = get_item_ns (list);
+  insert = insert_ns (stores);
+  remove = remove_ns (stores);
+  if (models[model].update)
+    update = update_ns (list, models[model].update);
+  else
+    update = 0;
+
+  g_print ("%-8s %8u %10.1f %10.1f %10.1f %10.1f",
+           models[model].name, n_items, create, get_item, insert, remove);
+  if (models[model].update)
+    g_print (" %12.0f", update);
+  else
+    g_print (" %12s", "-");
+  g_print (" %8.1f %10ld\n", (double) heap / n_items, get_peak_rss ());
+
+  g_object_unref (list);
+  g_ptr_array_unref (stores);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  char **sizes;
+  guint i, j, n_items;
+  gboolean found;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  gtk_init ();
+
+  sizes = g_strsplit (sizes_arg ? sizes_arg : "1000,10000,100000", ",", -1);
+  bench_rand = g_rand_new_with_seed (seed);
+
+  g_print ("%-8s %8s %10s %10s %10s %10s %12s %8s %10s\n",
+           "model", "items", "create", "get_item", "insert", "remove", "update", "heap", "peak RSS");
+  g_print ("%-8s %8s %10s %10s %10s %10s %12s %8s %10s\n",
+           "", "", "ns/item", "ns/op", "ns/op", "ns/op", "ns/op", "B/item", "kB");
+
+  found = FALSE;
+  for (i = 0; i < G_N_ELEMENTS (models); i++)
+    {
+      if (model_arg && !g_str_equal (model_arg, models[i].name))
+        continue;
+
+      found = TRUE;
+      for (j = 0; sizes[j]; j++)
+        {
+          n_items = g_ascii_strtoull (sizes[j], NULL, 10);
+          if (n_items > 0)
+            measure (i, n_items);
+        }
+    }
+
+  if (!found)
+    g_printerr ("Unknown model \"%s\"\n", model_arg);
+
+  g_rand_free (bench_rand);
+  g_strfreev (sizes);
+  g_option_context_free (context);
+
+  return found ? 0 : 1;
+}
@@ -5,6 +5,8 @@
 
 #include "frame-stats.h"
 
+static char *list_type = NULL;
+static int n_items = 100000;
 
 /* Stub definition of MyTextView which is used in the
  * widget-factory.ui file. We just need this so the
@@ -64,6 +66,122 @@ set_adjustment_to_fraction (GtkAdjustment *adjustment,
                             fraction * (upper - page_size));
 }
 
+static GListModel *
+create_list_model (void)
+{
+  GListStore *store;
+  GObject *object;
+  int i;
+
+  store = g_list_store_new (G_TYPE_OBJECT);
+  for (i = 0; i < n_items; i++)
+    {
+      object = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_set_data (object, "number", GINT_TO_POINTER (i));
+      g_list_store_append (store, object);
+      g_object_unref (object);
+    }
+
+  return G_LIST_MODEL (store);
+}
+
+static char *
+get_item_text (gpointer item)
+{
+  return g_strdup_printf ("Item %d", GPOINTER_TO_INT (g_object_get_data (item, "number")));
+}
+
+static GtkWidget *
+create_list_box_row (gpointer item,
+                     gpointer unused)
+{
+  GtkWidget *label;
+  char *text;
+
+  text = get_item_text (item);
+  label = gtk_label_new (text);
+  g_free (text);
+
+  return label;
+}
+
+static GtkWidget *
+setup_list_view_row (gpointer unused)
+{
+  return gtk_label_new (NULL);
+}
+
+static void
+bind_list_view_row (GtkWidget *widget,
+                    gpointer   item,
+                    gpointer   unused)
+{
+  char *text;
+
+  if (item == NULL)
+    return;
+
+  text = get_item_text (item);
+  gtk_label_set_text (GTK_LABEL (widget), text);
+  g_free (text);
+}
+
+static int
+count_widgets (GtkWidget *widget)
+{
+  GtkWidget *child;
+  int n = 1;
+
+  for (child = gtk_widget_get_first_child (widget);
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    n += count_widgets (child);
+
+  return n;
+}
+
+/* A list of labels, either in a GtkListBox, which creates a row for
+ * every item, or in a GtkListView, which only creates widgets for the
+ * visible items. Returns the scrollable widget.
+ */
+static GtkWidget *
+create_list (GtkWidget *scrolled_window)
+{
+  GListModel *model;
+  GtkWidget *list;
+  gint64 start;
+
+  model = create_list_model ();
+
+  start = g_get_monotonic_time ();
+
+  if (g_str_equal (list_type, "listbox"))
+    {
+      list = gtk_list_box_new ();
+      gtk_list_box_bind_model (GTK_LIST_BOX (list), model, create_list_box_row, NULL, NULL);
+    }
+  else if (g_str_equal (list_type, "listview"))
+    {
+      list = gtk_list_view_new ();
+      gtk_list_view_set_functions (GTK_LIST_VIEW (list), setup_list_view_row, bind_list_view_row, NULL, NULL);
+      gtk_list_view_set_model (GTK_LIST_VIEW (list), model);
+    }
+  else
+    {
+      g_error ("Unknown list type \"%s\", use listbox or listview", list_type);
+    }
+
+  gtk_container_add (GTK_CONTAINER (scrolled_window), list);
+
+  g_print ("%s: %d items, %d widgets, created in %.2f msec\n",
+           list_type, n_items, count_widgets (list),
+           (g_get_monotonic_time () - start) / 1000.);
+
+  g_object_unref (model);
+
+  return gtk_bin_get_child (GTK_BIN (scrolled_window));
+}
+
 gboolean
 scroll_viewport (GtkWidget     *viewport,
                  GdkFrameClock *frame_clock,
@@ -89,6 +207,8 @@ scroll_viewport (GtkWidget     *viewport,
 }
 
 static GOptionEntry options[] = {
+  { "list", 'l', 0, G_OPTION_ARG_STRING, &list_type, "Scroll a list instead of the widget factory", "listbox|listview" },
+  { "n-items", 'n', 0, G_OPTION_ARG_INT, &n_items, "Number of items in the list", "N" },
   { NULL }
 };
 
@@ -121,18 +241,25 @@ main (int argc, char **argv)
   scrolled_window = gtk_scrolled_window_new (NULL, NULL);
   gtk_container_add (GTK_CONTAINER (window), scrolled_window);
 
-  viewport = gtk_viewport_new (NULL, NULL);
-  gtk_container_add (GTK_CONTAINER (scrolled_window), viewport);
-
-  grid = gtk_grid_new ();
-  gtk_container_add (GTK_CONTAINER (viewport), grid);
-
-  for (i = 0; i < 4; i++)
+  if (list_type)
+    {
+      viewport = create_list (scrolled_window);
+    }
+  else
     {
-      GtkWidget *content = create_widget_factory_content ();
-      gtk_grid_attach (GTK_GRID (grid), content,
-                       i % 2, i / 2, 1, 1);
-      g_object_unref (content);
+      viewport = gtk_viewport_new (NULL, NULL);
+      gtk_container_add (GTK_CONTAINER (scrolled_window), viewport);
+
+      grid = gtk_grid_new ();
+      gtk_container_add (GTK_CONTAINER (viewport), grid);
+
+      for (i = 0; i < 4; i++)
+        {
+          GtkWidget *content = create_widget_factory_content ();
+          gtk_grid_attach (GTK_GRID (grid), content,
+                           i % 2, i / 2, 1, 1);
+          g_object_unref (content);
+        }
     }
 
   gtk_widget_add_tick_callback (viewport,
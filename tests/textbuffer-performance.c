@@ -0,0 +1,244 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+
+#include <string.h>
+#ifdef HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+/* Measures loading large text into a GtkTextBuffer:
+ *
+ * lines:  inserting it line by line at the end, like a naive loader
+ * insert: inserting all of it with gtk_text_buffer_set_text()
+ * bytes:  gtk_text_buffer_load_bytes()
+ * stream: gtk_text_buffer_load_stream_async() from a memory stream
+ *
+ * Times are for loading into a buffer that already contains the
+ * text. The peak RSS is for the whole process, so use --mode to
+ * compare it between the modes.
+ */
+
+static char *sizes_arg = NULL;
+static char *mode_arg = NULL;
+static int n_runs = 3;
+
+static GOptionEntry options[] = {
+  { "sizes", 's', 0, G_OPTION_ARG_STRING, &sizes_arg, "Comma-separated sizes of the text", "MB,..." },
+  { "mode", 'm', 0, G_OPTION_ARG_STRING, &mode_arg, "Only measure this mode", "NAME" },
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &n_runs, "Number of runs to take the best time from", "N" },
+  { NULL }
+};
+
+static GBytes *
+create_text (gsize size)
+{
+  static const char *words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+    "adipiscing", "elit", "sed", "do", "eiusmod", "tempor",
+    "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua"
+  };
+  GString *text;
+  GRand *rand;
+  int i, n_words;
+
+  rand = g_rand_new_with_seed (0);
+  text = g_string_sized_new (size + 1024);
+
+  while (text->len < size)
+    {
+      n_words = g_rand_int_range (rand, 0, 16);
+      for (i = 0; i < n_words; i++)
+        {
+          if (i > 0)
+            g_string_append_c (text, ' ');
+          g_string_append (text, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+        }
+      g_string_append_c (text, '\n');
+    }
+
+  g_rand_free (rand);
+
+  return g_string_free_to_bytes (text);
+}
+
+static void
+load_lines (GtkTextBuffer *buffer,
+            GBytes        *bytes)
+{
+  const char *text, *end, *nl;
+  GtkTextIter iter;
+  gsize len;
+
+  text = g_bytes_get_data (bytes, &len);
+  end = text + len;
+
+  gtk_text_buffer_set_text (buffer, "", 0);
+
+  while (text < end)
+    {
+      nl = memchr (text, '\n', end - text);
+      nl = nl ? nl + 1 : end;
+      gtk_text_buffer_get_end_iter (buffer, &iter);
+      gtk_text_buffer_insert (buffer, &iter, text, nl - text);
+      text = nl;
+    }
+}
+
+static void
+load_insert (GtkTextBuffer *buffer,
+             GBytes        *bytes)
+{
+  gsize len;
+  const char *text;
+
+  text = g_bytes_get_data (bytes, &len);
+  gtk_text_buffer_set_text (buffer, text, len);
+}
+
+static void
+load_bytes (GtkTextBuffer *buffer,
+            GBytes        *bytes)
+{
+  GError *error = NULL;
+
+  if (!gtk_text_buffer_load_bytes (buffer, bytes, &error))
+    g_error ("%s", error->message);
+}
+
+static void
+load_stream_done (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      data)
+{
+  GError *error = NULL;
+
+  if (!gtk_text_buffer_load_stream_finish (GTK_TEXT_BUFFER (source), result, &error))
+    g_error ("%s", error->message);
+
+  *(gboolean *) data = TRUE;
+}
+
+static void
+load_stream (GtkTextBuffer *buffer,
+             GBytes        *bytes)
+{
+  GInputStream *stream;
+  gboolean done = FALSE;
+
+  stream = g_memory_input_stream_new_from_bytes (bytes);
+  gtk_text_buffer_load_stream_async (buffer, stream, G_PRIORITY_DEFAULT, NULL,
+                                     NULL, NULL,
+                                     load_stream_done, &done);
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_unref (stream);
+}
+
+static struct {
+  const char *name;
+  void (* load) (GtkTextBuffer *buffer,
+                 GBytes        *bytes);
+} modes[] = {
+  { "lines", load_lines },
+  { "insert", load_insert },
+  { "bytes", load_bytes },
+  { "stream", load_stream },
+};
+
+static long
+get_peak_rss (void)
+{
+#ifdef HAVE_GETRUSAGE
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+  return 0;
+}
+
+static void
+measure (guint   mode,
+         GBytes *bytes)
+{
+  GtkTextBuffer *buffer;
+  gint64 start, best;
+  int i;
+
+  buffer = gtk_text_buffer_new (NULL);
+  best = G_MAXINT64;
+
+  for (i = 0; i < MAX (n_runs, 1); i++)
+    {
+      start = g_get_monotonic_time ();
+      modes[mode].load (buffer, bytes);
+      best = MIN (best, g_get_monotonic_time () - start);
+    }
+
+  g_print ("%-8s %8.1f %10d %10.1f %10.1f %10ld\n",
+           modes[mode].name,
+           g_bytes_get_size (bytes) / (1024. * 1024.),
+           gtk_text_buffer_get_line_count (buffer),
+           best / 1000.,
+           g_bytes_get_size (bytes) / (double) best,
+           get_peak_rss ());
+
+  g_object_unref (buffer);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  char **sizes;
+  GBytes *bytes;
+  guint i, j;
+  gboolean found;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  gtk_init ();
+
+  sizes = g_strsplit (sizes_arg ? sizes_arg : "1,100", ",", -1);
+
+  g_print ("%-8s %8s %10s %10s %10s %10s\n",
+           "mode", "size", "lines", "time", "speed", "peak RSS");
+  g_print ("%-8s %8s %10s %10s %10s %10s\n",
+           "", "MB", "", "msec", "MB/s", "kB");
+
+  found = FALSE;
+  for (i = 0; sizes[i]; i++)
+    {
+      bytes = create_text (g_ascii_strtod (sizes[i], NULL) * 1024 * 1024);
+
+      for (j = 0; j < G_N_ELEMENTS (modes); j++)
+        {
+          if (mode_arg && !g_str_equal (mode_arg, modes[j].name))
+            continue;
+
+          found = TRUE;
+          measure (j, bytes);
+        }
+
+      g_bytes_unref (bytes);
+    }
+
+  if (!found)
+    g_printerr ("Unknown mode \"%s\"\n", mode_arg);
+
+  g_strfreev (sizes);
+  g_option_context_free (context);
+
+  return found ? 0 : 1;
+}
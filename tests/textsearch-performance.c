@@ -0,0 +1,168 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <gtk/gtk.h>
+
+/* Measures finding all occurrences of a word in a large buffer, like
+ * "highlight all" in an editor does:
+ *
+ * single: calling gtk_text_iter_forward_search() repeatedly
+ * all:    gtk_text_iter_forward_search_all()
+ * steps:  gtk_text_iter_forward_search_all() in steps of --step chars
+ */
+
+static double size = 10;
+static char *needle = NULL;
+static int step = 100000;
+static gboolean caseless = FALSE;
+
+static GOptionEntry options[] = {
+  { "size", 's', 0, G_OPTION_ARG_DOUBLE, &size, "Size of the text", "MB" },
+  { "needle", 'n', 0, G_OPTION_ARG_STRING, &needle, "String to search for", "STRING" },
+  { "step", 0, 0, G_OPTION_ARG_INT, &step, "Characters to search per step", "N" },
+  { "case-insensitive", 'i', 0, G_OPTION_ARG_NONE, &caseless, "Search case insensitively", NULL },
+  { NULL }
+};
+
+static char *
+create_text (gsize size)
+{
+  static const char *words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+    "adipiscing", "elit", "sed", "do", "eiusmod", "tempor",
+    "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua",
+    "Lorem", "Ipsum", "Dolor"
+  };
+  GString *text;
+  GRand *rand;
+  int i, n_words;
+
+  rand = g_rand_new_with_seed (0);
+  text = g_string_sized_new (size + 1024);
+
+  while (text->len < size)
+    {
+      n_words = g_rand_int_range (rand, 0, 16);
+      for (i = 0; i < n_words; i++)
+        {
+          if (i > 0)
+            g_string_append_c (text, ' ');
+          g_string_append (text, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+        }
+      g_string_append_c (text, '\n');
+    }
+
+  g_rand_free (rand);
+
+  return g_string_free (text, FALSE);
+}
+
+static void
+search_single (GtkTextBuffer      *buffer,
+               GtkTextSearchFlags  flags,
+               GArray             *matches)
+{
+  GtkTextIter iter, start, end;
+  guint offset;
+
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  while (gtk_text_iter_forward_search (&iter, needle, flags, &start, &end, NULL))
+    {
+      offset = gtk_text_iter_get_offset (&start);
+      g_array_append_val (matches, offset);
+      offset = gtk_text_iter_get_offset (&end);
+      g_array_append_val (matches, offset);
+      iter = end;
+    }
+}
+
+static void
+search_all (GtkTextBuffer      *buffer,
+            GtkTextSearchFlags  flags,
+            GArray             *matches)
+{
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  gtk_text_iter_forward_search_all (&iter, needle, flags, NULL, 0, matches);
+}
+
+static void
+search_steps (GtkTextBuffer      *buffer,
+              GtkTextSearchFlags  flags,
+              GArray             *matches)
+{
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  while (gtk_text_iter_forward_search_all (&iter, needle, flags, NULL, step, matches))
+    ;
+}
+
+static struct {
+  const char *name;
+  void (* search) (GtkTextBuffer      *buffer,
+                   GtkTextSearchFlags  flags,
+                   GArray             *matches);
+} modes[] = {
+  { "single", search_single },
+  { "all", search_all },
+  { "steps", search_steps },
+};
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkTextBuffer *buffer;
+  GtkTextSearchFlags flags;
+  GArray *matches;
+  gint64 start;
+  char *text;
+  guint i;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (needle == NULL)
+    needle = g_strdup ("dolor");
+
+  gtk_init ();
+
+  text = create_text (size * 1024 * 1024);
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, text, -1);
+
+  flags = GTK_TEXT_SEARCH_TEXT_ONLY;
+  if (caseless)
+    flags |= GTK_TEXT_SEARCH_CASE_INSENSITIVE;
+
+  g_print ("%-8s %8s %10s %10s\n", "mode", "size", "matches", "time");
+  g_print ("%-8s %8s %10s %10s\n", "", "MB", "", "msec");
+
+  for (i = 0; i < G_N_ELEMENTS (modes); i++)
+    {
+      matches = g_array_new (FALSE, FALSE, sizeof (guint));
+
+      start = g_get_monotonic_time ();
+      modes[i].search (buffer, flags, matches);
+
+      g_print ("%-8s %8.1f %10u %10.1f\n",
+               modes[i].name, size, matches->len / 2,
+               (g_get_monotonic_time () - start) / 1000.);
+
+      g_array_unref (matches);
+    }
+
+  g_object_unref (buffer);
+  g_free (text);
+  g_free (needle);
+  g_option_context_free (context);
+
+  return 0;
+}
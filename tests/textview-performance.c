@@ -0,0 +1,183 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <gtk/gtk.h>
+
+/* Measures how long a GtkTextView showing a large buffer needs until
+ * its scrollbar stops changing, i.e. until all lines have been
+ * measured in the background, and how long the main loop is blocked
+ * while that happens.
+ *
+ * The scrollbar is considered stable when the upper value of the
+ * vertical adjustment did not change for the settle time. The time
+ * reported is the time of the last change, counted from showing the
+ * window. The stall column is the longest time a 1 ms timeout was
+ * kept from running.
+ *
+ * With --long, the buffer starts with a single huge paragraph; use
+ * it with --wrap to see how long shaping that blocks the main loop.
+ */
+
+static int n_lines = 100000;
+static int settle = 2000;
+static gboolean sync_only = FALSE;
+static gboolean wrap = FALSE;
+static int long_words = 0;
+
+static GOptionEntry options[] = {
+  { "lines", 'n', 0, G_OPTION_ARG_INT, &n_lines, "Number of lines in the buffer", "N" },
+  { "settle", 's', 0, G_OPTION_ARG_INT, &settle, "Time without changes before the scrollbar counts as stable", "MSEC" },
+  { "sync", 0, 0, G_OPTION_ARG_NONE, &sync_only, "Don't measure lines in threads", NULL },
+  { "wrap", 'w', 0, G_OPTION_ARG_NONE, &wrap, "Wrap lines", NULL },
+  { "long", 'l', 0, G_OPTION_ARG_INT, &long_words, "Start with a paragraph of N words", "N" },
+  { NULL }
+};
+
+static gint64 start_time;
+static gint64 last_change;
+static gint64 last_tick;
+static gint64 max_stall;
+static guint n_changes;
+static double upper;
+
+static char *
+create_text (void)
+{
+  static const char *words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+    "adipiscing", "elit", "sed", "do", "eiusmod", "tempor",
+    "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua"
+  };
+  GString *text;
+  GRand *rand;
+  int i, j, n_words;
+
+  rand = g_rand_new_with_seed (0);
+  text = g_string_new (NULL);
+
+  if (long_words > 0)
+    {
+      for (j = 0; j < long_words; j++)
+        {
+          g_string_append (text, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+          g_string_append_c (text, ' ');
+        }
+      g_string_append_c (text, '\n');
+    }
+
+  for (i = 0; i < n_lines; i++)
+    {
+      g_string_append_printf (text, "%d:", i);
+
+      /* mostly short lines, some long ones that wrap */
+      n_words = g_rand_int_range (rand, 0, 10) == 0 ? g_rand_int_range (rand, 20, 100)
+                                                     : g_rand_int_range (rand, 1, 12);
+      for (j = 0; j < n_words; j++)
+        {
+          g_string_append_c (text, ' ');
+          g_string_append (text, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+        }
+      g_string_append_c (text, '\n');
+    }
+
+  g_rand_free (rand);
+
+  return g_string_free (text, FALSE);
+}
+
+static void
+upper_changed (GtkAdjustment *adjustment)
+{
+  if (gtk_adjustment_get_upper (adjustment) == upper)
+    return;
+
+  upper = gtk_adjustment_get_upper (adjustment);
+  last_change = g_get_monotonic_time ();
+  n_changes++;
+}
+
+static gboolean
+tick (gpointer data)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  max_stall = MAX (max_stall, now - last_tick);
+  last_tick = now;
+
+  if (n_changes > 0 && now - last_change > settle * 1000)
+    {
+      *(gboolean *) data = TRUE;
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkWidget *window, *scrolled_window, *view;
+  GtkTextBuffer *buffer;
+  GtkAdjustment *adjustment;
+  gboolean done = FALSE;
+  char *text;
+  gint64 load_time;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (sync_only)
+    g_setenv ("GTK_TEXT_VALIDATE_THREADS", "0", TRUE);
+
+  gtk_init ();
+
+  text = create_text ();
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_container_add (GTK_CONTAINER (window), scrolled_window);
+  view = gtk_text_view_new ();
+  if (wrap)
+    gtk_text_view_set_wrap_mode (GTK_TEXT_VIEW (view), GTK_WRAP_WORD_CHAR);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), view);
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (view));
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (view));
+  g_signal_connect (adjustment, "changed", G_CALLBACK (upper_changed), NULL);
+
+  load_time = g_get_monotonic_time ();
+  gtk_text_buffer_set_text (buffer, text, -1);
+  load_time = g_get_monotonic_time () - load_time;
+
+  start_time = last_tick = g_get_monotonic_time ();
+  gtk_widget_show (window);
+  g_timeout_add (1, tick, &done);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_print ("%-8s %8s %10s %10s %8s %10s %12s\n",
+           "mode", "lines", "load", "stable", "changes", "stall", "height");
+  g_print ("%-8s %8s %10s %10s %8s %10s %12s\n",
+           "", "", "msec", "msec", "", "msec", "px");
+  g_print ("%-8s %8d %10.1f %10.1f %8u %10.1f %12.0f\n",
+           sync_only ? "sync" : "threads", n_lines,
+           load_time / 1000.,
+           (last_change - start_time) / 1000.,
+           n_changes,
+           max_stall / 1000.,
+           upper);
+
+  gtk_widget_destroy (window);
+  g_free (text);
+  g_option_context_free (context);
+
+  return 0;
+}
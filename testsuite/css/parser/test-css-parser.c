@@ -25,6 +25,7 @@
 #include <string.h>
 #include <glib/gstdio.h>
 #include <gtk/gtk.h>
+#include <gtk/gtkcssproviderprivate.h>
 
 #ifdef G_OS_WIN32
 # include <io.h>
@@ -235,12 +236,90 @@ test_css_file (GFile *file)
   parse_css_file (file, FALSE);
 }
 
+static void
+ignore_parsing_error (GtkCssProvider *provider,
+                      GtkCssSection  *section,
+                      const GError   *error,
+                      gpointer        data)
+{
+  /* The errors are checked by test_css_file() */
+}
+
+/* Loads a copy of @file, compiles it and checks that loading the
+ * compiled file gives the same provider as parsing.
+ */
+static void
+test_compiled_css_file (GFile *file)
+{
+  GtkCssProvider *provider;
+  GError *error = NULL;
+  GBytes *css, *compiled;
+  char *dir, *basename, *path, *compiled_path;
+  char *expected, *result;
+
+  css = g_file_load_bytes (file, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  dir = g_dir_make_tmp ("test-css-parser-XXXXXX", &error);
+  g_assert_no_error (error);
+  basename = g_file_get_basename (file);
+  path = g_build_filename (dir, basename, NULL);
+  compiled_path = g_strconcat (path, ".compiled", NULL);
+  g_file_set_contents (path, g_bytes_get_data (css, NULL), g_bytes_get_size (css), &error);
+  g_assert_no_error (error);
+
+  provider = gtk_css_provider_new ();
+  g_signal_connect (provider, "parsing-error", G_CALLBACK (ignore_parsing_error), NULL);
+  gtk_css_provider_load_from_path (provider, path);
+  g_assert_false (gtk_css_provider_is_compiled (provider));
+  expected = gtk_css_provider_to_string (provider);
+  compiled = gtk_css_provider_compile (provider, &error);
+  g_object_unref (provider);
+
+  if (compiled == NULL)
+    {
+      /* binding sets and failed imports */
+      g_test_skip (error->message);
+      g_clear_error (&error);
+      result = NULL;
+      goto out;
+    }
+
+  g_file_set_contents (compiled_path, g_bytes_get_data (compiled, NULL), g_bytes_get_size (compiled), &error);
+  g_assert_no_error (error);
+  g_bytes_unref (compiled);
+
+  provider = gtk_css_provider_new ();
+  g_signal_connect (provider, "parsing-error", G_CALLBACK (ignore_parsing_error), NULL);
+  gtk_css_provider_load_from_path (provider, path);
+  g_assert_true (gtk_css_provider_is_compiled (provider));
+  result = gtk_css_provider_to_string (provider);
+  g_object_unref (provider);
+
+  g_assert_cmpstr (result, ==, expected);
+
+  g_unlink (compiled_path);
+
+out:
+  g_unlink (path);
+  g_rmdir (dir);
+
+  g_free (result);
+  g_free (expected);
+  g_free (compiled_path);
+  g_free (path);
+  g_free (basename);
+  g_free (dir);
+  g_bytes_unref (css);
+}
+
 static void
 add_test_for_file (GFile *file)
 {
-  char *path;
+  char *path, *compiled_path;
 
   path = g_file_get_path (file);
+  compiled_path = g_strconcat (path, "/compiled", NULL);
 
   g_test_add_vtable (path,
                      0,
@@ -248,7 +327,14 @@ add_test_for_file (GFile *file)
                      NULL,
                      (GTestFixtureFunc) test_css_file,
                      (GTestFixtureFunc) g_object_unref);
+  g_test_add_vtable (compiled_path,
+                     0,
+                     g_object_ref (file),
+                     NULL,
+                     (GTestFixtureFunc) test_compiled_css_file,
+                     (GTestFixtureFunc) g_object_unref);
 
+  g_free (compiled_path);
   g_free (path);
 }
 
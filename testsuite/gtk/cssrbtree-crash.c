@@ -273,6 +273,96 @@ test_crash (void)
   gtk_css_rb_tree_unref (tree);
 }
 
+static guint
+count (GtkCssRbTree *tree)
+{
+  Node *root = gtk_css_rb_tree_get_root (tree);
+  Aug *aug;
+
+  if (root == NULL)
+    return 0;
+
+  aug = gtk_css_rb_tree_get_augment (tree, root);
+
+  return aug->n_items;
+}
+
+static void
+test_insert_n (void)
+{
+  GtkCssRbTree *tree;
+  Node *node;
+  guint i, j, n, pos, n_items;
+
+  tree = gtk_css_rb_tree_new (Node, Aug, augment, NULL, NULL);
+  n_items = 0;
+
+  for (i = 0; i < 200; i++)
+    {
+      pos = g_test_rand_int_range (0, n_items + 1);
+      if (i % 4 == 0)
+        n = g_test_rand_int_range (0, n_items / 4 + 50);
+      else
+        n = g_test_rand_int_range (0, 5);
+
+      node = gtk_css_rb_tree_insert_n_before (tree, get (tree, pos), n);
+      if (n == 0)
+        g_assert_null (node);
+      for (j = 0; j < n; j++)
+        {
+          g_assert_nonnull (node);
+          node->unused = i + 1;
+          node = gtk_css_rb_tree_get_next (tree, node);
+        }
+      n_items += n;
+      g_assert_cmpuint (count (tree), ==, n_items);
+
+      for (j = 0; j < n; j++)
+        g_assert_cmpuint (get (tree, pos + j)->unused, ==, i + 1);
+
+      if (n_items > 0 && i % 3 == 0)
+        {
+          delete (tree, g_test_rand_int_range (0, n_items));
+          n_items--;
+          g_assert_cmpuint (count (tree), ==, n_items);
+        }
+    }
+
+  gtk_css_rb_tree_unref (tree);
+}
+
+static void
+test_insert_n_performance (void)
+{
+  GtkCssRbTree *tree;
+  guint i, n;
+  double single, bulk;
+
+  if (!g_test_perf ())
+    return;
+
+  for (n = 1000; n <= 1000000; n *= 10)
+    {
+      tree = gtk_css_rb_tree_new (Node, Aug, augment, NULL, NULL);
+      g_test_timer_start ();
+      for (i = 0; i < n; i++)
+        gtk_css_rb_tree_insert_before (tree, NULL);
+      count (tree);
+      single = g_test_timer_elapsed ();
+      gtk_css_rb_tree_unref (tree);
+
+      tree = gtk_css_rb_tree_new (Node, Aug, augment, NULL, NULL);
+      g_test_timer_start ();
+      gtk_css_rb_tree_insert_n_before (tree, NULL, n);
+      count (tree);
+      bulk = g_test_timer_elapsed ();
+      gtk_css_rb_tree_unref (tree);
+
+      g_test_minimized_result (bulk, "inserting %u nodes: %gs one by one, %gs at once",
+                               n, single, bulk);
+    }
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -281,6 +371,8 @@ main (int argc, char *argv[])
   g_test_bug_base ("http://bugzilla.gnome.org/show_bug.cgi?id=%s");
 
   g_test_add_func ("/csrbtree/crash", test_crash);
+  g_test_add_func ("/csrbtree/insert-n", test_insert_n);
+  g_test_add_func ("/csrbtree/insert-n-performance", test_insert_n_performance);
 
   return g_test_run ();
 }
@@ -306,6 +306,102 @@ test_change_filter_func (void)
   g_object_unref (filter);
 }
 
+static void
+test_incremental (void)
+{
+  GtkFilterListModel *filter;
+  GString *changes;
+
+  filter = new_model (1000, is_smaller_than, GUINT_TO_POINTER (501));
+  changes = g_object_get_qdata (G_OBJECT (filter), changes_quark);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (filter)), ==, 500);
+
+  gtk_filter_list_model_set_incremental (filter, TRUE);
+  gtk_filter_list_model_set_filter_func (filter, is_larger_than, GUINT_TO_POINTER (900), NULL);
+  /* Nothing was refiltered yet */
+  g_assert_cmpuint (gtk_filter_list_model_get_pending (filter), ==, 1000);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (filter)), ==, 500);
+  assert_changes (filter, "");
+
+  while (gtk_filter_list_model_get_pending (filter) > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (filter)), ==, 100);
+  g_assert_cmpuint (get (G_LIST_MODEL (filter), 0), ==, 901);
+  g_assert_cmpuint (get (G_LIST_MODEL (filter), 99), ==, 1000);
+  g_string_set_size (changes, 0);
+
+  /* Turning incremental off refilters the rest right away */
+  gtk_filter_list_model_set_filter_func (filter, is_smaller_than, GUINT_TO_POINTER (11), NULL);
+  g_assert_cmpuint (gtk_filter_list_model_get_pending (filter), ==, 1000);
+  gtk_filter_list_model_set_incremental (filter, FALSE);
+  g_assert_cmpuint (gtk_filter_list_model_get_pending (filter), ==, 0);
+  assert_model (filter, "1 2 3 4 5 6 7 8 9 10");
+  assert_changes (filter, "0-100+10");
+
+  g_object_unref (filter);
+}
+
+static guint n_filter_calls;
+
+static gboolean
+is_smaller_than_limit (gpointer item,
+                       gpointer data)
+{
+  guint *limit = data;
+
+  n_filter_calls++;
+
+  return GPOINTER_TO_UINT (g_object_get_qdata (item, number_quark)) < *limit;
+}
+
+static void
+test_refilter_with_change (void)
+{
+  GtkFilterListModel *filter;
+  guint limit;
+
+  limit = 51;
+  filter = new_model (100, is_smaller_than_limit, &limit);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (filter)), ==, 50);
+
+  /* Only the 50 visible items are checked */
+  n_filter_calls = 0;
+  limit = 41;
+  gtk_filter_list_model_refilter_with_change (filter, GTK_FILTER_LIST_MODEL_CHANGE_MORE_STRICT);
+  g_assert_cmpuint (n_filter_calls, ==, 50);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (filter)), ==, 40);
+  assert_changes (filter, "40-10");
+
+  /* Only the 60 hidden items are checked */
+  n_filter_calls = 0;
+  limit = 46;
+  gtk_filter_list_model_refilter_with_change (filter, GTK_FILTER_LIST_MODEL_CHANGE_LESS_STRICT);
+  g_assert_cmpuint (n_filter_calls, ==, 60);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (filter)), ==, 45);
+  assert_changes (filter, "40+5");
+
+  n_filter_calls = 0;
+  limit = 11;
+  gtk_filter_list_model_refilter_with_change (filter, GTK_FILTER_LIST_MODEL_CHANGE_DIFFERENT);
+  g_assert_cmpuint (n_filter_calls, ==, 100);
+  assert_model (filter, "1 2 3 4 5 6 7 8 9 10");
+  assert_changes (filter, "10-35");
+
+  /* Incremental refiltering checks the same items */
+  gtk_filter_list_model_set_incremental (filter, TRUE);
+  n_filter_calls = 0;
+  limit = 6;
+  gtk_filter_list_model_refilter_with_change (filter, GTK_FILTER_LIST_MODEL_CHANGE_MORE_STRICT);
+  while (gtk_filter_list_model_get_pending (filter) > 0)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpuint (n_filter_calls, ==, 10);
+  assert_model (filter, "1 2 3 4 5");
+  assert_changes (filter, "5-5");
+
+  g_object_unref (filter);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -319,6 +415,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/filterlistmodel/create", test_create);
   g_test_add_func ("/filterlistmodel/empty_set_filter_func", test_empty_set_filter_func);
   g_test_add_func ("/filterlistmodel/change_filter_func", test_change_filter_func);
+  g_test_add_func ("/filterlistmodel/incremental", test_incremental);
+  g_test_add_func ("/filterlistmodel/refilter_with_change", test_refilter_with_change);
 
   return g_test_run ();
 }
@@ -0,0 +1,278 @@
+/* Copyright (C) 2018 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+#define N_ITEMS 100000
+#define WIDTH 400
+#define HEIGHT 300
+
+static GQuark number_quark;
+
+static GListStore *
+new_store (guint n_items)
+{
+  GListStore *store;
+  GObject *object;
+  guint i;
+
+  store = g_list_store_new (G_TYPE_OBJECT);
+  for (i = 0; i < n_items; i++)
+    {
+      object = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_set_qdata (object, number_quark, GUINT_TO_POINTER (i));
+      g_list_store_append (store, object);
+      g_object_unref (object);
+    }
+
+  return store;
+}
+
+static GtkWidget *
+setup_label (gpointer data)
+{
+  guint *n_created = data;
+  GtkWidget *label;
+
+  (*n_created)++;
+
+  label = gtk_label_new (NULL);
+  gtk_widget_set_size_request (label, 50, 50);
+
+  return label;
+}
+
+static void
+inc_counter (gpointer data)
+{
+  guint *counter = data;
+
+  (*counter)++;
+}
+
+static void
+bind_label (GtkWidget *widget,
+            gpointer   item,
+            gpointer   data)
+{
+  char *text;
+
+  if (item == NULL)
+    {
+      gtk_label_set_text (GTK_LABEL (widget), "unbound");
+      return;
+    }
+
+  text = g_strdup_printf ("%u", GPOINTER_TO_UINT (g_object_get_qdata (item, number_quark)));
+  gtk_label_set_text (GTK_LABEL (widget), text);
+  g_free (text);
+}
+
+static void
+allocate (GtkWidget *widget)
+{
+  int min, nat;
+
+  gtk_widget_measure (widget, GTK_ORIENTATION_HORIZONTAL, -1, &min, &nat, NULL, NULL);
+  gtk_widget_measure (widget, GTK_ORIENTATION_VERTICAL, WIDTH, &min, &nat, NULL, NULL);
+  gtk_widget_size_allocate (widget, &(GtkAllocation) { 0, 0, WIDTH, HEIGHT }, -1);
+}
+
+static guint
+count_bound (GtkWidget *widget,
+             guint     *n_selected)
+{
+  GtkWidget *child;
+  guint n_bound;
+
+  n_bound = 0;
+  *n_selected = 0;
+
+  for (child = gtk_widget_get_first_child (widget);
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      if (!gtk_widget_get_child_visible (child))
+        continue;
+
+      n_bound++;
+      g_assert_cmpstr (gtk_label_get_text (GTK_LABEL (child)), !=, "unbound");
+      if (gtk_widget_get_state_flags (child) & GTK_STATE_FLAG_SELECTED)
+        (*n_selected)++;
+    }
+
+  return n_bound;
+}
+
+static GtkWidget *
+new_view (GListStore *store,
+          guint      *n_created)
+{
+  GtkWidget *view;
+
+  view = gtk_grid_view_new ();
+  g_object_ref_sink (view);
+  *n_created = 0;
+  gtk_grid_view_set_functions (GTK_GRID_VIEW (view), setup_label, bind_label, n_created, NULL);
+  gtk_grid_view_set_model (GTK_GRID_VIEW (view), G_LIST_MODEL (store));
+
+  return view;
+}
+
+static void
+test_create_visible_only (void)
+{
+  GtkWidget *view;
+  GListStore *store;
+  guint n_created, n_bound, n_selected;
+
+  store = new_store (N_ITEMS);
+  view = new_view (store, &n_created);
+
+  allocate (view);
+
+  /* 7 columns of 50x50 cells, 6 visible rows and one more below */
+  n_bound = count_bound (view, &n_selected);
+  g_assert_cmpuint (n_bound, ==, 7 * 7);
+  g_assert_cmpuint (n_created, <=, n_bound + 1);
+  g_assert_cmpint (gtk_adjustment_get_upper (gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (view))),
+                   ==, (N_ITEMS + 6) / 7 * 50);
+
+  g_object_unref (view);
+  g_object_unref (store);
+}
+
+static void
+test_scroll_recycles (void)
+{
+  GtkWidget *view;
+  GListStore *store;
+  GtkAdjustment *adjustment;
+  guint i, n_created, n_bound, n_selected, max_bound;
+
+  store = new_store (N_ITEMS);
+  view = new_view (store, &n_created);
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (view));
+
+  allocate (view);
+  max_bound = count_bound (view, &n_selected);
+
+  for (i = 0; i < 100; i++)
+    {
+      gtk_adjustment_set_value (adjustment, gtk_adjustment_get_value (adjustment) + HEIGHT / 2);
+      allocate (view);
+      max_bound = MAX (max_bound, count_bound (view, &n_selected));
+    }
+
+  gtk_adjustment_set_value (adjustment, gtk_adjustment_get_upper (adjustment));
+  allocate (view);
+  max_bound = MAX (max_bound, count_bound (view, &n_selected));
+
+  g_assert_cmpuint (n_created, <=, max_bound + 1);
+
+  g_object_unref (view);
+  g_object_unref (store);
+}
+
+static void
+test_select_all (void)
+{
+  GtkWidget *view;
+  GListStore *store;
+  guint n_created, n_bound, n_selected, n_changed;
+
+  store = new_store (N_ITEMS);
+  view = new_view (store, &n_created);
+  n_changed = 0;
+  g_signal_connect_swapped (view, "selection-changed", G_CALLBACK (inc_counter), &n_changed);
+
+  gtk_grid_view_select_all (GTK_GRID_VIEW (view));
+  g_assert_cmpuint (n_changed, ==, 1);
+  g_assert_cmpuint (n_created, ==, 0);
+  g_assert_true (gtk_grid_view_is_selected (GTK_GRID_VIEW (view), 0));
+  g_assert_true (gtk_grid_view_is_selected (GTK_GRID_VIEW (view), N_ITEMS - 1));
+  g_assert_false (gtk_grid_view_is_selected (GTK_GRID_VIEW (view), N_ITEMS));
+
+  allocate (view);
+  n_bound = count_bound (view, &n_selected);
+  g_assert_cmpuint (n_selected, ==, n_bound);
+
+  gtk_grid_view_select_item (GTK_GRID_VIEW (view), 3, TRUE);
+  g_assert_cmpuint (n_changed, ==, 2);
+  n_bound = count_bound (view, &n_selected);
+  g_assert_cmpuint (n_selected, ==, 1);
+  g_assert_false (gtk_grid_view_is_selected (GTK_GRID_VIEW (view), 0));
+  g_assert_true (gtk_grid_view_is_selected (GTK_GRID_VIEW (view), 3));
+
+  gtk_grid_view_select_item (GTK_GRID_VIEW (view), 3, TRUE);
+  g_assert_cmpuint (n_changed, ==, 2);
+
+  gtk_grid_view_unselect_all (GTK_GRID_VIEW (view));
+  g_assert_cmpuint (n_changed, ==, 3);
+  n_bound = count_bound (view, &n_selected);
+  g_assert_cmpuint (n_selected, ==, 0);
+
+  g_object_unref (view);
+  g_object_unref (store);
+}
+
+static void
+test_items_changed (void)
+{
+  GtkWidget *view;
+  GListStore *store;
+  guint n_created, n_changed;
+
+  store = new_store (N_ITEMS);
+  view = new_view (store, &n_created);
+  n_changed = 0;
+  g_signal_connect_swapped (view, "selection-changed", G_CALLBACK (inc_counter), &n_changed);
+  allocate (view);
+
+  gtk_grid_view_select_item (GTK_GRID_VIEW (view), 5, FALSE);
+  gtk_grid_view_select_item (GTK_GRID_VIEW (view), 20, FALSE);
+  g_assert_cmpuint (n_changed, ==, 2);
+
+  /* the selection moves with the items */
+  g_list_store_splice (store, 0, 10, NULL, 0);
+  allocate (view);
+  g_assert_cmpuint (n_changed, ==, 3);
+  g_assert_false (gtk_grid_view_is_selected (GTK_GRID_VIEW (view), 5));
+  g_assert_true (gtk_grid_view_is_selected (GTK_GRID_VIEW (view), 10));
+
+  g_list_store_remove_all (store);
+  allocate (view);
+  g_assert_cmpuint (n_changed, ==, 4);
+  g_assert_false (gtk_grid_view_is_selected (GTK_GRID_VIEW (view), 10));
+
+  g_object_unref (view);
+  g_object_unref (store);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv);
+
+  number_quark = g_quark_from_static_string ("Hell and fire was spawned to be released.");
+
+  g_test_add_func ("/gridview/create-visible-only", test_create_visible_only);
+  g_test_add_func ("/gridview/scroll-recycles", test_scroll_recycles);
+  g_test_add_func ("/gridview/select-all", test_select_all);
+  g_test_add_func ("/gridview/items-changed", test_items_changed);
+
+  return g_test_run ();
+}
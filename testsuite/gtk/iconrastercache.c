@@ -0,0 +1,197 @@
+/* GtkIconRasterCache tests.
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <locale.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "../../gtk/gtkiconrastercacheprivate.h"
+
+typedef struct
+{
+  gchar *directory;
+  gchar *source;
+  GtkIconRasterCache *cache;
+} Fixture;
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+  fixture->directory = g_dir_make_tmp ("gtk-icon-raster-cache-XXXXXX", NULL);
+  g_assert_nonnull (fixture->directory);
+
+  fixture->source = g_build_filename (fixture->directory, "icon.svg", NULL);
+  g_assert_true (g_file_set_contents (fixture->source, "<svg/>", -1, NULL));
+
+  fixture->cache = gtk_icon_raster_cache_new (fixture->directory, 64 * 1024);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+  const gchar *name;
+  GDir *dir;
+
+  dir = g_dir_open (fixture->directory, 0, NULL);
+  while ((name = g_dir_read_name (dir)))
+    {
+      gchar *path = g_build_filename (fixture->directory, name, NULL);
+      g_unlink (path);
+      g_free (path);
+    }
+  g_dir_close (dir);
+  g_rmdir (fixture->directory);
+
+  gtk_icon_raster_cache_free (fixture->cache);
+  g_free (fixture->source);
+  g_free (fixture->directory);
+}
+
+static GdkPixbuf *
+make_pixbuf (gint   size,
+             guint8 value)
+{
+  GdkPixbuf *pixbuf;
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, size, size);
+  gdk_pixbuf_fill (pixbuf, value << 24 | 0x204080ff);
+
+  return pixbuf;
+}
+
+static void
+assert_pixbuf_equal (GdkPixbuf *a,
+                     GdkPixbuf *b)
+{
+  gint y, width, height, n_channels;
+
+  width = gdk_pixbuf_get_width (a);
+  height = gdk_pixbuf_get_height (a);
+  n_channels = gdk_pixbuf_get_n_channels (a);
+
+  g_assert_cmpint (width, ==, gdk_pixbuf_get_width (b));
+  g_assert_cmpint (height, ==, gdk_pixbuf_get_height (b));
+  g_assert_cmpint (n_channels, ==, gdk_pixbuf_get_n_channels (b));
+
+  for (y = 0; y < height; y++)
+    g_assert_true (memcmp (gdk_pixbuf_get_pixels (a) + y * gdk_pixbuf_get_rowstride (a),
+                           gdk_pixbuf_get_pixels (b) + y * gdk_pixbuf_get_rowstride (b),
+                           width * n_channels) == 0);
+}
+
+static void
+test_roundtrip (Fixture       *fixture,
+                gconstpointer  data)
+{
+  GdkPixbuf *pixbuf, *cached;
+  gdouble scale = 0;
+
+  cached = gtk_icon_raster_cache_lookup (fixture->cache, "icon 16", fixture->source, &scale);
+  g_assert_null (cached);
+
+  pixbuf = make_pixbuf (16, 0x10);
+  gtk_icon_raster_cache_store (fixture->cache, "icon 16", fixture->source, pixbuf, 0.5);
+
+  cached = gtk_icon_raster_cache_lookup (fixture->cache, "icon 16", fixture->source, &scale);
+  g_assert_nonnull (cached);
+  g_assert_cmpfloat (scale, ==, 0.5);
+  assert_pixbuf_equal (pixbuf, cached);
+  g_object_unref (cached);
+
+  cached = gtk_icon_raster_cache_lookup (fixture->cache, "icon 32", fixture->source, &scale);
+  g_assert_null (cached);
+
+  g_object_unref (pixbuf);
+}
+
+static void
+test_source_changed (Fixture       *fixture,
+                     gconstpointer  data)
+{
+  GdkPixbuf *pixbuf, *cached;
+  gdouble scale;
+
+  pixbuf = make_pixbuf (16, 0x20);
+  gtk_icon_raster_cache_store (fixture->cache, "icon", fixture->source, pixbuf, 1.0);
+  g_object_unref (pixbuf);
+
+  g_assert_true (g_file_set_contents (fixture->source, "<svg></svg>", -1, NULL));
+
+  cached = gtk_icon_raster_cache_lookup (fixture->cache, "icon", fixture->source, &scale);
+  g_assert_null (cached);
+
+  g_unlink (fixture->source);
+
+  cached = gtk_icon_raster_cache_lookup (fixture->cache, "icon", fixture->source, &scale);
+  g_assert_null (cached);
+}
+
+static void
+test_budget (Fixture       *fixture,
+             gconstpointer  data)
+{
+  GStatBuf st;
+  const gchar *name;
+  gint64 total;
+  GDir *dir;
+  guint i;
+
+  for (i = 0; i < 100; i++)
+    {
+      GdkPixbuf *pixbuf;
+      gchar *key;
+
+      key = g_strdup_printf ("icon %u", i);
+      pixbuf = make_pixbuf (32, i);
+      gtk_icon_raster_cache_store (fixture->cache, key, fixture->source, pixbuf, 1.0);
+      g_object_unref (pixbuf);
+      g_free (key);
+    }
+
+  gtk_icon_raster_cache_trim (fixture->cache);
+
+  total = 0;
+  dir = g_dir_open (fixture->directory, 0, NULL);
+  while ((name = g_dir_read_name (dir)))
+    {
+      gchar *path = g_build_filename (fixture->directory, name, NULL);
+      g_assert_cmpint (g_stat (path, &st), ==, 0);
+      total += st.st_size;
+      g_free (path);
+    }
+  g_dir_close (dir);
+
+  g_assert_cmpint (total, >, 0);
+  g_assert_cmpint (total, <=, 64 * 1024);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  setlocale (LC_ALL, "C");
+
+  g_test_add ("/iconrastercache/roundtrip", Fixture, NULL, fixture_setup, test_roundtrip, fixture_teardown);
+  g_test_add ("/iconrastercache/source-changed", Fixture, NULL, fixture_setup, test_source_changed, fixture_teardown);
+  g_test_add ("/iconrastercache/budget", Fixture, NULL, fixture_setup, test_budget, fixture_teardown);
+
+  return g_test_run ();
+}
@@ -754,6 +754,78 @@ test_nonsquare_symbolic (void)
   g_object_unref (info);
 }
 
+static void
+assert_symbolic_color (GdkPixbuf     *pixbuf,
+                       const GdkRGBA *color)
+{
+  guchar *pixels, *p;
+  int x, y, rowstride;
+  gboolean seen = FALSE;
+
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  for (y = 0; y < gdk_pixbuf_get_height (pixbuf); y++)
+    for (x = 0; x < gdk_pixbuf_get_width (pixbuf); x++)
+      {
+        p = pixels + y * rowstride + x * 4;
+        if (p[3] == 0)
+          continue;
+
+        g_assert_cmpint (p[0], ==, (int) (color->red * 255));
+        g_assert_cmpint (p[1], ==, (int) (color->green * 255));
+        g_assert_cmpint (p[2], ==, (int) (color->blue * 255));
+        seen = TRUE;
+      }
+
+  g_assert_true (seen);
+}
+
+static void
+test_symbolic_colors (void)
+{
+  GtkIconTheme *icon_theme;
+  GtkIconInfo *info;
+  GFile *file;
+  GIcon *icon;
+  GdkRGBA red = { 1.0, 0.0, 0.0, 1.0 };
+  GdkRGBA blue = { 0.0, 0.0, 1.0, 1.0 };
+  GdkPixbuf *pixbuf;
+  GError *error = NULL;
+  gchar *path = g_build_filename (g_test_get_dir (G_TEST_DIST),
+                                  "icons",
+                                  "scalable",
+                                  "nonsquare-symbolic.svg",
+                                  NULL);
+
+  icon_theme = gtk_icon_theme_get_default ();
+  file = g_file_new_for_path (path);
+  icon = g_file_icon_new (file);
+  info = gtk_icon_theme_lookup_by_gicon_for_scale (icon_theme, icon, 18, 1, 0);
+  g_assert_nonnull (info);
+
+  /* Loading in another color recolors the same mask */
+  pixbuf = gtk_icon_info_load_symbolic (info, &red, NULL, NULL, NULL, NULL, &error);
+  g_assert_no_error (error);
+  assert_symbolic_color (pixbuf, &red);
+  g_object_unref (pixbuf);
+
+  pixbuf = gtk_icon_info_load_symbolic (info, &blue, NULL, NULL, NULL, NULL, &error);
+  g_assert_no_error (error);
+  assert_symbolic_color (pixbuf, &blue);
+  g_object_unref (pixbuf);
+
+  pixbuf = gtk_icon_info_load_symbolic (info, &red, NULL, NULL, NULL, NULL, &error);
+  g_assert_no_error (error);
+  assert_symbolic_color (pixbuf, &red);
+  g_object_unref (pixbuf);
+
+  g_free (path);
+  g_object_unref (file);
+  g_object_unref (icon);
+  g_object_unref (info);
+}
+
 static GLogWriterOutput
 log_writer_drop_warnings (GLogLevelFlags   log_level,
                           const GLogField *fields,
@@ -794,6 +866,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/icontheme/async", test_async);
   g_test_add_func ("/icontheme/inherit", test_inherit);
   g_test_add_func ("/icontheme/nonsquare-symbolic", test_nonsquare_symbolic);
+  g_test_add_func ("/icontheme/symbolic-colors", test_symbolic_colors);
 
   return g_test_run();
 }
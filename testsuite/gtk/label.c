@@ -0,0 +1,157 @@
+/* Copyright (C) 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+#include "gtk/gtklabelprivate.h"
+
+static const char *text =
+  "The quick brown fox jumps over the lazy dog. "
+  "Pack my box with five dozen liquor jugs. "
+  "Averyveryverylongwordthatonlywrapsbetweencharacters";
+
+static const int widths[] = { 60, 120, 200, 400 };
+
+static GtkWidget *
+create_label (const char    *label_text,
+              PangoAttrList *attrs,
+              PangoWrapMode  wrap_mode)
+{
+  GtkWidget *label;
+
+  label = gtk_label_new (label_text);
+  g_object_ref_sink (label);
+  gtk_label_set_line_wrap (GTK_LABEL (label), TRUE);
+  gtk_label_set_line_wrap_mode (GTK_LABEL (label), wrap_mode);
+  gtk_label_set_attributes (GTK_LABEL (label), attrs);
+
+  return label;
+}
+
+static int
+measure_height (GtkWidget *label,
+                int        width)
+{
+  int height;
+
+  /* Drop the widget's size request cache, but not the label's */
+  gtk_widget_queue_resize (label);
+  gtk_widget_measure (label, GTK_ORIENTATION_VERTICAL, width,
+                      &height, NULL, NULL, NULL);
+
+  return height;
+}
+
+/* Compares the heights of @label to those of a new label with
+ * the same contents, which can't have cached anything.
+ */
+static void
+assert_heights (GtkWidget     *label,
+                const char    *label_text,
+                PangoAttrList *attrs,
+                PangoWrapMode  wrap_mode)
+{
+  GtkWidget *fresh;
+  guint i;
+
+  fresh = create_label (label_text, attrs, wrap_mode);
+
+  for (i = 0; i < G_N_ELEMENTS (widths); i++)
+    g_assert_cmpint (measure_height (label, widths[i]), ==, measure_height (fresh, widths[i]));
+
+  g_object_unref (fresh);
+}
+
+static void
+test_measure_changes (void)
+{
+  GtkWidget *label;
+  PangoAttrList *attrs;
+
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_scale_new (2.0));
+
+  label = create_label (text, NULL, PANGO_WRAP_WORD);
+  assert_heights (label, text, NULL, PANGO_WRAP_WORD);
+
+  gtk_label_set_text (GTK_LABEL (label), "Short");
+  assert_heights (label, "Short", NULL, PANGO_WRAP_WORD);
+
+  gtk_label_set_text (GTK_LABEL (label), text);
+  assert_heights (label, text, NULL, PANGO_WRAP_WORD);
+
+  gtk_label_set_attributes (GTK_LABEL (label), attrs);
+  assert_heights (label, text, attrs, PANGO_WRAP_WORD);
+
+  gtk_label_set_line_wrap_mode (GTK_LABEL (label), PANGO_WRAP_CHAR);
+  assert_heights (label, text, attrs, PANGO_WRAP_CHAR);
+
+  gtk_label_set_attributes (GTK_LABEL (label), NULL);
+  assert_heights (label, text, NULL, PANGO_WRAP_CHAR);
+
+  g_object_unref (label);
+  pango_attr_list_unref (attrs);
+}
+
+static void
+test_measure_cache (void)
+{
+  /* Few enough for the layouts to fit the label's cache, together
+   * with the ones used for measuring widths.
+   */
+  const int cache_widths[] = { 120, 200 };
+  GtkWidget *label;
+  PangoLayout *layout;
+  int heights[G_N_ELEMENTS (cache_widths)];
+  guint updates;
+  guint i;
+
+  label = create_label (text, NULL, PANGO_WRAP_WORD);
+
+  for (i = 0; i < G_N_ELEMENTS (cache_widths); i++)
+    heights[i] = measure_height (label, cache_widths[i]);
+
+  /* Measuring the same widths again reuses the layouts */
+  updates = _gtk_label_get_n_layout_updates ();
+  for (i = 0; i < G_N_ELEMENTS (cache_widths); i++)
+    g_assert_cmpint (measure_height (label, cache_widths[i]), ==, heights[i]);
+  g_assert_cmpuint (_gtk_label_get_n_layout_updates (), ==, updates);
+
+  /* The label swaps in the layouts it measured before, so
+   * gtk_label_get_layout() must be called again after measuring.
+   */
+  measure_height (label, cache_widths[0]);
+  layout = gtk_label_get_layout (GTK_LABEL (label));
+  g_assert_cmpint (pango_layout_get_width (layout), ==, cache_widths[0] * PANGO_SCALE);
+  measure_height (label, cache_widths[1]);
+  g_assert_true (gtk_label_get_layout (GTK_LABEL (label)) != layout);
+  measure_height (label, cache_widths[0]);
+  g_assert_true (gtk_label_get_layout (GTK_LABEL (label)) == layout);
+  g_assert_cmpuint (_gtk_label_get_n_layout_updates (), ==, updates);
+
+  g_object_unref (label);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/label/measure/changes", test_measure_changes);
+  g_test_add_func ("/label/measure/cache", test_measure_cache);
+
+  return g_test_run ();
+}
@@ -0,0 +1,236 @@
+/* Copyright (C) 2018 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+#define N_ITEMS 100000
+#define WIDTH 200
+#define HEIGHT 300
+
+static GQuark number_quark;
+
+static GListStore *
+new_store (guint n_items)
+{
+  GListStore *store;
+  GObject *object;
+  guint i;
+
+  store = g_list_store_new (G_TYPE_OBJECT);
+  for (i = 0; i < n_items; i++)
+    {
+      object = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_set_qdata (object, number_quark, GUINT_TO_POINTER (i));
+      g_list_store_append (store, object);
+      g_object_unref (object);
+    }
+
+  return store;
+}
+
+static GtkWidget *
+setup_label (gpointer data)
+{
+  guint *n_created = data;
+
+  (*n_created)++;
+
+  return gtk_label_new (NULL);
+}
+
+static void
+bind_label (GtkWidget *widget,
+            gpointer   item,
+            gpointer   data)
+{
+  char *text;
+
+  if (item == NULL)
+    {
+      gtk_label_set_text (GTK_LABEL (widget), "unbound");
+      return;
+    }
+
+  text = g_strdup_printf ("%u", GPOINTER_TO_UINT (g_object_get_qdata (item, number_quark)));
+  gtk_label_set_text (GTK_LABEL (widget), text);
+  g_free (text);
+}
+
+static void
+allocate (GtkWidget *widget)
+{
+  int min, nat;
+
+  gtk_widget_measure (widget, GTK_ORIENTATION_HORIZONTAL, -1, &min, &nat, NULL, NULL);
+  gtk_widget_measure (widget, GTK_ORIENTATION_VERTICAL, WIDTH, &min, &nat, NULL, NULL);
+  gtk_widget_size_allocate (widget, &(GtkAllocation) { 0, 0, WIDTH, HEIGHT }, -1);
+}
+
+/* Returns the number of the first visible item and counts the
+ * widgets that display items */
+static guint
+get_first_visible (GtkWidget *widget,
+                   guint     *n_bound)
+{
+  GtkWidget *child;
+  GtkAllocation alloc;
+  guint first, number;
+
+  first = G_MAXUINT;
+  *n_bound = 0;
+
+  for (child = gtk_widget_get_first_child (widget);
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      if (!gtk_widget_get_child_visible (child))
+        continue;
+
+      (*n_bound)++;
+      g_assert_cmpstr (gtk_label_get_text (GTK_LABEL (child)), !=, "unbound");
+
+      gtk_widget_get_allocation (child, &alloc);
+      if (alloc.y + alloc.height <= 0 || alloc.y >= HEIGHT)
+        continue;
+
+      number = g_ascii_strtoull (gtk_label_get_text (GTK_LABEL (child)), NULL, 10);
+      first = MIN (first, number);
+    }
+
+  return first;
+}
+
+static void
+test_create_visible_only (void)
+{
+  GtkWidget *view;
+  GListStore *store;
+  guint n_created, n_bound;
+
+  store = new_store (N_ITEMS);
+  view = gtk_list_view_new ();
+  g_object_ref_sink (view);
+  n_created = 0;
+  gtk_list_view_set_functions (GTK_LIST_VIEW (view), setup_label, bind_label, &n_created, NULL);
+  gtk_list_view_set_model (GTK_LIST_VIEW (view), G_LIST_MODEL (store));
+
+  allocate (view);
+
+  g_assert_cmpuint (get_first_visible (view, &n_bound), ==, 0);
+  g_assert_cmpuint (n_bound, >, 0);
+  g_assert_cmpuint (n_bound, <, 100);
+  g_assert_cmpuint (n_created, ==, n_bound);
+
+  g_object_unref (view);
+  g_object_unref (store);
+}
+
+static void
+test_scroll_recycles (void)
+{
+  GtkWidget *view;
+  GListStore *store;
+  GtkAdjustment *adjustment;
+  guint i, first, n_created, n_bound, max_bound;
+
+  store = new_store (N_ITEMS);
+  view = gtk_list_view_new ();
+  g_object_ref_sink (view);
+  n_created = 0;
+  gtk_list_view_set_functions (GTK_LIST_VIEW (view), setup_label, bind_label, &n_created, NULL);
+  gtk_list_view_set_model (GTK_LIST_VIEW (view), G_LIST_MODEL (store));
+  adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (view));
+
+  allocate (view);
+  get_first_visible (view, &max_bound);
+
+  /* scroll down by half a page at a time */
+  first = 0;
+  for (i = 0; i < 100; i++)
+    {
+      gtk_adjustment_set_value (adjustment, gtk_adjustment_get_value (adjustment) + HEIGHT / 2);
+      allocate (view);
+      g_assert_cmpuint (get_first_visible (view, &n_bound), >, first);
+      first = get_first_visible (view, &n_bound);
+      max_bound = MAX (max_bound, n_bound);
+    }
+
+  /* jump far */
+  gtk_adjustment_set_value (adjustment, gtk_adjustment_get_upper (adjustment) / 2);
+  allocate (view);
+  first = get_first_visible (view, &n_bound);
+  g_assert_cmpuint (first, >, N_ITEMS / 4);
+  g_assert_cmpuint (first, <, 3 * N_ITEMS / 4);
+  max_bound = MAX (max_bound, n_bound);
+
+  /* and to the end */
+  gtk_adjustment_set_value (adjustment, gtk_adjustment_get_upper (adjustment));
+  allocate (view);
+  allocate (view);
+  first = get_first_visible (view, &n_bound);
+  g_assert_cmpuint (first, >, N_ITEMS - 100);
+  max_bound = MAX (max_bound, n_bound);
+
+  /* Widgets were reused instead of creating new ones */
+  g_assert_cmpuint (n_created, <=, 2 * max_bound);
+
+  g_object_unref (view);
+  g_object_unref (store);
+}
+
+static void
+test_items_changed (void)
+{
+  GtkWidget *view;
+  GListStore *store;
+  guint n_created, n_bound;
+
+  store = new_store (N_ITEMS);
+  view = gtk_list_view_new ();
+  g_object_ref_sink (view);
+  n_created = 0;
+  gtk_list_view_set_functions (GTK_LIST_VIEW (view), setup_label, bind_label, &n_created, NULL);
+  gtk_list_view_set_model (GTK_LIST_VIEW (view), G_LIST_MODEL (store));
+
+  allocate (view);
+  g_assert_cmpuint (get_first_visible (view, &n_bound), ==, 0);
+
+  g_list_store_splice (store, 0, 10, NULL, 0);
+  allocate (view);
+  g_assert_cmpuint (get_first_visible (view, &n_bound), ==, 10);
+
+  g_list_store_remove_all (store);
+  allocate (view);
+  g_assert_cmpuint (get_first_visible (view, &n_bound), ==, G_MAXUINT);
+  g_assert_cmpuint (n_bound, ==, 0);
+
+  g_object_unref (view);
+  g_object_unref (store);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv);
+
+  number_quark = g_quark_from_static_string ("Hell and fire was spawned to be released.");
+
+  g_test_add_func ("/listview/create-visible-only", test_create_visible_only);
+  g_test_add_func ("/listview/scroll-recycles", test_scroll_recycles);
+  g_test_add_func ("/listview/items-changed", test_items_changed);
+
+  return g_test_run ();
+}
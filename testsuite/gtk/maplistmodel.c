@@ -187,6 +187,17 @@ map_multiply (gpointer item,
   return object;
 }
 
+static guint n_mapped;
+
+static gpointer
+map_count (gpointer item,
+           gpointer factor)
+{
+  n_mapped++;
+
+  return map_multiply (item, factor);
+}
+
 static GtkMapListModel *
 new_model (GListStore *store)
 {
@@ -281,6 +292,95 @@ test_set_map_func (void)
   g_object_unref (map);
 }
 
+static void
+test_items_changed (void)
+{
+  GtkMapListModel *map;
+  GListStore *store;
+  GObject *object;
+
+  store = new_store (1, 5, 1);
+  map = new_model (store);
+  assert_model (map, "2 4 6 8 10");
+  assert_changes (map, "");
+
+  object = g_object_new (G_TYPE_OBJECT, NULL);
+  g_object_set_qdata (object, number_quark, GUINT_TO_POINTER (11));
+  g_list_store_insert (store, 0, object);
+  g_object_unref (object);
+  assert_model (map, "22 2 4 6 8 10");
+  assert_changes (map, "+0");
+
+  g_list_store_remove (store, 2);
+  assert_model (map, "22 2 6 8 10");
+  assert_changes (map, "-2");
+
+  g_list_store_splice (store, 1, 3, NULL, 0);
+  assert_model (map, "22 10");
+  assert_changes (map, "1-3");
+
+  g_object_unref (store);
+  g_object_unref (map);
+}
+
+static void
+get_and_unref (GListModel *model,
+               guint       start,
+               guint       end)
+{
+  guint i;
+
+  for (i = start; i < end; i++)
+    g_object_unref (g_list_model_get_item (model, i));
+}
+
+static void
+test_cache (void)
+{
+  GtkMapListModel *map;
+  GListStore *store;
+
+  store = new_store (1, 100, 1);
+  map = gtk_map_list_model_new (G_TYPE_OBJECT, G_LIST_MODEL (store), map_count, GUINT_TO_POINTER (2), NULL);
+  g_assert_cmpuint (gtk_map_list_model_get_cache_size (map), ==, 0);
+  n_mapped = 0;
+
+  /* without cache, unused items are mapped again */
+  get_and_unref (G_LIST_MODEL (map), 0, 10);
+  get_and_unref (G_LIST_MODEL (map), 0, 10);
+  g_assert_cmpuint (n_mapped, ==, 20);
+
+  gtk_map_list_model_set_cache_size (map, 10);
+  n_mapped = 0;
+  get_and_unref (G_LIST_MODEL (map), 0, 10);
+  g_assert_cmpuint (n_mapped, ==, 10);
+  get_and_unref (G_LIST_MODEL (map), 0, 10);
+  g_assert_cmpuint (n_mapped, ==, 10);
+
+  /* the least recently used items are dropped */
+  get_and_unref (G_LIST_MODEL (map), 0, 1);
+  get_and_unref (G_LIST_MODEL (map), 10, 19);
+  g_assert_cmpuint (n_mapped, ==, 19);
+  get_and_unref (G_LIST_MODEL (map), 0, 1);
+  g_assert_cmpuint (n_mapped, ==, 19);
+  get_and_unref (G_LIST_MODEL (map), 1, 2);
+  g_assert_cmpuint (n_mapped, ==, 20);
+
+  /* removed items leave the cache */
+  g_list_store_splice (store, 0, 50, NULL, 0);
+  get_and_unref (G_LIST_MODEL (map), 0, 10);
+  g_assert_cmpuint (n_mapped, ==, 30);
+  get_and_unref (G_LIST_MODEL (map), 0, 10);
+  g_assert_cmpuint (n_mapped, ==, 30);
+
+  gtk_map_list_model_set_cache_size (map, 0);
+  get_and_unref (G_LIST_MODEL (map), 0, 10);
+  g_assert_cmpuint (n_mapped, ==, 40);
+
+  g_object_unref (store);
+  g_object_unref (map);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -295,6 +395,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/maplistmodel/create", test_create);
   g_test_add_func ("/maplistmodel/set-model", test_set_model);
   g_test_add_func ("/maplistmodel/set-map-func", test_set_map_func);
+  g_test_add_func ("/maplistmodel/items-changed", test_items_changed);
+  g_test_add_func ("/maplistmodel/cache", test_cache);
 
   return g_test_run ();
 }
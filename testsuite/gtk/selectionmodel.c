@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2018, Red Hat, Inc.
+ * Authors: Benjamin Otte <otte@gnome.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <locale.h>
+
+#include <gtk/gtk.h>
+
+static GQuark changes_quark;
+
+static GListStore *
+new_store (guint n_items)
+{
+  GListStore *store;
+  GObject *object;
+  guint i;
+
+  store = g_list_store_new (G_TYPE_OBJECT);
+  for (i = 0; i < n_items; i++)
+    {
+      object = g_object_new (G_TYPE_OBJECT, NULL);
+      g_list_store_append (store, object);
+      g_object_unref (object);
+    }
+
+  return store;
+}
+
+static char *
+selection_to_string (GtkSelectionModel *selection)
+{
+  GString *string = g_string_new (NULL);
+  guint start, n_items;
+
+  for (start = 0;
+       gtk_selection_model_get_next_selected (selection, start, &start, &n_items);
+       start += n_items)
+    {
+      if (string->len > 0)
+        g_string_append (string, " ");
+      if (n_items == 1)
+        g_string_append_printf (string, "%u", start);
+      else
+        g_string_append_printf (string, "%u-%u", start, start + n_items - 1);
+    }
+
+  return g_string_free (string, FALSE);
+}
+
+#define assert_selection(selection, expected) G_STMT_START{ \
+  char *s = selection_to_string (selection); \
+  if (!g_str_equal (s, expected)) \
+     g_assertion_message_cmpstr (G_LOG_DOMAIN, __FILE__, __LINE__, G_STRFUNC, \
+         #selection " == " #expected, s, "==", expected); \
+  g_free (s); \
+}G_STMT_END
+
+#define assert_changes(selection, expected) G_STMT_START{ \
+  GString *changes = g_object_get_qdata (G_OBJECT (selection), changes_quark); \
+  if (!g_str_equal (changes->str, expected)) \
+     g_assertion_message_cmpstr (G_LOG_DOMAIN, __FILE__, __LINE__, G_STRFUNC, \
+         #selection " == " #expected, changes->str, "==", expected); \
+  g_string_set_size (changes, 0); \
+}G_STMT_END
+
+static void
+selection_changed (GtkSelectionModel *selection,
+                   guint              position,
+                   guint              n_items,
+                   GString           *changes)
+{
+  g_assert_cmpuint (n_items, >, 0);
+
+  if (changes->len)
+    g_string_append (changes, ", ");
+
+  g_string_append_printf (changes, "%u:%u", position, n_items);
+}
+
+static void
+free_changes (gpointer data)
+{
+  GString *changes = data;
+
+  /* all changes must have been checked via assert_changes() before */
+  g_assert_cmpstr (changes->str, ==, "");
+
+  g_string_free (changes, TRUE);
+}
+
+static GtkSelectionModel *
+new_selection (GListModel *model)
+{
+  GtkSelectionModel *result;
+  GString *changes;
+
+  result = gtk_selection_model_new (model);
+
+  changes = g_string_new ("");
+  g_object_set_qdata_full (G_OBJECT (result), changes_quark, changes, free_changes);
+  g_signal_connect (result, "selection-changed", G_CALLBACK (selection_changed), changes);
+
+  return result;
+}
+
+static void
+test_create (void)
+{
+  GtkSelectionModel *selection;
+  GListStore *store;
+
+  store = new_store (10);
+  selection = new_selection (G_LIST_MODEL (store));
+
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (selection)), ==, 10);
+  g_assert_cmpuint (gtk_selection_model_get_n_selected (selection), ==, 0);
+  assert_selection (selection, "");
+
+  g_object_unref (store);
+  g_object_unref (selection);
+}
+
+static void
+test_select (void)
+{
+  GtkSelectionModel *selection;
+  GListStore *store;
+
+  store = new_store (20);
+  selection = new_selection (G_LIST_MODEL (store));
+
+  gtk_selection_model_select_range (selection, 2, 3, FALSE);
+  assert_selection (selection, "2-4");
+  assert_changes (selection, "2:3");
+  g_assert_true (gtk_selection_model_is_selected (selection, 2));
+  g_assert_false (gtk_selection_model_is_selected (selection, 5));
+
+  /* selecting selected items does nothing */
+  gtk_selection_model_select_range (selection, 3, 2, FALSE);
+  assert_changes (selection, "");
+
+  /* only the newly selected items change */
+  gtk_selection_model_select_range (selection, 4, 4, FALSE);
+  assert_selection (selection, "2-7");
+  assert_changes (selection, "5:3");
+
+  gtk_selection_model_select_range (selection, 10, 2, FALSE);
+  assert_selection (selection, "2-7 10-11");
+  assert_changes (selection, "10:2");
+
+  gtk_selection_model_unselect_range (selection, 0, 4);
+  assert_selection (selection, "4-7 10-11");
+  assert_changes (selection, "2:2");
+
+  /* exclusive selection reports one range covering all changes */
+  gtk_selection_model_select_range (selection, 6, 1, TRUE);
+  assert_selection (selection, "6");
+  assert_changes (selection, "4:8");
+  g_assert_cmpuint (gtk_selection_model_get_n_selected (selection), ==, 1);
+
+  gtk_selection_model_invert_range (selection, 5, 3);
+  assert_selection (selection, "5 7");
+  assert_changes (selection, "5:3");
+
+  gtk_selection_model_select_all (selection);
+  assert_selection (selection, "0-19");
+  assert_changes (selection, "0:20");
+  g_assert_cmpuint (gtk_selection_model_get_n_selected (selection), ==, 20);
+
+  gtk_selection_model_unselect_all (selection);
+  assert_selection (selection, "");
+  assert_changes (selection, "0:20");
+
+  gtk_selection_model_unselect_all (selection);
+  assert_changes (selection, "");
+
+  g_object_unref (store);
+  g_object_unref (selection);
+}
+
+static void
+test_items_changed (void)
+{
+  GtkSelectionModel *selection;
+  GListStore *store;
+  GObject *object;
+
+  store = new_store (20);
+  selection = new_selection (G_LIST_MODEL (store));
+
+  gtk_selection_model_select_range (selection, 5, 5, FALSE);
+  assert_changes (selection, "5:5");
+
+  /* items before the selection move it */
+  g_list_store_remove (store, 0);
+  assert_selection (selection, "4-8");
+
+  object = g_object_new (G_TYPE_OBJECT, NULL);
+  g_list_store_insert (store, 0, object);
+  g_list_store_insert (store, 0, object);
+  assert_selection (selection, "6-10");
+
+  /* new items are not selected */
+  g_list_store_insert (store, 8, object);
+  assert_selection (selection, "6-7 9-11");
+  g_object_unref (object);
+
+  /* removed items are removed from the selection */
+  g_list_store_remove (store, 7);
+  assert_selection (selection, "6 8-10");
+  g_assert_cmpuint (gtk_selection_model_get_n_selected (selection), ==, 4);
+
+  g_list_store_remove_all (store);
+  assert_selection (selection, "");
+
+  /* none of this emits selection-changed */
+  assert_changes (selection, "");
+
+  g_object_unref (store);
+  g_object_unref (selection);
+}
+
+static void
+test_set_model (void)
+{
+  GtkSelectionModel *selection;
+  GListStore *store;
+
+  store = new_store (20);
+  selection = new_selection (G_LIST_MODEL (store));
+
+  gtk_selection_model_select_all (selection);
+  assert_changes (selection, "0:20");
+
+  gtk_selection_model_set_model (selection, NULL);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (selection)), ==, 0);
+  assert_selection (selection, "");
+
+  gtk_selection_model_set_model (selection, G_LIST_MODEL (store));
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (selection)), ==, 20);
+  assert_selection (selection, "");
+  assert_changes (selection, "");
+
+  g_object_unref (store);
+  g_object_unref (selection);
+}
+
+static void
+test_large (void)
+{
+  GtkSelectionModel *selection;
+  GListStore *store;
+  guint i;
+
+  store = new_store (100000);
+  selection = new_selection (G_LIST_MODEL (store));
+
+  gtk_selection_model_select_all (selection);
+  assert_changes (selection, "0:100000");
+
+  for (i = 0; i < 100000; i += 1000)
+    gtk_selection_model_invert_range (selection, i, 1);
+  g_assert_cmpuint (gtk_selection_model_get_n_selected (selection), ==, 100000 - 100);
+  g_assert_false (gtk_selection_model_is_selected (selection, 5000));
+  g_assert_true (gtk_selection_model_is_selected (selection, 5001));
+  g_string_set_size (g_object_get_qdata (G_OBJECT (selection), changes_quark), 0);
+
+  g_list_store_splice (store, 0, 50000, NULL, 0);
+  g_assert_cmpuint (gtk_selection_model_get_n_selected (selection), ==, 50000 - 50);
+  g_assert_false (gtk_selection_model_is_selected (selection, 0));
+  g_assert_true (gtk_selection_model_is_selected (selection, 1));
+
+  g_object_unref (store);
+  g_object_unref (selection);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  setlocale (LC_ALL, "C");
+
+  changes_quark = g_quark_from_static_string ("What did I see? Can I believe what I saw?");
+
+  g_test_add_func ("/selectionmodel/create", test_create);
+  g_test_add_func ("/selectionmodel/select", test_select);
+  g_test_add_func ("/selectionmodel/items-changed", test_items_changed);
+  g_test_add_func ("/selectionmodel/set-model", test_set_model);
+  g_test_add_func ("/selectionmodel/large", test_large);
+
+  return g_test_run ();
+}
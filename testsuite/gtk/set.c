@@ -0,0 +1,297 @@
+/* GtkSet tests.
+ *
+ * Copyright (C) 2018, Red Hat, Inc.
+ * Authors: Benjamin Otte <otte@gnome.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <locale.h>
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "../../gtk/gtksetprivate.h"
+
+/* how many operations we do in our random tests */
+#define N_TRIES 10000
+
+/* the maximum number of items in the random tests */
+#define MAX_ITEMS 2000
+
+/* UTILITIES */
+
+/* Compares set against the booleans in members */
+static void
+assert_set (GtkSet         *set,
+            const gboolean *members,
+            guint           n_members)
+{
+  guint i, size, position, start, n_items;
+
+  size = 0;
+  for (i = 0; i < n_members; i++)
+    {
+      g_assert_cmpint (gtk_set_contains (set, i), ==, members[i]);
+      if (members[i])
+        size++;
+    }
+  g_assert_false (gtk_set_contains (set, n_members));
+  g_assert_cmpuint (gtk_set_get_size (set), ==, size);
+  g_assert_cmpint (gtk_set_is_empty (set), ==, size == 0);
+
+  /* ranges are as large as possible */
+  for (position = 0; gtk_set_get_next_range (set, position, &start, &n_items); position = start + n_items)
+    {
+      g_assert_cmpuint (n_items, >, 0);
+      g_assert_cmpuint (start + n_items, <=, n_members);
+      g_assert_true (start == position || !members[start - 1]);
+      g_assert_true (start + n_items == n_members || !members[start + n_items]);
+      size -= n_items;
+    }
+  g_assert_cmpuint (size, ==, 0);
+}
+
+/* TESTS */
+
+static void
+test_ranges (void)
+{
+  GtkSet *set;
+  guint start, n_items;
+
+  set = gtk_set_new ();
+  g_assert_true (gtk_set_is_empty (set));
+  g_assert_false (gtk_set_get_next_range (set, 0, &start, &n_items));
+
+  g_assert_true (gtk_set_add_range (set, 10, 10, &start, &n_items));
+  g_assert_cmpuint (start, ==, 10);
+  g_assert_cmpuint (n_items, ==, 10);
+
+  /* adding members again changes nothing */
+  g_assert_false (gtk_set_add_range (set, 12, 5, &start, &n_items));
+  g_assert_cmpuint (n_items, ==, 0);
+
+  /* touching ranges are merged */
+  g_assert_true (gtk_set_add_range (set, 20, 5, &start, &n_items));
+  g_assert_cmpuint (start, ==, 20);
+  g_assert_cmpuint (n_items, ==, 5);
+  g_assert_true (gtk_set_get_next_range (set, 0, &start, &n_items));
+  g_assert_cmpuint (start, ==, 10);
+  g_assert_cmpuint (n_items, ==, 15);
+
+  /* the changed range covers all new members */
+  g_assert_true (gtk_set_add_range (set, 30, 5, NULL, NULL));
+  g_assert_true (gtk_set_add_range (set, 0, 40, &start, &n_items));
+  g_assert_cmpuint (start, ==, 0);
+  g_assert_cmpuint (n_items, ==, 40);
+  g_assert_cmpuint (gtk_set_get_size (set), ==, 40);
+
+  g_assert_true (gtk_set_remove_range (set, 5, 10, &start, &n_items));
+  g_assert_cmpuint (start, ==, 5);
+  g_assert_cmpuint (n_items, ==, 10);
+  g_assert_false (gtk_set_remove_range (set, 5, 10, &start, &n_items));
+  g_assert_true (gtk_set_get_next_range (set, 5, &start, &n_items));
+  g_assert_cmpuint (start, ==, 15);
+  g_assert_cmpuint (n_items, ==, 25);
+
+  gtk_set_invert_range (set, 0, 50);
+  g_assert_true (gtk_set_get_next_range (set, 0, &start, &n_items));
+  g_assert_cmpuint (start, ==, 5);
+  g_assert_cmpuint (n_items, ==, 10);
+  g_assert_true (gtk_set_get_next_range (set, 15, &start, &n_items));
+  g_assert_cmpuint (start, ==, 40);
+  g_assert_cmpuint (n_items, ==, 10);
+
+  gtk_set_remove_all (set);
+  g_assert_true (gtk_set_is_empty (set));
+
+  gtk_set_free (set);
+}
+
+static void
+test_splice (void)
+{
+  GtkSet *set;
+  guint start, n_items;
+
+  set = gtk_set_new ();
+  gtk_set_add_range (set, 10, 10, NULL, NULL);
+
+  /* items added before the range move it */
+  gtk_set_splice (set, 0, 0, 5);
+  g_assert_true (gtk_set_get_next_range (set, 0, &start, &n_items));
+  g_assert_cmpuint (start, ==, 15);
+  g_assert_cmpuint (n_items, ==, 10);
+
+  /* items added inside split it */
+  gtk_set_splice (set, 20, 0, 5);
+  g_assert_cmpuint (gtk_set_get_size (set), ==, 10);
+  g_assert_false (gtk_set_contains (set, 20));
+  g_assert_true (gtk_set_contains (set, 25));
+
+  /* removing the added items joins the ranges again */
+  gtk_set_splice (set, 20, 5, 0);
+  g_assert_true (gtk_set_get_next_range (set, 0, &start, &n_items));
+  g_assert_cmpuint (start, ==, 15);
+  g_assert_cmpuint (n_items, ==, 10);
+
+  /* and removing the gap before them joins them with others */
+  gtk_set_add_range (set, 0, 5, NULL, NULL);
+  gtk_set_splice (set, 5, 10, 0);
+  g_assert_true (gtk_set_get_next_range (set, 0, &start, &n_items));
+  g_assert_cmpuint (start, ==, 0);
+  g_assert_cmpuint (n_items, ==, 15);
+
+  gtk_set_free (set);
+}
+
+static void
+test_huge (void)
+{
+  GtkSet *set;
+  guint i;
+
+  set = gtk_set_new ();
+
+  gtk_set_add_range (set, 0, G_MAXUINT, NULL, NULL);
+  g_assert_cmpuint (gtk_set_get_size (set), ==, G_MAXUINT);
+
+  /* every other item */
+  for (i = 0; i < 2000; i += 2)
+    gtk_set_remove_range (set, i, 1, NULL, NULL);
+  g_assert_cmpuint (gtk_set_get_size (set), ==, G_MAXUINT - 1000);
+  g_assert_false (gtk_set_contains (set, 1000));
+  g_assert_true (gtk_set_contains (set, 1001));
+  g_assert_true (gtk_set_contains (set, G_MAXUINT - 1));
+
+  gtk_set_invert_range (set, 0, 2000);
+  g_assert_true (gtk_set_contains (set, 1000));
+  g_assert_false (gtk_set_contains (set, 1001));
+
+  gtk_set_free (set);
+}
+
+static void
+test_random (void)
+{
+  GtkSet *set;
+  gboolean *members;
+  guint n_members, i, j;
+
+  set = gtk_set_new ();
+  members = g_new0 (gboolean, MAX_ITEMS);
+  n_members = MAX_ITEMS / 2;
+
+  for (i = 0; i < N_TRIES; i++)
+    {
+      guint start, n_items, changed_start, changed_n_items, first, last;
+      gboolean changed;
+
+      start = g_test_rand_int_range (0, n_members + 1);
+      n_items = g_test_rand_int_range (0, n_members - start + 1);
+      if (g_test_rand_bit ())
+        n_items = MIN (n_items, 5);
+      first = G_MAXUINT;
+      last = 0;
+
+      switch (g_test_rand_int_range (0, 4))
+        {
+        case 0:
+          for (j = start; j < start + n_items; j++)
+            {
+              if (!members[j])
+                {
+                  first = MIN (first, j);
+                  last = j + 1;
+                  members[j] = TRUE;
+                }
+            }
+          changed = gtk_set_add_range (set, start, n_items, &changed_start, &changed_n_items);
+          g_assert_cmpint (changed, ==, first < last);
+          if (changed)
+            {
+              g_assert_cmpuint (changed_start, ==, first);
+              g_assert_cmpuint (changed_n_items, ==, last - first);
+            }
+          break;
+
+        case 1:
+          for (j = start; j < start + n_items; j++)
+            {
+              if (members[j])
+                {
+                  first = MIN (first, j);
+                  last = j + 1;
+                  members[j] = FALSE;
+                }
+            }
+          changed = gtk_set_remove_range (set, start, n_items, &changed_start, &changed_n_items);
+          g_assert_cmpint (changed, ==, first < last);
+          if (changed)
+            {
+              g_assert_cmpuint (changed_start, ==, first);
+              g_assert_cmpuint (changed_n_items, ==, last - first);
+            }
+          break;
+
+        case 2:
+          for (j = start; j < start + n_items; j++)
+            members[j] = !members[j];
+          gtk_set_invert_range (set, start, n_items);
+          break;
+
+        case 3:
+          {
+            guint removed, added;
+
+            removed = MIN (n_items, 20);
+            added = g_test_rand_int_range (0, 40);
+            if (n_members - removed + added > MAX_ITEMS)
+              added = 0;
+
+            memmove (members + start + added,
+                     members + start + removed,
+                     (n_members - start - removed) * sizeof (gboolean));
+            for (j = start; j < start + added; j++)
+              members[j] = FALSE;
+            n_members = n_members - removed + added;
+            gtk_set_splice (set, start, removed, added);
+          }
+          break;
+
+        default:
+          g_assert_not_reached ();
+        }
+
+      assert_set (set, members, n_members);
+    }
+
+  g_free (members);
+  gtk_set_free (set);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  setlocale (LC_ALL, "C");
+
+  g_test_add_func ("/set/ranges", test_ranges);
+  g_test_add_func ("/set/splice", test_splice);
+  g_test_add_func ("/set/huge", test_huge);
+  g_test_add_func ("/set/random", test_random);
+
+  return g_test_run ();
+}
@@ -18,6 +18,7 @@
  */
 
 #include <locale.h>
+#include <stdlib.h>
 
 #include <gtk/gtk.h>
 
@@ -380,6 +381,216 @@ test_remove_items (void)
   g_object_unref (sort);
 }
 
+static void
+test_stability (void)
+{
+  GtkSortListModel *sort;
+  GListStore *store;
+
+  store = new_store ((guint[]) { 10, 5, 3, 8, 13, 1, 0 });
+  sort = new_model (store);
+  gtk_sort_list_model_set_sort_func (sort, compare_modulo, GUINT_TO_POINTER (5), NULL);
+  assert_model (sort, "10 5 1 3 8 13");
+  assert_changes (sort, "0-6+6");
+
+  splice (store, 0, 0, (guint[]) { 15 }, 1);
+  assert_model (sort, "15 10 5 1 3 8 13");
+  assert_changes (sort, "+0");
+
+  splice (store, 4, 1, (guint[]) { 23, 18 }, 2);
+  assert_model (sort, "15 10 5 1 3 23 18 13");
+  assert_changes (sort, "5-1+2");
+
+  g_object_unref (store);
+  g_object_unref (sort);
+}
+
+static int
+compare_uint (gconstpointer a,
+              gconstpointer b)
+{
+  guint ua = *(const guint *) a;
+  guint ub = *(const guint *) b;
+
+  return (ua > ub) - (ua < ub);
+}
+
+/* Checks that sort contains the numbers of store in sorted order */
+static void
+assert_sorted (GtkSortListModel *sort,
+               GListStore       *store)
+{
+  guint i, n_items;
+  guint *expected;
+
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (store));
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sort)), ==, n_items);
+
+  expected = g_new (guint, n_items);
+  for (i = 0; i < n_items; i++)
+    expected[i] = get (G_LIST_MODEL (store), i);
+  qsort (expected, n_items, sizeof (guint), compare_uint);
+
+  for (i = 0; i < n_items; i++)
+    g_assert_cmpuint (get (G_LIST_MODEL (sort), i), ==, expected[i]);
+
+  g_free (expected);
+}
+
+static void
+test_random (void)
+{
+  GtkSortListModel *sort;
+  GListStore *store;
+  guint i, j, n_items, position, removed, added;
+  guint numbers[50];
+
+  store = new_empty_store ();
+  sort = gtk_sort_list_model_new (G_LIST_MODEL (store), compare, NULL, NULL);
+
+  for (i = 0; i < 100; i++)
+    {
+      n_items = g_list_model_get_n_items (G_LIST_MODEL (store));
+      position = g_test_rand_int_range (0, n_items + 1);
+      removed = g_test_rand_int_range (0, MIN (n_items - position, 20) + 1);
+      added = g_test_rand_int_range (0, G_N_ELEMENTS (numbers));
+      for (j = 0; j < added; j++)
+        numbers[j] = g_test_rand_int_range (1, 100);
+
+      splice (store, position, removed, numbers, added);
+      assert_sorted (sort, store);
+    }
+
+  g_object_unref (store);
+  g_object_unref (sort);
+}
+
+static void
+test_incremental (void)
+{
+  GtkSortListModel *sort, *expected;
+  GListStore *store;
+  GString *changes;
+  char *s;
+  guint i;
+
+  store = new_empty_store ();
+  /* 7919 is prime, so this adds 1 to 1000 in some order */
+  for (i = 0; i < 1000; i++)
+    add (store, i * 7919 % 1000 + 1);
+
+  sort = new_model (store);
+  changes = g_object_get_qdata (G_OBJECT (sort), changes_quark);
+  expected = gtk_sort_list_model_new (G_LIST_MODEL (store), compare_modulo, GUINT_TO_POINTER (7), NULL);
+
+  gtk_sort_list_model_set_incremental (sort, TRUE);
+  gtk_sort_list_model_set_sort_func (sort, compare_modulo, GUINT_TO_POINTER (7), NULL);
+  /* Nothing was sorted yet */
+  g_assert_cmpuint (gtk_sort_list_model_get_pending (sort), ==, 1000);
+  g_assert_cmpuint (get (G_LIST_MODEL (sort), 0), ==, 1);
+  assert_changes (sort, "");
+
+  /* Changes while sorting start over */
+  splice (store, 500, 10, (guint[]) { 1001, 1002, 1003 }, 3);
+  g_assert_cmpuint (gtk_sort_list_model_get_pending (sort), ==, 993);
+
+  while (gtk_sort_list_model_get_pending (sort) > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  s = model_to_string (G_LIST_MODEL (expected));
+  assert_model (sort, s);
+  g_free (s);
+  g_string_set_size (changes, 0);
+
+  /* Turning incremental off sorts the rest right away */
+  gtk_sort_list_model_set_sort_func (sort, compare, NULL, NULL);
+  g_assert_cmpuint (gtk_sort_list_model_get_pending (sort), ==, 993);
+  gtk_sort_list_model_set_incremental (sort, FALSE);
+  g_assert_cmpuint (gtk_sort_list_model_get_pending (sort), ==, 0);
+  for (i = 1; i < 993; i++)
+    g_assert_cmpuint (get (G_LIST_MODEL (sort), i - 1), <, get (G_LIST_MODEL (sort), i));
+  assert_changes (sort, "0-993+993");
+
+  g_object_unref (expected);
+  g_object_unref (store);
+  g_object_unref (sort);
+}
+
+static gpointer *
+new_random_objects (guint n_objects)
+{
+  gpointer *objects = g_new (gpointer, n_objects);
+  guint i;
+
+  for (i = 0; i < n_objects; i++)
+    {
+      objects[i] = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_set_qdata (objects[i], number_quark, GUINT_TO_POINTER (g_test_rand_int_range (1, G_MAXINT32)));
+    }
+
+  return objects;
+}
+
+static void
+free_objects (gpointer *objects,
+              guint     n_objects)
+{
+  guint i;
+
+  for (i = 0; i < n_objects; i++)
+    g_object_unref (objects[i]);
+  g_free (objects);
+}
+
+static void
+test_performance (void)
+{
+  guint sizes[] = { 10000, 100000, 1000000 };
+  GtkSortListModel *sort;
+  GListStore *store;
+  gpointer *objects, *more;
+  guint i, n, n_more;
+  double elapsed;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      n = g_test_perf () ? sizes[i] : 100;
+      n_more = n / 10;
+      objects = new_random_objects (n);
+      more = new_random_objects (n_more);
+      store = new_empty_store ();
+      g_list_store_splice (store, 0, 0, objects, n);
+
+      g_test_timer_start ();
+      sort = gtk_sort_list_model_new (G_LIST_MODEL (store), compare, NULL, NULL);
+      elapsed = g_test_timer_elapsed ();
+      if (g_test_perf ())
+        g_test_minimized_result (elapsed, "sorting %u items: %gsec", n, elapsed);
+
+      g_test_timer_start ();
+      g_list_store_splice (store, n / 2, 0, more, n_more);
+      elapsed = g_test_timer_elapsed ();
+      if (g_test_perf ())
+        g_test_minimized_result (elapsed, "adding %u items to %u items: %gsec", n_more, n, elapsed);
+
+      g_test_timer_start ();
+      g_list_store_splice (store, n / 2, n_more, NULL, 0);
+      elapsed = g_test_timer_elapsed ();
+      if (g_test_perf ())
+        g_test_minimized_result (elapsed, "removing %u items from %u items: %gsec", n_more, n + n_more, elapsed);
+
+      g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sort)), ==, n);
+
+      g_object_unref (sort);
+      g_object_unref (store);
+      free_objects (objects, n);
+      free_objects (more, n_more);
+
+      if (!g_test_perf ())
+        break;
+    }
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -397,6 +608,10 @@ main (int argc, char *argv[])
 #if GLIB_CHECK_VERSION (2, 58, 0) /* g_list_store_splice() is broken before 2.58 */
   g_test_add_func ("/sortlistmodel/add_items", test_add_items);
   g_test_add_func ("/sortlistmodel/remove_items", test_remove_items);
+  g_test_add_func ("/sortlistmodel/stability", test_stability);
+  g_test_add_func ("/sortlistmodel/random", test_random);
+  g_test_add_func ("/sortlistmodel/incremental", test_incremental);
+  g_test_add_func ("/sortlistmodel/performance", test_performance);
 #endif
 
   return g_test_run ();
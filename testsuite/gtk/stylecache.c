@@ -0,0 +1,96 @@
+/* Copyright (C) 2018 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+#include "gtk/gtkcssnodestylecacheprivate.h"
+
+static GtkWidget *
+create_box_with_label (void)
+{
+  GtkWidget *box, *label;
+  GdkRGBA color;
+
+  box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  g_object_ref_sink (box);
+  label = gtk_label_new ("Hello");
+  gtk_container_add (GTK_CONTAINER (box), label);
+
+  /* Make sure the styles are computed */
+  gtk_style_context_get_color (gtk_widget_get_style_context (box), &color);
+  gtk_style_context_get_color (gtk_widget_get_style_context (label), &color);
+
+  return box;
+}
+
+static void
+test_shared_toplevel (void)
+{
+  GtkWidget *box1, *box2;
+  guint hits1, hits2, misses1, misses2;
+
+  box1 = create_box_with_label ();
+  gtk_css_node_style_cache_get_shared_stats (&hits1, &misses1, NULL);
+
+  /* Unrelated nodes with the same declaration share their style */
+  box2 = create_box_with_label ();
+  gtk_css_node_style_cache_get_shared_stats (&hits2, &misses2, NULL);
+
+  g_assert_cmpuint (hits2, >, hits1);
+
+  g_object_unref (box1);
+  g_object_unref (box2);
+}
+
+static void
+test_shared_provider_changed (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *box1, *box2;
+  GdkRGBA color, expected;
+
+  box1 = create_box_with_label ();
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, "box { color: rgb(255,0,0); }", -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  /* Must not get the style computed before the provider was added */
+  box2 = create_box_with_label ();
+  gtk_style_context_get_color (gtk_widget_get_style_context (box2), &color);
+  gdk_rgba_parse (&expected, "red");
+  g_assert_true (gdk_rgba_equal (&color, &expected));
+
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+  g_object_unref (box1);
+  g_object_unref (box2);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/style/shared-cache/toplevel", test_shared_toplevel);
+  g_test_add_func ("/style/shared-cache/provider-changed", test_shared_provider_changed);
+
+  return g_test_run ();
+}
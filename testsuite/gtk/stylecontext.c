@@ -1,5 +1,8 @@
 #include <gtk/gtk.h>
 
+#include "gtk/gtkcssstaticstyleprivate.h"
+#include "gtk/gtkwidgetprivate.h"
+
 typedef struct {
   GtkStyleContext *context;
   GtkCssProvider  *blue_provider;
@@ -310,6 +313,181 @@ test_style_classes (void)
   g_object_unref (context);
 }
 
+static void
+assert_label_color (GtkWidget  *label,
+                    const char *expected)
+{
+  GdkRGBA color, ref_color;
+
+  gdk_rgba_parse (&ref_color, expected);
+  gtk_style_context_get_color (gtk_widget_get_style_context (label), &color);
+
+  g_assert_true (gdk_rgba_equal (&ref_color, &color));
+}
+
+static void
+test_descendant_selectors (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *outer, *box1, *box2, *label;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider,
+                                   "label { color: blue; }\n"
+                                   ".outer .red label { color: red; }\n",
+                                   -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  outer = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  g_object_ref_sink (outer);
+  box1 = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  box2 = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_container_add (GTK_CONTAINER (outer), box1);
+  gtk_container_add (GTK_CONTAINER (outer), box2);
+  label = gtk_label_new ("label");
+  gtk_container_add (GTK_CONTAINER (box1), label);
+
+  assert_label_color (label, "blue");
+
+  /* Changing the classes of ancestors must be noticed */
+  gtk_style_context_add_class (gtk_widget_get_style_context (box1), "red");
+  assert_label_color (label, "blue");
+  gtk_style_context_add_class (gtk_widget_get_style_context (outer), "outer");
+  assert_label_color (label, "red");
+  gtk_style_context_remove_class (gtk_widget_get_style_context (box1), "red");
+  assert_label_color (label, "blue");
+
+  /* and so must moving to other ancestors */
+  gtk_style_context_add_class (gtk_widget_get_style_context (box2), "red");
+  g_object_ref (label);
+  gtk_container_remove (GTK_CONTAINER (box1), label);
+  gtk_container_add (GTK_CONTAINER (box2), label);
+  g_object_unref (label);
+  assert_label_color (label, "red");
+
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+  g_object_unref (outer);
+}
+
+static const char *partial_update_css =
+  "box:hover { color: rgb(255,0,0); }\n"
+  "box:backdrop label { background-color: rgb(0,0,255); }\n"
+  "box.spaced { letter-spacing: 2px; }\n"
+  "box.big { font-size: 20px; }\n"
+  "label { border: 1px solid currentColor; padding: 1em; }\n"
+  "label:hover { margin: 3px; }\n";
+
+typedef void (* PartialUpdateFunc) (GtkWidget *box, GtkWidget *label);
+
+static void
+hover_label (GtkWidget *box,
+             GtkWidget *label)
+{
+  gtk_widget_set_state_flags (label, GTK_STATE_FLAG_PRELIGHT, FALSE);
+}
+
+static void
+hover_box (GtkWidget *box,
+           GtkWidget *label)
+{
+  gtk_widget_set_state_flags (box, GTK_STATE_FLAG_PRELIGHT, FALSE);
+}
+
+static void
+backdrop_box (GtkWidget *box,
+              GtkWidget *label)
+{
+  gtk_widget_set_state_flags (box, GTK_STATE_FLAG_BACKDROP, FALSE);
+}
+
+static void
+add_class (GtkWidget *box,
+           GtkWidget *label)
+{
+  gtk_style_context_add_class (gtk_widget_get_style_context (box), "spaced");
+}
+
+static void
+change_inherited (GtkWidget *box,
+                  GtkWidget *label)
+{
+  gtk_style_context_add_class (gtk_widget_get_style_context (box), "big");
+}
+
+static char *
+validate_tree (GtkWidget *tree)
+{
+  gtk_css_node_validate (gtk_widget_get_css_node (tree));
+
+  return gtk_style_context_to_string (gtk_widget_get_style_context (tree),
+                                      GTK_STYLE_CONTEXT_PRINT_RECURSE |
+                                      GTK_STYLE_CONTEXT_PRINT_SHOW_STYLE);
+}
+
+/* Styles that were updated in place after a state or class change
+ * must be the same as styles computed from scratch.
+ */
+static void
+test_partial_update (void)
+{
+  const PartialUpdateFunc funcs[] = {
+    hover_label, hover_box, backdrop_box, add_class, change_inherited
+  };
+  GtkCssProvider *provider;
+  GtkWidget *tree, *box, *label;
+  char *updated, *computed;
+  guint n_updated_before, n_updated_after;
+  guint i, j;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, partial_update_css, -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  gtk_css_static_style_get_update_stats (&n_updated_before, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (funcs); i++)
+    {
+      tree = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+      g_object_ref_sink (tree);
+      box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+      gtk_container_add (GTK_CONTAINER (tree), box);
+      label = NULL;
+      for (j = 0; j < 3; j++)
+        {
+          label = gtk_label_new ("Label");
+          gtk_container_add (GTK_CONTAINER (box), label);
+        }
+
+      g_free (validate_tree (tree));
+
+      funcs[i] (box, label);
+      updated = validate_tree (tree);
+
+      gtk_widget_reset_style (tree);
+      computed = validate_tree (tree);
+
+      g_assert_cmpstr (updated, ==, computed);
+
+      g_free (updated);
+      g_free (computed);
+      g_object_unref (tree);
+    }
+
+  /* Make sure the partial update path was actually taken */
+  gtk_css_static_style_get_update_stats (&n_updated_after, NULL);
+  g_assert_cmpuint (n_updated_after, >, n_updated_before);
+
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
 static void
 test_style_priorities_setup (PrioritiesFixture *f,
                              gconstpointer      unused)
@@ -516,6 +694,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/style/basic", test_basic_properties);
   g_test_add_func ("/style/widget-path-parent", test_widget_path_parent);
   g_test_add_func ("/style/classes", test_style_classes);
+  g_test_add_func ("/style/descendant-selectors", test_descendant_selectors);
+  g_test_add_func ("/style/partial-update", test_partial_update);
 
 #define ADD_PRIORITIES_TEST(path, func) \
   g_test_add ("/style/priorities/" path, PrioritiesFixture, NULL, test_style_priorities_setup, \
@@ -0,0 +1,116 @@
+/* Copyright (C) 2018 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+#include "gtk/gtkcssprefetchprivate.h"
+#include "gtk/gtkwidgetprivate.h"
+
+#define N_ROWS 100
+#define N_LABELS 5
+
+static const char *css =
+  "box.odd label { color: rgb(255,0,0); }\n"
+  "box > label:first-child { font-size: 20px; }\n"
+  "label + label { margin-left: 3px; }\n"
+  "box:nth-child(3n) > label { background-color: rgb(0,0,255); }\n"
+  ".even.deep label:last-child { padding: 7px; }\n"
+  "box box:last-child label { border: 1px solid black; }\n";
+
+static GtkWidget *
+create_tree (void)
+{
+  GtkWidget *tree, *row;
+  int i, j;
+
+  tree = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  g_object_ref_sink (tree);
+
+  for (i = 0; i < N_ROWS; i++)
+    {
+      row = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+      gtk_style_context_add_class (gtk_widget_get_style_context (row), i % 2 ? "odd" : "even");
+      if (i % 5 == 0)
+        gtk_style_context_add_class (gtk_widget_get_style_context (row), "deep");
+      gtk_container_add (GTK_CONTAINER (tree), row);
+
+      for (j = 0; j < N_LABELS; j++)
+        gtk_container_add (GTK_CONTAINER (row), gtk_label_new ("Label"));
+    }
+
+  return tree;
+}
+
+static char *
+restyle (GtkWidget *tree,
+         guint      n_threads)
+{
+  gtk_css_prefetch_set_n_threads (n_threads);
+
+  gtk_widget_reset_style (tree);
+  gtk_css_node_validate (gtk_widget_get_css_node (tree));
+
+  return gtk_style_context_to_string (gtk_widget_get_style_context (tree),
+                                      GTK_STYLE_CONTEXT_PRINT_RECURSE |
+                                      GTK_STYLE_CONTEXT_PRINT_SHOW_STYLE);
+}
+
+static void
+test_prefetch_same_styles (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *tree;
+  char *serial, *parallel;
+  guint prefetched1, prefetched2, used1, used2;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css, -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  tree = create_tree ();
+
+  serial = restyle (tree, 1);
+  gtk_css_prefetch_get_stats (&prefetched1, &used1);
+
+  parallel = restyle (tree, 4);
+  gtk_css_prefetch_get_stats (&prefetched2, &used2);
+
+  /* Styles were looked up in threads and used */
+  g_assert_cmpuint (prefetched2, >, prefetched1);
+  g_assert_cmpuint (used2, >, used1);
+
+  g_assert_cmpstr (serial, ==, parallel);
+
+  gtk_css_prefetch_set_n_threads (0);
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+  g_object_unref (tree);
+  g_free (serial);
+  g_free (parallel);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/style/prefetch/same-styles", test_prefetch_same_styles);
+
+  return g_test_run ();
+}
@@ -1362,6 +1362,176 @@ check_buffer_contents (GtkTextBuffer *buffer,
   g_assert_cmpstr (buffer_contents, ==, contents);
 }
 
+/* Many lines, some with \r\n, and one long line with multibyte
+ * characters, so the text gets loaded in several chunks */
+static char *
+create_load_text (int n_lines)
+{
+  GString *str;
+  int i;
+
+  str = g_string_new (NULL);
+  for (i = 0; i < n_lines; i++)
+    g_string_append_printf (str, i % 3 ? "line %d\n" : "line %d\r\n", i);
+  for (i = 0; i < 700000; i++)
+    g_string_append (str, "ä");
+  g_string_append (str, "\r\nlast line");
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+check_loaded (GtkTextBuffer *buffer,
+              const char    *text,
+              int            n_lines)
+{
+  GtkTextIter iter;
+
+  check_buffer_contents (buffer, text);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, n_lines + 2);
+  g_assert_cmpint (gtk_text_buffer_get_char_count (buffer), ==, g_utf8_strlen (text, -1));
+  g_assert_false (gtk_text_buffer_get_modified (buffer));
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &iter, gtk_text_buffer_get_insert (buffer));
+  g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, 0);
+}
+
+static void
+test_load_bytes (void)
+{
+  GtkTextBuffer *buffer;
+  GError *error = NULL;
+  GBytes *bytes;
+  char *text;
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, "old contents", -1);
+
+  text = create_load_text (100000);
+  bytes = g_bytes_new_take (text, strlen (text));
+  g_assert_true (gtk_text_buffer_load_bytes (buffer, bytes, &error));
+  g_assert_no_error (error);
+  check_loaded (buffer, text, 100000);
+  g_bytes_unref (bytes);
+
+  /* Invalid text leaves the buffer alone */
+  bytes = g_bytes_new_static ("abc\xff\n", 5);
+  g_assert_false (gtk_text_buffer_load_bytes (buffer, bytes, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_clear_error (&error);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 100002);
+  g_bytes_unref (bytes);
+
+  g_object_unref (buffer);
+}
+
+static void
+load_stream_done (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      data)
+{
+  GError **error = data;
+
+  g_assert_false (gtk_text_buffer_load_stream_finish (GTK_TEXT_BUFFER (source), result, error));
+  g_assert_nonnull (*error);
+  g_main_context_wakeup (NULL);
+}
+
+static void
+load_stream_progress (goffset  current_num_bytes,
+                      goffset  total_num_bytes,
+                      gpointer data)
+{
+  goffset *progress = data;
+
+  g_assert_cmpint (current_num_bytes, >=, *progress);
+  g_assert_cmpint (total_num_bytes, ==, -1);
+  *progress = current_num_bytes;
+}
+
+static void
+load_stream_ok (GObject      *source,
+                GAsyncResult *result,
+                gpointer      data)
+{
+  gboolean *done = data;
+  GError *error = NULL;
+
+  g_assert_true (gtk_text_buffer_load_stream_finish (GTK_TEXT_BUFFER (source), result, &error));
+  g_assert_no_error (error);
+  *done = TRUE;
+  g_main_context_wakeup (NULL);
+}
+
+static void
+test_load_stream (void)
+{
+  GtkTextBuffer *buffer;
+  GInputStream *stream;
+  GError *error = NULL;
+  gboolean done = FALSE;
+  goffset progress = 0;
+  char *text;
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, "old contents", -1);
+
+  text = create_load_text (100000);
+  stream = g_memory_input_stream_new_from_data (text, strlen (text), g_free);
+  gtk_text_buffer_load_stream_async (buffer, stream, G_PRIORITY_DEFAULT, NULL,
+                                     load_stream_progress, &progress,
+                                     load_stream_ok, &done);
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpint (progress, ==, strlen (text));
+  check_loaded (buffer, text, 100000);
+  g_object_unref (stream);
+
+  /* Invalid text stops loading */
+  stream = g_memory_input_stream_new_from_data ("abc\ndef\xff\n", 9, NULL);
+  gtk_text_buffer_load_stream_async (buffer, stream, G_PRIORITY_DEFAULT, NULL,
+                                     NULL, NULL,
+                                     load_stream_done, &error);
+  while (error == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_clear_error (&error);
+  check_buffer_contents (buffer, "");
+  g_object_unref (stream);
+
+  g_object_unref (buffer);
+}
+
+static void
+test_insert_many_lines (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GString *str;
+  int i;
+
+  buffer = gtk_text_buffer_new (NULL);
+  fill_buffer (buffer);
+
+  /* Enough lines to get put into new nodes, in the middle of tagged text */
+  str = g_string_new (NULL);
+  for (i = 0; i < 1000; i++)
+    g_string_append_printf (str, "inserted line %d\n", i);
+
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &iter, 3, 2);
+  gtk_text_buffer_insert (buffer, &iter, str->str, str->len);
+  g_assert_cmpint (gtk_text_iter_get_line (&iter), ==, 1003);
+  g_assert_cmpint (gtk_text_iter_get_line_offset (&iter), ==, 0);
+
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  gtk_text_buffer_insert (buffer, &iter, str->str, str->len);
+
+  run_tests (buffer);
+
+  g_string_free (str, TRUE);
+  g_object_unref (buffer);
+}
+
 static void
 wait_for_changed (GtkTextBuffer *buffer)
 {
@@ -1580,6 +1750,135 @@ test_get_iter (void)
   g_object_unref (buffer);
 }
 
+static GArray *
+get_toggles (GtkTextBuffer *buffer,
+             GtkTextTag    *tag)
+{
+  GArray *toggles;
+  GtkTextIter iter;
+  int offset;
+
+  toggles = g_array_new (FALSE, FALSE, sizeof (int));
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  while (gtk_text_iter_forward_to_tag_toggle (&iter, tag))
+    {
+      offset = gtk_text_iter_get_offset (&iter);
+      g_array_append_val (toggles, offset);
+    }
+
+  return toggles;
+}
+
+static void
+apply_tag_count (GtkTextBuffer     *buffer,
+                 GtkTextTag        *tag,
+                 const GtkTextIter *start,
+                 const GtkTextIter *end,
+                 gpointer           data)
+{
+  (*(int *) data)++;
+}
+
+static void
+test_apply_tag_ranges (void)
+{
+  GtkTextBuffer *buffer, *expected;
+  GtkTextTagTable *table;
+  GtkTextTag *tags[3];
+  GtkTextTagRange *ranges;
+  GtkTextIter start, end;
+  GArray *toggles, *expected_toggles;
+  GString *text;
+  GRand *rand;
+  int i, j, n_chars, n_ranges, n_applied;
+
+  table = gtk_text_tag_table_new ();
+  tags[0] = g_object_new (GTK_TYPE_TEXT_TAG, "weight", PANGO_WEIGHT_BOLD, NULL);
+  tags[1] = g_object_new (GTK_TYPE_TEXT_TAG, "foreground", "blue", NULL);
+  tags[2] = g_object_new (GTK_TYPE_TEXT_TAG, NULL);
+  for (i = 0; i < G_N_ELEMENTS (tags); i++)
+    {
+      gtk_text_tag_table_add (table, tags[i]);
+      g_object_unref (tags[i]);
+    }
+
+  text = g_string_new (NULL);
+  for (i = 0; i < 2000; i++)
+    g_string_append_printf (text, "line %d with some wörds\n", i);
+
+  buffer = gtk_text_buffer_new (table);
+  expected = gtk_text_buffer_new (table);
+  gtk_text_buffer_set_text (buffer, text->str, -1);
+  gtk_text_buffer_set_text (expected, text->str, -1);
+  n_chars = gtk_text_buffer_get_char_count (buffer);
+
+  rand = g_rand_new_with_seed (42);
+
+  /* Some tags that are already there */
+  for (i = 0; i < 500; i++)
+    {
+      GtkTextTag *tag = tags[g_rand_int_range (rand, 0, 3)];
+      int offset = g_rand_int_range (rand, 0, n_chars);
+      int length = g_rand_int_range (rand, 1, 50);
+
+      gtk_text_buffer_get_iter_at_offset (buffer, &start, offset);
+      gtk_text_buffer_get_iter_at_offset (buffer, &end, offset + length);
+      gtk_text_buffer_apply_tag (buffer, tag, &start, &end);
+      gtk_text_buffer_get_iter_at_offset (expected, &start, offset);
+      gtk_text_buffer_get_iter_at_offset (expected, &end, offset + length);
+      gtk_text_buffer_apply_tag (expected, tag, &start, &end);
+    }
+
+  /* Sorted ranges like a highlighter produces them, then unsorted
+   * and overlapping ones */
+  n_ranges = 5000;
+  ranges = g_new (GtkTextTagRange, n_ranges);
+  for (j = 0; j < 2; j++)
+    {
+      for (i = 0; i < n_ranges; i++)
+        {
+          ranges[i].tag = tags[g_rand_int_range (rand, 0, 2)];
+          if (j == 0)
+            ranges[i].start = (gint64) i * n_chars / n_ranges;
+          else
+            ranges[i].start = g_rand_int_range (rand, 0, n_chars);
+          ranges[i].end = ranges[i].start + g_rand_int_range (rand, 0, 40);
+        }
+
+      gtk_text_buffer_apply_tag_ranges (buffer, ranges, n_ranges);
+
+      for (i = 0; i < n_ranges; i++)
+        {
+          gtk_text_buffer_get_iter_at_offset (expected, &start, ranges[i].start);
+          gtk_text_buffer_get_iter_at_offset (expected, &end, ranges[i].end);
+          gtk_text_buffer_apply_tag (expected, ranges[i].tag, &start, &end);
+        }
+
+      for (i = 0; i < G_N_ELEMENTS (tags); i++)
+        {
+          toggles = get_toggles (buffer, tags[i]);
+          expected_toggles = get_toggles (expected, tags[i]);
+          g_assert_cmpint (toggles->len, ==, expected_toggles->len);
+          g_assert (memcmp (toggles->data, expected_toggles->data, toggles->len * sizeof (int)) == 0);
+          g_array_unref (toggles);
+          g_array_unref (expected_toggles);
+        }
+    }
+
+  /* The apply-tag signal is still emitted if somebody listens */
+  n_applied = 0;
+  g_signal_connect (buffer, "apply-tag", G_CALLBACK (apply_tag_count), &n_applied);
+  gtk_text_buffer_apply_tag_ranges (buffer, ranges, 10);
+  g_assert_cmpint (n_applied, ==, 10);
+
+  g_free (ranges);
+  g_rand_free (rand);
+  g_string_free (text, TRUE);
+  g_object_unref (buffer);
+  g_object_unref (expected);
+  g_object_unref (table);
+}
+
 int
 main (int argc, char** argv)
 {
@@ -1599,6 +1898,10 @@ main (int argc, char** argv)
   g_test_add_func ("/TextBuffer/Tag", test_tag);
   g_test_add_func ("/TextBuffer/Clipboard", test_clipboard);
   g_test_add_func ("/TextBuffer/Get iter", test_get_iter);
+  g_test_add_func ("/TextBuffer/Insert many lines", test_insert_many_lines);
+  g_test_add_func ("/TextBuffer/Load bytes", test_load_bytes);
+  g_test_add_func ("/TextBuffer/Load stream", test_load_stream);
+  g_test_add_func ("/TextBuffer/Apply tag ranges", test_apply_tag_ranges);
 
   return g_test_run();
 }
@@ -279,6 +279,105 @@ test_search_caseless (void)
   check_found_backward ("aa \303\200", "aa", flags, 0, 2, "aa");
 }
 
+/* Compares gtk_text_iter_forward_search_all() with repeated
+ * gtk_text_iter_forward_search(), in one go and in small steps */
+static void
+check_search_all (GtkTextBuffer      *buffer,
+                  const gchar        *needle,
+                  GtkTextSearchFlags  flags)
+{
+  GArray *expected, *matches;
+  GtkTextIter i, s, e, end;
+  guint offset;
+  gint max_chars;
+
+  expected = g_array_new (FALSE, FALSE, sizeof (guint));
+  gtk_text_buffer_get_start_iter (buffer, &i);
+  while (gtk_text_iter_forward_search (&i, needle, flags, &s, &e, NULL))
+    {
+      offset = gtk_text_iter_get_offset (&s);
+      g_array_append_val (expected, offset);
+      offset = gtk_text_iter_get_offset (&e);
+      g_array_append_val (expected, offset);
+      i = e;
+    }
+
+  gtk_text_buffer_get_end_iter (buffer, &end);
+
+  for (max_chars = 0; max_chars < 3; max_chars++)
+    {
+      matches = g_array_new (FALSE, FALSE, sizeof (guint));
+      gtk_text_buffer_get_start_iter (buffer, &i);
+      while (gtk_text_iter_forward_search_all (&i, needle, flags, NULL, max_chars, matches))
+        g_assert (max_chars > 0);
+      g_assert (gtk_text_iter_equal (&i, &end));
+
+      g_assert_cmpuint (matches->len, ==, expected->len);
+      g_assert (memcmp (matches->data, expected->data, expected->len * sizeof (guint)) == 0);
+      g_array_unref (matches);
+    }
+
+  g_array_unref (expected);
+}
+
+static void
+test_search_all (void)
+{
+  const char *needles[] = {
+    "foo", "Foo", "oo", "o", "foo foo", "foo\nfoo", "o\n", "\303\240", "a\314\200", "x"
+  };
+  const GtkTextSearchFlags flags[] = {
+    0,
+    GTK_TEXT_SEARCH_CASE_INSENSITIVE,
+    GTK_TEXT_SEARCH_TEXT_ONLY,
+    GTK_TEXT_SEARCH_VISIBLE_ONLY | GTK_TEXT_SEARCH_CASE_INSENSITIVE
+  };
+  GtkTextBuffer *buffer;
+  GtkTextIter start, end;
+  GArray *matches;
+  guint i, j;
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer,
+                            "This is some foo foo text\n"
+                            "Foo fOO foofoo\n"
+                            "foo\nfoo\n"
+                            "\303\200 \303\240 foo\r\n"
+                            "foo",
+                            -1);
+
+  /* split a line into several segments */
+  gtk_text_buffer_get_iter_at_offset (buffer, &start, 14);
+  gtk_text_buffer_get_iter_at_offset (buffer, &end, 30);
+  gtk_text_buffer_apply_tag (buffer,
+                             gtk_text_buffer_create_tag (buffer, NULL, "weight", PANGO_WEIGHT_BOLD, NULL),
+                             &start, &end);
+  gtk_text_buffer_get_iter_at_offset (buffer, &start, 5);
+  gtk_text_buffer_create_child_anchor (buffer, &start);
+
+  for (i = 0; i < G_N_ELEMENTS (needles); i++)
+    for (j = 0; j < G_N_ELEMENTS (flags); j++)
+      check_search_all (buffer, needles[i], flags[j]);
+
+  /* the empty string matches nothing */
+  matches = g_array_new (FALSE, FALSE, sizeof (guint));
+  gtk_text_buffer_get_start_iter (buffer, &start);
+  g_assert (!gtk_text_iter_forward_search_all (&start, "", 0, NULL, 0, matches));
+  g_assert_cmpuint (matches->len, ==, 0);
+
+  /* matches must end before the limit */
+  gtk_text_buffer_get_start_iter (buffer, &start);
+  gtk_text_buffer_get_iter_at_offset (buffer, &end, 20);
+  g_assert (!gtk_text_iter_forward_search_all (&start, "foo", 0, &end, 0, matches));
+  g_assert (gtk_text_iter_equal (&start, &end));
+  g_assert_cmpuint (matches->len, ==, 2);
+  g_assert_cmpuint (g_array_index (matches, guint, 0), ==, 14);
+  g_assert_cmpuint (g_array_index (matches, guint, 1), ==, 17);
+  g_array_unref (matches);
+
+  g_object_unref (buffer);
+}
+
 static void
 test_forward_to_tag_toggle (void)
 {
@@ -789,6 +888,7 @@ main (int argc, char** argv)
   g_test_add_func ("/TextIter/Search Full Buffer", test_search_full_buffer);
   g_test_add_func ("/TextIter/Search", test_search);
   g_test_add_func ("/TextIter/Search Caseless", test_search_caseless);
+  g_test_add_func ("/TextIter/Search All", test_search_all);
   g_test_add_func ("/TextIter/Forward To Tag Toggle", test_forward_to_tag_toggle);
   g_test_add_func ("/TextIter/Forward To Line End", test_forward_to_line_end);
   g_test_add_func ("/TextIter/Word Boundaries", test_word_boundaries);
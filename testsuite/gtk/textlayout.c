@@ -0,0 +1,409 @@
+/* Copyright (C) 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+#include "gtk/gtktextdisplayprivate.h"
+#include "gtk/gtktextlayoutprivate.h"
+
+#include <pango/pangocairo.h>
+
+#define N_LINES 200
+
+static GtkWidget *
+create_text_view (GtkWidget **window)
+{
+  GtkWidget *sw, *text_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  int i;
+
+  *window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_default_size (GTK_WINDOW (*window), 400, 300);
+
+  sw = gtk_scrolled_window_new (NULL, NULL);
+  gtk_container_add (GTK_CONTAINER (*window), sw);
+
+  text_view = gtk_text_view_new ();
+  gtk_container_add (GTK_CONTAINER (sw), text_view);
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (text_view));
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  for (i = 0; i < N_LINES; i++)
+    gtk_text_buffer_insert (buffer, &iter, "The quick brown fox jumps over the lazy dog\n", -1);
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  gtk_text_buffer_place_cursor (buffer, &iter);
+
+  gtk_widget_show (*window);
+  gtk_test_widget_wait_for_draw (*window);
+  gtk_test_widget_wait_for_draw (*window);
+
+  return text_view;
+}
+
+static guint
+count_rendered (GtkWidget *window)
+{
+  guint before, after;
+
+  gtk_text_layout_get_render_stats (&before);
+  gtk_test_widget_wait_for_draw (window);
+  gtk_text_layout_get_render_stats (&after);
+
+  return after - before;
+}
+
+/* Render nodes of paragraphs are reused as long as nothing they
+ * depend on changed. Edits, tag changes and selection changes
+ * must re-render the affected paragraphs, but only those.
+ */
+static void
+test_render_node_reuse (void)
+{
+  GtkWidget *window, *text_view;
+  GtkTextBuffer *buffer;
+  GtkTextTag *tag;
+  GtkTextIter start, end;
+  GtkAdjustment *vadjustment;
+  double line_height;
+  guint rendered;
+
+  text_view = create_text_view (&window);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (text_view));
+  vadjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (text_view));
+  line_height = gtk_adjustment_get_upper (vadjustment) / (N_LINES + 1);
+
+  /* An edit away from the cursor */
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &start, 3, 4);
+  gtk_text_buffer_insert (buffer, &start, "very ", -1);
+  rendered = count_rendered (window);
+  g_assert_cmpuint (rendered, >=, 1);
+  g_assert_cmpuint (rendered, <=, 2);
+
+  /* A tag change */
+  tag = gtk_text_buffer_create_tag (buffer, NULL, "weight", PANGO_WEIGHT_BOLD, NULL);
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &start, 5, 4);
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &end, 5, 9);
+  gtk_text_buffer_apply_tag (buffer, tag, &start, &end);
+  rendered = count_rendered (window);
+  g_assert_cmpuint (rendered, >=, 1);
+  g_assert_cmpuint (rendered, <=, 2);
+
+  /* A selection change, which also moves the cursor off line 0 */
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &start, 7, 4);
+  gtk_text_buffer_get_iter_at_line_offset (buffer, &end, 7, 9);
+  gtk_text_buffer_select_range (buffer, &start, &end);
+  rendered = count_rendered (window);
+  g_assert_cmpuint (rendered, >=, 1);
+  g_assert_cmpuint (rendered, <=, 3);
+
+  /* Scrolling down only renders the lines that come into view,
+   * and scrolling back renders nothing.
+   */
+  gtk_adjustment_set_value (vadjustment, 2 * line_height);
+  rendered = count_rendered (window);
+  g_assert_cmpuint (rendered, <=, 3);
+
+  gtk_adjustment_set_value (vadjustment, 0);
+  rendered = count_rendered (window);
+  g_assert_cmpuint (rendered, ==, 0);
+
+  gtk_widget_destroy (window);
+}
+
+static GtkTextLayout *
+create_layout (GtkTextBuffer *buffer)
+{
+  GtkTextLayout *layout;
+  GtkTextAttributes *values;
+  PangoContext *ltr_context, *rtl_context;
+
+  layout = gtk_text_layout_new ();
+  gtk_text_layout_set_buffer (layout, buffer);
+
+  ltr_context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+  pango_context_set_base_dir (ltr_context, PANGO_DIRECTION_LTR);
+  rtl_context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+  pango_context_set_base_dir (rtl_context, PANGO_DIRECTION_RTL);
+  gtk_text_layout_set_contexts (layout, ltr_context, rtl_context);
+  g_object_unref (ltr_context);
+  g_object_unref (rtl_context);
+
+  values = gtk_text_attributes_new ();
+  values->font = pango_font_description_from_string ("Sans 11");
+  values->wrap_mode = GTK_WRAP_WORD;
+  gtk_text_layout_set_default_style (layout, values);
+  gtk_text_attributes_unref (values);
+
+  gtk_text_layout_set_screen_width (layout, 300);
+
+  return layout;
+}
+
+static void
+fill_buffer (GtkTextBuffer *buffer)
+{
+  GtkTextTag *bold, *big, *rtl, *spaced;
+  GtkTextIter iter;
+  int i;
+
+  bold = gtk_text_buffer_create_tag (buffer, "bold", "weight", PANGO_WEIGHT_BOLD, NULL);
+  big = gtk_text_buffer_create_tag (buffer, "big", "scale", 1.5, NULL);
+  rtl = gtk_text_buffer_create_tag (buffer, "rtl", "direction", GTK_TEXT_DIR_RTL, NULL);
+  spaced = gtk_text_buffer_create_tag (buffer, "spaced",
+                                       "pixels-above-lines", 3,
+                                       "left-margin", 20,
+                                       "wrap-mode", GTK_WRAP_CHAR,
+                                       NULL);
+
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  for (i = 0; i < 1000; i++)
+    {
+      switch (i % 5)
+        {
+        case 0:
+          gtk_text_buffer_insert (buffer, &iter,
+                                  "The quick brown fox jumps over the lazy dog, "
+                                  "and then some more text to make it wrap.\n", -1);
+          break;
+        case 1:
+          gtk_text_buffer_insert_with_tags (buffer, &iter, "Bold text that is long enough to wrap "
+                                            "over a couple of lines at this width.\n", -1,
+                                            bold, NULL);
+          break;
+        case 2:
+          gtk_text_buffer_insert_with_tags (buffer, &iter, "Big text\n", -1, big, NULL);
+          break;
+        case 3:
+          gtk_text_buffer_insert_with_tags (buffer, &iter,
+                                            "\327\251\327\234\327\225\327\235 "
+                                            "\327\242\327\225\327\234\327\235 "
+                                            "and some Latin text in a right-to-left paragraph\n", -1,
+                                            rtl, NULL);
+          break;
+        default:
+          gtk_text_buffer_insert_with_tags (buffer, &iter,
+                                            "Averyveryverylongwordthatonlywrapsbetweencharacters\n", -1,
+                                            spaced, NULL);
+          break;
+        }
+    }
+}
+
+/* Measuring lines in threads must give the same result as measuring
+ * them on the main thread, also if lines change while the jobs run.
+ */
+static void
+test_validate_in_thread (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextLayout *sync_layout, *thread_layout;
+  GtkTextIter iter, end;
+  int width1, height1, top_ink1, bottom_ink1;
+  int width2, height2, top_ink2, bottom_ink2;
+
+  buffer = gtk_text_buffer_new (NULL);
+  fill_buffer (buffer);
+
+  thread_layout = create_layout (buffer);
+  if (!gtk_text_layout_validate_in_thread (thread_layout))
+    {
+      g_test_skip ("Text layouts are not validated in threads");
+      g_object_unref (thread_layout);
+      g_object_unref (buffer);
+      return;
+    }
+
+  /* Change a few lines while jobs are running */
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 10);
+  gtk_text_buffer_insert (buffer, &iter, "Inserted text, ", -1);
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 51);
+  gtk_text_buffer_get_iter_at_line (buffer, &end, 53);
+  gtk_text_buffer_apply_tag_by_name (buffer, "big", &iter, &end);
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 120);
+  gtk_text_buffer_get_iter_at_line (buffer, &end, 122);
+  gtk_text_buffer_delete (buffer, &iter, &end);
+
+  while (!gtk_text_layout_is_valid (thread_layout))
+    g_main_context_iteration (NULL, TRUE);
+
+  sync_layout = create_layout (buffer);
+  gtk_text_layout_validate (sync_layout, G_MAXINT);
+  g_assert_true (gtk_text_layout_is_valid (sync_layout));
+
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  do
+    {
+      g_assert_true (gtk_text_layout_get_line_metrics (sync_layout, &iter,
+                                                       &width1, &height1,
+                                                       &top_ink1, &bottom_ink1));
+      g_assert_true (gtk_text_layout_get_line_metrics (thread_layout, &iter,
+                                                       &width2, &height2,
+                                                       &top_ink2, &bottom_ink2));
+      g_assert_cmpint (width1, ==, width2);
+      g_assert_cmpint (height1, ==, height2);
+      g_assert_cmpint (top_ink1, ==, top_ink2);
+      g_assert_cmpint (bottom_ink1, ==, bottom_ink2);
+    }
+  while (gtk_text_iter_forward_line (&iter));
+
+  g_object_unref (sync_layout);
+  g_object_unref (thread_layout);
+  g_object_unref (buffer);
+}
+
+#define CHUNK_SIZE (16 * 1024)
+
+static GtkTextBuffer *
+create_long_paragraph (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GString *text;
+
+  text = g_string_new ("First line\n");
+  while (text->len < 100 * 1024)
+    g_string_append (text, "abcdefghij ");
+  g_string_append (text, "\nLast line\n");
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, text->str, text->len);
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  gtk_text_buffer_place_cursor (buffer, &iter);
+
+  g_string_free (text, TRUE);
+
+  return buffer;
+}
+
+/* Paragraphs of more than 64 KiB are laid out in chunks of about
+ * 16 KiB. Positions must map to the same iters across chunks.
+ */
+static void
+test_long_paragraph_positions (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextLayout *layout;
+  GtkTextIter iter, found;
+  GdkRectangle rect;
+  int paragraph_start, offset, trailing;
+  int k;
+
+  buffer = create_long_paragraph ();
+  layout = create_layout (buffer);
+  gtk_text_layout_validate (layout, G_MAXINT);
+
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 1);
+  paragraph_start = gtk_text_iter_get_offset (&iter);
+
+  for (k = 1; k <= 5; k++)
+    {
+      for (offset = k * CHUNK_SIZE - 64; offset < k * CHUNK_SIZE + 64; offset++)
+        {
+          gtk_text_buffer_get_iter_at_offset (buffer, &iter, paragraph_start + offset);
+          gtk_text_layout_get_iter_location (layout, &iter, &rect);
+          gtk_text_layout_get_iter_at_position (layout, &found, &trailing,
+                                                rect.x, rect.y + rect.height / 2);
+
+          g_assert_cmpint (gtk_text_iter_get_offset (&found) + trailing, ==,
+                           gtk_text_iter_get_offset (&iter));
+        }
+    }
+
+  /* Shaping chunks keeps their sizes, editing drops them */
+  g_assert_true (gtk_text_layout_has_chunk_sizes (layout, &iter));
+  gtk_text_buffer_insert (buffer, &iter, "x", 1);
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 1);
+  g_assert_false (gtk_text_layout_has_chunk_sizes (layout, &iter));
+
+  g_object_unref (layout);
+  g_object_unref (buffer);
+}
+
+/* Moving by display lines must cross chunk boundaries, and give
+ * the same lines in both directions.
+ */
+static void
+test_long_paragraph_lines (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextLayout *layout;
+  GtkTextIter iter, end;
+  GArray *forward, *backward;
+  GdkRectangle rect;
+  int offset, last_y;
+  guint i;
+
+  buffer = create_long_paragraph ();
+  layout = create_layout (buffer);
+  gtk_text_layout_validate (layout, G_MAXINT);
+
+  forward = g_array_new (FALSE, FALSE, sizeof (int));
+  backward = g_array_new (FALSE, FALSE, sizeof (int));
+
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, 1);
+  gtk_text_buffer_get_iter_at_line (buffer, &end, 2);
+
+  last_y = -1;
+  do
+    {
+      gtk_text_layout_get_iter_location (layout, &iter, &rect);
+      g_assert_cmpint (rect.y, >, last_y);
+      last_y = rect.y;
+
+      offset = gtk_text_iter_get_offset (&iter);
+      g_array_append_val (forward, offset);
+    }
+  while (gtk_text_layout_move_iter_to_next_line (layout, &iter) &&
+         gtk_text_iter_compare (&iter, &end) < 0);
+
+  /* Each chunk starts on a new line */
+  g_assert_cmpuint (forward->len, >, 100 * 1024 / CHUNK_SIZE);
+
+  iter = end;
+  while (gtk_text_layout_move_iter_to_previous_line (layout, &iter))
+    {
+      offset = gtk_text_iter_get_offset (&iter);
+      g_array_append_val (backward, offset);
+
+      if (gtk_text_iter_get_line (&iter) < 1 ||
+          gtk_text_iter_starts_line (&iter))
+        break;
+    }
+
+  g_assert_cmpuint (forward->len, ==, backward->len);
+  for (i = 0; i < forward->len; i++)
+    g_assert_cmpint (g_array_index (forward, int, i), ==,
+                     g_array_index (backward, int, backward->len - 1 - i));
+
+  g_array_unref (forward);
+  g_array_unref (backward);
+  g_object_unref (layout);
+  g_object_unref (buffer);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/textlayout/render-node-reuse", test_render_node_reuse);
+  g_test_add_func ("/textlayout/validate-in-thread", test_validate_in_thread);
+  g_test_add_func ("/textlayout/long-paragraph/positions", test_long_paragraph_positions);
+  g_test_add_func ("/textlayout/long-paragraph/lines", test_long_paragraph_lines);
+
+  return g_test_run ();
+}
@@ -249,6 +249,130 @@ test_remove_some (void)
   g_object_unref (tree);
 }
 
+static void
+add_changes (GtkTreeListModel *tree)
+{
+  GString *changes;
+
+  changes = g_string_new ("");
+  g_object_set_qdata_full (G_OBJECT(tree), changes_quark, changes, free_changes);
+  g_signal_connect (tree, "items-changed", G_CALLBACK (items_changed), changes);
+}
+
+static void
+run_main_loop (void)
+{
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+}
+
+static GListModel *
+create_sub_model_counted_cb (gpointer item,
+                             gpointer data)
+{
+  guint *n_created = data;
+
+  (*n_created)++;
+
+  if (G_IS_LIST_MODEL (item))
+    return g_object_ref (item);
+
+  return NULL;
+}
+
+static void
+test_autoexpand_depth (void)
+{
+  GtkTreeListModel *tree;
+  GtkTreeListRow *row;
+  GListStore *store;
+  guint n_created;
+
+  n_created = 0;
+  store = new_store (100, 100, 100);
+  tree = gtk_tree_list_model_new (TRUE, G_LIST_MODEL (store), FALSE, create_sub_model_counted_cb, &n_created, NULL);
+  g_object_unref (store);
+  add_changes (tree);
+  gtk_tree_list_model_set_autoexpand_depth (tree, 1);
+  gtk_tree_list_model_set_autoexpand (tree, TRUE);
+
+  /* only the row at depth 0 is expanded */
+  row = gtk_tree_list_model_get_row (tree, 0);
+  gtk_tree_list_row_set_expanded (row, TRUE);
+  assert_model (tree, "100 100 90 80 70 60 50 40 30 20 10");
+  assert_changes (tree, "1+10");
+  g_assert_cmpuint (n_created, ==, 1);
+
+  gtk_tree_list_row_set_expanded (row, FALSE);
+  assert_model (tree, "100");
+  assert_changes (tree, "1-10");
+
+  /* now rows at depth 1 are expanded, too */
+  gtk_tree_list_model_set_autoexpand_depth (tree, 2);
+  gtk_tree_list_row_set_expanded (row, TRUE);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (tree)), ==, 111);
+  assert_changes (tree, "1+110");
+  g_assert_cmpuint (n_created, ==, 12);
+  g_object_unref (row);
+
+  g_object_unref (tree);
+}
+
+static void
+test_lazy (void)
+{
+  GtkTreeListModel *tree;
+  GtkTreeListRow *row;
+  GListStore *store;
+  guint i, n_created;
+
+  n_created = 0;
+  store = new_store (100, 100, 100);
+  tree = gtk_tree_list_model_new (TRUE, G_LIST_MODEL (store), FALSE, create_sub_model_counted_cb, &n_created, NULL);
+  g_object_unref (store);
+  gtk_tree_list_model_set_lazy (tree, TRUE);
+  gtk_tree_list_model_set_autoexpand (tree, TRUE);
+  add_changes (tree);
+
+  /* Nothing is created until rows are requested */
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (tree)), ==, 1);
+  assert_model (tree, "100");
+  g_assert_cmpuint (n_created, ==, 0);
+
+  run_main_loop ();
+  g_assert_cmpuint (n_created, ==, 1);
+  assert_changes (tree, "1+10");
+
+  /* Requesting rows again doesn't create anything */
+  assert_model (tree, "100 100 90 80 70 60 50 40 30 20 10");
+  assert_model (tree, "100 100 90 80 70 60 50 40 30 20 10");
+  g_assert_cmpuint (n_created, ==, 1);
+
+  run_main_loop ();
+  g_assert_cmpuint (n_created, ==, 11);
+  assert_changes (tree, "11+10, 10+10, 9+10, 8+10, 7+10, 6+10, 5+10, 4+10, 3+10, 2+10");
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (tree)), ==, 111);
+
+  /* Only the requested leaf rows are checked */
+  for (i = 0; i < 20; i++)
+    get (G_LIST_MODEL (tree), i);
+  run_main_loop ();
+  g_assert_cmpuint (n_created, ==, 28);
+  assert_changes (tree, "");
+
+  /* Collapsed rows are not expanded again */
+  row = gtk_tree_list_model_get_row (tree, 1);
+  gtk_tree_list_row_set_expanded (row, FALSE);
+  assert_changes (tree, "2-10");
+  get (G_LIST_MODEL (tree), 1);
+  run_main_loop ();
+  g_assert_false (gtk_tree_list_row_get_expanded (row));
+  assert_changes (tree, "");
+  g_object_unref (row);
+
+  g_object_unref (tree);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -261,6 +385,8 @@ main (int argc, char *argv[])
 
   g_test_add_func ("/treelistmodel/expand", test_expand);
   g_test_add_func ("/treelistmodel/remove_some", test_remove_some);
+  g_test_add_func ("/treelistmodel/autoexpand-depth", test_autoexpand_depth);
+  g_test_add_func ("/treelistmodel/lazy", test_lazy);
 
   return g_test_run ();
 }